@@ -0,0 +1,120 @@
+#ifndef UPQ_BENCHCOMMON_H
+#define UPQ_BENCHCOMMON_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace upq_bench {
+    struct BenchArgs {
+        std::string mode{"micro"};
+        std::string filter;  // substring match on benchmark / workload names
+
+        // micro
+        size_t iters{200000};
+        size_t rounds{5};
+
+        int threads{4};  // uvent threads: micro pool/notify cases, load
+
+        // load
+        std::string host{"localhost"};
+        std::string port{"12432"};  // examples/docker-compose.yaml
+        std::string user{"postgres"};
+        std::string db{"postgres"};
+        std::string password{"password"};
+        size_t connections{16};
+        size_t concurrency{64};
+        double seconds{5.0};
+        size_t pipeline_depth{16};
+        size_t copy_rows{1000};
+    };
+
+    [[nodiscard]] inline bool selected(const BenchArgs &a, std::string_view name) {
+        return a.filter.empty() || name.find(a.filter) != std::string_view::npos;
+    }
+
+    // Keeps the optimizer from dropping a computed value.
+    template<class T>
+    inline void keep(const T &v) noexcept {
+        asm volatile("" : : "g"(&v) : "memory");
+    }
+
+    inline void print_micro(std::string_view name, double ns) {
+        std::printf("%-44.*s %12.1f ns/op %14.0f op/s\n", static_cast<int>(name.size()), name.data(),
+                    ns, ns > 0 ? 1e9 / ns : 0.0);
+    }
+
+    // Best of `rounds` timings of `iters` calls to fn(i).
+    template<class F>
+    void run_micro(const BenchArgs &a, std::string_view name, F &&fn) {
+        if (!selected(a, name)) return;
+
+        for (size_t i = 0; i < a.iters / 10 + 1; ++i) fn(i);
+
+        double best = 0;
+        for (size_t r = 0; r < a.rounds; ++r) {
+            const auto t0 = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < a.iters; ++i) fn(i);
+            const auto t1 = std::chrono::steady_clock::now();
+            const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                              static_cast<double>(a.iters);
+            if (r == 0 || ns < best) best = ns;
+        }
+        print_micro(name, best);
+    }
+
+    // Per-worker samples; one writer each, merged after the run.
+    struct LatencySamples {
+        std::vector<uint64_t> ns;
+        uint64_t ops{0};
+        uint64_t errors{0};
+        std::string first_error;
+
+        void fail(std::string_view what) {
+            if (this->errors++ == 0) this->first_error = what;
+        }
+    };
+
+    inline void report_load(std::string_view name, std::vector<LatencySamples> &workers,
+                            std::chrono::steady_clock::duration elapsed) {
+        std::vector<uint64_t> all;
+        uint64_t ops = 0, errors = 0;
+        std::string first_error;
+        for (auto &w: workers) {
+            all.insert(all.end(), w.ns.begin(), w.ns.end());
+            ops += w.ops;
+            errors += w.errors;
+            if (first_error.empty()) first_error = w.first_error;
+        }
+        std::sort(all.begin(), all.end());
+
+        auto pct_us = [&](double q) -> double {
+            if (all.empty()) return 0;
+            const size_t i = std::min(all.size() - 1, static_cast<size_t>(q * static_cast<double>(all.size())));
+            return static_cast<double>(all[i]) / 1000.0;
+        };
+
+        const double secs = std::chrono::duration<double>(elapsed).count();
+        std::printf("%-12.*s %12.0f ops/s  p50 %9.1f us  p99 %9.1f us  p999 %9.1f us  (%llu ops, %llu errors)\n",
+                    static_cast<int>(name.size()), name.data(), secs > 0 ? static_cast<double>(ops) / secs : 0.0,
+                    pct_us(0.50), pct_us(0.99), pct_us(0.999),
+                    static_cast<unsigned long long>(ops), static_cast<unsigned long long>(errors));
+        if (!first_error.empty())
+            std::printf("%-12s first error: %s\n", "", first_error.c_str());
+        std::fflush(stdout);
+    }
+
+    int run_micro_suite(const BenchArgs &a);
+
+    // The micro cases that run PgPool / PgNotificationMultiplexer against a
+    // FakeServer; called at the end of run_micro_suite.
+    int run_server_micro_suite(const BenchArgs &a);
+
+    int run_load_suite(const BenchArgs &a);
+} // namespace upq_bench
+
+#endif // UPQ_BENCHCOMMON_H
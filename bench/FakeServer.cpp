@@ -0,0 +1,367 @@
+#include "FakeServer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <unordered_map>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace upq_bench {
+    namespace {
+        constexpr uint32_t ssl_request_code = 80877103;
+        constexpr uint32_t gssenc_request_code = 80877104;
+        constexpr int fake_backend_pid = 4242;
+
+        bool read_exact(int fd, void *dst, size_t n) {
+            auto *p = static_cast<char *>(dst);
+            while (n > 0) {
+                const ssize_t r = ::recv(fd, p, n, 0);
+                if (r <= 0) return false;
+                p += r;
+                n -= static_cast<size_t>(r);
+            }
+            return true;
+        }
+
+        bool write_all(int fd, const char *p, size_t n) {
+            while (n > 0) {
+                const ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+                if (w <= 0) return false;
+                p += w;
+                n -= static_cast<size_t>(w);
+            }
+            return true;
+        }
+
+        void put_u32(std::string &out, uint32_t v) {
+            const uint32_t be = htonl(v);
+            out.append(reinterpret_cast<const char *>(&be), 4);
+        }
+
+        void put_cstr(std::string &out, std::string_view s) {
+            out.append(s);
+            out.push_back('\0');
+        }
+
+        // Appends one backend message: type byte, length, body.
+        void put_msg(std::string &out, char type, std::string_view body) {
+            out.push_back(type);
+            put_u32(out, static_cast<uint32_t>(body.size() + 4));
+            out.append(body);
+        }
+
+        void put_status(std::string &out, std::string_view k, std::string_view v) {
+            std::string body;
+            put_cstr(body, k);
+            put_cstr(body, v);
+            put_msg(out, 'S', body);
+        }
+
+        void put_ready(std::string &out) { put_msg(out, 'Z', "I"); }
+
+        void put_complete(std::string &out, std::string_view tag) {
+            std::string body;
+            put_cstr(body, tag);
+            put_msg(out, 'C', body);
+        }
+
+        // Command tag for a simple query: its first word, except that
+        // SELECT and anything unknown report an empty SELECT.
+        std::string command_tag(std::string_view sql) {
+            const size_t b = sql.find_first_not_of(" \t\r\n");
+            if (b == std::string_view::npos) return "SELECT 0";
+            const size_t e = sql.find_first_of(" \t\r\n;", b);
+            std::string w(sql.substr(b, e == std::string_view::npos ? std::string_view::npos : e - b));
+            std::transform(w.begin(), w.end(), w.begin(), [](unsigned char c) { return std::toupper(c); });
+            if (w == "LISTEN" || w == "UNLISTEN" || w == "BEGIN" || w == "COMMIT" || w == "ROLLBACK" ||
+                w == "DEALLOCATE" || w == "SET" || w == "DISCARD")
+                return w;
+            return "SELECT 0";
+        }
+
+        void put_row_description(std::string &out, const std::vector<std::string> &columns) {
+            constexpr uint32_t text_oid = 25;
+            std::string body;
+            body.push_back(static_cast<char>(columns.size() >> 8));
+            body.push_back(static_cast<char>(columns.size() & 0xFF));
+            for (const auto &c: columns) {
+                put_cstr(body, c);
+                put_u32(body, 0);               // table oid
+                body.append("\0\0", 2);         // attnum
+                put_u32(body, text_oid);
+                body.append("\xFF\xFF", 2);     // typlen -1
+                put_u32(body, 0xFFFFFFFFu);     // typmod -1
+                body.append("\0\0", 2);         // text format
+            }
+            put_msg(out, 'T', body);
+        }
+
+        void put_data_rows(std::string &out, const std::vector<std::vector<std::string> > &rows) {
+            for (const auto &r: rows) {
+                std::string body;
+                body.push_back(static_cast<char>(r.size() >> 8));
+                body.push_back(static_cast<char>(r.size() & 0xFF));
+                for (const auto &v: r) {
+                    put_u32(body, static_cast<uint32_t>(v.size()));
+                    body.append(v);
+                }
+                put_msg(out, 'D', body);
+            }
+            put_complete(out, "SELECT " + std::to_string(rows.size()));
+        }
+
+        // Two NUL-terminated strings at the front of a Parse or Bind body.
+        std::pair<std::string, std::string> leading_cstrs(const std::string &body) {
+            const size_t a = body.find('\0');
+            if (a == std::string::npos) return {};
+            const size_t b = body.find('\0', a + 1);
+            if (b == std::string::npos) return {body.substr(0, a), {}};
+            return {body.substr(0, a), body.substr(a + 1, b - a - 1)};
+        }
+
+        // Channel named by LISTEN "x"; or empty for any other statement.
+        std::string listen_channel(std::string_view sql) {
+            if (command_tag(sql) != "LISTEN") return {};
+            std::string_view rest = sql.substr(sql.find_first_of(" \t\r\n"));
+            const size_t b = rest.find_first_not_of(" \t\r\n");
+            if (b == std::string_view::npos) return {};
+            rest = rest.substr(b);
+            while (!rest.empty() && (rest.back() == ';' || std::isspace(static_cast<unsigned char>(rest.back()))))
+                rest.remove_suffix(1);
+            if (rest.size() >= 2 && rest.front() == '"' && rest.back() == '"') rest = rest.substr(1, rest.size() - 2);
+            return std::string(rest);
+        }
+    } // namespace
+
+    FakeServer::FakeServer() {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return;
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, 128) != 0 ||
+            ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+            ::close(fd);
+            return;
+        }
+        this->listen_fd_ = fd;
+        this->port_ = ntohs(addr.sin_port);
+        this->acceptor_ = std::thread([this] { this->accept_loop(); });
+    }
+
+    FakeServer::~FakeServer() {
+        if (this->listen_fd_ >= 0) {
+            ::shutdown(this->listen_fd_, SHUT_RDWR);
+            ::close(this->listen_fd_);
+        }
+        if (this->acceptor_.joinable()) this->acceptor_.join();
+
+        std::lock_guard lk(this->mu_);
+        for (auto &s: this->sessions_) ::shutdown(s->fd, SHUT_RDWR);
+    }
+
+    size_t FakeServer::notify(std::string_view channel, std::string_view payload, size_t count) {
+        std::string msg;
+        {
+            std::string body;
+            put_u32(body, fake_backend_pid);
+            put_cstr(body, channel);
+            put_cstr(body, payload);
+            put_msg(msg, 'A', body);
+        }
+        // batch the messages so that one send() carries many of them
+        constexpr size_t per_send = 256;
+        std::string batch;
+        batch.reserve(msg.size() * per_send);
+        for (size_t i = 0; i < per_send; ++i) batch += msg;
+
+        std::vector<std::shared_ptr<Session> > targets;
+        {
+            std::lock_guard lk(this->mu_);
+            for (auto &s: this->sessions_) targets.push_back(s);
+        }
+        size_t reached = 0;
+        for (auto &s: targets) {
+            std::lock_guard lk(s->write_mu);
+            if (std::find(s->channels.begin(), s->channels.end(), channel) == s->channels.end()) continue;
+            ++reached;
+            for (size_t sent = 0; sent < count;) {
+                const size_t n = std::min(per_send, count - sent);
+                if (!write_all(s->fd, batch.data(), n * msg.size())) break;
+                sent += n;
+            }
+        }
+        return reached;
+    }
+
+    void FakeServer::answer(std::string sql_part, std::vector<std::string> columns,
+                            std::vector<std::vector<std::string> > rows) {
+        auto r = std::make_shared<const Rows>(Rows{std::move(columns), std::move(rows)});
+        std::lock_guard lk(this->mu_);
+        for (auto &a: this->answers_) {
+            if (a.first == sql_part) {
+                a.second = std::move(r);
+                return;
+            }
+        }
+        this->answers_.emplace_back(std::move(sql_part), std::move(r));
+    }
+
+    std::shared_ptr<const FakeServer::Rows> FakeServer::rows_for(std::string_view sql) {
+        std::lock_guard lk(this->mu_);
+        for (const auto &a: this->answers_)
+            if (sql.find(a.first) != std::string_view::npos) return a.second;
+        return nullptr;
+    }
+
+    void FakeServer::accept_loop() {
+        for (;;) {
+            const int fd = ::accept(this->listen_fd_, nullptr, nullptr);
+            if (fd < 0) return;
+            const int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            auto s = std::make_shared<Session>();
+            s->fd = fd;
+            {
+                std::lock_guard lk(this->mu_);
+                this->sessions_.push_back(s);
+            }
+            std::thread([this, s] { this->serve(s); }).detach();
+        }
+    }
+
+    void FakeServer::serve(std::shared_ptr<Session> s) {
+        const int fd = s->fd;
+        auto reply = [&](const std::string &out) {
+            std::lock_guard lk(s->write_mu);
+            return write_all(fd, out.data(), out.size());
+        };
+        auto finish = [&] {
+            {
+                std::lock_guard lk(this->mu_);
+                std::erase(this->sessions_, s);
+            }
+            ::close(fd);
+        };
+
+        // startup: refuse SSL / GSS encryption until a StartupMessage arrives
+        std::string body;
+        for (;;) {
+            uint32_t len_be = 0;
+            if (!read_exact(fd, &len_be, 4)) return finish();
+            const uint32_t len = ntohl(len_be);
+            if (len < 8 || len > (1u << 20)) return finish();
+            body.resize(len - 4);
+            if (!read_exact(fd, body.data(), body.size())) return finish();
+
+            uint32_t code_be = 0;
+            std::memcpy(&code_be, body.data(), 4);
+            const uint32_t code = ntohl(code_be);
+            if (code == ssl_request_code || code == gssenc_request_code) {
+                if (!write_all(fd, "N", 1)) return finish();
+                continue;
+            }
+            break;
+        }
+
+        std::string out;
+        {
+            std::string auth_ok;
+            put_u32(auth_ok, 0);
+            put_msg(out, 'R', auth_ok);
+        }
+        put_status(out, "server_version", "16.0");
+        put_status(out, "server_encoding", "UTF8");
+        put_status(out, "client_encoding", "UTF8");
+        put_status(out, "DateStyle", "ISO, MDY");
+        put_status(out, "integer_datetimes", "on");
+        put_status(out, "standard_conforming_strings", "on");
+        {
+            std::string key;
+            put_u32(key, fake_backend_pid);
+            put_u32(key, 1);
+            put_msg(out, 'K', key);
+        }
+        put_ready(out);
+        if (!reply(out)) return finish();
+
+        // extended protocol: statement name -> text, and what the unnamed
+        // portal runs
+        std::unordered_map<std::string, std::string> statements;
+        std::string portal_sql;
+
+        for (;;) {
+            char type = 0;
+            uint32_t len_be = 0;
+            if (!read_exact(fd, &type, 1) || !read_exact(fd, &len_be, 4)) return finish();
+            const uint32_t len = ntohl(len_be);
+            if (len < 4 || len > (64u << 20)) return finish();
+            body.resize(len - 4);
+            if (!read_exact(fd, body.data(), body.size())) return finish();
+
+            out.clear();
+            switch (type) {
+                case 'Q': {
+                    const std::string_view sql(body.data(), body.empty() ? 0 : body.size() - 1);
+                    if (auto ch = listen_channel(sql); !ch.empty()) {
+                        std::lock_guard lk(s->write_mu);
+                        s->channels.push_back(std::move(ch));
+                    }
+                    if (auto rows = this->rows_for(sql)) {
+                        put_row_description(out, rows->columns);
+                        put_data_rows(out, rows->rows);
+                    } else {
+                        put_complete(out, command_tag(sql));
+                    }
+                    put_ready(out);
+                    break;
+                }
+                case 'P': {
+                    auto [name, sql] = leading_cstrs(body);
+                    statements[name] = std::move(sql);
+                    put_msg(out, '1', {});
+                    break;
+                }
+                case 'B': {
+                    const auto [portal, stmt] = leading_cstrs(body);
+                    portal_sql = statements[stmt];
+                    put_msg(out, '2', {});
+                    break;
+                }
+                case 'D': {
+                    // a statement describes its (zero) parameters first
+                    const bool stmt = !body.empty() && body[0] == 'S';
+                    if (stmt) put_msg(out, 't', std::string_view("\0\0", 2));
+                    const std::string &sql = stmt ? statements[body.substr(1, body.find('\0', 1) - 1)] : portal_sql;
+                    if (auto rows = this->rows_for(sql)) put_row_description(out, rows->columns);
+                    else put_msg(out, 'n', {});
+                    break;
+                }
+                case 'E':
+                    if (auto rows = this->rows_for(portal_sql)) put_data_rows(out, rows->rows);
+                    else put_complete(out, "SELECT 0");
+                    break;
+                case 'C': put_msg(out, '3', {});
+                    break;
+                case 'S': put_ready(out);
+                    break;
+                case 'H':
+                    break;
+                case 'X':
+                    return finish();
+                default:
+                    return finish();
+            }
+            if (!out.empty() && !reply(out)) return finish();
+        }
+    }
+} // namespace upq_bench
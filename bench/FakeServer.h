@@ -0,0 +1,70 @@
+#ifndef UPQ_BENCH_FAKESERVER_H
+#define UPQ_BENCH_FAKESERVER_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace upq_bench {
+    // Just enough of a PostgreSQL backend on 127.0.0.1 for the micro suite and
+    // the tests to drive PgPool, PgNotificationMultiplexer and PgConnector
+    // without a server: trust auth, statements complete with no rows unless
+    // answer() says otherwise, and notify() pushes NotificationResponse
+    // messages to the sessions that ran LISTEN.
+    class FakeServer {
+    public:
+        FakeServer();
+
+        ~FakeServer();
+
+        FakeServer(const FakeServer &) = delete;
+
+        FakeServer &operator=(const FakeServer &) = delete;
+
+        [[nodiscard]] bool ok() const noexcept { return this->listen_fd_ >= 0; }
+
+        [[nodiscard]] std::string port() const { return std::to_string(this->port_); }
+
+        // Sends `count` notifications to every session that ran LISTEN on
+        // `channel`; returns how many sessions got them. Blocks until written.
+        size_t notify(std::string_view channel, std::string_view payload, size_t count);
+
+        // Statements whose text contains `sql_part` return these text rows
+        // (all columns typed text), on both protocols. A later rule for the
+        // same `sql_part` replaces the earlier one.
+        void answer(std::string sql_part, std::vector<std::string> columns,
+                    std::vector<std::vector<std::string> > rows);
+
+    private:
+        struct Rows {
+            std::vector<std::string> columns;
+            std::vector<std::vector<std::string> > rows;
+        };
+
+        struct Session {
+            int fd{-1};
+            std::mutex write_mu;
+            std::vector<std::string> channels;  // under write_mu
+        };
+
+        void accept_loop();
+
+        void serve(std::shared_ptr<Session> s);
+
+        // The rule matching `sql`, or null.
+        std::shared_ptr<const Rows> rows_for(std::string_view sql);
+
+        int listen_fd_{-1};
+        uint16_t port_{0};
+        std::thread acceptor_;
+        std::mutex mu_;
+        std::vector<std::shared_ptr<Session> > sessions_;
+        std::vector<std::pair<std::string, std::shared_ptr<const Rows> > > answers_;
+    };
+} // namespace upq_bench
+
+#endif // UPQ_BENCH_FAKESERVER_H
@@ -0,0 +1,266 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "uvent/Uvent.h"
+#include "uvent/sync/AsyncSemaphore.h"
+#include "upq/PgNotificationMultiplexer.h"
+#include "upq/PgPool.h"
+#include "upq/PgTransaction.h"
+
+using namespace usub::uvent;
+
+namespace upq_bench {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        // One iteration of a workload; returns how many operations it did
+        // (statements, rows) or 0 on failure after calling s.fail().
+        using Step = std::function<task::Awaitable<uint64_t>(usub::pg::PgPool &, LatencySamples &, uint64_t)>;
+
+        struct Workload {
+            const char *name;
+            Step step;
+        };
+
+        struct RunState {
+            std::vector<LatencySamples> workers;
+            usub::uvent::sync::AsyncSemaphore done{0};
+            Clock::time_point deadline;
+        };
+
+        task::Awaitable<void> worker(usub::pg::PgPool &pool, const Step &step, std::shared_ptr<RunState> st,
+                                     size_t idx) {
+            LatencySamples &s = st->workers[idx];
+            for (uint64_t i = 0; Clock::now() < st->deadline; ++i) {
+                const auto t0 = Clock::now();
+                const uint64_t ops = co_await step(pool, s, i);
+                const auto t1 = Clock::now();
+                if (ops == 0) continue;
+                s.ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+                s.ops += ops;
+            }
+            st->done.release();
+        }
+
+        task::Awaitable<void> run_workload(const BenchArgs &a, usub::pg::PgPool &pool, const Workload &w) {
+            auto st = std::make_shared<RunState>();
+            st->workers.resize(a.concurrency);
+            const auto t0 = Clock::now();
+            st->deadline = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(a.seconds));
+
+            for (size_t i = 0; i < a.concurrency; ++i)
+                system::co_spawn(worker(pool, w.step, st, i));
+            for (size_t i = 0; i < a.concurrency; ++i)
+                co_await st->done.acquire();
+
+            report_load(w.name, st->workers, Clock::now() - t0);
+        }
+
+        task::Awaitable<uint64_t> step_simple(usub::pg::PgPool &pool, LatencySamples &s, uint64_t) {
+            auto r = co_await pool.query_awaitable("SELECT 1");
+            if (!r.ok) {
+                s.fail(r.error);
+                co_return 0;
+            }
+            co_return 1;
+        }
+
+        task::Awaitable<uint64_t> step_param(usub::pg::PgPool &pool, LatencySamples &s, uint64_t i) {
+            const int64_t v = static_cast<int64_t>(i);
+            auto r = co_await pool.query_awaitable("SELECT $1::int8 + 1", v);
+            if (!r.ok) {
+                s.fail(r.error);
+                co_return 0;
+            }
+            co_return 1;
+        }
+
+        Step make_pipeline_step(size_t depth) {
+            return [depth](usub::pg::PgPool &pool, LatencySamples &s, uint64_t i) -> task::Awaitable<uint64_t> {
+                usub::pg::PgPipeline p;
+                for (size_t k = 0; k < depth; ++k)
+                    p.add("SELECT $1::int8", static_cast<int64_t>(i * depth + k));
+                auto rs = co_await pool.pipeline_awaitable(std::move(p));
+                for (const auto &r: rs) {
+                    if (!r.ok) {
+                        s.fail(r.error);
+                        co_return 0;
+                    }
+                }
+                co_return rs.size();
+            };
+        }
+
+        Step make_copy_step(size_t rows) {
+            return [rows](usub::pg::PgPool &pool, LatencySamples &s, uint64_t i) -> task::Awaitable<uint64_t> {
+                auto c = co_await pool.acquire_connection();
+                if (!c) {
+                    s.fail(c.error().error);
+                    co_return 0;
+                }
+                auto conn = *c;
+
+                std::string chunk;
+                chunk.reserve(rows * 12);
+                for (size_t k = 0; k < rows; ++k) {
+                    chunk += std::to_string(i * rows + k);
+                    chunk.push_back('\n');
+                }
+
+                uint64_t ops = 0;
+                auto st = co_await conn->copy_in_start("COPY upq_bench_copy(v) FROM STDIN");
+                if (st.ok) st = co_await conn->copy_in_send_chunk(chunk.data(), chunk.size());
+                if (st.ok) st = co_await conn->copy_in_finish();
+                if (st.ok) ops = rows;
+                else s.fail(st.error);
+
+                if (conn->connected()) co_await pool.release_connection_async(conn);
+                else pool.mark_dead(conn);
+                co_return ops;
+            };
+        }
+
+        task::Awaitable<uint64_t> step_tx(usub::pg::PgPool &pool, LatencySamples &s, uint64_t i) {
+            usub::pg::PgTransaction tx(&pool);
+            if (auto err = co_await tx.begin_errored(); err) {
+                s.fail(err->error);
+                co_await tx.finish();
+                co_return 0;
+            }
+            const int64_t v = static_cast<int64_t>(i);
+            auto r = co_await tx.query("INSERT INTO upq_bench_tx(v) VALUES ($1)", v);
+            if (!r.ok) {
+                s.fail(r.error);
+                co_await tx.finish();
+                co_return 0;
+            }
+            if (!co_await tx.commit()) {
+                s.fail("COMMIT failed");
+                co_await tx.finish();
+                co_return 0;
+            }
+            co_return 1;
+        }
+
+        // acquire/release round trip only: measures pool contention.
+        task::Awaitable<uint64_t> step_pool(usub::pg::PgPool &pool, LatencySamples &s, uint64_t) {
+            auto c = co_await pool.acquire_connection();
+            if (!c) {
+                s.fail(c.error().error);
+                co_return 0;
+            }
+            co_await pool.release_connection_async(*c);
+            co_return 1;
+        }
+
+        constexpr const char *notify_channel = "upq_bench";
+
+        // Payload carries the send time; delivery latency lands in samples.
+        struct NotifyProbe : usub::pg::IPgNotifyHandler {
+            std::atomic<uint64_t> received{0};
+            std::atomic<uint64_t> latency_ns_total{0};
+            std::atomic<uint64_t> latency_ns_max{0};
+
+            task::Awaitable<void> operator()(std::string, std::string payload, int) override {
+                const auto sent = std::strtoull(payload.c_str(), nullptr, 10);
+                const auto now = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+                const uint64_t d = now > sent ? now - sent : 0;
+                this->received.fetch_add(1, std::memory_order_relaxed);
+                this->latency_ns_total.fetch_add(d, std::memory_order_relaxed);
+                uint64_t m = this->latency_ns_max.load(std::memory_order_relaxed);
+                while (d > m && !this->latency_ns_max.compare_exchange_weak(m, d, std::memory_order_relaxed)) {
+                }
+                co_return;
+            }
+        };
+
+        task::Awaitable<uint64_t> step_notify(usub::pg::PgPool &pool, LatencySamples &s, uint64_t) {
+            const std::string ts = std::to_string(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+            auto r = co_await pool.query_awaitable("SELECT pg_notify($1, $2)", std::string(notify_channel), ts);
+            if (!r.ok) {
+                s.fail(r.error);
+                co_return 0;
+            }
+            co_return 1;
+        }
+
+        task::Awaitable<void> run_mux(std::shared_ptr<usub::pg::PgNotificationMultiplexer> mux) {
+            co_await mux->run();
+        }
+
+        task::Awaitable<bool> setup_schema(usub::pg::PgPool &pool) {
+            auto r = co_await pool.query_awaitable(
+                "CREATE UNLOGGED TABLE IF NOT EXISTS upq_bench_copy(v int8);"
+                "CREATE UNLOGGED TABLE IF NOT EXISTS upq_bench_tx(id bigserial PRIMARY KEY, v int8);"
+                "TRUNCATE upq_bench_copy, upq_bench_tx;");
+            if (!r.ok) std::fprintf(stderr, "upq_bench: schema setup failed: %s\n", r.error.c_str());
+            co_return r.ok;
+        }
+
+        task::Awaitable<void> drive(const BenchArgs &a, usub::pg::PgPool &pool) {
+            if (!co_await setup_schema(pool)) std::_Exit(1);
+
+            std::printf("# load: %zu connections, %zu workers, %d threads, %.1fs per workload\n",
+                        a.connections, a.concurrency, a.threads, a.seconds);
+
+            const std::vector<Workload> workloads = {
+                {"simple", step_simple},
+                {"param", step_param},
+                {"pipeline", make_pipeline_step(a.pipeline_depth)},
+                {"copy", make_copy_step(a.copy_rows)},
+                {"tx", step_tx},
+                {"pool", step_pool},
+            };
+            for (const auto &w: workloads)
+                if (selected(a, w.name)) co_await run_workload(a, pool, w);
+
+            if (selected(a, "notify")) {
+                auto c = co_await pool.acquire_connection();
+                if (!c) {
+                    std::fprintf(stderr, "upq_bench: no connection for the multiplexer: %s\n", c.error().error.c_str());
+                    std::_Exit(1);
+                }
+                // rate limiting off: the bench wants raw dispatch throughput
+                usub::pg::PgNotificationMultiplexer::Config cfg{4096, 1024, 100000, 4, 0xFFFFFFFFu};
+                auto mux = std::make_shared<usub::pg::PgNotificationMultiplexer>(
+                    *c, pool.host(), pool.port(), pool.user(), pool.db(), pool.password(), cfg);
+                auto probe = std::make_shared<NotifyProbe>();
+                if (!co_await mux->add_handler(notify_channel, probe)) {
+                    std::fprintf(stderr, "upq_bench: LISTEN failed\n");
+                    std::_Exit(1);
+                }
+                system::co_spawn(run_mux(mux));
+
+                co_await run_workload(a, pool, Workload{"notify", step_notify});
+                co_await system::this_coroutine::sleep_for(std::chrono::milliseconds(500));
+
+                const uint64_t n = probe->received.load(std::memory_order_relaxed);
+                std::printf("%-12s %llu delivered, mean %.1f us, max %.1f us send-to-handler\n", "",
+                            static_cast<unsigned long long>(n),
+                            n ? static_cast<double>(probe->latency_ns_total.load()) / static_cast<double>(n) / 1000.0 : 0.0,
+                            static_cast<double>(probe->latency_ns_max.load()) / 1000.0);
+            }
+
+            std::fflush(stdout);
+            // the pool and the uvent workers have no shutdown path
+            std::_Exit(0);
+        }
+    } // namespace
+
+    int run_load_suite(const BenchArgs &a) {
+        usub::Uvent uvent(a.threads);
+        usub::pg::PgPool pool(a.host, a.port, a.user, a.db, a.password, a.connections);
+        system::co_spawn(drive(a, pool));
+        uvent.run();
+        return 0;
+    }
+} // namespace upq_bench
@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "BenchCommon.h"
+
+// upq_bench micro [--filter S] [--iters N] [--rounds N] [--threads N]
+// upq_bench load  [--filter S] [--host H] [--port P] [--user U] [--db D] [--password W]
+//                 [--threads N] [--connections N] [--concurrency N] [--seconds S]
+//                 [--pipeline-depth N] [--copy-rows N]
+namespace {
+    void usage() {
+        std::fprintf(stderr,
+                     "usage: upq_bench micro [--filter S] [--iters N] [--rounds N] [--threads N]\n"
+                     "       upq_bench load  [--filter S] [--host H] [--port P] [--user U] [--db D]\n"
+                     "                       [--password W] [--threads N] [--connections N]\n"
+                     "                       [--concurrency N] [--seconds S] [--pipeline-depth N]\n"
+                     "                       [--copy-rows N]\n"
+                     "load workloads: simple param pipeline copy tx pool notify\n");
+    }
+
+    bool parse_args(int argc, char **argv, upq_bench::BenchArgs &a) {
+        if (argc < 2) return false;
+        a.mode = argv[1];
+        if (a.mode != "micro" && a.mode != "load") return false;
+
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view k = argv[i];
+            if (i + 1 >= argc) return false;
+            const char *v = argv[++i];
+
+            if (k == "--filter") a.filter = v;
+            else if (k == "--iters") a.iters = std::strtoull(v, nullptr, 10);
+            else if (k == "--rounds") a.rounds = std::strtoull(v, nullptr, 10);
+            else if (k == "--host") a.host = v;
+            else if (k == "--port") a.port = v;
+            else if (k == "--user") a.user = v;
+            else if (k == "--db") a.db = v;
+            else if (k == "--password") a.password = v;
+            else if (k == "--threads") a.threads = std::atoi(v);
+            else if (k == "--connections") a.connections = std::strtoull(v, nullptr, 10);
+            else if (k == "--concurrency") a.concurrency = std::strtoull(v, nullptr, 10);
+            else if (k == "--seconds") a.seconds = std::strtod(v, nullptr);
+            else if (k == "--pipeline-depth") a.pipeline_depth = std::strtoull(v, nullptr, 10);
+            else if (k == "--copy-rows") a.copy_rows = std::strtoull(v, nullptr, 10);
+            else return false;
+        }
+        return a.iters > 0 && a.rounds > 0 && a.threads > 0 && a.connections > 0 && a.concurrency > 0 &&
+               a.pipeline_depth > 0 && a.copy_rows > 0;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    upq_bench::BenchArgs a;
+    if (!parse_args(argc, argv, a)) {
+        usage();
+        return 2;
+    }
+    return a.mode == "micro" ? upq_bench::run_micro_suite(a) : upq_bench::run_load_suite(a);
+}
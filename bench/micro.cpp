@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "upq/PgConnection.h"
+#include "upq/PgReflect.h"
+#include "upq/PgTypes.h"
+
+namespace upq_bench {
+    namespace {
+        struct BenchDoc {
+            int64_t id;
+            std::string name;
+            std::vector<int> tags;
+        };
+
+        struct BenchRow {
+            int64_t id;
+            std::string name;
+            double score;
+            std::vector<int> tags;
+        };
+
+        // What a "SELECT id, name, score, tags" would hand back in text format.
+        usub::pg::QueryResult make_result(size_t rows) {
+            usub::pg::QueryResult qr;
+            qr.ok = true;
+            qr.code = usub::pg::PgErrorCode::OK;
+            qr.columns = {"id", "name", "score", "tags"};
+            qr.rows.reserve(rows);
+            for (size_t i = 0; i < rows; ++i) {
+                usub::pg::QueryResult::Row r;
+                r.cols = {
+                    std::to_string(1000000 + i),
+                    "user_" + std::to_string(i),
+                    std::to_string(static_cast<double>(i) * 0.25),
+                    "{1,2,3,4,5,6,7,8}"
+                };
+                qr.rows.push_back(std::move(r));
+            }
+            return qr;
+        }
+
+        template<class T>
+        void bench_encode(const BenchArgs &a, std::string_view name, const T &v) {
+            run_micro(a, name, [&](size_t) {
+                usub::pg::ParamBuffer<usub::pg::detail::count_total_params<T>()> pb;
+                usub::pg::detail::encode_one(pb.ps, v);
+                keep(pb.values[0]);
+            });
+        }
+
+        template<class T>
+        void bench_parse(const BenchArgs &a, std::string_view name, std::string_view cell) {
+            run_micro(a, name, [&](size_t) {
+                auto r = usub::pg::QueryResult::parse_cell<T>(cell);
+                keep(r);
+            });
+        }
+    } // namespace
+
+    int run_micro_suite(const BenchArgs &a) {
+        std::printf("# encode_one\n");
+        bench_encode(a, "encode/int32", int32_t{123456});
+        bench_encode(a, "encode/int64", int64_t{-9000000000000000000});
+        bench_encode(a, "encode/double", 3.14159265358979);
+        bench_encode(a, "encode/bool", true);
+        bench_encode(a, "encode/string_16", std::string(16, 'a'));
+        bench_encode(a, "encode/string_1k", std::string(1024, 'a'));
+        bench_encode(a, "encode/optional_int32", std::optional<int32_t>{42});
+        bench_encode(a, "encode/optional_null", std::optional<int32_t>{});
+        bench_encode(a, "encode/vector_int32_100", std::vector<int32_t>(100, 7));
+        bench_encode(a, "encode/vector_double_100", std::vector<double>(100, 0.5));
+        bench_encode(a, "encode/vector_string_16", std::vector<std::string>(16, "tag,with\"quote"));
+
+        const BenchDoc doc{42, "document", std::vector<int>(32, 1)};
+        bench_encode(a, "encode/jsonb_text", usub::pg::pg_jsonb(doc));
+        bench_encode(a, "encode/jsonb_binary", usub::pg::pg_jsonb_binary(doc));
+
+        std::printf("# QueryResult::parse_cell\n");
+        bench_parse<int32_t>(a, "parse/int32", "1234567");
+        bench_parse<int64_t>(a, "parse/int64", "-9223372036854775807");
+        bench_parse<double>(a, "parse/double", "3.14159265358979");
+        bench_parse<bool>(a, "parse/bool", "t");
+        bench_parse<std::string>(a, "parse/string_64", std::string(64, 'x'));
+        bench_parse<std::optional<int64_t> >(a, "parse/optional_int64", "77");
+        bench_parse<std::optional<int64_t> >(a, "parse/optional_null", "NULL");
+
+        std::printf("# row mapping (1000 rows x 4 columns)\n");
+        const usub::pg::QueryResult qr = make_result(1000);
+        BenchArgs ma = a;
+        ma.iters = std::max<size_t>(a.iters / 1000, 10);
+        run_micro(ma, "map/named_1000", [&](size_t) {
+            auto rows = usub::pg::map_all_reflect_named<BenchRow>(qr);
+            keep(rows);
+        });
+        run_micro(ma, "map/positional_1000", [&](size_t) {
+            auto rows = usub::pg::map_all_reflect_positional<BenchRow>(qr);
+            keep(rows);
+        });
+        run_micro(ma, "map/expected_1000", [&](size_t) {
+            auto rows = usub::pg::map_all_reflect_expected<BenchRow>(qr);
+            keep(rows);
+        });
+
+        std::fflush(stdout);
+        return run_server_micro_suite(a);
+    }
+} // namespace upq_bench
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "BenchCommon.h"
+#include "FakeServer.h"
+#include "uvent/Uvent.h"
+#include "uvent/sync/AsyncSemaphore.h"
+#include "upq/PgNotificationMultiplexer.h"
+#include "upq/PgPool.h"
+
+using namespace usub::uvent;
+
+// Micro cases that need a peer: PgPool and PgNotificationMultiplexer talk to
+// an in-process FakeServer, so only the client side is measured.
+namespace upq_bench {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        usub::pg::SSLConfig no_ssl() {
+            usub::pg::SSLConfig ssl;
+            ssl.mode = usub::pg::SSLMode::disable;
+            return ssl;
+        }
+
+        task::Awaitable<void> pool_worker(usub::pg::PgPool &pool, size_t n,
+                                          std::shared_ptr<usub::uvent::sync::AsyncSemaphore> done) {
+            for (size_t i = 0; i < n; ++i) {
+                auto c = co_await pool.acquire_connection();
+                if (!c) {
+                    std::fprintf(stderr, "upq_bench: acquire failed: %s\n", c.error().error.c_str());
+                    std::_Exit(1);
+                }
+                co_await pool.release_connection_async(*c);
+            }
+            done->release();
+        }
+
+        // ns per acquire + release with `workers` coroutines sharing `conns`.
+        task::Awaitable<void> bench_pool(const BenchArgs &a, const FakeServer &srv, std::string name, size_t conns,
+                                         size_t workers) {
+            if (!selected(a, name)) co_return;
+
+            usub::pg::PgPool pool("127.0.0.1", srv.port(), "bench", "bench", "", conns, 1, no_ssl());
+            auto round = [&](size_t total) -> task::Awaitable<double> {
+                auto done = std::make_shared<usub::uvent::sync::AsyncSemaphore>(0);
+                const size_t per = total / workers + 1;
+                const auto t0 = Clock::now();
+                for (size_t w = 0; w < workers; ++w)
+                    system::co_spawn(pool_worker(pool, per, done));
+                for (size_t w = 0; w < workers; ++w)
+                    co_await done->acquire();
+                const auto t1 = Clock::now();
+                co_return std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                          static_cast<double>(per * workers);
+            };
+
+            co_await round(a.iters / 10 + 1);  // opens the connections
+            double best = 0;
+            for (size_t r = 0; r < a.rounds; ++r) {
+                const double ns = co_await round(a.iters);
+                if (r == 0 || ns < best) best = ns;
+            }
+            print_micro(name, best);
+        }
+
+        // Counts deliveries and wakes the bench once `target` is reached.
+        struct CountingProbe : usub::pg::IPgNotifyHandler {
+            std::atomic<uint64_t> received{0};
+            std::atomic<uint64_t> target{0};
+            usub::uvent::sync::AsyncSemaphore done{0};
+
+            task::Awaitable<void> operator()(std::string, std::string, int) override {
+                if (this->received.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+                    this->target.load(std::memory_order_acquire))
+                    this->done.release();
+                co_return;
+            }
+        };
+
+        // holds the pool the multiplexer's connection came from
+        task::Awaitable<void> run_mux(std::shared_ptr<usub::pg::PgNotificationMultiplexer> mux,
+                                      std::shared_ptr<usub::pg::PgPool> pool) {
+            co_await mux->run();
+        }
+
+        // ns per notification from the socket to a handler call.
+        task::Awaitable<void> bench_notify(const BenchArgs &a, FakeServer &srv, std::string name, uint32_t lanes) {
+            if (!selected(a, name)) co_return;
+
+            const size_t n = std::max<size_t>(a.iters / 10, 1000);
+            auto pool = std::make_shared<usub::pg::PgPool>("127.0.0.1", srv.port(), "bench", "bench", "", 1, 1,
+                                                           no_ssl());
+            auto c = co_await pool->acquire_connection();
+            if (!c) {
+                std::fprintf(stderr, "upq_bench: no connection for the multiplexer: %s\n", c.error().error.c_str());
+                std::_Exit(1);
+            }
+            // the queue holds a whole round, and rate limiting and the
+            // recursion guard are off, so nothing is dropped
+            usub::pg::PgNotificationMultiplexer::Config cfg{n + 1, 1024, 100000, 0, 0xFFFFFFFFu, lanes};
+            auto mux = std::make_shared<usub::pg::PgNotificationMultiplexer>(
+                *c, pool->host(), pool->port(), pool->user(), pool->db(), pool->password(), cfg, no_ssl());
+            auto probe = std::make_shared<CountingProbe>();
+            if (!co_await mux->add_handler(name, probe)) {
+                std::fprintf(stderr, "upq_bench: LISTEN failed\n");
+                std::_Exit(1);
+            }
+            system::co_spawn(run_mux(mux, pool));
+
+            auto round = [&](size_t count) -> task::Awaitable<double> {
+                probe->target.store(probe->received.load(std::memory_order_acquire) + count,
+                                    std::memory_order_release);
+                const auto t0 = Clock::now();
+                std::thread feeder([&srv, &name, count] { srv.notify(name, "payload", count); });
+                co_await probe->done.acquire();
+                const auto t1 = Clock::now();
+                feeder.join();
+                co_return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(count);
+            };
+
+            co_await round(n / 10 + 1);
+            double best = 0;
+            for (size_t r = 0; r < a.rounds; ++r) {
+                const double ns = co_await round(n);
+                if (r == 0 || ns < best) best = ns;
+            }
+            print_micro(name, best);
+        }
+
+        task::Awaitable<void> drive(const BenchArgs &a, FakeServer &srv) {
+            std::printf("# PgPool against a fake server (conns x workers)\n");
+            co_await bench_pool(a, srv, "pool/acquire_release_1x1", 1, 1);
+            co_await bench_pool(a, srv, "pool/acquire_release_4x64", 4, 64);
+
+            std::printf("# PgNotificationMultiplexer dispatch of synthetic notifications\n");
+            co_await bench_notify(a, srv, "notify/dispatch_per_channel", 0);
+            co_await bench_notify(a, srv, "notify/dispatch_lanes_4", 4);
+
+            std::fflush(stdout);
+            // the pools, the multiplexers and the uvent workers have no shutdown path
+            std::_Exit(0);
+        }
+    } // namespace
+
+    int run_server_micro_suite(const BenchArgs &a) {
+        constexpr std::string_view names[] = {
+            "pool/acquire_release_1x1", "pool/acquire_release_4x64",
+            "notify/dispatch_per_channel", "notify/dispatch_lanes_4",
+        };
+        if (std::none_of(std::begin(names), std::end(names), [&](std::string_view n) { return selected(a, n); }))
+            return 0;
+
+        FakeServer srv;
+        if (!srv.ok()) {
+            std::fprintf(stderr, "upq_bench: cannot listen on 127.0.0.1\n");
+            return 1;
+        }
+        usub::Uvent uvent(a.threads);
+        system::co_spawn(drive(a, srv));
+        uvent.run();
+        return 0;
+    }
+} // namespace upq_bench
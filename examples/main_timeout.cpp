@@ -148,6 +148,28 @@ task::Awaitable<void> tx_example() {
     co_return;
 }
 
+task::Awaitable<void> query_deadline_example() {
+    using namespace std::chrono_literals;
+
+    usub::pg::PgPool pool("localhost", "12432", "postgres", "postgres", "password", 2);
+
+    usub::pg::PgQueryOptions opts;
+    opts.timeout = 200ms;
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto slow = co_await pool.query_awaitable(opts, "SELECT pg_sleep($1)", 2.0);
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << "[DEADLINE] code=" << toString(slow.code) << " after " << elapsed_ms
+            << " ms: " << slow.error << "\n";
+
+    // the canceled connection went back to the pool and serves the next query
+    auto next = co_await pool.query_awaitable(opts, "SELECT 1");
+    std::cout << "[DEADLINE] follow-up ok=" << next.ok << "\n";
+    co_return;
+}
+
 int main() {
     log_ts("main(): before Uvent");
 
@@ -159,6 +181,8 @@ int main() {
 
     usub::uvent::system::co_spawn(tx_example());
 
+    usub::uvent::system::co_spawn(query_deadline_example());
+
     log_ts("main(): before run()");
 
     uvent.run();
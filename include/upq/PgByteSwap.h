@@ -0,0 +1,20 @@
+#ifndef PGBYTESWAP_H
+#define PGBYTESWAP_H
+
+#include <cstddef>
+
+namespace usub::pg::detail {
+    // n binary array records, [length word = width][big-endian value], from n
+    // native values of `width` (2, 4 or 8) bytes at src. Returns the end of the
+    // output. The kernel (SSSE3, NEON or scalar) is picked once from the CPU.
+    char *store_be_records(char *dst, const char *src, size_t n, size_t width) noexcept;
+
+    // The inverse: n records at src to n native values at dst. False when a
+    // length word is not `width` (dst is then partly written).
+    bool load_be_records(char *dst, const char *src, size_t n, size_t width) noexcept;
+
+    // "ssse3", "neon" or "scalar".
+    const char *byteswap_kernel() noexcept;
+} // namespace usub::pg::detail
+
+#endif // PGBYTESWAP_H
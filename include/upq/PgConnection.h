@@ -1,36 +1,47 @@
 #ifndef PGCONNECTIONLIBPQ_H
 #define PGCONNECTIONLIBPQ_H
 
+#include <array>
 #include <bit>
 #include <cctype>
 #include <charconv>
 #include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <initializer_list>
 #include <iterator>
 #include <limits>
 #include <memory>
 #include <optional>
+#include <ranges>
+#include <span>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <typeinfo>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <libpq-fe.h>
 #include <ujson/ujson.h>
 
+#include "PgByteSwap.h"
 #include "PgReflect.h"
+#include "PgResultView.h"
+#include "PgStatementCache.h"
+#include "PgStats.h"
+#include "PgTrace.h"
+#include "PgTypeRegistry.h"
 #include "PgTypes.h"
 #include "meta/PgConcepts.h"
 #include "uvent/Uvent.h"
 
 #ifndef UPQ_REFLECT_DEBUG
-#define UPQ_REFLECT_DEBUG 1
+#define UPQ_REFLECT_DEBUG 0
 #endif
 
 #if UPQ_REFLECT_DEBUG
@@ -50,6 +61,7 @@ namespace usub::pg {
         const char *primary = PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY);
         const char *detail = PQresultErrorField(res, PG_DIAG_MESSAGE_DETAIL);
         const char *hint = PQresultErrorField(res, PG_DIAG_MESSAGE_HINT);
+        const char *routine = PQresultErrorField(res, PG_DIAG_SOURCE_FUNCTION);
 
         if (primary && *primary) out.error = primary;
         else if (const char *fb = PQresultErrorMessage(res); fb && *fb) out.error = fb;
@@ -57,6 +69,7 @@ namespace usub::pg {
         if (sqlstate) out.err_detail.sqlstate = sqlstate;
         if (detail) out.err_detail.detail = detail;
         if (hint) out.err_detail.hint = hint;
+        if (routine) out.err_detail.routine = routine;
 
         if (primary && *primary) out.err_detail.message = primary;
         else if (!out.error.empty()) out.err_detail.message = out.error;
@@ -64,7 +77,7 @@ namespace usub::pg {
         out.err_detail.category = classify_sqlstate(out.err_detail.sqlstate);
 
         out.ok = false;
-        out.code = PgErrorCode::ServerError;
+        out.code = server_error_code(out.err_detail.sqlstate);
         out.rows_valid = false;
     }
 
@@ -83,6 +96,11 @@ namespace usub::pg {
         return 0;
     }
 
+    static inline bool is_rollback_tag(PGresult *res) {
+        const char *tag = res ? PQcmdStatus(res) : nullptr;
+        return tag && std::strcmp(tag, "ROLLBACK") == 0;
+    }
+
     constexpr uint16_t to_be16(uint16_t v) noexcept {
         if constexpr (std::endian::native == std::endian::little) return std::byteswap(v);
         else return v;
@@ -118,6 +136,38 @@ namespace usub::pg {
         std::vector<std::string> &temp_strings;
         std::vector<std::vector<char> > &temp_bytes;
 
+        // Optional inline arena (see ParamBuffer) for binary scalars and short
+        // copied strings; temp_strings / temp_bytes are only used on overflow.
+        char *arena{nullptr};
+        size_t arena_cap{0};
+        size_t arena_used{0};
+
+        // temp_strings is reserved to this size on first use so that earlier
+        // c_str() pointers survive later insertions.
+        size_t reserve_hint{0};
+
+        // Reference NUL-terminated caller strings instead of copying them;
+        // only valid when the send happens before the arguments die.
+        bool borrow{false};
+
+        char *arena_take(size_t n) noexcept {
+            if (!arena || arena_cap - arena_used < n) return nullptr;
+            char *p = arena + arena_used;
+            arena_used += n;
+            return p;
+        }
+
+        const char *stash_text(std::string_view sv) {
+            if (char *p = arena_take(sv.size() + 1)) {
+                if (!sv.empty()) std::memcpy(p, sv.data(), sv.size());
+                p[sv.size()] = '\0';
+                return p;
+            }
+            if (temp_strings.empty() && reserve_hint) temp_strings.reserve(reserve_hint);
+            temp_strings.emplace_back(sv);
+            return temp_strings.back().c_str();
+        }
+
         void set_null() {
             const auto i = (*idx)++;
             values[i] = nullptr;
@@ -128,24 +178,69 @@ namespace usub::pg {
 
         void set_text(std::string_view sv) {
             const auto i = (*idx)++;
-            temp_strings.emplace_back(sv);
-            values[i] = temp_strings.back().c_str();
+            values[i] = stash_text(sv);
             lengths[i] = static_cast<int>(sv.size());
             formats[i] = 0;
             types[i] = 0;
         }
 
+        // z[n] must be '\0' (std::string::c_str(), literals, C strings).
+        void set_text_zstr(const char *z, size_t n) {
+            if (!borrow) {
+                set_text(std::string_view(z, n));
+                return;
+            }
+            const auto i = (*idx)++;
+            values[i] = z;
+            lengths[i] = static_cast<int>(n);
+            formats[i] = 0;
+            types[i] = 0;
+        }
+
         void set_text_typed(std::string_view sv, Oid oid) {
             const auto i = (*idx)++;
-            temp_strings.emplace_back(sv);
-            values[i] = temp_strings.back().c_str();
+            values[i] = stash_text(sv);
             lengths[i] = static_cast<int>(sv.size());
             formats[i] = 0;
             types[i] = oid;
         }
 
+        // Takes ownership of s instead of copying it. Short strings still go
+        // through stash_text: their bytes live inside the std::string and
+        // would move with it.
+        const char *adopt_string(std::string &&s) {
+            if (s.size() < sizeof(std::string)) return stash_text(s);
+            if (temp_strings.empty() && reserve_hint) temp_strings.reserve(reserve_hint);
+            temp_strings.push_back(std::move(s));
+            return temp_strings.back().c_str();
+        }
+
+        void set_text_owned(std::string &&s, Oid oid) {
+            const auto i = (*idx)++;
+            lengths[i] = static_cast<int>(s.size());
+            values[i] = adopt_string(std::move(s));
+            formats[i] = 0;
+            types[i] = oid;
+        }
+
+        void set_bin_owned(std::string &&s, Oid oid) {
+            const auto i = (*idx)++;
+            lengths[i] = static_cast<int>(s.size());
+            values[i] = adopt_string(std::move(s));
+            formats[i] = 1;
+            types[i] = oid;
+        }
+
         void set_bin_raw(const void *data, size_t n, Oid oid) {
             const auto i = (*idx)++;
+            if (char *p = arena_take(n)) {
+                std::memcpy(p, data, n);
+                values[i] = p;
+                lengths[i] = static_cast<int>(n);
+                formats[i] = 1;
+                types[i] = oid;
+                return;
+            }
             temp_bytes.emplace_back();
             auto &buf = temp_bytes.back();
             buf.resize(n);
@@ -170,6 +265,21 @@ namespace usub::pg {
             }
         }
 
+        // Binary parameter of n bytes that the caller writes in place.
+        char *set_bin_slot(size_t n, Oid oid) {
+            const auto i = (*idx)++;
+            char *p = arena_take(n);
+            if (!p) {
+                temp_bytes.emplace_back(n);
+                p = temp_bytes.back().data();
+            }
+            values[i] = p;
+            lengths[i] = static_cast<int>(n);
+            formats[i] = 1;
+            types[i] = oid;
+            return p;
+        }
+
         void set_bin_f32(float v) {
             uint32_t be = fp_to_be(v);
             set_bin_raw(&be, 4, detail::FLOAT4OID);
@@ -186,6 +296,57 @@ namespace usub::pg {
         }
     };
 
+    // Call-scoped parameter storage sized from count_total_params<Args...>():
+    // slot arrays and the scalar arena live inline (in the coroutine frame),
+    // so encoding fixed-arity scalars and caller-owned strings allocates
+    // nothing. Not copyable or movable: ps points into the object itself.
+    template<size_t M>
+    struct ParamBuffer {
+        static constexpr size_t slots = M ? M : 1;
+        static constexpr size_t arena_bytes = slots * 8 + 256;
+
+        std::array<const char *, slots> values{};
+        std::array<int, slots> lengths{};
+        std::array<int, slots> formats{};
+        std::array<Oid, slots> types{};
+        alignas(8) std::array<char, arena_bytes> arena;
+
+        std::vector<std::string> temp_strings;
+        std::vector<std::vector<char> > temp_bytes;
+        size_t idx{0};
+
+        ParamSlices ps{
+            values.data(),
+            lengths.data(),
+            formats.data(),
+            types.data(),
+            &idx,
+            temp_strings,
+            temp_bytes,
+            arena.data(),
+            arena_bytes,
+            0,
+            slots,
+            true
+        };
+
+        ParamBuffer() = default;
+
+        ParamBuffer(const ParamBuffer &) = delete;
+
+        ParamBuffer &operator=(const ParamBuffer &) = delete;
+
+        [[nodiscard]] int count() const noexcept { return static_cast<int>(idx); }
+
+        // Makes the buffer reusable for the next row / call.
+        void reset() noexcept {
+            idx = 0;
+            ps.arena_used = 0;
+            temp_strings.clear();
+            temp_bytes.clear();
+        }
+    };
+
     namespace detail {
         inline void encode_one(ParamSlices &ps, bool v);
 
@@ -208,8 +369,8 @@ namespace usub::pg {
         template<EnumType E>
         inline void encode_one(ParamSlices &ps, E v);
 
-        template<class T, bool Strict, bool Jsonb>
-        inline void encode_one(ParamSlices &ps, const ::usub::pg::PgJsonParam<T, Strict, Jsonb> &p);
+        template<class T, bool Strict, bool Jsonb, bool Binary>
+        inline void encode_one(ParamSlices &ps, const ::usub::pg::PgJsonParam<T, Strict, Jsonb, Binary> &p);
 
         template<class T, bool Strict>
         inline void encode_one(ParamSlices &ps, const ::usub::pg::PgJson<T, Strict> &v);
@@ -278,15 +439,15 @@ namespace usub::pg {
         inline void encode_one(ParamSlices &ps, double v) { ps.set_bin_f64(v); }
 
         inline void encode_one(ParamSlices &ps, std::string_view v) { ps.set_text(v); }
-        inline void encode_one(ParamSlices &ps, const std::string &v) { ps.set_text(v); }
+        inline void encode_one(ParamSlices &ps, const std::string &v) { ps.set_text_zstr(v.c_str(), v.size()); }
 
         template<size_t N>
         inline void encode_one(ParamSlices &ps, const char (&lit)[N]) {
-            ps.set_text(std::string_view(lit, N ? (N - 1) : 0));
+            ps.set_text_zstr(lit, std::char_traits<char>::length(lit));
         }
 
         inline void encode_one(ParamSlices &ps, const char *v) {
-            if (v) ps.set_text(std::string_view(v, std::char_traits<char>::length(v)));
+            if (v) ps.set_text_zstr(v, std::char_traits<char>::length(v));
             else ps.set_null();
         }
 
@@ -306,16 +467,32 @@ namespace usub::pg {
                 ps.set_bin_integral<uint64_t>(static_cast<uint64_t>(static_cast<U>(v)), INT8OID);
         }
 
-        template<class T, bool Strict, bool Jsonb>
-        inline void encode_one(ParamSlices &ps, const ::usub::pg::PgJsonParam<T, Strict, Jsonb> &p) {
+        // `prefix` followed by the JSON text, in the buffer ujson dumped into.
+        // ujson::dump() cannot write after a reserved byte, so the document is
+        // shifted by one in place: one memmove, no second buffer.
+        template<class T>
+        inline std::string dump_json_prefixed(char prefix, const T &v) {
+            std::string s = ::ujson::dump(v);
+            s.insert(s.begin(), prefix);
+            return s;
+        }
+
+        template<class T, bool Strict, bool Jsonb, bool Binary>
+        inline void encode_one(ParamSlices &ps, const ::usub::pg::PgJsonParam<T, Strict, Jsonb, Binary> &p) {
             (void) Strict;
             if (!p.ptr) {
                 ps.set_null();
                 return;
             }
 
-            std::string s = ::ujson::dump(*p.ptr);
-            ps.set_text_typed(s, Jsonb ? ::usub::pg::detail::JSONBOID : ::usub::pg::detail::JSONOID);
+            // the dumped document becomes the parameter buffer itself
+            if constexpr (Binary) {
+                // jsonb binary send format: version byte (1) followed by the text
+                ps.set_bin_owned(dump_json_prefixed('\x01', *p.ptr), ::usub::pg::detail::JSONBOID);
+            } else {
+                std::string s = ::ujson::dump(*p.ptr);
+                ps.set_text_owned(std::move(s), Jsonb ? ::usub::pg::detail::JSONBOID : ::usub::pg::detail::JSONOID);
+            }
         }
 
         template<class T, bool Strict>
@@ -423,33 +600,143 @@ namespace usub::pg {
             return pick_array_oid<Elem>();
         }
 
+        // Array elements sent in the binary wire format; everything else
+        // (strings, enums, unions, ...) keeps the text literal.
+        template<class E>
+        concept BinaryArrayElem = std::is_same_v<Decay<E>, bool> || Integral<E>
+                                  || std::is_same_v<Decay<E>, float> || std::is_same_v<Decay<E>, double>;
+
+        template<BinaryArrayElem E>
+        consteval size_t binary_array_elem_width() {
+            if constexpr (std::is_same_v<Decay<E>, bool>) return 1;
+            else if constexpr (Integral<E>) return sizeof(Decay<E>) <= 2 ? 2 : sizeof(Decay<E>) == 4 ? 4 : 8;
+            else return sizeof(Decay<E>);
+        }
+
+        template<BinaryArrayElem E>
+        consteval Oid binary_array_elem_oid() {
+            if constexpr (std::is_same_v<Decay<E>, bool>) return BOOLOID;
+            else if constexpr (std::is_same_v<Decay<E>, float>) return FLOAT4OID;
+            else if constexpr (std::is_same_v<Decay<E>, double>) return FLOAT8OID;
+            else if constexpr (binary_array_elem_width<E>() == 2) return INT2OID;
+            else if constexpr (binary_array_elem_width<E>() == 4) return INT4OID;
+            else return INT8OID;
+        }
+
+        template<BinaryArrayElem E>
+        inline void store_binary_array_elem(char *p, const E &v) noexcept {
+            constexpr size_t W = binary_array_elem_width<E>();
+            if constexpr (std::is_same_v<Decay<E>, bool>) {
+                *p = v ? 1 : 0;
+            } else if constexpr (Floating<E>) {
+                const auto be = fp_to_be(v);
+                std::memcpy(p, &be, W);
+            } else if constexpr (W == 2) {
+                const uint16_t be = to_be16(static_cast<uint16_t>(v));
+                std::memcpy(p, &be, 2);
+            } else if constexpr (W == 4) {
+                const uint32_t be = to_be32(static_cast<uint32_t>(v));
+                std::memcpy(p, &be, 4);
+            } else {
+                const uint64_t be = to_be64(static_cast<uint64_t>(v));
+                std::memcpy(p, &be, 8);
+            }
+        }
+
+        // [length word][big-endian value] for n contiguous values of native
+        // width W. Longer runs go to the shuffle kernel in PgByteSwap, which
+        // writes several records per vector store.
+        template<size_t W>
+        inline char *store_binary_array_run(char *p, const char *src, size_t n) noexcept {
+            using U = std::conditional_t<W == 1, uint8_t,
+                std::conditional_t<W == 2, uint16_t, std::conditional_t<W == 4, uint32_t, uint64_t> > >;
+            if constexpr (W > 1) {
+                if (n >= 16) return store_be_records(p, src, n, W);
+            }
+            constexpr uint32_t len_be = to_be32(static_cast<uint32_t>(W));
+            for (size_t i = 0; i < n; ++i, src += W, p += 4 + W) {
+                U v;
+                std::memcpy(&v, src, W);
+                if constexpr (W > 1 && std::endian::native == std::endian::little) v = std::byteswap(v);
+                std::memcpy(p, &len_be, 4);
+                std::memcpy(p + 4, &v, W);
+            }
+            return p;
+        }
+
+        // One-dimensional array in the binary wire format: ndim, has-null flag,
+        // element OID, then (length, lower bound 1) and per element a length
+        // word (-1 for NULL) followed by the big-endian value.
+        template<class Range>
+        inline void encode_binary_array(ParamSlices &ps, const Range &r) {
+            using VT = std::decay_t<std::ranges::range_reference_t<const Range> >;
+            using E = unopt_t<VT>;
+            constexpr size_t W = binary_array_elem_width<E>();
+
+            const auto n = static_cast<size_t>(std::ranges::distance(r));
+            size_t nulls = 0;
+            if constexpr (Optional<VT>)
+                for (const auto &e: r) nulls += e ? 0 : 1;
+
+            const size_t bytes = n ? 20 + n * 4 + (n - nulls) * W : 12;
+            char *p = ps.set_bin_slot(bytes, array_oid_for_elem<E>());
+
+            auto put32 = [&p](uint32_t v) {
+                const uint32_t be = to_be32(v);
+                std::memcpy(p, &be, 4);
+                p += 4;
+            };
+            put32(n ? 1u : 0u);
+            put32(nulls ? 1u : 0u);
+            put32(binary_array_elem_oid<E>());
+            if (n == 0) return;
+            put32(static_cast<uint32_t>(n));
+            put32(1u);
+
+            if constexpr (!Optional<VT> && std::ranges::contiguous_range<const Range> && sizeof(E) == W) {
+                store_binary_array_run<W>(p, reinterpret_cast<const char *>(std::ranges::data(r)), n);
+            } else {
+                for (const auto &e: r) {
+                    if constexpr (Optional<VT>) {
+                        if (!e) {
+                            put32(0xFFFFFFFFu);
+                            continue;
+                        }
+                        put32(static_cast<uint32_t>(W));
+                        store_binary_array_elem<E>(p, *e);
+                    } else {
+                        put32(static_cast<uint32_t>(W));
+                        store_binary_array_elem<E>(p, e);
+                    }
+                    p += W;
+                }
+            }
+        }
+
+        template<class Range>
+        inline void encode_array(ParamSlices &ps, const Range &r) {
+            using E = unopt_t<std::decay_t<std::ranges::range_reference_t<const Range> > >;
+            if constexpr (BinaryArrayElem<E>) {
+                encode_binary_array(ps, r);
+            } else {
+                const std::string s = build_pg_text_array_literal_any(r);
+                ps.set_text_typed(s, array_oid_for_elem<E>());
+            }
+        }
+
         template<ArrayLike C>
         inline void encode_one(ParamSlices &ps, const C &cont) {
-            using VT = typename std::decay_t<C>::value_type;
-            using E = unopt_t<VT>;
-            const std::string s = build_pg_text_array_literal_any(cont);
-            ps.set_text_typed(s, array_oid_for_elem<E>());
+            encode_array(ps, cont);
         }
 
         template<class T, class A>
         inline void encode_one(ParamSlices &ps, const std::vector<T, A> &cont) {
-            using E = unopt_t<T>;
-            const std::string s = build_pg_text_array_literal_any(cont);
-            ps.set_text_typed(s, array_oid_for_elem<E>());
+            encode_array(ps, cont);
         }
 
         template<class T, size_t N>
         inline void encode_one(ParamSlices &ps, const T (&arr)[N]) {
-            struct PtrRange {
-                const T *b;
-                const T *e;
-                const T * begin() const { return b; }
-                const T * end() const { return e; }
-            } r{arr, arr + N};
-
-            using E = unopt_t<T>;
-            const std::string s = build_pg_text_array_literal_any(r);
-            ps.set_text_typed(s, array_oid_for_elem<E>());
+            encode_array(ps, std::span<const T, N>(arr));
         }
 
         template<class T, size_t N>
@@ -459,9 +746,7 @@ namespace usub::pg {
 
         template<class T>
         inline void encode_one(ParamSlices &ps, std::initializer_list<T> il) {
-            using E = unopt_t<T>;
-            const std::string s = build_pg_text_array_literal_any(il);
-            ps.set_text_typed(s, array_oid_for_elem<E>());
+            encode_array(ps, std::span<const T>(il.begin(), il.size()));
         }
 
         template<class Tup>
@@ -601,6 +886,116 @@ namespace usub::pg {
         }
     } // namespace detail
 
+    // One statement queued into a PgPipeline. Owns the encoded parameters so
+    // the batch can be built up front and sent later in a single flush.
+    struct PgPipelineStatement {
+        std::string sql;
+
+        std::vector<const char *> values;
+        std::vector<int> lengths;
+        std::vector<int> formats;
+        std::vector<Oid> types;
+
+        std::vector<std::string> temp_strings;
+        std::vector<std::vector<char> > temp_bytes;
+        std::vector<char> arena;
+
+        int n_params{0};
+        bool sync_after{false};
+    };
+
+    // Batch of parameterized statements executed over libpq pipeline mode.
+    // Statements between two sync points share an implicit transaction on the
+    // server: a failure aborts the rest of that segment (reported as
+    // PGRES_PIPELINE_ABORTED), later segments still run.
+    class PgPipeline {
+    public:
+        PgPipeline() = default;
+
+        // Encodes one statement into self-contained storage.
+        template<typename... Args>
+        static PgPipelineStatement make_statement(std::string sql, Args &&... args) {
+            constexpr size_t M = detail::count_total_params<Args...>();
+
+            PgPipelineStatement st;
+            st.sql = std::move(sql);
+            st.values.assign(M ? M : 1, nullptr);
+            st.lengths.assign(M ? M : 1, 0);
+            st.formats.assign(M ? M : 1, 0);
+            st.types.assign(M ? M : 1, 0);
+            st.arena.resize(ParamBuffer<M>::arena_bytes);
+
+            // statements outlive the arguments: copy strings, never borrow
+            size_t idx = 0;
+            [[maybe_unused]] ParamSlices ps{
+                st.values.data(),
+                st.lengths.data(),
+                st.formats.data(),
+                st.types.data(),
+                &idx,
+                st.temp_strings,
+                st.temp_bytes,
+                st.arena.data(),
+                st.arena.size(),
+                0,
+                M ? M : 1,
+                false
+            };
+
+            (detail::encode_one(ps, std::forward<Args>(args)), ...);
+
+            st.n_params = static_cast<int>(idx);
+            return st;
+        }
+
+        template<typename... Args>
+        PgPipeline &add(std::string sql, Args &&... args) {
+            return add_statement(make_statement(std::move(sql), std::forward<Args>(args)...));
+        }
+
+        PgPipeline &add_statement(PgPipelineStatement st) {
+            st.sync_after = st.sync_after || sync_each_;
+            this->stmts_.emplace_back(std::move(st));
+            return *this;
+        }
+
+        template<typename Sql, typename... Args>
+            requires (std::is_convertible_v<Sql, std::string_view>
+                      && !std::is_same_v<std::decay_t<Sql>, std::string>)
+        PgPipeline &add(Sql &&sql, Args &&... args) {
+            constexpr size_t actual = detail::count_total_params<Args...>();
+            const std::string_view sv(sql);
+            assert(detail::count_pg_params(sv) == actual &&
+                "pg: $N placeholder count does not match argument count");
+            return add(std::string(sv), std::forward<Args>(args)...);
+        }
+
+        // Places a sync point after the last queued statement.
+        PgPipeline &sync() noexcept {
+            if (!this->stmts_.empty()) this->stmts_.back().sync_after = true;
+            return *this;
+        }
+
+        // Places a sync point after every statement added from now on, so a
+        // failing statement never aborts its neighbours.
+        PgPipeline &sync_each(bool on = true) noexcept {
+            this->sync_each_ = on;
+            return *this;
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return this->stmts_.size(); }
+        [[nodiscard]] bool empty() const noexcept { return this->stmts_.empty(); }
+
+        void clear() noexcept { this->stmts_.clear(); }
+
+        std::vector<PgPipelineStatement> &statements() noexcept { return this->stmts_; }
+        const std::vector<PgPipelineStatement> &statements() const noexcept { return this->stmts_; }
+
+    private:
+        std::vector<PgPipelineStatement> stmts_;
+        bool sync_each_{false};
+    };
+
     enum class SSLMode {
         disable,
         allow,
@@ -646,6 +1041,17 @@ namespace usub::pg {
         int count{3}; // probes before drop
     };
 
+    namespace detail {
+        struct PgCancelHandle;
+        struct PgDeadlineState;
+        struct PgIoWait;
+    } // namespace detail
+
+    // Watchdog armed around one statement; empty when there is no deadline.
+    struct PgQueryDeadline {
+        std::shared_ptr<detail::PgDeadlineState> state;
+    };
+
     class PgConnectionLibpq {
     public:
         template<class HandlerT>
@@ -674,6 +1080,12 @@ namespace usub::pg {
         usub::uvent::task::Awaitable<QueryResult>
         exec_param_query_nonblocking(const std::string &sql, Args &&... args);
 
+        // Same as exec_param_query_nonblocking, but keeps the PGresult and
+        // exposes cells as string_views instead of copying them into rows.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResultView>
+        exec_param_query_view_nonblocking(const std::string &sql, Args &&... args);
+
         template<class T>
         usub::uvent::task::Awaitable<std::vector<T> >
         exec_simple_query_nonblocking(const std::string &sql) {
@@ -795,10 +1207,19 @@ namespace usub::pg {
 
         usub::uvent::task::Awaitable<PgCopyResult> copy_in_finish();
 
+        // Result column types of `query` without running it: Prepare and
+        // Describe of the unnamed statement, pipelined into one round trip.
+        usub::uvent::task::Awaitable<PgCopyResult>
+        copy_out_describe(const std::string &query, std::vector<uint32_t> &oids);
+
         usub::uvent::task::Awaitable<PgCopyResult> copy_out_start(const std::string &sql);
 
         usub::uvent::task::Awaitable<PgWireResult<std::vector<uint8_t> > > copy_out_read_chunk();
 
+        // Appends the next CopyData message to dst (value == true); value is
+        // false once the COPY has completed. dst keeps its capacity between calls.
+        usub::uvent::task::Awaitable<PgWireResult<bool> > copy_out_read_append(std::string &dst);
+
         std::string make_cursor_name();
 
         usub::uvent::task::Awaitable<QueryResult>
@@ -810,8 +1231,102 @@ namespace usub::pg {
         usub::uvent::task::Awaitable<QueryResult>
         cursor_close(const std::string &cursor_name);
 
+        // Starts a streaming query: rows are pulled with stream_fetch_chunk
+        // while the server is still sending, without a cursor or transaction.
+        // Uses chunked-rows mode where libpq has it (17+), single-row otherwise.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResult>
+        stream_start(const std::string &sql, Args &&... args);
+
+        // Returns up to max_rows rows that are already available (waits only
+        // for the first one). done == true after the last row or an error.
+        usub::uvent::task::Awaitable<PgCursorChunk>
+        stream_fetch_chunk(uint32_t max_rows);
+
+        // Discards the remaining rows so the connection becomes idle again.
+        usub::uvent::task::Awaitable<QueryResult> stream_close();
+
+        [[nodiscard]] bool streaming() const noexcept;
+
+        // Rows per PGresult in chunked-rows mode; applies to the next stream_start.
+        void set_stream_chunk_rows(int rows) noexcept;
+
+        // Sends every queued statement in one flush (libpq pipeline mode) and
+        // returns one QueryResult per statement, in queue order.
+        usub::uvent::task::Awaitable<std::vector<QueryResult> >
+        exec_pipeline_nonblocking(PgPipeline pipeline);
+
+        // Runs one statement for every element of `items` (tuples or reflected
+        // structs, encoded like query params): prepared once as the unnamed
+        // statement, then pipelined `opts.window` items at a time through one
+        // reused ParamBuffer. Parameter types come from the first element, so
+        // give NULLs a typed std::optional.
+        template<std::ranges::forward_range R>
+        usub::uvent::task::Awaitable<PgExecManyResult>
+        execute_many(const std::string &sql, R &&items, PgExecManyOptions opts = {});
+
+        // Opt-in LRU of server-side prepared statements used transparently by
+        // exec_param_query_nonblocking. Capacity 0 disables it.
+        void set_statement_cache_capacity(size_t capacity, PgStatementCacheStats *shared = nullptr);
+
+        [[nodiscard]] const PgStatementCache &statement_cache() const noexcept;
+
+        // Executes a statement under a caller-chosen, stable server-side name
+        // (PgStatement); it is prepared on first use on this connection.
+        usub::uvent::task::Awaitable<QueryResult>
+        exec_prepared_named(const char *name, const char *sql, uint64_t key, int n_params,
+                            const Oid *types, const char *const *values, const int *lengths,
+                            const int *formats);
+
+        // Result format requested for parameterized queries and pipelines.
+        // Simple queries always return text.
+        void set_result_format(PgResultFormat fmt) noexcept;
+
+        [[nodiscard]] PgResultFormat result_format() const noexcept;
+
         PGconn *raw_conn() noexcept;
 
+        // Home shard in a sharded PgPool.
+        [[nodiscard]] uint32_t pool_shard() const noexcept { return this->pool_shard_; }
+        void set_pool_shard(uint32_t shard) noexcept { this->pool_shard_ = shard; }
+
+        // Process-unique id, reported in trace spans.
+        [[nodiscard]] uint64_t id() const noexcept { return this->id_; }
+
+        // Sampled per-statement spans (PgTraceSink); nullptr turns it off.
+        void set_trace(std::shared_ptr<const PgTraceConfig> cfg) noexcept;
+
+        [[nodiscard]] const std::shared_ptr<const PgTraceConfig> &trace() const noexcept { return this->trace_; }
+
+        // The next statement's span is held until trace_mapped() (after the
+        // caller maps rows into its type) or trace_flush() (nothing mapped).
+        void trace_defer_map() noexcept { this->trace_defer_map_ = this->trace_ != nullptr; }
+
+        void trace_mapped() noexcept;
+
+        void trace_flush() noexcept;
+
+        // PgStatsRegistry scope that queries on this connection are counted under.
+        [[nodiscard]] uint32_t stats_scope() const noexcept { return this->stats_scope_; }
+        void set_stats_scope(uint32_t scope) noexcept { this->stats_scope_ = scope; }
+
+        // Latency average of the owning pool, fed by every statement.
+        void set_latency_ewma(PgLatencyEwma *ewma) noexcept { this->latency_ewma_ = ewma; }
+
+        // When the last successful connect_async completed.
+        [[nodiscard]] std::chrono::steady_clock::time_point connected_at() const noexcept {
+            return this->connected_at_;
+        }
+
+        // Starts a watchdog for opts.timeout (see PgQueryOptions) around the
+        // next statement on this connection.
+        PgQueryDeadline arm_deadline(const PgQueryOptions &opts);
+
+        // Stops the watchdog. If it fired, first waits for the cancel request
+        // to complete, so it cannot hit a later statement, then turns the
+        // canceled result into QueryTimeout.
+        usub::uvent::task::Awaitable<void> disarm_deadline(PgQueryDeadline &dl, QueryResult &r);
+
         bool is_idle();
 
         void close();
@@ -821,18 +1336,56 @@ namespace usub::pg {
 
         usub::uvent::task::Awaitable<void> wait_writable();
 
+        // POLLIN and/or POLLOUT once the socket is readable or writable.
+        usub::uvent::task::Awaitable<short> wait_readable_or_writable();
+
         usub::uvent::task::Awaitable<void> wait_readable_for_listener();
 
         usub::uvent::task::Awaitable<bool> flush_outgoing();
 
+        usub::uvent::task::Awaitable<bool> flush_outgoing_pipelined();
+
         usub::uvent::task::Awaitable<bool> pump_input();
 
+        // execute_many without the element type: encode(i, ps) fills ps for
+        // item i, called once per item in order.
+        usub::uvent::task::Awaitable<PgExecManyResult>
+        execute_many_encoded(const std::string &sql, size_t count, ParamSlices &ps,
+                             const std::function<void(size_t, ParamSlices &)> &encode,
+                             PgExecManyOptions opts);
+
         QueryResult drain_all_results();
 
         PgCopyResult drain_copy_end_result();
 
+        // One CopyData message in *buf (PQfreemem it); value is its length,
+        // 0 once the COPY has completed.
+        usub::uvent::task::Awaitable<PgWireResult<int> > copy_out_fetch(char **buf);
+
         PgCursorChunk drain_single_result_rows();
 
+        usub::uvent::task::Awaitable<QueryResultView> collect_result_view();
+
+        // Moves rows of stream_res_ into out up to max_rows; clears it once drained.
+        void take_stream_rows(PgCursorChunk &out, uint32_t max_rows);
+
+        // Sends the queued DEALLOCATEs once no transaction is open; false
+        // only when the connection was lost doing so.
+        usub::uvent::task::Awaitable<bool> flush_deallocations();
+
+        usub::uvent::task::Awaitable<QueryResult>
+        exec_prepared_cached(const std::string &sql, int n_params, const Oid *types,
+                             const char *const *values, const int *lengths, const int *formats,
+                             PgQueryProbe &probe);
+
+        // Timing for PgStatsRegistry and the trace sink; inactive (and free)
+        // when both are off. fingerprint 0 means "hash the SQL text".
+        [[nodiscard]] PgQueryProbe begin_query(std::string_view sql, uint64_t fingerprint) noexcept;
+
+        QueryResult finish_query(PgQueryProbe &probe, QueryResult &&r) noexcept;
+
+        void emit_span(PgTraceSpan &span) noexcept;
+
     private:
         PGconn *conn_{nullptr};
         bool connected_{false};
@@ -845,8 +1398,49 @@ namespace usub::pg {
         > sock_;
 
         uint64_t cursor_seq_{0};
+
+        PgStatementCache stmt_cache_;
+        PgResultFormat result_format_{PgResultFormat::Text};
+        bool stream_active_{false};
+        int stream_chunk_rows_{256};
+        PGresult *stream_res_{nullptr};  // chunk with rows not handed out yet
+        int stream_res_row_{0};
+        std::unordered_set<uint64_t> named_prepared_;
+        // evicted statements still allocated on the server; DEALLOCATE fails
+        // inside an aborted transaction, so these wait for an idle connection
+        std::vector<std::string> pending_deallocate_;
+        uint32_t pool_shard_{0};
+        uint32_t stats_scope_{0};
+        uint64_t bytes_in_{0};  // result cell bytes decoded so far; probes take deltas
+        PgLatencyEwma *latency_ewma_{nullptr};
+        uint64_t id_;
+        std::shared_ptr<const PgTraceConfig> trace_;
+        bool trace_defer_map_{false};
+        bool span_held_{false};
+        PgTraceSpan held_span_;
+        std::string held_sql_;
+        std::chrono::steady_clock::time_point connected_at_{};
+        std::shared_ptr<detail::PgCancelHandle> cancel_;  // lazily, for the deadline watchdog
+        std::shared_ptr<detail::PgIoWait> io_wait_;       // lazily, for pipelined flushes
     };
 
+    template<std::ranges::forward_range R>
+    usub::uvent::task::Awaitable<PgExecManyResult>
+    PgConnectionLibpq::execute_many(const std::string &sql, R &&items, PgExecManyOptions opts) {
+        using E = std::ranges::range_reference_t<R>;
+        constexpr size_t M = detail::count_total_params<E>();
+
+        const auto count = static_cast<size_t>(std::ranges::distance(items));
+
+        ParamBuffer<M> pb;
+        auto it = std::ranges::begin(items);
+        std::function<void(size_t, ParamSlices &)> encode = [&](size_t, ParamSlices &ps) {
+            detail::encode_one(ps, *it);
+            ++it;
+        };
+        co_return co_await this->execute_many_encoded(sql, count, pb.ps, encode, opts);
+    }
+
     template<typename... Args>
     usub::uvent::task::Awaitable<QueryResult>
     PgConnectionLibpq::exec_param_query_nonblocking(const std::string &sql, Args &&... args) {
@@ -860,54 +1454,51 @@ namespace usub::pg {
             co_return out;
         }
 
-        constexpr size_t M = detail::count_total_params<Args...>();
-
-        std::vector<const char *> values(M ? M : 1, nullptr);
-        std::vector<int> lengths(M ? M : 1, 0);
-        std::vector<int> formats(M ? M : 1, 0);
-        std::vector<Oid> types(M ? M : 1, 0);
-
-        std::vector<std::string> temp_strings;
-        temp_strings.reserve(M ? M : 1);
+        PgQueryProbe probe = this->begin_query(sql, 0);
 
-        std::vector<std::vector<char> > temp_bytes;
-        temp_bytes.reserve(M ? M : 1);
-
-        size_t idx = 0;
-        ParamSlices ps{
-            values.data(),
-            lengths.data(),
-            formats.data(),
-            types.data(),
-            &idx,
-            temp_strings,
-            temp_bytes
-        };
+        constexpr size_t M = detail::count_total_params<Args...>();
 
-        (detail::encode_one(ps, std::forward<Args>(args)), ...);
+        ParamBuffer<M> pb;
+        (detail::encode_one(pb.ps, std::forward<Args>(args)), ...);
 
-        const int nParams = static_cast<int>(idx);
+        const int nParams = pb.count();
+        probe.add_params(nParams, pb.values.data(), pb.lengths.data(), pb.formats.data());
 
 #if UPQ_REFLECT_DEBUG
         UPQ_CONN_DBG("SQL: %s", sql.c_str());
         UPQ_CONN_DBG("nParams=%d", nParams);
         for (int i = 0; i < nParams; ++i) {
-            const char *v = values[i];
+            const char *v = pb.values[i];
             UPQ_CONN_DBG("  $%d: type=%u fmt=%d len=%d val=%s",
                          i + 1,
-                         static_cast<unsigned>(types[i]),
-                         formats[i],
-                         lengths[i],
+                         static_cast<unsigned>(pb.types[i]),
+                         pb.formats[i],
+                         pb.lengths[i],
                          v ? v : "NULL");
         }
 #endif
 
+        if (!this->pending_deallocate_.empty()) {
+            if (!(co_await this->flush_deallocations())) {
+                out.code = PgErrorCode::SocketReadFailed;
+                out.error = PQerrorMessage(conn_);
+                co_return this->finish_query(probe, std::move(out));
+            }
+        }
+
+        if (this->stmt_cache_.enabled()) {
+            co_return this->finish_query(
+                probe, co_await exec_prepared_cached(sql, nParams, pb.types.data(), pb.values.data(),
+                                                     pb.lengths.data(), pb.formats.data(), probe));
+        }
+
         if (!PQsendQueryParams(conn_, sql.c_str(), nParams,
-                               types.data(), values.data(), lengths.data(), formats.data(), 0)) {
+                               pb.types.data(), pb.values.data(), pb.lengths.data(), pb.formats.data(),
+                               static_cast<int>(result_format_))) {
             out.code = PgErrorCode::SocketReadFailed;
             out.error = PQerrorMessage(conn_);
             connected_ = false;
-            co_return out;
+            co_return this->finish_query(probe, std::move(out));
         }
 
         for (;;) {
@@ -917,21 +1508,24 @@ namespace usub::pg {
                 out.code = PgErrorCode::SocketReadFailed;
                 out.error = PQerrorMessage(conn_);
                 connected_ = false;
-                co_return out;
+                co_return this->finish_query(probe, std::move(out));
             }
             co_await wait_writable();
         }
+        probe.mark(probe.sent);
 
         for (;;) {
             if (PQconsumeInput(conn_) == 0) {
                 out.code = PgErrorCode::SocketReadFailed;
                 out.error = PQerrorMessage(conn_);
                 connected_ = false;
-                co_return out;
+                co_return this->finish_query(probe, std::move(out));
             }
 
             bool saw_any = false;
             while (PGresult *res = PQgetResult(conn_)) {
+                if (!saw_any && probe.server == std::chrono::steady_clock::time_point{})
+                    probe.mark(probe.server);
                 saw_any = true;
                 const auto st = PQresultStatus(res);
 
@@ -941,10 +1535,13 @@ namespace usub::pg {
 
                     if (out.columns.empty()) {
                         out.columns.reserve(ncols);
+                        out.column_oids.reserve(ncols);
                         for (int c = 0; c < ncols; ++c) {
                             const char *nm = PQfname(res, c);
                             out.columns.emplace_back(nm ? nm : "");
+                            out.column_oids.push_back(static_cast<uint32_t>(PQftype(res, c)));
                         }
+                        out.binary = PQbinaryTuples(res) != 0;
                     }
 
                     if (nrows > 0) out.rows.reserve(out.rows.size() + nrows);
@@ -960,6 +1557,7 @@ namespace usub::pg {
                                 const char *v = PQgetvalue(res, r, c);
                                 const int len = PQgetlength(res, r, c);
                                 row.cols.emplace_back(v, static_cast<size_t>(len));
+                                this->bytes_in_ += static_cast<uint64_t>(len);
                             }
                         }
 
@@ -973,6 +1571,7 @@ namespace usub::pg {
                     out.ok = true;
                     out.code = PgErrorCode::OK;
                     out.rows_affected += extract_rows_affected(res);
+                    out.rolled_back = out.rolled_back || is_rollback_tag(res);
                 } else {
                     fill_server_error_fields(res, out);
                 }
@@ -985,12 +1584,99 @@ namespace usub::pg {
                     out.ok = true;
                     out.code = PgErrorCode::OK;
                 }
-                co_return out;
+                co_return this->finish_query(probe, std::move(out));
             }
 
             co_await wait_readable();
         }
     }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResultView>
+    PgConnectionLibpq::exec_param_query_view_nonblocking(const std::string &sql, Args &&... args) {
+        if (!connected()) {
+            QueryResultView bad;
+            bad.code = PgErrorCode::ConnectionClosed;
+            bad.error = "connection not OK";
+            bad.rows_valid = false;
+            co_return bad;
+        }
+
+        constexpr size_t M = detail::count_total_params<Args...>();
+
+        ParamBuffer<M> pb;
+        (detail::encode_one(pb.ps, std::forward<Args>(args)), ...);
+
+        if (!PQsendQueryParams(conn_, sql.c_str(), pb.count(),
+                               pb.types.data(), pb.values.data(), pb.lengths.data(), pb.formats.data(),
+                               static_cast<int>(result_format_))) {
+            QueryResultView bad;
+            bad.code = PgErrorCode::SocketReadFailed;
+            bad.error = PQerrorMessage(conn_);
+            bad.rows_valid = false;
+            connected_ = false;
+            co_return bad;
+        }
+
+        co_return co_await collect_result_view();
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResult>
+    PgConnectionLibpq::stream_start(const std::string &sql, Args &&... args) {
+        QueryResult out{};
+        out.ok = false;
+        out.rows_valid = false;
+
+        if (!connected()) {
+            out.code = PgErrorCode::ConnectionClosed;
+            out.error = "connection not OK";
+            co_return out;
+        }
+
+        if (stream_active_) {
+            out.code = PgErrorCode::InvalidFuture;
+            out.error = "another stream is active on this connection";
+            co_return out;
+        }
+
+        constexpr size_t M = detail::count_total_params<Args...>();
+
+        ParamBuffer<M> pb;
+        (detail::encode_one(pb.ps, std::forward<Args>(args)), ...);
+
+        if (!PQsendQueryParams(conn_, sql.c_str(), pb.count(),
+                               pb.types.data(), pb.values.data(), pb.lengths.data(), pb.formats.data(),
+                               static_cast<int>(result_format_))) {
+            out.code = PgErrorCode::SocketReadFailed;
+            out.error = PQerrorMessage(conn_);
+            connected_ = false;
+            co_return out;
+        }
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        if (PQsetChunkedRowsMode(conn_, stream_chunk_rows_) != 1) {
+            UPQ_CONN_DBG("stream: PQsetChunkedRowsMode failed, falling back to one result");
+        }
+#else
+        if (PQsetSingleRowMode(conn_) != 1) {
+            UPQ_CONN_DBG("stream: PQsetSingleRowMode failed, falling back to one result");
+        }
+#endif
+
+        if (!(co_await flush_outgoing())) {
+            out.code = PgErrorCode::SocketReadFailed;
+            out.error = PQerrorMessage(conn_);
+            connected_ = false;
+            co_return out;
+        }
+
+        stream_active_ = true;
+        out.ok = true;
+        out.code = PgErrorCode::OK;
+        out.rows_valid = true;
+        co_return out;
+    }
 } // namespace usub::pg
 
 #endif // PGCONNECTIONLIBPQ_H
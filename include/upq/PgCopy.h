@@ -0,0 +1,641 @@
+#ifndef PGCOPY_H
+#define PGCOPY_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "uvent/Uvent.h"
+#include "PgConnection.h"
+#include "PgReflect.h"
+#include "PgTypes.h"
+
+namespace usub::pg {
+    class PgPool;
+
+    namespace detail {
+        // "PGCOPY\n\377\r\n\0", flags, header extension length
+        inline constexpr char copy_binary_signature[] = {'P', 'G', 'C', 'O', 'P', 'Y', '\n', '\377', '\r', '\n', '\0'};
+
+        inline void copy_put_be16(std::string &buf, uint16_t v) {
+            const uint16_t be = to_be16(v);
+            buf.append(reinterpret_cast<const char *>(&be), 2);
+        }
+
+        inline void copy_put_be32(std::string &buf, uint32_t v) {
+            const uint32_t be = to_be32(v);
+            buf.append(reinterpret_cast<const char *>(&be), 4);
+        }
+
+        inline void copy_binary_header(std::string &buf) {
+            buf.append(copy_binary_signature, sizeof(copy_binary_signature));
+            copy_put_be32(buf, 0);
+            copy_put_be32(buf, 0);
+        }
+
+        inline void copy_binary_trailer(std::string &buf) {
+            copy_put_be16(buf, 0xFFFFu);
+        }
+
+        // A target column as the binary COPY stream sees it. `textual`:
+        // string category or enum (or a domain over one), whose binary form
+        // is the text itself.
+        struct CopyColumnType {
+            Oid oid{0};
+            bool textual{false};
+            std::string name;  // as stored in pg_attribute
+        };
+
+        inline int copy_int_width(Oid oid) noexcept {
+            return oid == INT2OID ? 2 : oid == INT4OID ? 4 : oid == INT8OID ? 8 : 0;
+        }
+
+        // Sign-extends a big-endian integer of `from` bytes to `to` bytes.
+        inline void copy_put_widened(std::string &buf, const char *v, int from, int to) {
+            const bool neg = (static_cast<unsigned char>(v[0]) & 0x80u) != 0;
+            copy_put_be32(buf, static_cast<uint32_t>(to));
+            buf.append(static_cast<size_t>(to - from), neg ? '\xFF' : '\0');
+            buf.append(v, static_cast<size_t>(from));
+        }
+
+        // Appends one tuple from slots filled by encode_one, checked against
+        // the target columns. Binary slots must carry the column's own type;
+        // text slots only feed textual columns, json, and jsonb (which gets its
+        // version byte). Anything else, e.g. a std::string into bigint or
+        // uuid, would be read as raw binary and is rejected. The one allowed
+        // conversion is integer widening (int2/int4 into a wider integer).
+        inline bool copy_binary_append_tuple(std::string &buf, const ParamSlices &ps, int n,
+                                             const CopyColumnType *cols, std::string *err) {
+            copy_put_be16(buf, static_cast<uint16_t>(n));
+            for (int i = 0; i < n; ++i) {
+                const char *v = ps.values[i];
+                if (!v) {
+                    copy_put_be32(buf, 0xFFFFFFFFu);
+                    continue;
+                }
+
+                const Oid oid = ps.types[i];
+                const CopyColumnType &col = cols[i];
+                const uint32_t len = static_cast<uint32_t>(ps.lengths[i]);
+
+                if (ps.formats[i] == 1) {
+                    const int from = copy_int_width(oid);
+                    const int to = copy_int_width(col.oid);
+                    if (from && to > from && len == static_cast<uint32_t>(from)) {
+                        copy_put_widened(buf, v, from, to);
+                        continue;
+                    }
+                    if (oid != 0 && oid != col.oid) {
+                        if (err)
+                            *err = "COPY binary: field " + std::to_string(i) + " is " + pg_type_name_from_oid(oid) +
+                                   ", column is " + pg_type_name_from_oid(col.oid);
+                        return false;
+                    }
+                    copy_put_be32(buf, len);
+                    buf.append(v, len);
+                } else if (col.oid == JSONBOID) {
+                    copy_put_be32(buf, len + 1);
+                    buf.push_back('\1');
+                    buf.append(v, len);
+                } else if (col.textual || col.oid == JSONOID) {
+                    copy_put_be32(buf, len);
+                    buf.append(v, len);
+                } else {
+                    if (err)
+                        *err = "COPY binary: field " + std::to_string(i) + " is text-encoded, column type " +
+                               pg_type_name_from_oid(col.oid) + " needs its binary form";
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        inline void copy_quote_ident(std::string &out, std::string_view id) {
+            out.push_back('"');
+            for (char c: id) {
+                if (c == '"') out.push_back('"');
+                out.push_back(c);
+            }
+            out.push_back('"');
+        }
+
+        // Table name for COPY, read the way SQL reads it: double-quoted parts
+        // are kept as given, unquoted ones are folded to lower case and then
+        // quoted, so `Public.Users` names public.users and `"Users"` stays.
+        inline std::string copy_quote_name(std::string_view name) {
+            std::string out;
+            out.reserve(name.size() + 4);
+            size_t i = 0;
+            while (i <= name.size()) {
+                if (i < name.size() && name[i] == '"') {
+                    const size_t start = i++;
+                    while (i < name.size()) {
+                        if (name[i] == '"' && (i + 1 >= name.size() || name[i + 1] != '"')) break;
+                        i += name[i] == '"' ? 2 : 1;
+                    }
+                    out.append(name.substr(start, i + 1 - start));
+                    ++i;
+                } else {
+                    const size_t dot = std::min(name.find('.', i), name.size());
+                    std::string part(name.substr(i, dot - i));
+                    for (char &ch: part)
+                        if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+                    copy_quote_ident(out, part);
+                    i = dot;
+                }
+                if (i >= name.size()) break;
+                out.push_back('.');
+                ++i;
+            }
+            return out;
+        }
+
+        // The matched columns by their catalog names; tuples write every column.
+        template<class T>
+        inline std::string copy_column_list(const std::vector<CopyColumnType> &cols) {
+            if constexpr (ReflectAggregate<T> && !is_tuple_like_v<T>) {
+                std::string out = " (";
+                for (size_t i = 0; i < cols.size(); ++i) {
+                    if (i) out += ", ";
+                    copy_quote_ident(out, cols[i].name);
+                }
+                out += ")";
+                return out;
+            } else {
+                return {};
+            }
+        }
+
+        // Column names, types and whether each is textual, in table order.
+        inline constexpr const char *copy_target_types_sql =
+            "SELECT a.attname::text AS name, a.atttypid::int8 AS oid, "
+            "(CASE WHEN t.typtype = 'd' THEN b.typcategory ELSE t.typcategory END) IN ('S', 'E') AS textual "
+            "FROM pg_attribute a JOIN pg_type t ON t.oid = a.atttypid "
+            "LEFT JOIN pg_type b ON b.oid = t.typbasetype "
+            "WHERE a.attrelid = $1::regclass AND a.attnum > 0 AND NOT a.attisdropped AND a.attgenerated = '' "
+            "ORDER BY a.attnum";
+
+        // The columns the COPY writes, in stream order: members by name for
+        // aggregates (compared with normalize_ident, like the named reflect
+        // mapping), every column for tuples.
+        template<class T>
+        inline bool copy_target_types(const QueryResult &qr, std::vector<CopyColumnType> &out, std::string *err) {
+            struct Column {
+                std::string name;
+                CopyColumnType type;
+            };
+            std::vector<Column> all;
+            all.reserve(qr.rows.size());
+            for (const auto &row: qr.rows) {
+                auto name = row.get<std::string>(qr, "name");
+                auto oid = row.get<int64_t>(qr, "oid");
+                auto textual = row.get<bool>(qr, "textual");
+                if (!name || !oid || !textual) {
+                    if (err) *err = "COPY: unreadable pg_attribute row";
+                    return false;
+                }
+                all.push_back(Column{normalize_ident(*name),
+                                     CopyColumnType{static_cast<Oid>(*oid), *textual, std::move(*name)}});
+            }
+
+            out.clear();
+            if constexpr (ReflectAggregate<T> && !is_tuple_like_v<T>) {
+                for (std::string_view member: ureflect::member_names<T>) {
+                    const std::string key = normalize_ident(member);
+                    auto it = std::find_if(all.begin(), all.end(), [&](const Column &c) { return c.name == key; });
+                    if (it == all.end()) {
+                        if (err) *err = "COPY: table has no column \"" + std::string(member) + "\"";
+                        return false;
+                    }
+                    out.push_back(it->type);
+                }
+            } else {
+                for (const Column &c: all) out.push_back(c.type);
+            }
+
+            if (out.size() != count_total_params<T>()) {
+                if (err)
+                    *err = "COPY: row type encodes " + std::to_string(count_total_params<T>()) + " fields for " +
+                           std::to_string(out.size()) + " columns";
+                return false;
+            }
+            return true;
+        }
+
+        enum class CopyParse : uint8_t { NeedMore, Tuple, Trailer, Corrupt };
+
+        // Consumes the 19-byte file header plus any header extension.
+        inline CopyParse copy_binary_parse_header(std::string_view in, size_t &used) {
+            constexpr size_t fixed = sizeof(copy_binary_signature) + 8;
+            if (in.size() < fixed) return CopyParse::NeedMore;
+            if (std::memcmp(in.data(), copy_binary_signature, sizeof(copy_binary_signature)) != 0)
+                return CopyParse::Corrupt;
+            const uint32_t ext = load_be<uint32_t>(in.data() + sizeof(copy_binary_signature) + 4);
+            if (in.size() - fixed < ext) return CopyParse::NeedMore;
+            used = fixed + ext;
+            return CopyParse::Tuple;
+        }
+
+        // Splits one tuple into cells viewing `in`; a NULL field is a
+        // default-constructed view (data() == nullptr). Nothing is consumed
+        // until the whole tuple is available.
+        inline CopyParse copy_binary_parse_tuple(std::string_view in, size_t &used,
+                                                 std::vector<std::string_view> &cells) {
+            if (in.size() < 2) return CopyParse::NeedMore;
+            const auto n = static_cast<int16_t>(load_be<uint16_t>(in.data()));
+            if (n == -1) {
+                used = 2;
+                return CopyParse::Trailer;
+            }
+            if (n < 0) return CopyParse::Corrupt;
+
+            cells.clear();
+            size_t off = 2;
+            for (int16_t i = 0; i < n; ++i) {
+                if (in.size() - off < 4) return CopyParse::NeedMore;
+                const auto len = static_cast<int32_t>(load_be<uint32_t>(in.data() + off));
+                off += 4;
+                if (len == -1) {
+                    cells.emplace_back();
+                    continue;
+                }
+                if (len < 0) return CopyParse::Corrupt;
+                if (in.size() - off < static_cast<size_t>(len)) return CopyParse::NeedMore;
+                cells.emplace_back(in.data() + off, static_cast<size_t>(len));
+                off += static_cast<size_t>(len);
+            }
+            used = off;
+            return CopyParse::Tuple;
+        }
+
+        // Whether a member of type F can read a binary cell of column type
+        // `oid`, mirroring decode_binary_builtin; types it does not know go
+        // to the registry (custom decoders) and are checked per cell.
+        template<class F>
+        inline bool copy_out_accepts(uint32_t oid) noexcept {
+            if constexpr (Optional<F>) {
+                return copy_out_accepts<typename F::value_type>(oid);
+            } else if constexpr (std::is_same_v<F, bool>) {
+                return oid == BOOLOID;
+            } else if constexpr (std::is_integral_v<F>) {
+                return oid == INT2OID || oid == INT4OID || oid == INT8OID || oid == OIDOID || is_text_like_oid(oid);
+            } else if constexpr (std::is_floating_point_v<F>) {
+                return oid == FLOAT4OID || oid == FLOAT8OID || oid == NUMERICOID || oid == INT2OID ||
+                       oid == INT4OID || oid == INT8OID || is_text_like_oid(oid);
+            } else if constexpr (std::is_same_v<F, std::string>) {
+                return true;  // any built-in column renders as its text form
+            } else if constexpr (std::is_same_v<F, std::vector<uint8_t> > || std::is_same_v<F, std::vector<char> >) {
+                return oid == BYTEAOID;
+            } else if constexpr (is_binary_array_target<F>::value) {
+                return is_builtin_array_oid(oid);
+            } else if constexpr (is_sys_time_point<F>::value) {
+                return oid == TIMESTAMPTZOID || oid == TIMESTAMPOID || oid == DATEOID;
+            } else {
+                return true;
+            }
+        }
+
+        template<class F>
+        inline bool copy_decode_cell(std::string_view sv, F &out, uint32_t oid) {
+            if (sv.data() == nullptr) {
+                if constexpr (Optional<F>) {
+                    out.reset();
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+            return decode_field(sv, out, true, oid);
+        }
+
+        // f(index, member) for every member of a row type.
+        template<class T, size_t N, class Fn>
+        inline void copy_for_each_member(T &row, Fn &&f) {
+            if constexpr (is_tuple_like_v<T>) {
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    (f(I, std::get<I>(row)), ...);
+                }(std::make_index_sequence<N>{});
+            } else {
+                auto tie = ureflect::to_tie(row);
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    (f(I, ureflect::get<I>(tie)), ...);
+                }(std::make_index_sequence<N>{});
+            }
+        }
+
+        // Checks the row type against the described result columns before
+        // any tuple is read, the way copy_target_types does for COPY IN.
+        template<class T, size_t N>
+        inline bool copy_out_check(const std::vector<uint32_t> &oids, std::string *err) {
+            if (oids.size() != N) {
+                if (err)
+                    *err = "COPY query returns " + std::to_string(oids.size()) + " columns, row type has " +
+                           std::to_string(N) + " members";
+                return false;
+            }
+            bool ok = true;
+            T probe{};
+            copy_for_each_member<T, N>(probe, [&]<class F>(size_t c, F &) {
+                if (!ok || copy_out_accepts<F>(oids[c])) return;
+                if (err)
+                    *err = "COPY column " + std::to_string(c) + " is " + pg_type_name_from_oid(oids[c]) +
+                           ", member needs " + expect_type<F>();
+                ok = false;
+            });
+            return ok;
+        }
+
+        // Decodes a tuple into T; member i reads field i as column type oids[i].
+        template<class T, size_t N>
+        inline bool copy_decode_tuple(const std::vector<std::string_view> &cells, const std::vector<uint32_t> &oids,
+                                      T &dst, std::string *err) {
+            if (cells.size() != N || oids.size() != N) {
+                if (err)
+                    *err = "COPY tuple has " + std::to_string(cells.size()) + " fields, row type has " +
+                           std::to_string(N) + " members";
+                return false;
+            }
+
+            bool ok = true;
+            copy_for_each_member<T, N>(dst, [&]<class F>(size_t c, F &field) {
+                // cells view the reader's buffer, which is compacted on the next fill
+                static_assert(!std::is_same_v<std::remove_cvref_t<F>, std::string_view> &&
+                              !std::is_same_v<std::remove_cvref_t<F>, std::optional<std::string_view> >,
+                              "COPY OUT rows outlive the receive buffer; use std::string, not std::string_view");
+                if (!ok) return;
+                F tmp{};
+                if (!copy_decode_cell(cells[c], tmp, oids[c])) {
+                    if (err)
+                        *err = "COPY column " + std::to_string(c) +
+                               (cells[c].data() ? " (" + pg_type_name_from_oid(oids[c]) + ") does not decode as "
+                                                : " is NULL for ") + expect_type<F>();
+                    ok = false;
+                    return;
+                }
+                field = std::move(tmp);
+            });
+            return ok;
+        }
+
+        template<class T>
+        consteval size_t copy_out_members() {
+            if constexpr (is_tuple_like_v<T>) return std::tuple_size_v<T>;
+            else return ureflect::count_members<T>;
+        }
+    } // namespace detail
+
+    // Owns a connection in COPY FROM STDIN (FORMAT binary) state and a
+    // reusable send buffer that is flushed once it reaches chunk_bytes.
+    class PgCopyInWriter {
+    public:
+        static constexpr size_t default_chunk_bytes = 1u << 20;
+
+        PgCopyInWriter() = default;
+
+        PgCopyInWriter(PgPool *pool, std::shared_ptr<PgConnectionLibpq> conn, size_t chunk_bytes);
+
+        PgCopyInWriter(PgCopyInWriter &&o) noexcept;
+
+        PgCopyInWriter &operator=(PgCopyInWriter &&o) noexcept;
+
+        PgCopyInWriter(const PgCopyInWriter &) = delete;
+
+        PgCopyInWriter &operator=(const PgCopyInWriter &) = delete;
+
+        // An unfinished COPY leaves the connection busy; the pool drops it.
+        ~PgCopyInWriter();
+
+        [[nodiscard]] std::string &buffer() noexcept { return this->buf_; }
+        [[nodiscard]] bool full() const noexcept { return this->buf_.size() >= this->chunk_bytes_; }
+        [[nodiscard]] bool active() const noexcept { return this->conn_ != nullptr; }
+
+        // Sends the buffered bytes; the buffer keeps its capacity.
+        usub::uvent::task::Awaitable<std::optional<PgOpError> > flush();
+
+        // Writes the trailer, ends the COPY and returns the connection.
+        usub::uvent::task::Awaitable<std::expected<uint64_t, PgOpError> > finish();
+
+    private:
+        void release() noexcept;
+
+        PgPool *pool_{nullptr};
+        std::shared_ptr<PgConnectionLibpq> conn_;
+        size_t chunk_bytes_{default_chunk_bytes};
+        std::string buf_;
+    };
+
+    // Typed bulk loader: rows of T are encoded straight into the COPY binary
+    // stream with the same scalar encoders as query parameters.
+    template<class T>
+    class PgCopyInSink {
+    public:
+        static constexpr size_t fields = detail::count_total_params<T>();
+
+        PgCopyInSink() = default;
+
+        PgCopyInSink(PgCopyInWriter writer, std::vector<detail::CopyColumnType> columns)
+            : writer_(std::move(writer))
+              , columns_(std::move(columns))
+              , slots_(std::make_unique<ParamBuffer<fields> >()) {
+        }
+
+        usub::uvent::task::Awaitable<std::optional<PgOpError> > write(const T &row) {
+            if (auto e = this->append(row)) co_return e;
+            if (this->writer_.full()) co_return co_await this->writer_.flush();
+            co_return std::nullopt;
+        }
+
+        usub::uvent::task::Awaitable<std::optional<PgOpError> > write(std::span<const T> rows) {
+            for (const T &row: rows) {
+                if (auto e = this->append(row)) co_return e;
+                if (this->writer_.full()) {
+                    if (auto e = co_await this->writer_.flush()) co_return e;
+                }
+            }
+            co_return std::nullopt;
+        }
+
+        // Rows written so far (as seen by the client).
+        [[nodiscard]] uint64_t rows() const noexcept { return this->rows_; }
+
+        usub::uvent::task::Awaitable<std::expected<uint64_t, PgOpError> > finish() {
+            co_return co_await this->writer_.finish();
+        }
+
+    private:
+        std::optional<PgOpError> append(const T &row) {
+            if (!this->writer_.active())
+                return PgOpError{PgErrorCode::InvalidFuture, "COPY sink is not active", {}};
+
+            ParamBuffer<fields> &pb = *this->slots_;
+            pb.reset();
+            detail::encode_one(pb.ps, row);
+
+            std::string &buf = this->writer_.buffer();
+            const size_t mark = buf.size();
+            std::string err;
+            if (!detail::copy_binary_append_tuple(buf, pb.ps, pb.count(), this->columns_.data(), &err)) {
+                buf.resize(mark);  // keep the stream well-formed
+                return PgOpError{PgErrorCode::ParserTruncatedField, std::move(err), {}};
+            }
+            ++this->rows_;
+            return std::nullopt;
+        }
+
+        PgCopyInWriter writer_;
+        std::vector<detail::CopyColumnType> columns_;
+        std::unique_ptr<ParamBuffer<fields> > slots_;
+        uint64_t rows_{0};
+    };
+    // Owns a connection in COPY TO STDOUT state and the receive buffer the
+    // binary stream is parsed from. Consumed bytes are compacted away before
+    // the next message is appended, so the buffer only ever holds the tail of
+    // an incomplete tuple plus one CopyData message and keeps its capacity.
+    class PgCopyOutReader {
+    public:
+        static constexpr size_t default_buffer_bytes = 256u << 10;
+
+        PgCopyOutReader() = default;
+
+        PgCopyOutReader(PgPool *pool, std::shared_ptr<PgConnectionLibpq> conn, size_t buffer_bytes);
+
+        PgCopyOutReader(PgCopyOutReader &&o) noexcept;
+
+        PgCopyOutReader &operator=(PgCopyOutReader &&o) noexcept;
+
+        PgCopyOutReader(const PgCopyOutReader &) = delete;
+
+        PgCopyOutReader &operator=(const PgCopyOutReader &) = delete;
+
+        // An unfinished COPY leaves the connection busy; the pool drops it.
+        ~PgCopyOutReader();
+
+        [[nodiscard]] std::string_view pending() const noexcept {
+            return std::string_view(this->buf_).substr(this->pos_);
+        }
+
+        void consume(size_t n) noexcept { this->pos_ += n; }
+
+        // True once the server reported the end of the COPY.
+        [[nodiscard]] bool finished() const noexcept { return this->finished_; }
+
+        // Appends the next CopyData message; at the end of the COPY the
+        // connection goes back to the pool and finished() turns true.
+        usub::uvent::task::Awaitable<std::optional<PgOpError> > fill();
+
+    private:
+        void release() noexcept;
+
+        PgPool *pool_{nullptr};
+        std::shared_ptr<PgConnectionLibpq> conn_;
+        std::string buf_;
+        size_t pos_{0};
+        bool finished_{true};
+    };
+
+    // Typed export: decodes COPY (query) TO STDOUT (FORMAT binary) straight
+    // into batches of T. The stream carries neither names nor types, so
+    // members map by position and each cell is decoded by the column type
+    // Describe reported for the query (see copy_out_describe).
+    template<class T>
+    class PgCopyOutStream {
+    public:
+        static constexpr size_t members = detail::copy_out_members<T>();
+
+        PgCopyOutStream() = default;
+
+        PgCopyOutStream(PgCopyOutReader reader, uint32_t batch_rows, std::vector<uint32_t> oids)
+            : reader_(std::move(reader))
+              , oids_(std::move(oids))
+              , batch_rows_(batch_rows ? batch_rows : 1)
+              , done_(false) {
+            this->cells_.reserve(members);
+        }
+
+        // Next batch of at most batch_rows rows. An empty vector together
+        // with done() marks the end of the export.
+        usub::uvent::task::Awaitable<std::expected<std::vector<T>, PgOpError> > next() {
+            std::vector<T> out;
+            if (this->done_)
+                co_return out;
+            out.reserve(this->batch_rows_);
+
+            while (out.size() < this->batch_rows_) {
+                detail::CopyParse st = detail::CopyParse::NeedMore;
+                size_t used = 0;
+                if (!this->trailer_) {
+                    const std::string_view in = this->reader_.pending();
+                    st = this->header_
+                             ? detail::copy_binary_parse_tuple(in, used, this->cells_)
+                             : detail::copy_binary_parse_header(in, used);
+                }
+
+                if (st == detail::CopyParse::Corrupt)
+                    co_return this->fail(PgErrorCode::ProtocolCorrupt, "COPY binary stream is malformed");
+
+                if (st == detail::CopyParse::Tuple) {
+                    if (!this->header_) {
+                        this->header_ = true;
+                    } else {
+                        T row{};
+                        std::string err;
+                        if (!detail::copy_decode_tuple<T, members>(this->cells_, this->oids_, row, &err))
+                            co_return this->fail(PgErrorCode::ParserTruncatedField, std::move(err));
+                        out.push_back(std::move(row));
+                    }
+                    this->reader_.consume(used);
+                    continue;
+                }
+
+                if (st == detail::CopyParse::Trailer) {
+                    this->trailer_ = true;
+                    this->reader_.consume(used);
+                }
+
+                if (this->reader_.finished()) {
+                    if (!this->trailer_)
+                        co_return this->fail(PgErrorCode::ProtocolCorrupt, "COPY ended inside a tuple");
+                    this->done_ = true;
+                    break;
+                }
+
+                // after the trailer this only collects the command completion
+                if (auto e = co_await this->reader_.fill()) {
+                    this->done_ = true;
+                    co_return std::unexpected(std::move(*e));
+                }
+            }
+
+            co_return out;
+        }
+
+        [[nodiscard]] bool done() const noexcept { return this->done_; }
+        [[nodiscard]] uint32_t batch_rows() const noexcept { return this->batch_rows_; }
+
+    private:
+        std::unexpected<PgOpError> fail(PgErrorCode code, std::string msg) {
+            this->done_ = true;
+            this->reader_ = PgCopyOutReader{};  // drops the half-read connection
+            return std::unexpected(PgOpError{code, std::move(msg), {}});
+        }
+
+        PgCopyOutReader reader_;
+        std::vector<uint32_t> oids_;
+        std::vector<std::string_view> cells_;
+        uint32_t batch_rows_{1024};
+        bool header_{false};
+        bool trailer_{false};
+        bool done_{true};
+    };
+} // namespace usub::pg
+
+#endif // PGCOPY_H
@@ -3,12 +3,17 @@
 
 #include <libpq-fe.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <deque>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -19,14 +24,28 @@
 #include "PgTypes.h"
 #include "utils/ConnInfo.h"
 #include "uvent/Uvent.h"
+#include "uvent/sync/AsyncSemaphore.h"
 #include "uvent/utils/datastructures/queue/ConcurrentQueues.h"
 
 namespace usub::pg {
+    struct PgNotification {
+        std::string channel;
+        std::string payload;
+        int backend_pid{0};
+    };
+
     struct IPgNotifyHandler {
         virtual usub::uvent::task::Awaitable<void> operator()(std::string channel,
                                                               std::string payload,
                                                               int backend_pid) = 0;
 
+        // Lane dispatch (Config::dispatch_lanes > 0) hands over runs of one
+        // channel's events, in order. Override to process them together.
+        virtual usub::uvent::task::Awaitable<void> on_batch(std::span<const PgNotification> batch) {
+            for (const auto &n: batch)
+                co_await (*this)(n.channel, n.payload, n.backend_pid);
+        }
+
         virtual ~IPgNotifyHandler() = default;
     };
 
@@ -36,22 +55,42 @@ namespace usub::pg {
             size_t channel_queue_capacity;
             size_t pending_after_disconnect_capacity;
             uint64_t reconnect_backoff_us;
+            // Cap on handler calls for one channel still running at once; an
+            // event arriving past it is dropped (dropped_recursive). 0: no cap.
             uint32_t max_recursive_depth;
             uint32_t rate_limit_per_sec;
+            // 0: one worker per channel, one co_spawn per handler call.
+            // N: N lane coroutines; events are hashed to a lane by channel (and
+            // partition key), drained in batches, and handlers are awaited in
+            // order within a lane.
+            uint32_t dispatch_lanes;
+            // 0: lanes are co_spawned on the thread that calls run().
+            // T: lane i is pinned to uvent thread i % T (co_spawn_static), so
+            // lanes run in parallel; T must not exceed the Uvent thread count.
+            uint32_t lane_threads;
 
             constexpr Config(size_t channel_queue_capacity_ = 256,
                              size_t pending_after_disconnect_capacity_ = 1024,
                              uint64_t reconnect_backoff_us_ = 100000,
                              uint32_t max_recursive_depth_ = 4,
-                             uint32_t rate_limit_per_sec_ = 1000) noexcept
+                             uint32_t rate_limit_per_sec_ = 1000,
+                             uint32_t dispatch_lanes_ = 0,
+                             uint32_t lane_threads_ = 0) noexcept
                 : channel_queue_capacity(channel_queue_capacity_),
                   pending_after_disconnect_capacity(pending_after_disconnect_capacity_),
                   reconnect_backoff_us(reconnect_backoff_us_),
                   max_recursive_depth(max_recursive_depth_),
-                  rate_limit_per_sec(rate_limit_per_sec_) {
+                  rate_limit_per_sec(rate_limit_per_sec_),
+                  dispatch_lanes(dispatch_lanes_),
+                  lane_threads(lane_threads_) {
             }
         };
 
+        // Lane dispatch: events with equal (channel, key) keep their order;
+        // one channel may then be handled from several lanes at once.
+        using PartitionKeyFn = std::function<std::string_view(std::string_view channel,
+                                                               std::string_view payload)>;
+
         struct HandlerHandle {
             uint64_t id;
             std::string channel;
@@ -72,23 +111,45 @@ namespace usub::pg {
               cfg_(cfg),
               keepalive_config_(keepalive_config) {
             next_handler_id_.store(1, std::memory_order_relaxed);
+            for (uint32_t i = 0; i < cfg_.dispatch_lanes; ++i)
+                lanes_.push_back(std::make_shared<DispatchLane>());
+            staged_.resize(lanes_.size());
+        }
+
+        // Parked channel workers and lanes wake up and exit without touching *this.
+        ~PgNotificationMultiplexer() {
+            for (auto &kv: channel_runtime_) {
+                kv.second->closed.store(true, std::memory_order_release);
+                kv.second->ready.release();
+            }
+            for (auto &lane: lanes_) {
+                lane->closed.store(true, std::memory_order_release);
+                lane->ready.release();
+            }
         }
 
+        // Set before run().
+        void set_partition_key(PartitionKeyFn fn) { partition_key_ = std::move(fn); }
+
         usub::uvent::task::Awaitable<std::optional<HandlerHandle> > add_handler(
             const std::string &channel, std::shared_ptr<IPgNotifyHandler> handler) {
             uint64_t hid = next_handler_id_.fetch_add(1, std::memory_order_relaxed);
 
             bool is_wild = is_wildcard(channel);
             if (is_wild) {
+                std::lock_guard lk(handlers_mu_);
                 auto &info = wildcard_[channel];
                 info.handlers.emplace_back(hid, std::move(handler));
                 co_return HandlerHandle{hid, channel, true};
             }
 
-            auto &ci = exact_[channel];
-            bool first_for_channel = ci.handlers.empty();
-
-            ci.handlers.emplace_back(hid, std::move(handler));
+            bool first_for_channel;
+            {
+                std::lock_guard lk(handlers_mu_);
+                auto &ci = exact_[channel];
+                first_for_channel = ci.handlers.empty();
+                ci.handlers.emplace_back(hid, std::move(handler));
+            }
             ensure_channel_runtime(channel);
 
             if (first_for_channel) {
@@ -101,6 +162,7 @@ namespace usub::pg {
         }
 
         bool remove_handler(const HandlerHandle &h) {
+            std::lock_guard lk(handlers_mu_);
             if (h.wildcard) {
                 auto it = wildcard_.find(h.channel);
                 if (it == wildcard_.end()) return false;
@@ -126,7 +188,7 @@ namespace usub::pg {
                     if (vec.empty()) {
                         unlisten_channel_sync(h.channel);
                         exact_.erase(it);
-                        channel_runtime_.erase(h.channel);
+                        erase_channel_runtime(h.channel);
                     }
                     return true;
                 }
@@ -135,6 +197,7 @@ namespace usub::pg {
         }
 
         bool remove_channel(const std::string &channel) {
+            std::lock_guard lk(handlers_mu_);
             bool is_wild = is_wildcard(channel);
             if (is_wild) {
                 auto it = wildcard_.find(channel);
@@ -147,7 +210,7 @@ namespace usub::pg {
             if (it == exact_.end()) return false;
             unlisten_channel_sync(channel);
             exact_.erase(it);
-            channel_runtime_.erase(channel);
+            erase_channel_runtime(channel);
             return true;
         }
 
@@ -192,24 +255,45 @@ namespace usub::pg {
 
                     PQfreemem(n);
                 }
+                // one hand-off per lane for everything this read produced
+                flush_staged();
             }
 
             co_return;
         }
 
+        struct ChannelStats {
+            std::string channel;
+            uint64_t queue_depth = 0;  // queued, not yet handed to handlers
+            uint64_t delivered = 0;
+            uint64_t dropped_overflow = 0;
+            uint64_t dropped_recursive = 0;
+            uint64_t dropped_rate_limited = 0;
+        };
+
         struct Stats {
             uint64_t dropped_overflow = 0;
             uint64_t dropped_recursive = 0;
             uint64_t dropped_rate_limited = 0;
+            std::vector<ChannelStats> channels;
         };
 
         Stats stats() const {
             Stats s;
+            s.channels.reserve(channel_runtime_.size());
             for (auto const &kv: channel_runtime_) {
-                s.dropped_overflow += kv.second.dropped_overflow.load(std::memory_order_relaxed);
-                s.dropped_recursive += kv.second.dropped_recursive.load(std::memory_order_relaxed);
-                s.dropped_rate_limited +=
-                        kv.second.dropped_rate_limited.load(std::memory_order_relaxed);
+                const auto &st = *kv.second;
+                ChannelStats cs;
+                cs.channel = kv.first;
+                cs.queue_depth = st.depth.load(std::memory_order_relaxed);
+                cs.delivered = st.delivered.load(std::memory_order_relaxed);
+                cs.dropped_overflow = st.dropped_overflow.load(std::memory_order_relaxed);
+                cs.dropped_recursive = st.dropped_recursive.load(std::memory_order_relaxed);
+                cs.dropped_rate_limited = st.dropped_rate_limited.load(std::memory_order_relaxed);
+                s.dropped_overflow += cs.dropped_overflow;
+                s.dropped_recursive += cs.dropped_recursive;
+                s.dropped_rate_limited += cs.dropped_rate_limited;
+                s.channels.push_back(std::move(cs));
             }
             return s;
         }
@@ -229,12 +313,19 @@ namespace usub::pg {
             int pid;
         };
 
+        // Shared with the channel's worker, which parks on `ready` (one permit
+        // per queued event) and exits once `closed` is set.
         struct ChannelRuntimeState {
             usub::queue::concurrent::MPMCQueue<PendingEvent> queue;
+            usub::uvent::sync::AsyncSemaphore ready{0};
+            std::atomic<bool> closed{false};
             std::atomic<bool> worker_running{false};
+            std::atomic<uint64_t> depth{0};
+            std::atomic<uint64_t> delivered{0};
             std::atomic<uint64_t> dropped_overflow{0};
             std::atomic<uint64_t> dropped_recursive{0};
             std::atomic<uint64_t> dropped_rate_limited{0};
+            std::atomic<uint32_t> handlers_running{0};  // events whose handlers still run
             std::atomic<uint64_t> last_tick_ns{0};
             std::atomic<uint32_t> tick_count{0};
 
@@ -253,9 +344,51 @@ namespace usub::pg {
             ChannelRuntimeState &operator=(const ChannelRuntimeState &) = delete;
         };
 
-        inline static thread_local uint32_t tls_dispatch_depth = 0;
-        inline static thread_local std::string tls_last_channel;
-        inline static thread_local std::string tls_last_payload;
+        struct LaneEvent {
+            PgNotification n;
+            std::shared_ptr<ChannelRuntimeState> st;
+        };
+
+        struct DispatchLane {
+            std::mutex mu;
+            std::vector<LaneEvent> pending;  // guarded by mu
+            usub::uvent::sync::AsyncSemaphore ready{0};
+            std::atomic<bool> closed{false};
+        };
+
+        // Recursion guard: a handler that NOTIFYs its own channel and is still
+        // running when the echo arrives nests one level deeper. Only that is
+        // refused; repeated identical events from handlers that have returned
+        // (refresh pings, cache tags) always go through.
+        bool admit_nested(ChannelRuntimeState &st) const noexcept {
+            return cfg_.max_recursive_depth == 0 ||
+                   st.handlers_running.load(std::memory_order_acquire) < cfg_.max_recursive_depth;
+        }
+
+        // One dispatched event; it counts toward the depth from the moment
+        // its first handler starts until the last one returns. Calls that are
+        // spawned but not yet scheduled are not nesting and do not count.
+        struct NestedCall {
+            std::shared_ptr<ChannelRuntimeState> st;
+            std::atomic<bool> entered{false};
+
+            explicit NestedCall(std::shared_ptr<ChannelRuntimeState> s) noexcept : st(std::move(s)) {
+            }
+
+            void enter() noexcept {
+                if (!this->entered.exchange(true, std::memory_order_acq_rel))
+                    this->st->handlers_running.fetch_add(1, std::memory_order_acq_rel);
+            }
+
+            ~NestedCall() {
+                if (this->entered.load(std::memory_order_acquire))
+                    this->st->handlers_running.fetch_sub(1, std::memory_order_acq_rel);
+            }
+
+            NestedCall(const NestedCall &) = delete;
+
+            NestedCall &operator=(const NestedCall &) = delete;
+        };
 
         static bool is_wildcard(const std::string &ch) {
             size_t n = ch.size();
@@ -345,6 +478,7 @@ namespace usub::pg {
                 dispatch_event(ev.channel, ev.payload, ev.pid);
             }
             pending_after_disconnect_.clear();
+            flush_staged();
         }
 
         usub::uvent::task::Awaitable<bool> listen_channel(const std::string &channel) {
@@ -365,18 +499,38 @@ namespace usub::pg {
         void ensure_channel_runtime(const std::string &channel) {
             if (channel_runtime_.find(channel) != channel_runtime_.end()) return;
 
-            channel_runtime_.emplace(std::piecewise_construct, std::forward_as_tuple(channel),
-                                     std::forward_as_tuple(cfg_.channel_queue_capacity));
+            channel_runtime_.emplace(channel, std::make_shared<ChannelRuntimeState>(cfg_.channel_queue_capacity));
+        }
+
+        void erase_channel_runtime(const std::string &channel) {
+            auto it = channel_runtime_.find(channel);
+            if (it == channel_runtime_.end()) return;
+            it->second->closed.store(true, std::memory_order_release);
+            it->second->ready.release();
+            channel_runtime_.erase(it);
         }
 
         void start_channel_workers() {
+            if (!lanes_.empty()) {
+                if (!lanes_started_) {
+                    lanes_started_ = true;
+                    for (size_t i = 0; i < lanes_.size(); ++i) {
+                        if (cfg_.lane_threads > 0) {
+                            usub::uvent::system::co_spawn_static(lane_worker(lanes_[i], this),
+                                                                 int(i % cfg_.lane_threads));
+                        } else {
+                            usub::uvent::system::co_spawn(lane_worker(lanes_[i], this));
+                        }
+                    }
+                }
+                return;
+            }
             for (auto &kv: channel_runtime_) {
-                auto &state = kv.second;
+                auto &state = *kv.second;
                 bool expected = false;
                 if (state.worker_running.compare_exchange_strong(
                     expected, true, std::memory_order_acq_rel, std::memory_order_relaxed)) {
-                    std::string ch_copy = kv.first;
-                    usub::uvent::system::co_spawn(channel_worker(ch_copy, this));
+                    usub::uvent::system::co_spawn(channel_worker(kv.second, this));
                 }
             }
         }
@@ -398,20 +552,18 @@ namespace usub::pg {
                 }
 
                 auto insert_res = channel_runtime_.emplace(
-                    std::piecewise_construct, std::forward_as_tuple(std::string(ch)),
-                    std::forward_as_tuple(cfg_.channel_queue_capacity));
+                    std::string(ch), std::make_shared<ChannelRuntimeState>(cfg_.channel_queue_capacity));
 
                 it = insert_res.first;
 
                 bool expected = false;
-                if (it->second.worker_running.compare_exchange_strong(
+                if (lanes_.empty() && it->second->worker_running.compare_exchange_strong(
                     expected, true, std::memory_order_acq_rel, std::memory_order_relaxed)) {
-                    std::string ch_copy2 = it->first;
-                    usub::uvent::system::co_spawn(channel_worker(ch_copy2, this));
+                    usub::uvent::system::co_spawn(channel_worker(it->second, this));
                 }
             }
 
-            auto &state = it->second;
+            auto &state = *it->second;
             PendingEvent ev{std::string(ch), std::string(payload), pid};
 
             if (!push_rate_limited(state, ev)) {
@@ -419,10 +571,125 @@ namespace usub::pg {
                 return;
             }
 
+            if (!lanes_.empty()) {
+                stage_event(it->second, std::move(ev));
+                return;
+            }
+
+            state.depth.fetch_add(1, std::memory_order_relaxed);
             if (!state.queue.try_enqueue(std::move(ev))) {
+                state.depth.fetch_sub(1, std::memory_order_relaxed);
                 state.dropped_overflow.fetch_add(1, std::memory_order_relaxed);
                 return;
             }
+            state.ready.release();
+        }
+
+        void stage_event(const std::shared_ptr<ChannelRuntimeState> &st, PendingEvent ev) {
+            if (st->depth.load(std::memory_order_relaxed) >= cfg_.channel_queue_capacity) {
+                st->dropped_overflow.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            st->depth.fetch_add(1, std::memory_order_relaxed);
+
+            size_t h = std::hash<std::string_view>{}(ev.channel);
+            if (partition_key_)
+                h ^= std::hash<std::string_view>{}(partition_key_(ev.channel, ev.payload)) * 0x9E3779B97F4A7C15ull;
+
+            staged_[h % lanes_.size()].push_back(
+                LaneEvent{PgNotification{std::move(ev.channel), std::move(ev.payload), ev.pid}, st});
+        }
+
+        void flush_staged() {
+            for (size_t i = 0; i < staged_.size(); ++i) {
+                auto &v = staged_[i];
+                if (v.empty()) continue;
+                auto &lane = *lanes_[i];
+                {
+                    std::lock_guard lk(lane.mu);
+                    if (lane.pending.empty()) {
+                        lane.pending.swap(v);
+                    } else {
+                        std::move(v.begin(), v.end(), std::back_inserter(lane.pending));
+                    }
+                }
+                v.clear();
+                lane.ready.release();
+            }
+        }
+
+        static usub::uvent::task::Awaitable<void> lane_worker(std::shared_ptr<DispatchLane> lane,
+                                                              PgNotificationMultiplexer *self) {
+            std::vector<LaneEvent> batch;
+            std::vector<PgNotification> run;
+            for (;;) {
+                co_await lane->ready.acquire();
+                if (lane->closed.load(std::memory_order_acquire)) {
+                    co_return;
+                }
+
+                {
+                    std::lock_guard lk(lane->mu);
+                    batch.swap(lane->pending);
+                }
+                if (batch.empty()) {
+                    continue;
+                }
+
+                // runs of one channel, each in arrival order
+                std::stable_sort(batch.begin(), batch.end(), [](const LaneEvent &a, const LaneEvent &b) {
+                    return a.n.channel < b.n.channel;
+                });
+
+                for (size_t i = 0; i < batch.size();) {
+                    size_t j = i + 1;
+                    while (j < batch.size() && batch[j].n.channel == batch[i].n.channel) ++j;
+
+                    auto &st = *batch[i].st;
+                    run.clear();
+                    if (!self->admit_nested(st)) {
+                        st.depth.fetch_sub(j - i, std::memory_order_relaxed);
+                        st.dropped_recursive.fetch_add(j - i, std::memory_order_relaxed);
+                        i = j;
+                        continue;
+                    }
+                    for (size_t k = i; k < j; ++k) run.push_back(std::move(batch[k].n));
+                    co_await self->deliver_run(batch[i].st, run);
+                    i = j;
+                }
+                batch.clear();
+            }
+        }
+
+        usub::uvent::task::Awaitable<void> deliver_run(std::shared_ptr<ChannelRuntimeState> st,
+                                                       std::span<const PgNotification> run) {
+            st->depth.fetch_sub(run.size(), std::memory_order_relaxed);
+            if (st->closed.load(std::memory_order_acquire)) {
+                co_return;
+            }
+
+            // lanes may run on other threads than add/remove_handler
+            std::vector<std::shared_ptr<IPgNotifyHandler> > handlers;
+            ChannelInfo *ci_exact = nullptr;
+            std::vector<WildcardInfo *> ci_wild;
+            std::unique_lock lk(handlers_mu_);
+            if (get_exact_handlers(run.front().channel, ci_exact)) {
+                for (auto &pair: ci_exact->handlers) handlers.push_back(pair.second);
+            }
+            if (get_wild_handlers(run.front().channel, ci_wild)) {
+                for (auto *wi: ci_wild)
+                    for (auto &pair: wi->handlers) handlers.push_back(pair.second);
+            }
+            lk.unlock();
+
+            {
+                NestedCall call{st};
+                call.enter();
+                for (auto &h: handlers) {
+                    co_await h->on_batch(run);
+                }
+            }
+            st->delivered.fetch_add(run.size(), std::memory_order_relaxed);
         }
 
         bool push_rate_limited(ChannelRuntimeState &st, const PendingEvent &) {
@@ -442,33 +709,29 @@ namespace usub::pg {
             return true;
         }
 
-        static usub::uvent::task::Awaitable<void> channel_worker(std::string channel_name,
+        // Idle channels cost nothing: the worker sleeps until an event is queued.
+        static usub::uvent::task::Awaitable<void> channel_worker(std::shared_ptr<ChannelRuntimeState> st,
                                                                  PgNotificationMultiplexer *self) {
-            using namespace std::chrono_literals;
-
             for (;;) {
-                auto it = self->channel_runtime_.find(channel_name);
-                if (it == self->channel_runtime_.end()) {
+                co_await st->ready.acquire();
+                if (st->closed.load(std::memory_order_acquire)) {
                     co_return;
                 }
 
-                auto &st = it->second;
-
                 PendingEvent ev;
-                if (!st.queue.try_dequeue(ev)) {
-                    co_await usub::uvent::system::this_coroutine::sleep_for(100us);
+                if (!st->queue.try_dequeue(ev)) {
                     continue;
                 }
 
+                st->depth.fetch_sub(1, std::memory_order_relaxed);
                 self->dispatch_to_handlers_ordered(ev, st);
+                st->delivered.fetch_add(1, std::memory_order_relaxed);
             }
-
-            co_return;
         }
 
-        void dispatch_to_handlers_ordered(const PendingEvent &ev, ChannelRuntimeState &st) {
-            if (!check_recursion(ev)) {
-                st.dropped_recursive.fetch_add(1, std::memory_order_relaxed);
+        void dispatch_to_handlers_ordered(const PendingEvent &ev, const std::shared_ptr<ChannelRuntimeState> &st) {
+            if (!admit_nested(*st)) {
+                st->dropped_recursive.fetch_add(1, std::memory_order_relaxed);
                 return;
             }
 
@@ -482,6 +745,9 @@ namespace usub::pg {
                 return;
             }
 
+            // shared by this event's handler calls; see NestedCall
+            auto call = std::make_shared<NestedCall>(st);
+
             if (have_exact) {
                 for (auto &pair: ci_exact->handlers) {
                     std::shared_ptr<IPgNotifyHandler> hptr = pair.second;
@@ -490,7 +756,7 @@ namespace usub::pg {
                     int pid_copy = ev.pid;
 
                     usub::uvent::system::co_spawn(
-                        run_single_handler(hptr, std::move(ch_copy), std::move(pl_copy), pid_copy));
+                        run_single_handler(hptr, call, std::move(ch_copy), std::move(pl_copy), pid_copy));
                 }
             }
 
@@ -503,26 +769,12 @@ namespace usub::pg {
                         int pid_copy = ev.pid;
 
                         usub::uvent::system::co_spawn(run_single_handler(
-                            hptr, std::move(ch_copy), std::move(pl_copy), pid_copy));
+                            hptr, call, std::move(ch_copy), std::move(pl_copy), pid_copy));
                     }
                 }
             }
         }
 
-        bool check_recursion(const PendingEvent &ev) {
-            if (tls_dispatch_depth >= cfg_.max_recursive_depth) {
-                if (tls_last_channel == ev.channel && tls_last_payload == ev.payload) {
-                    return false;
-                }
-            }
-
-            tls_dispatch_depth++;
-            tls_last_channel = ev.channel;
-            tls_last_payload = ev.payload;
-            tls_dispatch_depth--;
-            return true;
-        }
-
         bool match_any_wildcard(const std::string &ch) const {
             for (auto const &kv: wildcard_) {
                 const std::string &pat = kv.first;
@@ -559,8 +811,9 @@ namespace usub::pg {
         }
 
         static usub::uvent::task::Awaitable<void> run_single_handler(
-            std::shared_ptr<IPgNotifyHandler> hptr, std::string ch_copy, std::string payload_copy,
-            int pid_copy) {
+            std::shared_ptr<IPgNotifyHandler> hptr, std::shared_ptr<NestedCall> call,
+            std::string ch_copy, std::string payload_copy, int pid_copy) {
+            call->enter();
             co_await (*hptr)(std::move(ch_copy), std::move(payload_copy), pid_copy);
             co_return;
         }
@@ -578,11 +831,17 @@ namespace usub::pg {
 
         std::unordered_map<std::string, ChannelInfo> exact_;
         std::unordered_map<std::string, WildcardInfo> wildcard_;
+        std::mutex handlers_mu_;  // handler lists vs. lanes on other threads
 
-        std::unordered_map<std::string, ChannelRuntimeState> channel_runtime_;
+        std::unordered_map<std::string, std::shared_ptr<ChannelRuntimeState> > channel_runtime_;
 
         std::deque<PendingEvent> pending_after_disconnect_;
 
+        std::vector<std::shared_ptr<DispatchLane> > lanes_;
+        std::vector<std::vector<LaneEvent> > staged_;  // per lane; filled by the run() loop only
+        bool lanes_started_{false};
+        PartitionKeyFn partition_key_;
+
         std::atomic<uint64_t> next_handler_id_;
     };
 } // namespace usub::pg
@@ -10,12 +10,18 @@
 #include <expected>
 #include <cstdio>
 #include <cassert>
+#include <span>
+#include <deque>
+#include <mutex>
 
 #include "uvent/Uvent.h"
 #include "uvent/sync/AsyncSemaphore.h"
 #include "PgConnection.h"
 #include "PgTypes.h"
 #include "PgReflect.h"
+#include "PgCopy.h"
+#include "PgStatement.h"
+#include "PgStream.h"
 #include "utils/ConnInfo.h"
 #include "uvent/utils/datastructures/queue/ConcurrentQueues.h"
 
@@ -32,11 +38,51 @@ namespace usub::pg {
         std::atomic<uint64_t> reconnected{0};
     };
 
+    // Per-shard counters of a sharded pool (see PgPool::enable_sharding).
+    struct PgPoolShardStats {
+        uint64_t idle{0};        // connections parked in the shard right now
+        uint64_t local_hits{0};  // acquires served by the caller's own shard
+        uint64_t stolen{0};      // acquires served by this shard for another worker
+        uint64_t created{0};     // connections opened with this shard as home
+        uint64_t returned{0};    // releases that parked a connection here
+    };
+
+    // Waiters of a higher class are served first; FIFO within a class.
+    enum class PgAcquirePriority : uint8_t { High = 0, Normal = 1, Low = 2 };
+
+    struct PgAcquireOptions {
+        PgAcquirePriority priority{PgAcquirePriority::Normal};
+        // Bound on the time spent waiting for a connection; nullopt takes the
+        // pool default (PgPool::set_acquire_timeout), 0 waits forever.
+        std::optional<std::chrono::milliseconds> timeout{};
+    };
+
+    struct PgAcquireStats {
+        std::atomic<uint64_t> waits{0};          // acquires that had to queue
+        std::atomic<uint64_t> timeouts{0};       // ... and gave up at their deadline
+        std::atomic<uint64_t> rejected{0};       // refused because the queue was full
+        std::atomic<uint64_t> wait_us_total{0};  // queueing time of served waiters
+        std::atomic<uint64_t> wait_us_max{0};
+    };
+
+    struct PgCoalesceStats {
+        std::atomic<uint64_t> queries{0};    // statements sent through the coalescer
+        std::atomic<uint64_t> batches{0};    // pipelines they were packed into
+        std::atomic<uint64_t> max_batch{0};  // largest pipeline so far
+    };
+
+    // A statement's result plus a read-your-writes token (RouteHint::min_lsn).
+    struct PgWriteResult {
+        QueryResult result;
+        PgLsn lsn{};  // empty when the statement or the position query failed
+    };
+
     inline bool is_fatal_connection_error(const QueryResult &qr) {
         if (qr.ok)
             return false;
 
         if (qr.code == PgErrorCode::SocketReadFailed ||
+            qr.code == PgErrorCode::SocketWriteFailed ||
             qr.code == PgErrorCode::ConnectionClosed)
             return true;
 
@@ -68,6 +114,13 @@ namespace usub::pg {
         usub::uvent::task::Awaitable<std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError> >
         acquire_connection();
 
+        // When the pool is saturated the caller queues FIFO within its
+        // priority class; a release hands its connection straight to the
+        // first waiter. Fails with PoolAcquireTimeout at the deadline and with
+        // PoolQueueFull when max_acquire_waiters are already queued.
+        usub::uvent::task::Awaitable<std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError> >
+        acquire_connection(PgAcquireOptions opts);
+
         void release_connection(std::shared_ptr<PgConnectionLibpq> conn);
 
         usub::uvent::task::Awaitable<void>
@@ -83,6 +136,86 @@ namespace usub::pg {
         usub::uvent::task::Awaitable<QueryResult>
         query_awaitable(std::string sql, Args &&... args);
 
+        // With a deadline: an overrun is canceled server-side, reported as
+        // QueryTimeout, and the connection goes back to the pool. Never
+        // coalesced.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResult>
+        query_awaitable(PgQueryOptions opts, std::string sql, Args &&... args);
+
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResultView>
+        query_view_on(std::shared_ptr<PgConnectionLibpq> const &conn,
+                      std::string sql,
+                      Args &&... args);
+
+        // Zero-copy variant of query_awaitable: cells are string_views into
+        // the PGresult owned by the returned view.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResultView>
+        query_view_awaitable(std::string sql, Args &&... args);
+
+        // Runs a PgStatement on an already acquired connection.
+        template<class R, class... P>
+        usub::uvent::task::Awaitable<typename PgStatement<R(P...)>::result_type>
+        execute_on(std::shared_ptr<PgConnectionLibpq> const &conn,
+                   const PgStatement<R(P...)> &st,
+                   std::type_identity_t<const P &>... args);
+
+        // Acquires a connection, runs the statement (preparing it on first use
+        // on that connection) and releases the connection.
+        template<class R, class... P>
+        usub::uvent::task::Awaitable<typename PgStatement<R(P...)>::result_type>
+        execute(const PgStatement<R(P...)> &st, std::type_identity_t<const P &>... args);
+
+        // Starts COPY table (<members of T>) FROM STDIN (FORMAT binary) and
+        // hands the connection to a sink that encodes rows of T into the
+        // stream, sending it in chunk_bytes pieces.
+        template<class T>
+        usub::uvent::task::Awaitable<std::expected<PgCopyInSink<T>, PgOpError> >
+        copy_in_sink(std::string table, size_t chunk_bytes = PgCopyInWriter::default_chunk_bytes);
+
+        // Bulk-loads rows with one binary COPY; returns the server's row count.
+        template<class T>
+        usub::uvent::task::Awaitable<std::expected<uint64_t, PgOpError> >
+        copy_in_reflect(std::string table, std::span<const T> rows,
+                        size_t chunk_bytes = PgCopyInWriter::default_chunk_bytes);
+
+        // Runs COPY (query) TO STDOUT (FORMAT binary) and hands the connection
+        // to a stream that decodes the tuples into batches of T.
+        template<class T>
+        usub::uvent::task::Awaitable<std::expected<PgCopyOutStream<T>, PgOpError> >
+        copy_out_reflect(std::string query, uint32_t batch_rows = 1024,
+                         size_t buffer_bytes = PgCopyOutReader::default_buffer_bytes);
+
+        // Starts a single-row-mode query and hands the connection to the
+        // returned stream, which delivers at most batch_rows rows per next().
+        template<typename... Args>
+        usub::uvent::task::Awaitable<std::expected<PgRowStream, PgOpError> >
+        stream_awaitable(std::string sql, uint32_t batch_rows, Args &&... args);
+
+        // Runs a PgPipeline on an already acquired connection.
+        usub::uvent::task::Awaitable<std::vector<QueryResult> >
+        pipeline_on(std::shared_ptr<PgConnectionLibpq> const &conn,
+                    PgPipeline pipeline);
+
+        // Acquires a connection, runs the whole batch in one round trip and
+        // releases it; one QueryResult per queued statement.
+        usub::uvent::task::Awaitable<std::vector<QueryResult> >
+        pipeline_awaitable(PgPipeline pipeline);
+
+        // Runs an autocommit statement and, in the same round trip, reads the
+        // WAL position after its commit.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<PgWriteResult>
+        query_with_lsn(std::string sql, Args &&... args);
+
+        // PgConnectionLibpq::execute_many on one pooled connection. `items`
+        // must stay alive until the call completes.
+        template<std::ranges::forward_range R>
+        usub::uvent::task::Awaitable<PgExecManyResult>
+        execute_many(std::string sql, R &&items, PgExecManyOptions opts = {});
+
         template<class T>
         usub::uvent::task::Awaitable<std::vector<T> >
         query_on_reflect(std::shared_ptr<PgConnectionLibpq> const &conn,
@@ -105,43 +238,37 @@ namespace usub::pg {
         usub::uvent::task::Awaitable<std::expected<std::vector<T>, PgOpError> >
         query_on_reflect_expected(std::shared_ptr<PgConnectionLibpq> const &conn,
                                   std::string sql) {
+            conn->trace_defer_map();
             QueryResult qr = co_await query_on(conn, std::move(sql));
-            if (!qr.ok)
+            if (!qr.ok) {
+                conn->trace_flush();
                 co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
-
-            try {
-                auto vec = usub::pg::map_all_reflect_named<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            } catch (const std::exception &e) {
-#if UPQ_POOL_DEBUG
-                UPQ_POOL_DBG("query_on_reflect_expected named-map FAIL: %s — fallback to positional", e.what());
-#endif
-                auto vec = usub::pg::map_all_reflect_positional<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
             }
+
+            auto res = usub::pg::map_all_reflect_expected<T>(qr);
+            conn->trace_mapped();
+            co_return res;
         }
 
         template<class T>
         usub::uvent::task::Awaitable<std::expected<T, PgOpError> >
         query_on_reflect_expected_one(std::shared_ptr<PgConnectionLibpq> const &conn,
                                       std::string sql) {
+            conn->trace_defer_map();
             QueryResult qr = co_await query_on(conn, std::move(sql));
-            if (!qr.ok)
+            if (!qr.ok) {
+                conn->trace_flush();
                 co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
+            }
 
-            if (qr.rows.empty())
+            if (qr.rows.empty()) {
+                conn->trace_flush();
                 co_return std::unexpected(PgOpError{PgErrorCode::Unknown, "no rows", {}});
-
-            try {
-                auto v = usub::pg::map_single_reflect_named<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            } catch (const std::exception &e) {
-#if UPQ_POOL_DEBUG
-                UPQ_POOL_DBG("query_on_reflect_expected_one named-one FAIL: %s — fallback to positional", e.what());
-#endif
-                auto v = usub::pg::map_single_reflect_positional<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
             }
+
+            auto res = usub::pg::map_single_reflect_expected<T>(qr, 0);
+            conn->trace_mapped();
+            co_return res;
         }
 
         template<class T>
@@ -154,7 +281,8 @@ namespace usub::pg {
             auto conn = *c;
             auto res = co_await query_on_reflect_expected<T>(conn, std::move(sql));
 
-            if (!res)
+            // mapping errors leave the connection usable; release checks idleness
+            if (!conn->connected())
                 mark_dead(conn);
             else
                 co_await release_connection_async(conn);
@@ -172,7 +300,8 @@ namespace usub::pg {
             auto conn = *c;
             auto res = co_await query_on_reflect_expected_one<T>(conn, std::move(sql));
 
-            if (!res)
+            // mapping errors leave the connection usable; release checks idleness
+            if (!conn->connected())
                 mark_dead(conn);
             else
                 co_await release_connection_async(conn);
@@ -202,44 +331,37 @@ namespace usub::pg {
         usub::uvent::task::Awaitable<std::expected<std::vector<T>, PgOpError> >
         query_on_reflect_expected(std::shared_ptr<PgConnectionLibpq> const &conn,
                                   std::string sql, Args &&... args) {
+            conn->trace_defer_map();
             QueryResult qr = co_await query_on(conn, std::move(sql), std::forward<Args>(args)...);
-            if (!qr.ok)
+            if (!qr.ok) {
+                conn->trace_flush();
                 co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
-
-            try {
-                auto vec = usub::pg::map_all_reflect_named<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            } catch (const std::exception &e) {
-#if UPQ_POOL_DEBUG
-                UPQ_POOL_DBG("query_on_reflect_expected (param) named-map FAIL: %s — fallback to positional", e.what());
-#endif
-                auto vec = usub::pg::map_all_reflect_positional<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
             }
+
+            auto res = usub::pg::map_all_reflect_expected<T>(qr);
+            conn->trace_mapped();
+            co_return res;
         }
 
         template<class T, typename... Args>
         usub::uvent::task::Awaitable<std::expected<T, PgOpError> >
         query_on_reflect_expected_one(std::shared_ptr<PgConnectionLibpq> const &conn,
                                       std::string sql, Args &&... args) {
+            conn->trace_defer_map();
             QueryResult qr = co_await query_on(conn, std::move(sql), std::forward<Args>(args)...);
-            if (!qr.ok)
+            if (!qr.ok) {
+                conn->trace_flush();
                 co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
+            }
 
-            if (qr.rows.empty())
+            if (qr.rows.empty()) {
+                conn->trace_flush();
                 co_return std::unexpected(PgOpError{PgErrorCode::Unknown, "no rows", {}});
-
-            try {
-                auto v = usub::pg::map_single_reflect_named<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            } catch (const std::exception &e) {
-#if UPQ_POOL_DEBUG
-                UPQ_POOL_DBG("query_on_reflect_expected_one (param) named-one FAIL: %s — fallback to positional",
-                             e.what());
-#endif
-                auto v = usub::pg::map_single_reflect_positional<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
             }
+
+            auto res = usub::pg::map_single_reflect_expected<T>(qr, 0);
+            conn->trace_mapped();
+            co_return res;
         }
 
         template<class T, typename... Args>
@@ -253,7 +375,8 @@ namespace usub::pg {
             auto res = co_await query_on_reflect_expected<T>(
                 conn, std::move(sql), std::forward<Args>(args)...);
 
-            if (!res)
+            // mapping errors leave the connection usable; release checks idleness
+            if (!conn->connected())
                 mark_dead(conn);
             else
                 co_await release_connection_async(conn);
@@ -272,7 +395,8 @@ namespace usub::pg {
             auto res = co_await query_on_reflect_expected_one<T>(
                 conn, std::move(sql), std::forward<Args>(args)...);
 
-            if (!res)
+            // mapping errors leave the connection usable; release checks idleness
+            if (!conn->connected())
                 mark_dead(conn);
             else
                 co_await release_connection_async(conn);
@@ -510,7 +634,209 @@ namespace usub::pg {
 
         inline HealthStats &health_stats() { return stats_; }
 
+        // Opt-in: every connection handed out keeps an LRU of up to `capacity`
+        // prepared statements and reuses them for parameterized queries.
+        // 0 (default) keeps the plain PQsendQueryParams path.
+        inline void enable_statement_cache(size_t capacity) {
+            this->stmt_cache_capacity_.store(capacity, std::memory_order_relaxed);
+        }
+
+        inline size_t statement_cache_capacity() const {
+            return this->stmt_cache_capacity_.load(std::memory_order_relaxed);
+        }
+
+        inline PgStatementCacheStats &statement_cache_stats() { return stmt_cache_stats_; }
+
+        // Opt-in binary results (resultFormat=1) for parameterized queries;
+        // reflect mapping and Row::get decode them through PgTypeRegistry.
+        inline void set_result_format(PgResultFormat fmt) {
+            this->result_format_.store(fmt, std::memory_order_relaxed);
+        }
+
+        inline PgResultFormat result_format() const {
+            return this->result_format_.load(std::memory_order_relaxed);
+        }
+
+        // Opt-in: parameterized query_awaitable calls are queued and packed
+        // into pipelines of up to max_batch statements over at most
+        // max_connections connections, each statement in its own implicit
+        // transaction (a sync point after each). While one batch is on the
+        // wire the next one accumulates. 0 connections turns it off.
+        inline void enable_query_coalescing(size_t max_connections, size_t max_batch = 64) {
+            this->coalesce_batch_.store(max_batch ? max_batch : 1, std::memory_order_relaxed);
+            this->coalesce_conns_.store(max_connections, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] inline bool query_coalescing() const {
+            return this->coalesce_conns_.load(std::memory_order_relaxed) != 0;
+        }
+
+        inline PgCoalesceStats &coalesce_stats() { return this->coalesce_stats_; }
+
+        // Opt-in: splits the idle list into `shards` per-worker lists. Each
+        // worker thread maps to one shard, a connection always returns to the
+        // shard of the worker that opened it (whose loop polls its socket),
+        // and a worker steals from other shards only when its own is empty.
+        // Call before the first acquire; 0 or 1 keeps the single shared queue.
+        void enable_sharding(size_t shards);
+
+        [[nodiscard]] inline size_t shard_count() const noexcept { return this->shards_.size(); }
+
+        [[nodiscard]] std::vector<PgPoolShardStats> shard_stats() const;
+
+        // Opens up to n connections concurrently and parks them idle, so the
+        // first burst of traffic does not pay the handshakes. Stops at
+        // max_pool; returns how many were opened.
+        usub::uvent::task::Awaitable<size_t> prewarm(size_t n, int attempts = 1);
+
+        // Idle connections PgReconnectSupervisor keeps ready (0: none).
+        inline void set_min_idle(size_t n) { this->min_idle_.store(n, std::memory_order_relaxed); }
+
+        [[nodiscard]] inline size_t min_idle() const { return this->min_idle_.load(std::memory_order_relaxed); }
+
+        // Connections older than this are retired on acquire/release instead
+        // of being reused (0: unlimited).
+        inline void set_max_lifetime(std::chrono::milliseconds d) {
+            this->max_lifetime_.store(d, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] inline std::chrono::milliseconds max_lifetime() const {
+            return this->max_lifetime_.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] inline size_t max_pool_size() const noexcept { return this->max_pool_; }
+
+        [[nodiscard]] inline size_t live_count() const { return this->live_count_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] size_t idle_count() const;
+
+        // Connections currently handed out.
+        [[nodiscard]] inline size_t busy_count() const {
+            const size_t live = this->live_count();
+            const size_t idle = this->idle_count();
+            return live > idle ? live - idle : 0;
+        }
+
+        // EWMA of statement latency over this pool's connections (0: no data yet).
+        [[nodiscard]] inline uint64_t latency_ewma_us() const noexcept { return this->latency_ewma_.value_us(); }
+
+        // One sample from outside the pool's statements (the health probe's
+        // RTT), so an idle node's EWMA drifts back instead of staying frozen.
+        inline void observe_latency_us(uint64_t us) noexcept { this->latency_ewma_.observe(us); }
+
+        // Default deadline for acquire_connection (0: wait forever).
+        inline void set_acquire_timeout(std::chrono::milliseconds d) {
+            this->acquire_timeout_.store(d, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] inline std::chrono::milliseconds acquire_timeout() const {
+            return this->acquire_timeout_.load(std::memory_order_relaxed);
+        }
+
+        // Fail fast instead of queueing once this many acquires wait (0: unbounded).
+        inline void set_max_acquire_waiters(size_t n) {
+            this->max_acquire_waiters_.store(n, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] inline size_t max_acquire_waiters() const {
+            return this->max_acquire_waiters_.load(std::memory_order_relaxed);
+        }
+
+        // Acquires currently queued; a load-shedding signal.
+        [[nodiscard]] inline size_t acquire_queue_depth() const {
+            return this->waiting_.load(std::memory_order_relaxed);
+        }
+
+        inline PgAcquireStats &acquire_stats() { return this->acquire_stats_; }
+
+        // Label of this pool in metrics_dump() and trace spans (default
+        // user@host:port/db).
+        void set_stats_name(std::string name);
+
+        // Sends a span per sampled statement (phase timestamps, rows, bytes,
+        // connection id, pool name) to `sink`; nullptr turns tracing off.
+        // Connections pick the change up on their next acquire.
+        void set_trace_sink(std::shared_ptr<PgTraceSink> sink, double sample_ratio = 1.0);
+
+        [[nodiscard]] std::shared_ptr<const PgTraceConfig> trace_config() const {
+            return this->trace_.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] inline uint32_t stats_scope() const noexcept { return this->stats_scope_; }
+
     private:
+        struct alignas(64) Shard {
+            explicit Shard(size_t capacity) : idle(capacity) {
+            }
+
+            queue::concurrent::MPMCQueue<std::shared_ptr<PgConnectionLibpq> > idle;
+            std::atomic<size_t> idle_count{0};
+            std::atomic<uint64_t> local_hits{0};
+            std::atomic<uint64_t> stolen{0};
+            std::atomic<uint64_t> created{0};
+            std::atomic<uint64_t> returned{0};
+        };
+
+        struct PrewarmJoin;
+
+        struct CoalescedQuery {
+            PgPipelineStatement st;
+            QueryResult result;
+            usub::uvent::sync::AsyncSemaphore done{0};
+        };
+
+        usub::uvent::task::Awaitable<QueryResult> coalesced_query(PgPipelineStatement st);
+
+        usub::uvent::task::Awaitable<void> coalesce_flusher();
+
+        struct AcquireWaiter {
+            static constexpr uint8_t Waiting = 0;
+            static constexpr uint8_t Served = 1;
+            static constexpr uint8_t TimedOut = 2;
+
+            std::atomic<uint8_t> state{Waiting};
+            std::atomic<bool> expired{false};   // the deadline passed
+            std::atomic<bool> finished{false};  // the acquire returned; the deadline stops
+            bool stale{false};                  // cancelled but still in a queue; guarded by wait_mu_
+            std::shared_ptr<PgConnectionLibpq> conn;  // null: retry, a slot or idle conn appeared
+            usub::uvent::sync::AsyncSemaphore ready{0};
+        };
+
+        static usub::uvent::task::Awaitable<void>
+        acquire_deadline(std::shared_ptr<AcquireWaiter> w, std::chrono::milliseconds d);
+
+        // (Re)queues w as Waiting; front puts a nudged waiter back at the head.
+        void enqueue_waiter(std::shared_ptr<AcquireWaiter> const &w, size_t prio, bool front);
+
+        // Withdraws a waiter that has not been served yet.
+        bool cancel_waiter(AcquireWaiter &w);
+
+        // Hands conn (possibly null) to the first live waiter; false if none.
+        bool serve_waiter(std::shared_ptr<PgConnectionLibpq> &conn);
+
+        void record_wait(std::chrono::steady_clock::time_point t0);
+
+        // Opens a connection for a live slot the caller already reserved;
+        // on failure the slot is given back.
+        usub::uvent::task::Awaitable<std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError> >
+        open_connection(int attempts);
+
+        usub::uvent::task::Awaitable<void> prewarm_one(std::shared_ptr<PrewarmJoin> join, int attempts);
+
+        bool reserve_slot();
+
+        bool expired(const PgConnectionLibpq &conn) const;
+
+        bool try_take_idle(std::shared_ptr<PgConnectionLibpq> &conn);
+
+        bool put_idle(std::shared_ptr<PgConnectionLibpq> const &conn);
+
+        bool any_idle_or_capacity() const;
+
+        void wake_waiter();
+
+        size_t local_shard() const noexcept;
+
         std::string host_;
         std::string port_;
         std::string user_;
@@ -525,9 +851,42 @@ namespace usub::pg {
         HealthStats stats_;
         int retries_on_connection_failed_;
 
-        usub::uvent::sync::AsyncSemaphore idle_sem_{0};
         SSLConfig ssl_config_;
         TCPKeepaliveConfig keepalive_config_;
+
+        std::atomic<size_t> stmt_cache_capacity_{0};
+        PgStatementCacheStats stmt_cache_stats_;
+        std::atomic<PgResultFormat> result_format_{PgResultFormat::Text};
+
+        std::vector<std::unique_ptr<Shard> > shards_;
+        std::mutex wait_mu_;
+        std::deque<std::shared_ptr<AcquireWaiter> > wait_q_[3];
+        std::atomic<size_t> waiting_{0};
+        std::atomic<std::chrono::milliseconds> acquire_timeout_{std::chrono::milliseconds{0}};
+        std::atomic<size_t> max_acquire_waiters_{0};
+        PgAcquireStats acquire_stats_;
+        std::atomic<size_t> idle_count_{0};
+
+        std::atomic<size_t> coalesce_conns_{0};
+        std::atomic<size_t> coalesce_batch_{64};
+        std::mutex coalesce_mu_;
+        std::deque<std::shared_ptr<CoalescedQuery> > coalesce_q_;
+        size_t coalesce_flushers_{0};  // guarded by coalesce_mu_
+        PgCoalesceStats coalesce_stats_;
+
+        std::atomic<size_t> min_idle_{0};
+        std::atomic<std::chrono::milliseconds> max_lifetime_{std::chrono::milliseconds{0}};
+
+        uint32_t stats_scope_{0};
+        uint64_t stats_gauges_{0};
+        PgLatencyEwma latency_ewma_;
+        std::string stats_name_;
+
+        std::mutex trace_mu_;
+        std::atomic<bool> tracing_{false};
+        std::atomic<std::shared_ptr<const PgTraceConfig> > trace_;
+
+        void apply_connection_settings(PgConnectionLibpq &conn);
     };
 
     template<typename... Args>
@@ -559,6 +918,14 @@ namespace usub::pg {
     template<typename... Args>
     usub::uvent::task::Awaitable<QueryResult>
     PgPool::query_awaitable(std::string sql, Args &&... args) {
+        // only the extended protocol can be pipelined; argument-less calls may
+        // carry several statements and keep the simple-query path
+        if constexpr (sizeof...(Args) > 0) {
+            if (this->query_coalescing())
+                co_return co_await this->coalesced_query(
+                    PgPipeline::make_statement(std::move(sql), std::forward<Args>(args)...));
+        }
+
         auto c = co_await acquire_connection();
         if (!c) {
             const auto &e = c.error();
@@ -588,6 +955,290 @@ namespace usub::pg {
         co_return qr;
     }
 
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResult>
+    PgPool::query_awaitable(PgQueryOptions opts, std::string sql, Args &&... args) {
+        auto c = co_await acquire_connection();
+        if (!c) {
+            const auto &e = c.error();
+            QueryResult bad;
+            bad.ok = false;
+            bad.code = e.code;
+            bad.error = e.error;
+            bad.err_detail = e.err_detail;
+            bad.rows_valid = false;
+            co_return bad;
+        }
+
+        auto conn = *c;
+
+        PgQueryDeadline dl = conn->arm_deadline(opts);
+        QueryResult qr = co_await query_on(
+            conn,
+            std::move(sql),
+            std::forward<Args>(args)...
+        );
+        co_await conn->disarm_deadline(dl, qr);
+
+        if (is_fatal_connection_error(qr) || !conn->connected()) {
+            mark_dead(conn);
+        } else {
+            co_await release_connection_async(conn);
+        }
+
+        co_return qr;
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<PgWriteResult>
+    PgPool::query_with_lsn(std::string sql, Args &&... args) {
+        // the sync point commits the statement before the position is read
+        PgPipeline p;
+        p.add(std::move(sql), std::forward<Args>(args)...).sync();
+        p.add(std::string{"SELECT pg_current_wal_insert_lsn()::text"});
+
+        std::vector<QueryResult> rs = co_await this->pipeline_awaitable(std::move(p));
+
+        PgWriteResult out;
+        // a COMMIT statement that answered ROLLBACK wrote nothing
+        if (rs.size() == 2 && rs[0].ok && !rs[0].rolled_back && rs[1].ok && !rs[1].rows.empty() &&
+            !rs[1].rows[0].cols.empty())
+            if (auto lsn = PgLsn::parse(rs[1].rows[0].cols[0])) out.lsn = *lsn;
+        if (!rs.empty()) out.result = std::move(rs[0]);
+        co_return out;
+    }
+
+    template<std::ranges::forward_range R>
+    usub::uvent::task::Awaitable<PgExecManyResult>
+    PgPool::execute_many(std::string sql, R &&items, PgExecManyOptions opts) {
+        auto c = co_await acquire_connection();
+        if (!c)
+            co_return PgExecManyResult::all_failed(static_cast<size_t>(std::ranges::distance(items)), c.error());
+
+        auto conn = *c;
+        PgExecManyResult out = co_await conn->execute_many(sql, items, opts);
+
+        // transport failures inside execute_many drop the connection state
+        if (!conn->connected()) {
+            mark_dead(conn);
+        } else {
+            co_await release_connection_async(conn);
+        }
+        co_return out;
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResultView>
+    PgPool::query_view_on(std::shared_ptr<PgConnectionLibpq> const &conn,
+                          std::string sql,
+                          Args &&... args) {
+        if (!conn || !conn->connected()) {
+            QueryResultView bad;
+            bad.ok = false;
+            bad.code = PgErrorCode::ConnectionClosed;
+            bad.error = "connection not OK";
+            bad.rows_valid = false;
+            co_return bad;
+        }
+
+        co_return co_await conn->exec_param_query_view_nonblocking(sql, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResultView>
+    PgPool::query_view_awaitable(std::string sql, Args &&... args) {
+        auto c = co_await acquire_connection();
+        if (!c) {
+            const auto &e = c.error();
+            QueryResultView bad;
+            bad.ok = false;
+            bad.code = e.code;
+            bad.error = e.error;
+            bad.err_detail = e.err_detail;
+            bad.rows_valid = false;
+            co_return bad;
+        }
+
+        auto conn = *c;
+
+        QueryResultView qv = co_await query_view_on(conn, std::move(sql), std::forward<Args>(args)...);
+
+        if (!conn->connected()) {
+            mark_dead(conn);
+        } else {
+            co_await release_connection_async(conn);
+        }
+
+        co_return qv;
+    }
+
+    template<class T>
+    usub::uvent::task::Awaitable<std::expected<PgCopyInSink<T>, PgOpError> >
+    PgPool::copy_in_sink(std::string table, size_t chunk_bytes) {
+        auto c = co_await acquire_connection();
+        if (!c)
+            co_return std::unexpected(c.error());
+
+        auto conn = *c;
+        const std::string target = detail::copy_quote_name(table);
+
+        // binary fields are only checked against the columns on the client
+        QueryResult cat = co_await conn->exec_param_query_nonblocking(detail::copy_target_types_sql, target);
+        std::vector<detail::CopyColumnType> columns;
+        std::string err;
+        if (!cat.ok || !detail::copy_target_types<T>(cat, columns, &err)) {
+            if (!conn->connected()) {
+                mark_dead(conn);
+            } else {
+                co_await release_connection_async(conn);
+            }
+            if (!cat.ok)
+                co_return std::unexpected(PgOpError{cat.code, std::move(cat.error), std::move(cat.err_detail)});
+            co_return std::unexpected(PgOpError{PgErrorCode::ParserTruncatedField, std::move(err), {}});
+        }
+
+        std::string sql = "COPY " + target + detail::copy_column_list<T>(columns) + " FROM STDIN (FORMAT binary)";
+        PgCopyResult r = co_await conn->copy_in_start(sql);
+        if (!r.ok) {
+            if (!conn->connected()) {
+                mark_dead(conn);
+            } else {
+                co_await release_connection_async(conn);
+            }
+            co_return std::unexpected(PgOpError{r.code, std::move(r.error), std::move(r.err_detail)});
+        }
+
+        co_return PgCopyInSink<T>{PgCopyInWriter{this, std::move(conn), chunk_bytes}, std::move(columns)};
+    }
+
+    template<class T>
+    usub::uvent::task::Awaitable<std::expected<uint64_t, PgOpError> >
+    PgPool::copy_in_reflect(std::string table, std::span<const T> rows, size_t chunk_bytes) {
+        auto sink = co_await copy_in_sink<T>(std::move(table), chunk_bytes);
+        if (!sink)
+            co_return std::unexpected(std::move(sink.error()));
+
+        if (auto e = co_await sink->write(rows))
+            co_return std::unexpected(std::move(*e));
+
+        co_return co_await sink->finish();
+    }
+
+    template<class T>
+    usub::uvent::task::Awaitable<std::expected<PgCopyOutStream<T>, PgOpError> >
+    PgPool::copy_out_reflect(std::string query, uint32_t batch_rows, size_t buffer_bytes) {
+        auto c = co_await acquire_connection();
+        if (!c)
+            co_return std::unexpected(c.error());
+
+        auto conn = *c;
+
+        // the stream has no types; take them from Describe and check the members first
+        std::vector<uint32_t> oids;
+        PgCopyResult d = co_await conn->copy_out_describe(query, oids);
+        std::string err;
+        if (!d.ok || !detail::copy_out_check<T, PgCopyOutStream<T>::members>(oids, &err)) {
+            if (!conn->connected()) {
+                mark_dead(conn);
+            } else {
+                co_await release_connection_async(conn);
+            }
+            if (!d.ok)
+                co_return std::unexpected(PgOpError{d.code, std::move(d.error), std::move(d.err_detail)});
+            co_return std::unexpected(PgOpError{PgErrorCode::ParserTruncatedField, std::move(err), {}});
+        }
+
+        PgCopyResult r = co_await conn->copy_out_start("COPY (" + query + ") TO STDOUT (FORMAT binary)");
+        if (!r.ok) {
+            if (!conn->connected()) {
+                mark_dead(conn);
+            } else {
+                co_await release_connection_async(conn);
+            }
+            co_return std::unexpected(PgOpError{r.code, std::move(r.error), std::move(r.err_detail)});
+        }
+
+        co_return PgCopyOutStream<T>{PgCopyOutReader{this, std::move(conn), buffer_bytes}, batch_rows, std::move(oids)};
+    }
+
+    template<class R, class... P>
+    usub::uvent::task::Awaitable<typename PgStatement<R(P...)>::result_type>
+    PgPool::execute_on(std::shared_ptr<PgConnectionLibpq> const &conn,
+                       const PgStatement<R(P...)> &st,
+                       std::type_identity_t<const P &>... args) {
+        if (!conn || !conn->connected()) {
+            QueryResult bad;
+            bad.ok = false;
+            bad.code = PgErrorCode::ConnectionClosed;
+            bad.error = "connection not OK";
+            bad.rows_valid = false;
+            co_return detail::finish_statement<R>(std::move(bad));
+        }
+
+        conn->trace_defer_map();
+        QueryResult qr = co_await detail::run_statement(*conn, st, args...);
+        auto res = detail::finish_statement<R>(std::move(qr));
+        conn->trace_mapped();
+        co_return res;
+    }
+
+    template<class R, class... P>
+    usub::uvent::task::Awaitable<typename PgStatement<R(P...)>::result_type>
+    PgPool::execute(const PgStatement<R(P...)> &st, std::type_identity_t<const P &>... args) {
+        auto c = co_await acquire_connection();
+        if (!c) {
+            const auto &e = c.error();
+            QueryResult bad;
+            bad.ok = false;
+            bad.code = e.code;
+            bad.error = e.error;
+            bad.err_detail = e.err_detail;
+            bad.rows_valid = false;
+            co_return detail::finish_statement<R>(std::move(bad));
+        }
+
+        auto conn = *c;
+
+        conn->trace_defer_map();
+        QueryResult qr = co_await detail::run_statement(*conn, st, args...);
+        const bool dead = !conn->connected() || is_fatal_connection_error(qr);
+
+        // map before the connection can be handed to someone else
+        auto res = detail::finish_statement<R>(std::move(qr));
+        conn->trace_mapped();
+
+        if (dead) {
+            mark_dead(conn);
+        } else {
+            co_await release_connection_async(conn);
+        }
+
+        co_return res;
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<std::expected<PgRowStream, PgOpError> >
+    PgPool::stream_awaitable(std::string sql, uint32_t batch_rows, Args &&... args) {
+        auto c = co_await acquire_connection();
+        if (!c)
+            co_return std::unexpected(c.error());
+
+        auto conn = *c;
+
+        conn->set_stream_chunk_rows(static_cast<int>(batch_rows ? batch_rows : 1));
+        QueryResult qr = co_await conn->stream_start(sql, std::forward<Args>(args)...);
+        if (!qr.ok) {
+            if (!conn->connected()) {
+                mark_dead(conn);
+            } else {
+                co_await release_connection_async(conn);
+            }
+            co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
+        }
+
+        co_return PgRowStream{this, std::move(conn), batch_rows};
+    }
+
     template<class T>
     usub::uvent::task::Awaitable<std::vector<T> >
     PgPool::query_on_reflect(std::shared_ptr<PgConnectionLibpq> const &conn,
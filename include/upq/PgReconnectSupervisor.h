@@ -0,0 +1,65 @@
+#ifndef PGRECONNECTSUPERVISOR_H
+#define PGRECONNECTSUPERVISOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "uvent/Uvent.h"
+#include "PgPool.h"
+
+namespace usub::pg {
+    struct PgReconnectConfig {
+        // Keep at least this many connections open (0: only min_idle applies).
+        size_t target_live{0};
+        // Handshakes started per tick.
+        size_t max_parallel_connects{4};
+        std::chrono::milliseconds interval{200};
+        // Failed ticks back off exponentially between these bounds, with
+        // +-50% jitter so many clients do not reconnect in lockstep.
+        std::chrono::milliseconds backoff_initial{100};
+        std::chrono::milliseconds backoff_max{10000};
+    };
+
+    struct PgReconnectStats {
+        std::atomic<uint64_t> ticks{0};
+        std::atomic<uint64_t> opened{0};
+        std::atomic<uint64_t> failed{0};
+        std::atomic<uint32_t> consecutive_failures{0};
+    };
+
+    // Background coroutine that keeps a PgPool at its target size: it tops up
+    // the idle list to pool.min_idle() and the live count to target_live,
+    // replacing connections retired by mark_dead or max_lifetime. Start it
+    // with co_spawn(supervisor.run()); it must outlive the coroutine.
+    class PgReconnectSupervisor {
+    public:
+        explicit PgReconnectSupervisor(PgPool &pool, PgReconnectConfig cfg = {});
+
+        usub::uvent::task::Awaitable<void> run();
+
+        // One reconcile step; returns the number of connections opened.
+        usub::uvent::task::Awaitable<size_t> tick();
+
+        // run() returns after its current sleep.
+        void stop() noexcept { this->stop_.store(true, std::memory_order_relaxed); }
+
+        [[nodiscard]] bool running() const noexcept { return this->running_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] const PgReconnectStats &stats() const noexcept { return this->stats_; }
+
+    private:
+        size_t deficit() const;
+
+        std::chrono::milliseconds next_delay();
+
+        PgPool &pool_;
+        PgReconnectConfig cfg_;
+        PgReconnectStats stats_;
+        std::atomic<bool> stop_{false};
+        std::atomic<bool> running_{false};
+        uint64_t rng_;
+    };
+} // namespace usub::pg
+
+#endif // PGRECONNECTSUPERVISOR_H
@@ -11,17 +11,23 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <expected>
 #include <ios>
 #include <istream>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "PgResultView.h"
+#include "PgTextScan.h"
+#include "PgTypeRegistry.h"
 #include "PgTypes.h"
 
 #ifndef UPQ_REFLECT_DEBUG
@@ -107,15 +113,7 @@ namespace usub::pg {
 
         template <class Int>
         inline bool parse_int(std::string_view sv, Int &out) noexcept {
-            Int tmp{};
-            const char *begin = sv.data();
-            const char *end = sv.data() + sv.size();
-            auto res = std::from_chars(begin, end, tmp);
-            if (res.ec == std::errc() && res.ptr == end) {
-                out = tmp;
-                return true;
-            }
-            return false;
+            return parse_decimal_int(sv, out);
         }
 
         inline bool parse_bool(std::string_view sv, bool &out) noexcept {
@@ -144,58 +142,92 @@ namespace usub::pg {
             return false;
         }
 
-        inline std::vector<std::string_view> split_pg_array_items(std::string_view s) {
-            std::vector<std::string_view> items;
-            if (s.size() < 2 || s.front() != '{' || s.back() != '}') return items;
-            size_t i = 1, start = 1;
+        // Calls fn(token) for every top-level element of a one-dimensional
+        // array literal, stopping early when fn returns false. Tokens keep
+        // their quotes (see pg_text_elt_view). Delimiters are found by the
+        // vector kernel in PgTextScan.
+        template <class Fn>
+        inline bool for_each_pg_array_item(std::string_view s, Fn &&fn) {
+            if (s.size() < 2 || s.front() != '{' || s.back() != '}') return false;
+            const char *p = s.data() + 1;
+            const char *const end = s.data() + s.size() - 1;
+            if (p == end) return true;
+
+            const char *start = p;
             bool inq = false;
-            for (; i + 1 < s.size(); ++i) {
-                char c = s[i];
+            for (;;) {
+                p += scan_array_special(p, static_cast<size_t>(end - p));
+                if (p == end) break;
+                const char c = *p;
+                if (c == '\\') {
+                    p += (end - p >= 2) ? 2 : 1;
+                    continue;
+                }
                 if (inq) {
-                    if (c == '"' && i + 1 < s.size() && s[i + 1] == '"') {
-                        ++i;
-                        continue;
-                    }
                     if (c == '"') {
+                        if (p + 1 < end && p[1] == '"') {
+                            p += 2;
+                            continue;
+                        }
                         inq = false;
-                        continue;
-                    }
-                } else {
-                    if (c == '"') {
-                        inq = true;
-                        continue;
-                    }
-                    if (c == ',') {
-                        items.emplace_back(s.substr(start, i - start));
-                        start = i + 1;
                     }
+                } else if (c == '"') {
+                    inq = true;
+                } else if (c == ',') {
+                    if (!fn(std::string_view(start, static_cast<size_t>(p - start)))) return true;
+                    start = p + 1;
                 }
+                ++p;
             }
-            if (start <= s.size() - 1) items.emplace_back(s.substr(start, s.size() - 1 - start));
+            fn(std::string_view(start, static_cast<size_t>(end - start)));
+            return true;
+        }
+
+        inline std::vector<std::string_view> split_pg_array_items(std::string_view s) {
+            std::vector<std::string_view> items;
+            for_each_pg_array_item(s, [&](std::string_view item) {
+                items.push_back(item);
+                return true;
+            });
             return items;
         }
 
-        inline bool parse_pg_text_elt(std::string_view sv, std::string &out, bool &is_null) {
+        // Token -> element text: a view into `sv` unless the quoted token
+        // holds escapes (\x or ""), in which case it is unescaped into scratch.
+        inline void pg_text_elt_view(std::string_view sv, std::string &scratch, std::string_view &out,
+                                     bool &is_null) {
             is_null = false;
             if (sv == "NULL") {
                 is_null = true;
-                out.clear();
-                return true;
+                out = {};
+                return;
             }
-            if (!sv.empty() && sv.front() == '"' && sv.back() == '"') {
-                out.clear();
-                out.reserve(sv.size());
-                for (size_t i = 1; i + 1 < sv.size(); ++i) {
-                    char c = sv[i];
-                    if (c == '"' && i + 1 < sv.size() && sv[i + 1] == '"') {
-                        out.push_back('"');
-                        ++i;
-                    } else
-                        out.push_back(c);
-                }
-                return true;
+            if (sv.size() < 2 || sv.front() != '"' || sv.back() != '"') {
+                out = sv;
+                return;
+            }
+            sv = sv.substr(1, sv.size() - 2);
+            if (sv.find_first_of("\\\"") == std::string_view::npos) {
+                out = sv;
+                return;
+            }
+            scratch.clear();
+            scratch.reserve(sv.size());
+            for (size_t i = 0; i < sv.size(); ++i) {
+                const char c = sv[i];
+                if ((c == '\\' || c == '"') && i + 1 < sv.size())
+                    scratch.push_back(sv[++i]);
+                else
+                    scratch.push_back(c);
             }
-            out.assign(sv.begin(), sv.end());
+            out = scratch;
+        }
+
+        inline bool parse_pg_text_elt(std::string_view sv, std::string &out, bool &is_null) {
+            std::string scratch;
+            std::string_view v;
+            pg_text_elt_view(sv, scratch, v, is_null);
+            out.assign(v.data(), v.size());
             return true;
         }
 
@@ -397,46 +429,54 @@ namespace usub::pg {
         struct Decoder<VecT, std::enable_if_t<is_std_vector_reflect<VecT>::value>> {
             using T = typename VecT::value_type;
 
+            // Element by element straight from the cell: tokens are views, and
+            // only escaped strings touch the one scratch buffer.
             static bool apply(std::string_view sv, VecT &out) {
                 out.clear();
-                auto parts = split_pg_array_items(sv);
-                if (parts.empty() && !(sv.size() >= 2 && sv.front() == '{' && sv.back() == '}'))
-                    return false;
-
-                out.reserve(parts.size());
-                for (auto p : parts) {
-                    std::string tok;
+                std::string scratch;
+                bool ok = true;
+                const bool shaped = for_each_pg_array_item(sv, [&](std::string_view item) {
+                    std::string_view tok;
                     bool is_null = false;
-                    if (!parse_pg_text_elt(p, tok, is_null)) return false;
+                    pg_text_elt_view(item, scratch, tok, is_null);
                     if (is_null) {
                         out.emplace_back(T{});
-                        continue;
+                        return true;
                     }
-
-                    if constexpr (std::is_same_v<T, std::string>)
-                        out.emplace_back(std::move(tok));
-                    else if constexpr (std::is_integral_v<T>) {
-                        T v{};
-                        if (!parse_int<T>(tok, v)) return false;
-                        out.emplace_back(v);
-                    } else if constexpr (std::is_floating_point_v<T>) {
-                        T v{};
-                        if (!parse_float<T>(tok, v)) return false;
-                        out.emplace_back(v);
-                    } else if constexpr (has_istream_extractor<T>::value) {
-                        std::istringstream iss(tok);
-                        T v{};
-                        if (!(iss >> v) || !fully_consumed(iss)) return false;
-                        out.emplace_back(std::move(v));
-                    } else if constexpr (std::is_enum_v<T>) {
-                        T v{};
-                        if (!detail::enum_from_token_impl(tok, v)) return false;
-                        out.emplace_back(v);
+                    if constexpr (Optional<T>) {
+                        typename T::value_type v{};
+                        ok = decode_elem(tok, v);
+                        if (ok) out.emplace_back(std::move(v));
                     } else {
-                        return false;
+                        T v{};
+                        ok = decode_elem(tok, v);
+                        if (ok) out.emplace_back(std::move(v));
                     }
+                    return ok;
+                });
+                return shaped && ok;
+            }
+
+        private:
+            template <class E>
+            static bool decode_elem(std::string_view tok, E &v) {
+                if constexpr (std::is_same_v<E, std::string>) {
+                    v.assign(tok.data(), tok.size());
+                    return true;
+                } else if constexpr (std::is_same_v<E, bool>) {
+                    return parse_bool(tok, v);
+                } else if constexpr (std::is_integral_v<E>) {
+                    return parse_int<E>(tok, v);
+                } else if constexpr (std::is_floating_point_v<E>) {
+                    return parse_float<E>(tok, v);
+                } else if constexpr (has_istream_extractor<E>::value) {
+                    std::istringstream iss{std::string(tok)};
+                    return (iss >> v) && fully_consumed(iss);
+                } else if constexpr (std::is_enum_v<E>) {
+                    return detail::enum_from_token_impl(tok, v);
+                } else {
+                    return false;
                 }
-                return true;
             }
         };
 
@@ -494,6 +534,17 @@ namespace usub::pg {
             }
         };
 
+        // Text cells go through Decoder<T>; binary cells (resultFormat=1) are
+        // decoded by OID through PgTypeRegistry.
+        template <class T>
+        inline bool decode_field(std::string_view sv, T &out, bool binary, uint32_t oid) {
+            if (!binary) return Decoder<T>::apply(sv, out);
+            auto r = decode_binary_cell<T>(oid, sv);
+            if (!r) return false;
+            out = std::move(*r);
+            return true;
+        }
+
 #ifdef UPQ_ENABLE_PARAM_ENCODER
         inline void append_escaped(std::string &dst, std::string_view s) {
             dst.push_back('"');
@@ -607,18 +658,18 @@ namespace usub::pg {
             return -1;
         }
 
-        template <class Tuple>
+        template <class Tuple, class RowT>
             requires is_tuple_like_v<Tuple>
-        inline bool fill_from_row_positional_ex(const QueryResult::Row &row,
+        inline bool fill_from_row_positional_ex(const RowT &row,
                                                 const std::vector<std::string> *col_names,
                                                 const std::vector<uint32_t> *col_oids, Tuple &dst,
-                                                std::string *err) {
+                                                std::string *err, bool binary = false) {
             using Tup = std::decay_t<Tuple>;
             constexpr std::size_t N = std::tuple_size_v<Tup>;
-            if (row.cols.size() < N) {
+            if (row.size() < N) {
                 if (err)
                     *err = "not enough columns: expected=" + std::to_string(N) +
-                           ", got=" + std::to_string(row.cols.size());
+                           ", got=" + std::to_string(row.size());
                 return false;
             }
 
@@ -627,16 +678,17 @@ namespace usub::pg {
                 (
                     [&] {
                         using Elem = std::tuple_element_t<I, Tup>;
-                        const auto &sv = row.cols[I];
+                        const std::string_view sv = row.cell(I);
                         Elem tmp{};
 
-                        std::string col_type = "unknown";
-                        std::string col_name;
-                        if (col_oids && I < col_oids->size())
-                            col_type = pg_type_name_from_oid((*col_oids)[I]);
-                        if (col_names && I < col_names->size()) col_name = (*col_names)[I];
-
-                        if (!Decoder<Elem>::apply(std::string_view(sv.data(), sv.size()), tmp)) {
+                        const uint32_t oid =
+                            (col_oids && I < col_oids->size()) ? (*col_oids)[I] : 0;
+                        if (!decode_field(std::string_view(sv.data(), sv.size()), tmp, binary, oid)) {
+                            std::string col_type = "unknown";
+                            std::string col_name;
+                            if (col_oids && I < col_oids->size())
+                                col_type = pg_type_name_from_oid((*col_oids)[I]);
+                            if (col_names && I < col_names->size()) col_name = (*col_names)[I];
                             if (err)
                                 *err = format_mismatch_positional(
                                     I, expect_type<Elem>(), I, col_name, col_type,
@@ -652,18 +704,18 @@ namespace usub::pg {
             return ok;
         }
 
-        template <class T>
+        template <class T, class RowT>
             requires ReflectAggregate<T>
-        inline bool fill_from_row_positional_ex(const QueryResult::Row &row,
+        inline bool fill_from_row_positional_ex(const RowT &row,
                                                 const std::vector<std::string> *col_names,
                                                 const std::vector<uint32_t> *col_oids, T &dst,
-                                                std::string *err) {
+                                                std::string *err, bool binary = false) {
             using V = std::decay_t<T>;
             constexpr std::size_t N = ureflect::count_members<V>;
-            if (row.cols.size() < N) {
+            if (row.size() < N) {
                 if (err)
                     *err = "not enough columns: expected=" + std::to_string(N) +
-                           ", got=" + std::to_string(row.cols.size());
+                           ", got=" + std::to_string(row.size());
                 return false;
             }
 
@@ -673,16 +725,17 @@ namespace usub::pg {
                 (
                     [&] {
                         using FieldT = std::remove_reference_t<decltype(ureflect::get<I>(tie))>;
-                        const auto &sv = row.cols[I];
+                        const std::string_view sv = row.cell(I);
                         FieldT tmp{};
 
-                        std::string col_type = "unknown";
-                        std::string col_name;
-                        if (col_oids && I < col_oids->size())
-                            col_type = pg_type_name_from_oid((*col_oids)[I]);
-                        if (col_names && I < col_names->size()) col_name = (*col_names)[I];
-
-                        if (!Decoder<FieldT>::apply(std::string_view(sv.data(), sv.size()), tmp)) {
+                        const uint32_t oid =
+                            (col_oids && I < col_oids->size()) ? (*col_oids)[I] : 0;
+                        if (!decode_field(std::string_view(sv.data(), sv.size()), tmp, binary, oid)) {
+                            std::string col_type = "unknown";
+                            std::string col_name;
+                            if (col_oids && I < col_oids->size())
+                                col_type = pg_type_name_from_oid((*col_oids)[I]);
+                            if (col_names && I < col_names->size()) col_name = (*col_names)[I];
                             if (err)
                                 *err = format_mismatch_positional(
                                     I, expect_type<FieldT>(), I, col_name, col_type,
@@ -698,88 +751,131 @@ namespace usub::pg {
             return ok;
         }
 
+        // Member -> column table for one (column list, T) pair. Built once per
+        // distinct result shape, then applied to every row without any name
+        // lookup or normalization.
         template <class T>
-            requires ReflectAggregate<T>
-        inline bool fill_from_row_named(const QueryResult &qr, size_t row_index, T &dst,
-                                        std::string *err) {
+        struct NamedMappingPlan {
+            static constexpr std::size_t N = ureflect::count_members<T>;
+
+            std::vector<std::string> columns;  // shape the plan was built for
+            std::array<int, N> col{};
+            bool ok{false};
+            std::string error;  // why mapping by name is impossible
+        };
+
+        inline uint64_t column_list_hash(const std::vector<std::string> &cols) noexcept {
+            uint64_t h = 1469598103934665603ull;
+            for (const auto &c : cols) {
+                for (unsigned char ch : c) {
+                    h ^= ch;
+                    h *= 1099511628211ull;
+                }
+                h ^= 0xFFu;  // separator: {"ab","c"} != {"a","bc"}
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        template <class T>
+        inline NamedMappingPlan<T> build_named_plan(const std::vector<std::string> &columns) {
             using V = std::decay_t<T>;
             constexpr std::size_t N = ureflect::count_members<V>;
 
-            if (row_index >= qr.rows.size()) {
-                if (err)
-                    *err = "row out of range: row=" + std::to_string(row_index) +
-                           ", total_rows=" + std::to_string(qr.rows.size());
-                return false;
-            }
-            const auto &row = qr.rows[row_index];
+            NamedMappingPlan<T> plan;
+            plan.columns = columns;
 
-            if (qr.columns.empty()) {
-                if (err) *err = "columns are empty (driver didn't fill names)";
-                return false;
+            if (columns.empty()) {
+                plan.error = "columns are empty (driver didn't fill names)";
+                return plan;
             }
 
             std::vector<std::string> norm_cols;
-            norm_cols.reserve(qr.columns.size());
-            for (auto &c : qr.columns) norm_cols.emplace_back(normalize_ident(c));
+            norm_cols.reserve(columns.size());
+            for (auto &c : columns) norm_cols.emplace_back(normalize_ident(c));
 
 #if UPQ_REFLECT_DEBUG
-            UPQ_LOG("[UPQ/reflect] columns[%zu]: %s", norm_cols.size(),
-                    join_csv(qr.columns).c_str());
+            UPQ_LOG("[UPQ/reflect] plan columns[%zu]: %s", norm_cols.size(),
+                    join_csv(columns).c_str());
 #endif
 
             constexpr auto fnames = ureflect::member_names<V>;
-            std::array<std::string, N> norm_fields{};
-            [&]<std::size_t... I>(std::index_sequence<I...>) {
-                ((norm_fields[I] = normalize_ident(fnames[I])), ...);
-            }(std::make_index_sequence<N>{});
-
-            int col_map[N];
-            bool all_found = true;
             std::vector<std::string> missing;
-
             [&]<std::size_t... I>(std::index_sequence<I...>) {
                 (([&] {
-                     const int idx = find_col_idx(norm_cols, norm_fields[I]);
-                     col_map[I] = idx;
-                     if (idx < 0) {
-                         all_found = false;
-                         missing.emplace_back(norm_fields[I]);
-                     }
+                     const std::string nf = normalize_ident(fnames[I]);
+                     const int idx = find_col_idx(norm_cols, nf);
+                     plan.col[I] = idx;
+                     if (idx < 0) missing.emplace_back(nf);
                  }()),
                  ...);
             }(std::make_index_sequence<N>{});
 
-            if (!all_found) {
-                if (err) {
-                    *err = "not all fields matched by name: missing=[" + join_csv(missing) +
-                           "], available_cols=[" + join_csv(qr.columns) + "]";
-                }
-                return false;
+            if (!missing.empty()) {
+                plan.error = "not all fields matched by name: missing=[" + join_csv(missing) +
+                             "], available_cols=[" + join_csv(columns) + "]";
+                return plan;
+            }
+
+            plan.ok = true;
+            return plan;
+        }
+
+        // Per-thread cache of plans for T keyed by the column list hash; the
+        // stored column list guards against hash collisions.
+        template <class T>
+        inline const NamedMappingPlan<T> &named_plan_for(const std::vector<std::string> &columns) {
+            thread_local std::unordered_map<uint64_t, NamedMappingPlan<T>> cache;
+
+            const uint64_t h = column_list_hash(columns);
+            if (auto it = cache.find(h); it != cache.end()) {
+                if (it->second.columns == columns) return it->second;
+                it->second = build_named_plan<T>(columns);
+                return it->second;
             }
 
+            if (cache.size() >= 64) cache.clear();  // ad-hoc shapes must not grow it forever
+            return cache.emplace(h, build_named_plan<T>(columns)).first->second;
+        }
+
+        template <class T, class R>
+            requires ReflectAggregate<T> && PgResultLike<R>
+        inline bool fill_from_row_planned(const R &qr, const NamedMappingPlan<T> &plan,
+                                          size_t row_index, T &dst, std::string *err) {
+            using V = std::decay_t<T>;
+            constexpr std::size_t N = ureflect::count_members<V>;
+
+            decltype(auto) row = qr[row_index];
+            const size_t ncells = row.size();
+
             auto tie = ureflect::to_tie(dst);
             bool ok = true;
             [&]<std::size_t... I>(std::index_sequence<I...>) {
                 (
                     [&] {
+                        if (!ok) return;
                         using FieldT = std::remove_reference_t<decltype(ureflect::get<I>(tie))>;
-                        const int c = col_map[I];
-                        const auto &sv = row.cols[static_cast<size_t>(c)];
-                        FieldT tmp{};
+                        const size_t c = static_cast<size_t>(plan.col[I]);
+                        if (c >= ncells) {
+                            if (err) *err = "row has fewer cells than columns";
+                            ok = false;
+                            return;
+                        }
 
-                        std::string col_type = "unknown";
+                        const std::string_view sv = row.cell(c);
+                        uint32_t oid = 0;
 #ifdef UPQ_RESULT_HAS_COLUMN_OIDS
-                        if (c >= 0 && static_cast<size_t>(c) < qr.column_oids.size())
-                            col_type =
-                                pg_type_name_from_oid(qr.column_oids[static_cast<size_t>(c)]);
+                        if (c < qr.column_oids.size()) oid = qr.column_oids[c];
 #endif
 
-                        if (!Decoder<FieldT>::apply(std::string_view(sv.data(), sv.size()), tmp)) {
+                        FieldT tmp{};
+                        if (!decode_field(sv, tmp, qr.binary, oid)) {
                             if (err) {
+                                constexpr auto fnames = ureflect::member_names<V>;
                                 *err = format_mismatch_named(
-                                    fnames[I], expect_type<FieldT>(),
-                                    qr.columns[static_cast<size_t>(c)], col_type,
-                                    preview_val(std::string_view(sv.data(), sv.size())));
+                                    fnames[I], expect_type<FieldT>(), qr.columns[c],
+                                    oid ? pg_type_name_from_oid(oid) : std::string("unknown"),
+                                    preview_val(sv));
                             }
                             ok = false;
                         } else {
@@ -792,24 +888,99 @@ namespace usub::pg {
             if (!ok && err && err->empty()) *err = "failed to decode aggregate field (named)";
             return ok;
         }
+
+        // All rows at once, column by column: each pass runs one field's
+        // decoder down a whole column. On failure *err reads "row=N: ...".
+        template <class T, class R>
+            requires ReflectAggregate<T> && PgResultLike<R>
+        inline bool fill_all_planned(const R &qr, const NamedMappingPlan<T> &plan, std::vector<T> &out,
+                                     std::string *err) {
+            using V = std::decay_t<T>;
+            constexpr std::size_t N = ureflect::count_members<V>;
+            const size_t nrows = qr.row_count();
+            out.resize(nrows);
+
+            bool ok = true;
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                (
+                    [&] {
+                        if (!ok) return;
+                        using FieldT = std::remove_reference_t<
+                            decltype(ureflect::get<I>(ureflect::to_tie(std::declval<V &>())))>;
+                        const size_t c = static_cast<size_t>(plan.col[I]);
+                        uint32_t oid = 0;
+#ifdef UPQ_RESULT_HAS_COLUMN_OIDS
+                        if (c < qr.column_oids.size()) oid = qr.column_oids[c];
+#endif
+
+                        for (size_t r = 0; r < nrows; ++r) {
+                            decltype(auto) row = qr[r];
+                            if (c >= row.size()) {
+                                if (err) *err = "row=" + std::to_string(r) + ": row has fewer cells than columns";
+                                ok = false;
+                                return;
+                            }
+
+                            const std::string_view sv = row.cell(c);
+                            auto tie = ureflect::to_tie(out[r]);
+                            FieldT &field = ureflect::get<I>(tie);
+                            if (!decode_field(sv, field, qr.binary, oid)) {
+                                if (err) {
+                                    constexpr auto fnames = ureflect::member_names<V>;
+                                    *err = "row=" + std::to_string(r) + ": " +
+                                           format_mismatch_named(
+                                               fnames[I], expect_type<FieldT>(), qr.columns[c],
+                                               oid ? pg_type_name_from_oid(oid) : std::string("unknown"),
+                                               preview_val(sv));
+                                }
+                                ok = false;
+                                return;
+                            }
+                        }
+                    }(),
+                    ...);
+            }(std::make_index_sequence<N>{});
+            return ok;
+        }
+
+        template <class T, class R>
+            requires ReflectAggregate<T> && PgResultLike<R>
+        inline bool fill_from_row_named(const R &qr, size_t row_index, T &dst,
+                                        std::string *err) {
+            if (row_index >= qr.row_count()) {
+                if (err)
+                    *err = "row out of range: row=" + std::to_string(row_index) +
+                           ", total_rows=" + std::to_string(qr.row_count());
+                return false;
+            }
+
+            const NamedMappingPlan<T> &plan = named_plan_for<T>(qr.columns);
+            if (!plan.ok) {
+                if (err) *err = plan.error;
+                return false;
+            }
+            return fill_from_row_planned(qr, plan, row_index, dst, err);
+        }
     }  // namespace detail
 
-    template <class T>
-    inline bool map_row_reflect_positional(const QueryResult::Row &row, T &out,
+    // The mappers below accept both QueryResult and the zero-copy QueryResultView.
+    template <class T, class RowT>
+    inline bool map_row_reflect_positional(const RowT &row, T &out,
                                            std::string *err = nullptr) {
         std::string local;
         std::string *perr = err ? err : &local;
         return detail::fill_from_row_positional_ex(row, nullptr, nullptr, out, perr);
     }
 
-    template <class T>
-    inline bool map_row_reflect_positional_ex(const QueryResult &qr, size_t row_index, T &out,
+    template <class T, class R>
+        requires detail::PgResultLike<R>
+    inline bool map_row_reflect_positional_ex(const R &qr, size_t row_index, T &out,
                                               std::string *err = nullptr) {
-        if (row_index >= qr.rows.size()) {
+        if (row_index >= qr.row_count()) {
             if (err) *err = "row out of range";
             return false;
         }
-        const auto &row = qr.rows[row_index];
+        decltype(auto) row = qr[row_index];
         const std::vector<std::string> *names = qr.columns.empty() ? nullptr : &qr.columns;
 #ifdef UPQ_RESULT_HAS_COLUMN_OIDS
         const std::vector<uint32_t> *oids = &qr.column_oids;
@@ -818,11 +989,12 @@ namespace usub::pg {
 #endif
         std::string local;
         std::string *perr = err ? err : &local;
-        return detail::fill_from_row_positional_ex(row, names, oids, out, perr);
+        return detail::fill_from_row_positional_ex(row, names, oids, out, perr, qr.binary);
     }
 
-    template <class T>
-    inline T map_single_reflect_positional(const QueryResult &qr, size_t row = 0,
+    template <class T, class R>
+        requires detail::PgResultLike<R>
+    inline T map_single_reflect_positional(const R &qr, size_t row = 0,
                                            std::string *err = nullptr) {
         std::string local;
         std::string *perr = err ? err : &local;
@@ -832,14 +1004,15 @@ namespace usub::pg {
         return dst;
     }
 
-    template <class T>
-    inline std::vector<T> map_all_reflect_positional(const QueryResult &qr,
+    template <class T, class R>
+        requires detail::PgResultLike<R>
+    inline std::vector<T> map_all_reflect_positional(const R &qr,
                                                      std::string *err = nullptr) {
         std::string local;
         std::string *perr = err ? err : &local;
         std::vector<T> out;
-        out.reserve(qr.rows.size());
-        for (size_t i = 0; i < qr.rows.size(); ++i) {
+        out.reserve(qr.row_count());
+        for (size_t i = 0; i < qr.row_count(); ++i) {
             T dst{};
             if (!map_row_reflect_positional_ex(qr, i, dst, perr)) {
                 if (perr->empty()) *perr = "decode failed";
@@ -851,18 +1024,18 @@ namespace usub::pg {
         return out;
     }
 
-    template <class T>
-        requires detail::ReflectAggregate<T>
-    inline bool map_row_reflect_named(const QueryResult &qr, size_t row_index, T &out,
+    template <class T, class R>
+        requires detail::ReflectAggregate<T> && detail::PgResultLike<R>
+    inline bool map_row_reflect_named(const R &qr, size_t row_index, T &out,
                                       std::string *err = nullptr) {
         std::string local;
         std::string *perr = err ? err : &local;
         return detail::fill_from_row_named(qr, row_index, out, perr);
     }
 
-    template <class T>
-        requires detail::ReflectAggregate<T>
-    inline T map_single_reflect_named(const QueryResult &qr, size_t row = 0,
+    template <class T, class R>
+        requires detail::ReflectAggregate<T> && detail::PgResultLike<R>
+    inline T map_single_reflect_named(const R &qr, size_t row = 0,
                                       std::string *err = nullptr) {
         std::string local;
         std::string *perr = err ? err : &local;
@@ -872,24 +1045,77 @@ namespace usub::pg {
         return dst;
     }
 
-    template <class T>
-        requires detail::ReflectAggregate<T>
-    inline std::vector<T> map_all_reflect_named(const QueryResult &qr, std::string *err = nullptr) {
+    template <class T, class R>
+        requires detail::ReflectAggregate<T> && detail::PgResultLike<R>
+    inline std::vector<T> map_all_reflect_named(const R &qr, std::string *err = nullptr) {
         std::string local;
         std::string *perr = err ? err : &local;
         std::vector<T> out;
-        out.reserve(qr.rows.size());
-        for (size_t i = 0; i < qr.rows.size(); ++i) {
-            T dst{};
-            if (!map_row_reflect_named(qr, i, dst, perr)) {
-                if (perr->empty()) *perr = "decode failed";
-                *perr = "row=" + std::to_string(i) + ": " + *perr;
-                throw std::runtime_error(*perr);
+        if (qr.row_count() == 0) return out;
+
+        const detail::NamedMappingPlan<T> &plan = detail::named_plan_for<T>(qr.columns);
+        if (!plan.ok) {
+            *perr = plan.error;
+            throw std::runtime_error(*perr);
+        }
+
+        if (!detail::fill_all_planned(qr, plan, out, perr)) {
+            if (perr->empty()) *perr = "decode failed";
+            throw std::runtime_error(*perr);
+        }
+        return out;
+    }
+
+    // Non-throwing mapping used by the *_expected APIs: by column name when
+    // every member of T has a matching column, otherwise by position.
+    template <class T, class R>
+        requires detail::PgResultLike<R>
+    inline std::expected<std::vector<T>, PgOpError> map_all_reflect_expected(const R &qr) {
+        std::vector<T> out;
+        out.reserve(qr.row_count());
+        std::string err;
+
+        if constexpr (detail::ReflectAggregate<T>) {
+            if (qr.row_count() == 0) return out;
+            const detail::NamedMappingPlan<T> &plan = detail::named_plan_for<T>(qr.columns);
+            if (plan.ok) {
+                if (!detail::fill_all_planned(qr, plan, out, &err))
+                    return std::unexpected(PgOpError{PgErrorCode::ParserTruncatedField, std::move(err), {}});
+                return out;
             }
+        }
+
+        for (size_t i = 0; i < qr.row_count(); ++i) {
+            T dst{};
+            if (!map_row_reflect_positional_ex(qr, i, dst, &err))
+                return std::unexpected(PgOpError{PgErrorCode::ParserTruncatedField,
+                                                 "row=" + std::to_string(i) + ": " + err, {}});
             out.emplace_back(std::move(dst));
         }
         return out;
     }
+
+    template <class T, class R>
+        requires detail::PgResultLike<R>
+    inline std::expected<T, PgOpError> map_single_reflect_expected(const R &qr, size_t row = 0) {
+        if (row >= qr.row_count())
+            return std::unexpected(PgOpError{PgErrorCode::Unknown, "no rows", {}});
+
+        std::string err;
+        T dst{};
+        if constexpr (detail::ReflectAggregate<T>) {
+            const detail::NamedMappingPlan<T> &plan = detail::named_plan_for<T>(qr.columns);
+            if (plan.ok) {
+                if (!detail::fill_from_row_planned(qr, plan, row, dst, &err))
+                    return std::unexpected(PgOpError{PgErrorCode::ParserTruncatedField, err, {}});
+                return dst;
+            }
+        }
+
+        if (!map_row_reflect_positional_ex(qr, row, dst, &err))
+            return std::unexpected(PgOpError{PgErrorCode::ParserTruncatedField, err, {}});
+        return dst;
+    }
 }  // namespace usub::pg
 
 #endif  // PGREFLECT_H
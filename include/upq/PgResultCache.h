@@ -0,0 +1,262 @@
+#ifndef PGRESULTCACHE_H
+#define PGRESULTCACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "PgNotificationMultiplexer.h"
+#include "PgPool.h"
+#include "PgReflect.h"
+#include "PgRouting.h"
+#include "PgTypes.h"
+#include "uvent/Uvent.h"
+#include "uvent/sync/AsyncSemaphore.h"
+
+namespace usub::pg {
+    struct PgResultCacheConfig {
+        size_t memory_budget_bytes{64u << 20};        // split evenly across shards
+        size_t shards{16};
+        std::chrono::milliseconds default_ttl{30000};  // 0: entries live until evicted or invalidated
+    };
+
+    struct PgResultCacheStats {
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};         // queries actually sent
+        std::atomic<uint64_t> coalesced{0};      // misses that waited on another caller's query
+        std::atomic<uint64_t> expired{0};
+        std::atomic<uint64_t> evictions{0};      // dropped to stay within the memory budget
+        std::atomic<uint64_t> invalidations{0};  // entries dropped by invalidate() / NOTIFY
+    };
+
+    struct PgCacheOptions {
+        std::chrono::milliseconds ttl{0};  // 0: PgResultCacheConfig::default_ttl
+        // invalidate(tag) drops the entry; with subscribe(), a NOTIFY on
+        // channel c drops tags "c" and "c:<payload>".
+        std::vector<std::string> tags;
+    };
+
+    namespace detail {
+        // kind + result type + SQL + every encoded parameter (format, OID, bytes)
+        template<typename... Args>
+        std::string result_cache_key(std::string_view kind, std::string_view sql, const Args &... args) {
+            constexpr size_t M = count_total_params<Args...>();
+            ParamBuffer<M> pb;
+            (encode_one(pb.ps, args), ...);
+
+            std::string key;
+            key.reserve(kind.size() + sql.size() + 2 + static_cast<size_t>(pb.count()) * 16);
+            key.append(kind);
+            key.push_back('\0');
+            key.append(sql);
+            for (int i = 0; i < pb.count(); ++i) {
+                const char *v = pb.values[i];
+                const uint32_t oid = static_cast<uint32_t>(pb.types[i]);
+                const uint32_t len = !v ? 0xFFFFFFFFu
+                                        : pb.formats[i] == 0 ? static_cast<uint32_t>(std::strlen(v))
+                                                             : static_cast<uint32_t>(pb.lengths[i]);
+                key.push_back(static_cast<char>(pb.formats[i]));
+                key.append(reinterpret_cast<const char *>(&oid), sizeof(oid));
+                key.append(reinterpret_cast<const char *>(&len), sizeof(len));
+                if (v) key.append(v, len);
+            }
+            return key;
+        }
+
+        size_t result_cache_footprint(const QueryResult &qr) noexcept;
+    } // namespace detail
+
+    // Read-through cache over a PgPool (or the read route of a PgConnector).
+    // Results are keyed by SQL plus encoded parameters and shared between
+    // callers as immutable snapshots; concurrent misses for one key send a
+    // single query. Failed queries are never cached.
+    //
+    //   PgResultCache cache{pool};
+    //   co_await cache.subscribe(mux, "countries_changed");
+    //   PgCacheOptions opts;
+    //   opts.tags = {"countries_changed"};
+    //   auto r = co_await cache.query_reflect<Country>(opts, "SELECT code, name FROM countries");
+    class PgResultCache {
+    public:
+        explicit PgResultCache(PgPool &pool, PgResultCacheConfig cfg = {});
+
+        // Misses go to connector.route(hint) (a read by default).
+        explicit PgResultCache(PgConnector &connector, PgResultCacheConfig cfg = {},
+                               RouteHint hint = {});
+
+        PgResultCache(const PgResultCache &) = delete;
+
+        PgResultCache &operator=(const PgResultCache &) = delete;
+
+        // Never null; errors come back as a shared QueryResult with ok == false.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<std::shared_ptr<const QueryResult> >
+        query(PgCacheOptions opts, std::string sql, Args &&... args);
+
+        template<class T, typename... Args>
+        usub::uvent::task::Awaitable<std::expected<std::shared_ptr<const std::vector<T> >, PgOpError> >
+        query_reflect(PgCacheOptions opts, std::string sql, Args &&... args);
+
+        // Drops entries carrying `tag`; queries in flight are not stored.
+        void invalidate(std::string_view tag);
+
+        void clear();
+
+        // Invalidates on NOTIFY. The cache must outlive the handler
+        // (remove_handler with the returned handle before destroying it).
+        usub::uvent::task::Awaitable<std::optional<PgNotificationMultiplexer::HandlerHandle> >
+        subscribe(PgNotificationMultiplexer &mux, const std::string &channel);
+
+        [[nodiscard]] size_t size() const;
+
+        [[nodiscard]] size_t bytes() const;
+
+        inline PgResultCacheStats &stats() { return this->stats_; }
+
+    private:
+        struct Entry {
+            std::string key;
+            std::shared_ptr<const void> value;
+            size_t bytes{0};
+            std::chrono::steady_clock::time_point expires{};  // zero: no expiry
+            std::vector<std::string> tags;
+        };
+
+        struct Flight {
+            usub::uvent::sync::AsyncSemaphore done{0};
+            std::vector<std::string> tags;
+            size_t waiters{0};     // guarded by the shard mutex
+            bool stale{false};     // a tag was invalidated meanwhile; guarded by the shard mutex
+            std::shared_ptr<const void> value;
+            std::optional<PgOpError> error;
+        };
+
+        struct alignas(64) Shard {
+            mutable std::mutex mu;
+            std::list<Entry> lru;  // front = most recent
+            std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+            // tag -> keys of the stored entries carrying it
+            std::unordered_map<std::string, std::unordered_set<std::string_view> > tagged;
+            std::unordered_map<std::string, std::shared_ptr<Flight> > inflight;
+            size_t bytes{0};
+        };
+
+        struct Lookup {
+            std::shared_ptr<const void> value;  // hit
+            std::shared_ptr<Flight> flight;     // miss: lead it or wait on it
+            bool leader{false};
+        };
+
+        Shard &shard_for(const std::string &key);
+
+        Lookup lookup(const std::string &key, const PgCacheOptions &opts);
+
+        // Publishes the leader's outcome to its waiters and stores it when
+        // cacheable and nothing was invalidated meanwhile.
+        void complete(const std::string &key, Lookup &lk, std::shared_ptr<const void> value, size_t bytes,
+                      std::optional<PgOpError> error, const PgCacheOptions &opts);
+
+        void erase_locked(Shard &sh, std::list<Entry>::iterator it);
+
+        PgPool *pick_pool();
+
+        PgResultCache(PgResultCacheConfig cfg, std::function<PgPool *()> resolve);
+
+        PgResultCacheConfig cfg_;
+        size_t shard_budget_;
+        std::vector<std::unique_ptr<Shard> > shards_;
+        std::function<PgPool *()> resolve_;
+        PgResultCacheStats stats_;
+    };
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<std::shared_ptr<const QueryResult> >
+    PgResultCache::query(PgCacheOptions opts, std::string sql, Args &&... args) {
+        const std::string key = detail::result_cache_key("R", sql, args...);
+        Lookup lk = this->lookup(key, opts);
+
+        if (lk.value)
+            co_return std::static_pointer_cast<const QueryResult>(lk.value);
+
+        if (!lk.leader) {
+            co_await lk.flight->done.acquire();
+            co_return std::static_pointer_cast<const QueryResult>(lk.flight->value);
+        }
+
+        QueryResult qr;
+        if (PgPool *pool = this->pick_pool()) {
+            qr = co_await pool->query_awaitable(std::move(sql), std::forward<Args>(args)...);
+        } else {
+            qr.ok = false;
+            qr.code = PgErrorCode::ConnectionClosed;
+            qr.error = "result cache: no pool to route to";
+            qr.rows_valid = false;
+        }
+
+        const size_t bytes = detail::result_cache_footprint(qr);
+        std::optional<PgOpError> err;
+        if (!qr.ok) err = PgOpError{qr.code, qr.error, qr.err_detail};
+
+        auto value = std::make_shared<const QueryResult>(std::move(qr));
+        this->complete(key, lk, value, bytes, std::move(err), opts);
+        co_return value;
+    }
+
+    template<class T, typename... Args>
+    usub::uvent::task::Awaitable<std::expected<std::shared_ptr<const std::vector<T> >, PgOpError> >
+    PgResultCache::query_reflect(PgCacheOptions opts, std::string sql, Args &&... args) {
+        using Vec = std::vector<T>;
+        const std::string key = detail::result_cache_key(typeid(Vec).name(), sql, args...);
+        Lookup lk = this->lookup(key, opts);
+
+        if (lk.value)
+            co_return std::static_pointer_cast<const Vec>(lk.value);
+
+        if (!lk.leader) {
+            co_await lk.flight->done.acquire();
+            if (lk.flight->error)
+                co_return std::unexpected(*lk.flight->error);
+            co_return std::static_pointer_cast<const Vec>(lk.flight->value);
+        }
+
+        QueryResult qr;
+        if (PgPool *pool = this->pick_pool()) {
+            qr = co_await pool->query_awaitable(std::move(sql), std::forward<Args>(args)...);
+        } else {
+            qr.ok = false;
+            qr.code = PgErrorCode::ConnectionClosed;
+            qr.error = "result cache: no pool to route to";
+        }
+
+        if (!qr.ok) {
+            PgOpError e{qr.code, qr.error, qr.err_detail};
+            this->complete(key, lk, nullptr, 0, e, opts);
+            co_return std::unexpected(std::move(e));
+        }
+
+        auto mapped = map_all_reflect_expected<T>(qr);
+        if (!mapped) {
+            this->complete(key, lk, nullptr, 0, mapped.error(), opts);
+            co_return std::unexpected(std::move(mapped.error()));
+        }
+
+        // the mapped rows are charged what their source result weighed
+        auto value = std::make_shared<const Vec>(std::move(*mapped));
+        this->complete(key, lk, value, detail::result_cache_footprint(qr), std::nullopt, opts);
+        co_return value;
+    }
+} // namespace usub::pg
+
+#endif // PGRESULTCACHE_H
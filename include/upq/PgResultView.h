@@ -0,0 +1,229 @@
+#ifndef PGRESULTVIEW_H
+#define PGRESULTVIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <libpq-fe.h>
+
+#include "PgTypeRegistry.h"
+#include "PgTypes.h"
+
+namespace usub::pg {
+    struct PgResultDeleter {
+        void operator()(PGresult *res) const noexcept {
+            if (res) PQclear(res);
+        }
+    };
+
+    using PgResultPtr = std::unique_ptr<PGresult, PgResultDeleter>;
+
+    // Read-only result that keeps the PGresult alive and hands out cells as
+    // std::string_view into libpq's buffer, so no per-cell allocation or copy
+    // happens. Move-only; Row objects and string_views must not outlive it.
+    class QueryResultView {
+    public:
+        class Row {
+        public:
+            Row() = default;
+
+            Row(const QueryResultView *view, int row) noexcept : view_(view), row_(row) {}
+
+            [[nodiscard]] std::string_view cell(size_t c) const noexcept {
+                PGresult *res = this->view_->res_.get();
+                const int ci = static_cast<int>(c);
+                return {PQgetvalue(res, this->row_, ci),
+                        static_cast<size_t>(PQgetlength(res, this->row_, ci))};
+            }
+
+            std::string_view operator[](size_t c) const noexcept { return cell(c); }
+
+            [[nodiscard]] bool is_null(size_t c) const noexcept {
+                return PQgetisnull(this->view_->res_.get(), this->row_, static_cast<int>(c)) != 0;
+            }
+
+            [[nodiscard]] inline size_t size() const noexcept { return this->view_->col_count(); }
+            [[nodiscard]] inline bool empty() const noexcept { return size() == 0; }
+
+            template <class T>
+            [[nodiscard]] inline std::expected<T, PgOpError> get(const QueryResultView &qr,
+                                                                 std::string_view col_name) const {
+                return qr.get<T>(static_cast<size_t>(this->row_), col_name);
+            }
+
+            template <class T>
+            [[nodiscard]] inline std::expected<T, PgOpError> get(std::string_view col_name) const {
+                return this->view_->get<T>(static_cast<size_t>(this->row_), col_name);
+            }
+
+        private:
+            const QueryResultView *view_{nullptr};
+            int row_{0};
+        };
+
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Row;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Row;
+
+            const_iterator() = default;
+
+            const_iterator(const QueryResultView *view, int row) noexcept : view_(view), row_(row) {}
+
+            Row operator*() const noexcept { return Row{this->view_, this->row_}; }
+
+            const_iterator &operator++() noexcept {
+                ++this->row_;
+                return *this;
+            }
+
+            const_iterator operator++(int) noexcept {
+                auto tmp = *this;
+                ++this->row_;
+                return tmp;
+            }
+
+            bool operator==(const const_iterator &o) const noexcept { return this->row_ == o.row_; }
+
+        private:
+            const QueryResultView *view_{nullptr};
+            int row_{0};
+        };
+
+        QueryResultView() = default;
+
+        QueryResultView(QueryResultView &&) noexcept = default;
+
+        QueryResultView &operator=(QueryResultView &&) noexcept = default;
+
+        QueryResultView(const QueryResultView &) = delete;
+
+        QueryResultView &operator=(const QueryResultView &) = delete;
+
+        // Takes ownership of a PGRES_TUPLES_OK result.
+        void adopt(PGresult *res) {
+            this->res_.reset(res);
+            this->nrows_ = res ? PQntuples(res) : 0;
+            this->ncols_ = res ? PQnfields(res) : 0;
+
+            this->columns.clear();
+            this->column_oids.clear();
+            this->columns.reserve(this->ncols_);
+            this->column_oids.reserve(this->ncols_);
+            for (int c = 0; c < this->ncols_; ++c) {
+                const char *nm = PQfname(res, c);
+                this->columns.emplace_back(nm ? nm : "");
+                this->column_oids.push_back(static_cast<uint32_t>(PQftype(res, c)));
+            }
+            this->binary = res && PQbinaryTuples(res) != 0;
+            this->rows_affected = static_cast<uint64_t>(this->nrows_);
+        }
+
+        std::vector<std::string> columns;
+        std::vector<uint32_t> column_oids;
+        bool binary{false};
+
+        bool ok{false};
+        PgErrorCode code{PgErrorCode::Unknown};
+
+        std::string error;
+
+        PgErrorDetail err_detail;
+
+        bool rows_valid{true};
+
+        uint64_t rows_affected{0};
+
+        [[nodiscard]] inline bool empty() const noexcept {
+            return this->ok && this->rows_valid && this->nrows_ == 0;
+        }
+
+        [[nodiscard]] inline bool has_rows() const noexcept {
+            return this->ok && this->rows_valid && this->nrows_ > 0;
+        }
+
+        [[nodiscard]] inline size_t row_count() const noexcept { return static_cast<size_t>(this->nrows_); }
+
+        [[nodiscard]] inline size_t col_count() const noexcept { return static_cast<size_t>(this->ncols_); }
+
+        Row operator[](size_t i) const noexcept { return Row{this, static_cast<int>(i)}; }
+
+        [[nodiscard]] Row at(size_t i) const {
+            if (i >= row_count()) throw std::out_of_range("QueryResultView::at");
+            return Row{this, static_cast<int>(i)};
+        }
+
+        [[nodiscard]] const_iterator begin() const noexcept { return {this, 0}; }
+        [[nodiscard]] const_iterator end() const noexcept { return {this, this->nrows_}; }
+
+        [[nodiscard]] inline std::optional<size_t> column_index(
+            std::string_view name) const noexcept {
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (columns[i] == name) return i;
+            }
+            return std::nullopt;
+        }
+
+        [[nodiscard]] bool is_null(size_t row_i, size_t col) const noexcept {
+            return PQgetisnull(this->res_.get(), static_cast<int>(row_i), static_cast<int>(col)) != 0;
+        }
+
+        template <class T>
+        [[nodiscard]] inline std::expected<T, PgOpError> get(size_t row_i,
+                                                             std::string_view col_name) const {
+            if (!ok || !rows_valid) {
+                PgOpError e;
+                e.code = code;
+                e.error = error.empty() ? "QueryResultView not ok/rows invalid" : error;
+                e.err_detail = err_detail;
+                return std::unexpected(std::move(e));
+            }
+
+            if (row_i >= row_count()) {
+                PgOpError e;
+                e.code = PgErrorCode::ParserTruncatedRow;
+                e.error = "row index out of range";
+                return std::unexpected(std::move(e));
+            }
+
+            auto idx = column_index(col_name);
+            if (!idx) {
+                PgOpError e;
+                e.code = PgErrorCode::ParserTruncatedField;
+                e.error = std::string("missing column: ") + std::string(col_name);
+                return std::unexpected(std::move(e));
+            }
+
+            const std::string_view sv = Row{this, static_cast<int>(row_i)}.cell(*idx);
+            if (binary) return decode_binary_cell<T>(column_oids[*idx], sv);
+            return QueryResult::parse_cell<T>(sv);
+        }
+
+        [[nodiscard]] PGresult *raw() const noexcept { return this->res_.get(); }
+
+    private:
+        PgResultPtr res_;
+        int nrows_{0};
+        int ncols_{0};
+    };
+
+    namespace detail {
+        template <class R>
+        concept PgResultLike = std::is_same_v<std::decay_t<R>, QueryResult> ||
+                               std::is_same_v<std::decay_t<R>, QueryResultView>;
+    } // namespace detail
+} // namespace usub::pg
+
+#endif // PGRESULTVIEW_H
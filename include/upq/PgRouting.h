@@ -4,6 +4,8 @@
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <atomic>
 #include <memory>
 #include <chrono>
 #include <optional>
@@ -20,6 +22,13 @@ namespace usub::pg
 
     enum class QueryKind : uint8_t { Read, Write, DDL, LongRead };
 
+    // How route() picks among eligible replicas.
+    //   LowestRtt         : lowest health-probe RTT, then higher weight (legacy)
+    //   PowerOfTwoChoices : two random candidates, the lower load score wins
+    //   LeastOutstanding  : lowest load score over all candidates
+    // load score = latency EWMA * (busy connections + queued acquires + 1) / weight
+    enum class ReplicaSelection : uint8_t { LowestRtt, PowerOfTwoChoices, LeastOutstanding };
+
     struct BoundedStalenessCfg
     {
         std::chrono::milliseconds max_staleness{0};
@@ -32,6 +41,11 @@ namespace usub::pg
         Consistency consistency{Consistency::Eventual};
         BoundedStalenessCfg staleness{};
         bool read_my_writes{false};
+        // Read-your-writes token (PgTransaction::commit_lsn(),
+        // PgPool::query_with_lsn()): only replicas whose last probed replay
+        // position is at or past it qualify, else the primary. Takes
+        // precedence over read_my_writes, which pins to the primary.
+        PgLsn min_lsn{};
     };
 
     struct PgEndpoint
@@ -49,6 +63,7 @@ namespace usub::pg
         std::chrono::milliseconds rtt{0};
         std::chrono::milliseconds replay_lag{0};
         uint64_t lsn_lag{0};
+        uint64_t replay_lsn{0};  // replay position on replicas, current WAL position on the primary
         uint32_t open_conns{0};
         uint32_t busy_conns{0};
     };
@@ -70,7 +85,12 @@ namespace usub::pg
     {
         uint32_t interval_ms{500};
         uint32_t lag_threshold_ms{120};
+        // Pipelined with the replication query on each node's probe
+        // connection: one statement, no parameters.
         std::string rtt_probe_sql{"SELECT 1"};
+        // Per node and tick, connecting included; a node that misses it is
+        // marked unhealthy for that tick.
+        uint32_t probe_timeout_ms{250};
         uint32_t cb_quiet_ms{500};
         uint32_t cb_backoff_ms{1000};
         uint32_t cb_max_ms{1500};
@@ -81,6 +101,7 @@ namespace usub::pg
         Consistency default_consistency{Consistency::Eventual};
         BoundedStalenessCfg bounded_staleness{std::chrono::milliseconds{150}, 0};
         uint32_t read_my_writes_ttl_ms{500};
+        ReplicaSelection replica_selection{ReplicaSelection::PowerOfTwoChoices};
     };
 
     struct Config
@@ -100,6 +121,7 @@ namespace usub::pg
     {
         int64_t lag_ms;
         int64_t lsn_lag;
+        std::string replay_lsn;
     };
 
     class PgConnector
@@ -113,25 +135,57 @@ namespace usub::pg
 
         usub::uvent::task::Awaitable<void> start_health_loop();
 
+        // Probes every node concurrently, each over one pipelined round trip
+        // on a dedicated connection outside the serving pool. Returns within
+        // HealthCfg::probe_timeout_ms. Run one tick at a time.
         usub::uvent::task::Awaitable<void> health_tick();
 
         PgPool* pin(const std::string& node_name, const RouteHint&);
 
         const Config& config() const { return this->cfg_; }
 
+        // Installs the sink on every node's pool (spans carry the node name),
+        // including pools created later.
+        void set_trace_sink(std::shared_ptr<PgTraceSink> sink, double sample_ratio = 1.0);
+
     private:
+        // NodeStats behind a seqlock: the health tick is the only writer, and
+        // routing reads consistent snapshots without taking a lock.
+        class StatsCell
+        {
+        public:
+            NodeStats load() const noexcept;
+            void store(const NodeStats& s) noexcept;
+
+        private:
+            std::atomic<uint64_t> seq_{0};
+            std::atomic<bool> healthy_{false};
+            std::atomic<int64_t> rtt_ms_{0};
+            std::atomic<int64_t> replay_lag_ms_{0};
+            std::atomic<uint64_t> lsn_lag_{0};
+            std::atomic<uint64_t> replay_lsn_{0};
+            std::atomic<uint32_t> open_conns_{0};
+            std::atomic<uint32_t> busy_conns_{0};
+        };
+
+        struct ProbeJob;
+
         struct Node
         {
             PgEndpoint ep;
             std::unique_ptr<PgPool> pool;
-            NodeStats stats;
-            uint8_t cb_state{0};
+            StatsCell stats;
+            std::atomic<uint8_t> cb_state{0};
             std::chrono::steady_clock::time_point cb_until{};
+            std::shared_ptr<PgConnectionLibpq> probe_conn;  // reused while it answers in time
+            std::shared_ptr<ProbeJob> probe_job;            // a probe that outlived its tick
         };
 
         Config cfg_;
-        std::vector<Node> nodes_;
+        std::deque<Node> nodes_;  // never moved: Node holds atomics
         std::vector<size_t> primary_failover_idx_;
+        std::shared_ptr<PgTraceSink> trace_sink_;
+        double trace_ratio_{1.0};
 
         Node* pick_primary();
         Node* pick_best_replica(const RouteHint& hint);
@@ -139,10 +193,8 @@ namespace usub::pg
         bool ensure_pool(Node& n);
         static bool is_replica(NodeRole r);
         static bool is_usable(NodeRole r);
-        usub::uvent::task::Awaitable<bool> probe_healthy(PgPool& pool);
-        usub::uvent::task::Awaitable<std::chrono::milliseconds> probe_rtt(PgPool& pool, const std::string& sql);
-        usub::uvent::task::Awaitable<std::pair<std::chrono::milliseconds, uint64_t>>
-        probe_replication_lag(PgPool& pool);
+        static usub::uvent::task::Awaitable<void> run_probe(std::shared_ptr<ProbeJob> job);
+        void apply_probe(Node& n, const ProbeJob* job);
         void apply_circuit_breaker(Node& n, bool ok);
     };
 }
@@ -43,6 +43,16 @@ namespace usub::pg {
             return *this;
         }
 
+        PgConnectorBuilder &probe_timeout(std::chrono::milliseconds t) {
+            this->cfg_.health.probe_timeout_ms = (uint32_t) t.count();
+            return *this;
+        }
+
+        PgConnectorBuilder &replica_selection(ReplicaSelection s) {
+            this->cfg_.routing.replica_selection = s;
+            return *this;
+        }
+
         PgConnectorBuilder &pool_limits(uint32_t def_max, uint32_t olap_max) {
             this->cfg_.limits = {def_max, olap_max};
             return *this;
@@ -0,0 +1,182 @@
+#ifndef PGSTATEMENT_H
+#define PGSTATEMENT_H
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "PgConnection.h"
+#include "PgReflect.h"
+#include "PgTypes.h"
+#include "uvent/Uvent.h"
+
+namespace usub::pg {
+    namespace detail {
+        // OID that encode_one always sends for T, or 0 when it depends on the
+        // value (strings, enums, JSON, arrays) and the server should infer it.
+        template<class T>
+        consteval Oid static_param_oid() {
+            using D = std::decay_t<T>;
+            if constexpr (std::is_same_v<D, bool>) return BOOLOID;
+            else if constexpr (Integral<D>) {
+                if constexpr (sizeof(D) <= 2) return INT2OID;
+                else if constexpr (sizeof(D) == 4) return INT4OID;
+                else return INT8OID;
+            } else if constexpr (std::is_same_v<D, float>) return FLOAT4OID;
+            else if constexpr (std::is_same_v<D, double>) return FLOAT8OID;
+            else if constexpr (Optional<D>) return static_param_oid<typename D::value_type>();
+            else return 0;
+        }
+
+        template<class... P>
+        consteval auto static_param_types() {
+            constexpr size_t M = count_total_params<P...>();
+            std::array<Oid, M ? M : 1> out{};
+            size_t i = 0;
+            // aggregates / tuples expand to several slots: leave those to the server
+            auto put = [&]<class T>() {
+                constexpr size_t n = count_total_params<T>();
+                if constexpr (n == 1) out[i] = static_param_oid<T>();
+                i += n;
+            };
+            (put.template operator()<P>(), ...);
+            return out;
+        }
+
+        template<class R>
+        struct statement_result {
+            using type = std::expected<R, PgOpError>;
+        };
+
+        template<>
+        struct statement_result<void> {
+            using type = QueryResult;
+        };
+
+        template<>
+        struct statement_result<QueryResult> {
+            using type = QueryResult;
+        };
+
+        template<class R>
+        inline typename statement_result<R>::type finish_statement(QueryResult &&qr) {
+            if constexpr (std::is_void_v<R> || std::is_same_v<R, QueryResult>) {
+                return std::move(qr);
+            } else {
+                if (!qr.ok)
+                    return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
+
+                // single-row forms: extra rows mean the statement is not what the signature says
+                if constexpr (!is_std_vector_reflect<R>::value) {
+                    if (qr.rows.size() > 1)
+                        return std::unexpected(PgOpError{
+                            PgErrorCode::Unknown,
+                            "statement returned " + std::to_string(qr.rows.size()) + " rows, expected at most one",
+                            {}
+                        });
+                }
+
+                if constexpr (is_std_vector_reflect<R>::value) {
+                    return map_all_reflect_expected<typename R::value_type>(qr);
+                } else if constexpr (Optional<R>) {
+                    if (qr.rows.empty()) return R{};
+                    auto v = map_single_reflect_expected<typename R::value_type>(qr, 0);
+                    if (!v) return std::unexpected(std::move(v.error()));
+                    return R{std::move(*v)};
+                } else {
+                    return map_single_reflect_expected<R>(qr, 0);
+                }
+            }
+        }
+    } // namespace detail
+
+    template<class Signature>
+    class PgStatement;
+
+    // A query declared once with its parameter and result types:
+    //
+    //   constexpr PgStatement<std::optional<User>(int64_t)> get_user{
+    //       "SELECT id, name FROM users WHERE id = $1"};
+    //
+    // The placeholder count is checked at compile time, the parameter OIDs
+    // and the server-side statement name are computed at compile time, and
+    // every connection prepares it once under that name.
+    //
+    // R: QueryResult / void (raw result), std::vector<T>, std::optional<T>,
+    // or T (exactly one row expected); all but the raw forms come back as
+    // std::expected<R, PgOpError>.
+    template<class R, class... P>
+    class PgStatement<R(P...)> {
+    public:
+        using result_type = typename detail::statement_result<R>::type;
+
+        static constexpr size_t param_count = detail::count_total_params<P...>();
+        static constexpr auto param_types = detail::static_param_types<P...>();
+
+        consteval PgStatement(const char *sql) : sql_(sql) {
+            const std::string_view sv(sql);
+            if (detail::count_pg_params(sv) != param_count)
+                throw "pg: $N placeholder count does not match the statement signature";
+
+            // FNV-1a over the SQL bytes followed by the OIDs (same as PgStatementCache)
+            uint64_t h = 1469598103934665603ull;
+            for (char c: sv) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 1099511628211ull;
+            }
+            for (size_t i = 0; i < param_count; ++i) {
+                const uint32_t oid = static_cast<uint32_t>(param_types[i]);
+                for (int b = 0; b < 4; ++b) {
+                    h ^= (oid >> (b * 8)) & 0xFFu;
+                    h *= 1099511628211ull;
+                }
+            }
+            this->key_ = h;
+
+            constexpr char prefix[] = "upq_st_";
+            constexpr char hex[] = "0123456789abcdef";
+            size_t n = 0;
+            for (size_t i = 0; i + 1 < sizeof(prefix); ++i) this->name_[n++] = prefix[i];
+            for (int s = 60; s >= 0; s -= 4) this->name_[n++] = hex[(h >> s) & 0xFu];
+            this->name_[n] = '\0';
+        }
+
+        [[nodiscard]] constexpr const char *sql() const noexcept { return this->sql_; }
+        [[nodiscard]] constexpr const char *name() const noexcept { return this->name_.data(); }
+        [[nodiscard]] constexpr uint64_t key() const noexcept { return this->key_; }
+
+    private:
+        const char *sql_;
+        uint64_t key_{0};
+        std::array<char, 24> name_{};
+    };
+
+    namespace detail {
+        template<class R, class... P>
+        usub::uvent::task::Awaitable<QueryResult>
+        run_statement(PgConnectionLibpq &conn, const PgStatement<R(P...)> &st,
+                      std::type_identity_t<const P &>... args) {
+            using Stmt = PgStatement<R(P...)>;
+            constexpr size_t M = Stmt::param_count;
+
+            ParamBuffer<M> pb;
+            (encode_one(pb.ps, args), ...);
+
+            // statically known OIDs win so a NULL optional does not prepare
+            // the statement with an unspecified type
+            std::array<Oid, ParamBuffer<M>::slots> types = pb.types;
+            for (size_t i = 0; i < M; ++i)
+                if (Stmt::param_types[i]) types[i] = Stmt::param_types[i];
+
+            co_return co_await conn.exec_prepared_named(st.name(), st.sql(), st.key(), pb.count(),
+                                                        types.data(), pb.values.data(),
+                                                        pb.lengths.data(), pb.formats.data());
+        }
+    } // namespace detail
+} // namespace usub::pg
+
+#endif // PGSTATEMENT_H
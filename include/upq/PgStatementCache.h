@@ -0,0 +1,164 @@
+#ifndef PGSTATEMENTCACHE_H
+#define PGSTATEMENTCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <libpq-fe.h>
+
+namespace usub::pg {
+    // Counters shared between all connections of one pool.
+    struct PgStatementCacheStats {
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+        std::atomic<uint64_t> invalidations{0};
+    };
+
+    // Per-connection LRU of server-side prepared statements, keyed by a hash
+    // of the SQL text and the parameter OIDs. Not thread-safe: a connection
+    // is used by one coroutine at a time.
+    class PgStatementCache {
+    public:
+        struct Entry {
+            uint64_t key{0};
+            std::string name;
+            std::string sql;
+            std::vector<Oid> types;
+        };
+
+        struct Counters {
+            uint64_t hits{0};
+            uint64_t misses{0};
+            uint64_t evictions{0};
+            uint64_t invalidations{0};
+        };
+
+        PgStatementCache() = default;
+
+        // Entries over the new capacity are evicted; their server-side names
+        // are returned so the caller can DEALLOCATE them.
+        [[nodiscard]] std::vector<std::string> set_capacity(size_t capacity,
+                                                            PgStatementCacheStats *shared = nullptr) {
+            this->capacity_ = capacity;
+            this->shared_ = shared;
+            std::vector<std::string> dropped;
+            while (this->lru_.size() > capacity) {
+                auto name = evict_lru();
+                if (!name) break;
+                dropped.push_back(std::move(*name));
+            }
+            return dropped;
+        }
+
+        [[nodiscard]] bool enabled() const noexcept { return this->capacity_ != 0; }
+        [[nodiscard]] size_t capacity() const noexcept { return this->capacity_; }
+        [[nodiscard]] size_t size() const noexcept { return this->lru_.size(); }
+        [[nodiscard]] bool full() const noexcept { return this->lru_.size() >= this->capacity_; }
+        [[nodiscard]] const Counters &counters() const noexcept { return this->counters_; }
+
+        static uint64_t make_key(std::string_view sql, const Oid *types, int n) noexcept {
+            // FNV-1a over the SQL bytes followed by the OIDs
+            uint64_t h = 1469598103934665603ull;
+            for (unsigned char c: sql) {
+                h ^= c;
+                h *= 1099511628211ull;
+            }
+            for (int i = 0; i < n; ++i) {
+                uint32_t oid = static_cast<uint32_t>(types[i]);
+                for (int b = 0; b < 4; ++b) {
+                    h ^= (oid >> (b * 8)) & 0xFFu;
+                    h *= 1099511628211ull;
+                }
+            }
+            return h;
+        }
+
+        // Returns the entry and moves it to the front, or nullptr on miss.
+        const Entry *find(uint64_t key, std::string_view sql, const Oid *types, int n) {
+            auto it = this->index_.find(key);
+            if (it == this->index_.end() || !same(*it->second, sql, types, n)) {
+                ++this->counters_.misses;
+                if (this->shared_) this->shared_->misses.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            this->lru_.splice(this->lru_.begin(), this->lru_, it->second);
+            ++this->counters_.hits;
+            if (this->shared_) this->shared_->hits.fetch_add(1, std::memory_order_relaxed);
+            return &*it->second;
+        }
+
+        // Drops the least recently used entry; returns its server-side name.
+        std::optional<std::string> evict_lru() {
+            if (this->lru_.empty()) return std::nullopt;
+            Entry &victim = this->lru_.back();
+            std::string name = std::move(victim.name);
+            this->index_.erase(victim.key);
+            this->lru_.pop_back();
+            ++this->counters_.evictions;
+            if (this->shared_) this->shared_->evictions.fetch_add(1, std::memory_order_relaxed);
+            return name;
+        }
+
+        const Entry &insert(uint64_t key, std::string_view sql, const Oid *types, int n, std::string name) {
+            if (auto it = this->index_.find(key); it != this->index_.end()) {
+                // hash collision with a different statement: the newer one wins
+                this->lru_.erase(it->second);
+                this->index_.erase(it);
+            }
+            Entry e;
+            e.key = key;
+            e.name = std::move(name);
+            e.sql.assign(sql.data(), sql.size());
+            e.types.assign(types, types + n);
+            this->lru_.emplace_front(std::move(e));
+            this->index_[key] = this->lru_.begin();
+            return this->lru_.front();
+        }
+
+        // Forgets one statement (stale plan, missing on the server).
+        std::optional<std::string> invalidate(uint64_t key) {
+            auto it = this->index_.find(key);
+            if (it == this->index_.end()) return std::nullopt;
+            std::string name = std::move(it->second->name);
+            this->lru_.erase(it->second);
+            this->index_.erase(it);
+            ++this->counters_.invalidations;
+            if (this->shared_) this->shared_->invalidations.fetch_add(1, std::memory_order_relaxed);
+            return name;
+        }
+
+        // Server-side statements are gone after a reconnect.
+        void clear() noexcept {
+            this->index_.clear();
+            this->lru_.clear();
+        }
+
+        std::string next_name() {
+            return "upq_ps_" + std::to_string(++this->seq_);
+        }
+
+    private:
+        static bool same(const Entry &e, std::string_view sql, const Oid *types, int n) noexcept {
+            return e.sql == sql
+                   && e.types.size() == static_cast<size_t>(n)
+                   && (n == 0 || std::memcmp(e.types.data(), types, sizeof(Oid) * static_cast<size_t>(n)) == 0);
+        }
+
+        size_t capacity_{0};
+        PgStatementCacheStats *shared_{nullptr};
+        std::list<Entry> lru_;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+        Counters counters_{};
+        uint64_t seq_{0};
+    };
+} // namespace usub::pg
+
+#endif // PGSTATEMENTCACHE_H
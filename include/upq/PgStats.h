@@ -0,0 +1,217 @@
+#ifndef PGSTATS_H
+#define PGSTATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "PgTypes.h"
+
+namespace usub::pg {
+    namespace detail {
+        // Log-linear buckets over microseconds: exact below 16us, then 8
+        // sub-buckets per power of two (<= 12.5% relative error) up to ~2.4h.
+        inline constexpr size_t latency_sub_bits = 3;
+        inline constexpr size_t latency_buckets = 248;
+
+        constexpr size_t latency_bucket(uint64_t us) noexcept {
+            constexpr uint64_t linear = uint64_t{2} << latency_sub_bits;
+            if (us < linear) return static_cast<size_t>(us);
+            const unsigned msb = 63u - static_cast<unsigned>(std::countl_zero(us));
+            const unsigned e = msb - static_cast<unsigned>(latency_sub_bits);
+            const size_t idx = (static_cast<size_t>(e) + 1) << latency_sub_bits |
+                               static_cast<size_t>((us >> e) & ((1u << latency_sub_bits) - 1));
+            return idx < latency_buckets ? idx : latency_buckets - 1;
+        }
+
+        // Smallest value that lands in bucket idx.
+        constexpr uint64_t latency_bucket_lower(size_t idx) noexcept {
+            constexpr size_t linear = size_t{2} << latency_sub_bits;
+            if (idx < linear) return idx;
+            const size_t e = (idx >> latency_sub_bits) - 1;
+            const uint64_t sub = idx & ((size_t{1} << latency_sub_bits) - 1);
+            return ((uint64_t{1} << latency_sub_bits) | sub) << e;
+        }
+
+        // Counters below have exactly one writer (the owning thread), so a
+        // relaxed load + store is enough and never bounces a cache line.
+        inline void stat_add(std::atomic<uint64_t> &a, uint64_t v = 1) noexcept {
+            a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+
+        // Fast statement fingerprint: 8 bytes per step, never 0.
+        inline uint64_t stats_fingerprint(std::string_view sql) noexcept {
+            uint64_t h = 0x9E3779B97F4A7C15ull ^ sql.size();
+            size_t i = 0;
+            for (; i + 8 <= sql.size(); i += 8) {
+                uint64_t w;
+                std::memcpy(&w, sql.data() + i, 8);
+                h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+                h ^= h >> 32;
+            }
+            uint64_t tail = 0;
+            for (size_t k = 0; i < sql.size(); ++i, k += 8)
+                tail |= static_cast<uint64_t>(static_cast<unsigned char>(sql[i])) << k;
+            h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+            h ^= h >> 29;
+            return h ? h : 1;
+        }
+
+        inline constexpr size_t error_code_count = static_cast<size_t>(PgErrorCode::Unknown) + 1;
+        inline constexpr size_t sqlstate_class_count = static_cast<size_t>(PgSqlStateClass::Other) + 1;
+    } // namespace detail
+
+    // Single-writer latency histogram; readers take snapshots.
+    class PgLatencyHistogram {
+    public:
+        void record(uint64_t us) noexcept {
+            detail::stat_add(this->counts_[detail::latency_bucket(us)]);
+            detail::stat_add(this->count_);
+            detail::stat_add(this->sum_us_, us);
+        }
+
+        friend struct PgLatencySnapshot;
+
+    private:
+        std::array<std::atomic<uint64_t>, detail::latency_buckets> counts_{};
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_us_{0};
+    };
+
+    struct PgLatencySnapshot {
+        std::array<uint64_t, detail::latency_buckets> counts{};
+        uint64_t count{0};
+        uint64_t sum_us{0};
+
+        void merge(const PgLatencyHistogram &h) noexcept {
+            for (size_t i = 0; i < detail::latency_buckets; ++i)
+                this->counts[i] += h.counts_[i].load(std::memory_order_relaxed);
+            this->count += h.count_.load(std::memory_order_relaxed);
+            this->sum_us += h.sum_us_.load(std::memory_order_relaxed);
+        }
+
+        // Lower bound of the bucket holding quantile q (0..1).
+        [[nodiscard]] uint64_t percentile_us(double q) const noexcept {
+            if (this->count == 0) return 0;
+            const auto rank = static_cast<uint64_t>(q * static_cast<double>(this->count - 1));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < detail::latency_buckets; ++i) {
+                seen += this->counts[i];
+                if (seen > rank) return detail::latency_bucket_lower(i);
+            }
+            return detail::latency_bucket_lower(detail::latency_buckets - 1);
+        }
+    };
+
+    // Exponentially weighted query latency of one pool (alpha = 1/8). Its
+    // connections update it without a CAS; a lost sample only slows convergence.
+    class PgLatencyEwma {
+    public:
+        void observe(uint64_t us) noexcept {
+            const uint64_t old = this->v_.load(std::memory_order_relaxed);
+            this->v_.store(old ? old - (old >> 3) + (us >> 3) : std::max<uint64_t>(us, 1),
+                           std::memory_order_relaxed);
+        }
+
+        // 0 until the first sample.
+        [[nodiscard]] uint64_t value_us() const noexcept { return this->v_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> v_{0};
+    };
+
+    struct PgPoolGauges {
+        uint64_t live{0};
+        uint64_t idle{0};
+        uint64_t waiters{0};
+        uint64_t acquire_waits{0};
+        uint64_t acquire_timeouts{0};
+        uint64_t acquire_wait_us_total{0};
+        uint64_t acquire_wait_us_max{0};
+    };
+
+    // Process-wide metrics. Every thread records into its own slab of
+    // single-writer counters; dumps sum the slabs. Scopes are pools (and so
+    // PgConnector nodes, each of which owns a pool); statements are keyed by
+    // a fingerprint of their SQL text.
+    class PgStatsRegistry {
+    public:
+        static constexpr uint32_t max_scopes = 64;
+        static constexpr size_t max_fingerprints = 512;  // per thread
+
+        static PgStatsRegistry &instance();
+
+        void set_enabled(bool on) noexcept { this->enabled_.store(on, std::memory_order_relaxed); }
+        [[nodiscard]] bool enabled() const noexcept { return this->enabled_.load(std::memory_order_relaxed); }
+
+        // Scope 0 ("default") collects connections that are not in a pool;
+        // it is also returned once max_scopes are taken.
+        uint32_t register_scope(std::string name);
+
+        void rename_scope(uint32_t scope, std::string name);
+
+        uint64_t register_pool_gauges(uint32_t scope, std::function<PgPoolGauges()> fn);
+
+        void unregister_pool_gauges(uint64_t token);
+
+        // Hot path. `sql` is only read the first time a thread sees `fingerprint`.
+        // A batch (execute_many) counts `statements` queries, `failed` of them
+        // errors, and one latency sample for the round trip.
+        void record_query(uint32_t scope, uint64_t fingerprint, std::string_view sql,
+                          std::chrono::steady_clock::duration latency, const QueryResult &r,
+                          uint64_t bytes_out, uint64_t bytes_in, uint64_t statements = 1,
+                          uint64_t failed = 0) noexcept;
+
+        void record_commit(uint32_t scope) noexcept;
+
+        void record_rollback(uint32_t scope) noexcept;
+
+        [[nodiscard]] PgLatencySnapshot latency(uint32_t scope) const;
+
+        // Prometheus text exposition format (version 0.0.4).
+        [[nodiscard]] std::string metrics_dump() const;
+
+    private:
+        struct ScopeCell;
+        struct FingerprintCell;
+        struct ThreadSlab;
+
+        PgStatsRegistry();
+
+        // Null only when out of memory; the sample is dropped.
+        ThreadSlab *slab() noexcept;
+
+        ThreadSlab *slab_slow() noexcept;
+
+        ScopeCell *scope_cell(ThreadSlab &s, uint32_t scope) noexcept;
+
+        FingerprintCell *fingerprint_cell(ThreadSlab &s, uint64_t fp, std::string_view sql) noexcept;
+
+        std::atomic<bool> enabled_{true};
+
+        mutable std::mutex mu_;
+        std::vector<std::unique_ptr<ThreadSlab> > slabs_;
+        std::array<std::string, max_scopes> scope_names_;
+        uint32_t next_scope_{1};
+        std::unordered_map<uint64_t, std::string> fingerprint_sql_;
+        std::unordered_map<uint64_t, std::pair<uint32_t, std::function<PgPoolGauges()> > > gauges_;
+        uint64_t next_gauge_{1};
+    };
+
+    inline std::string metrics_dump() {
+        return PgStatsRegistry::instance().metrics_dump();
+    }
+} // namespace usub::pg
+
+#endif // PGSTATS_H
@@ -0,0 +1,85 @@
+#ifndef PGSTREAM_H
+#define PGSTREAM_H
+
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "uvent/Uvent.h"
+#include "PgConnection.h"
+#include "PgReflect.h"
+#include "PgTypes.h"
+
+namespace usub::pg {
+    class PgPool;
+
+    // Pull-style row stream over a single-row-mode query. The connection
+    // stays checked out of the pool until the stream is finished or closed;
+    // at most batch_rows rows are buffered on the client at a time, and the
+    // server is slowed down by TCP backpressure while the caller is busy.
+    class PgRowStream {
+    public:
+        PgRowStream() = default;
+
+        PgRowStream(PgPool *pool, std::shared_ptr<PgConnectionLibpq> conn, uint32_t batch_rows) noexcept;
+
+        PgRowStream(PgRowStream &&o) noexcept;
+
+        PgRowStream &operator=(PgRowStream &&o) noexcept;
+
+        PgRowStream(const PgRowStream &) = delete;
+
+        PgRowStream &operator=(const PgRowStream &) = delete;
+
+        // Releases the connection; a stream that was not drained closes it.
+        ~PgRowStream();
+
+        // Next batch of rows; chunk.done is set after the last batch or an error.
+        usub::uvent::task::Awaitable<PgCursorChunk> next();
+
+        // Next batch mapped onto T (by name, positional when names do not match).
+        // An empty vector together with done() marks the end of the stream.
+        template<class T>
+        usub::uvent::task::Awaitable<std::expected<std::vector<T>, PgOpError> > next_as();
+
+        // Discards unread rows and returns the connection to the pool.
+        usub::uvent::task::Awaitable<void> close();
+
+        [[nodiscard]] bool done() const noexcept { return this->done_; }
+        [[nodiscard]] uint32_t batch_rows() const noexcept { return this->batch_rows_; }
+        [[nodiscard]] const std::vector<std::string> &columns() const noexcept { return this->columns_; }
+
+    private:
+        void release() noexcept;
+
+        PgPool *pool_{nullptr};
+        std::shared_ptr<PgConnectionLibpq> conn_;
+        uint32_t batch_rows_{256};
+        bool done_{true};
+        std::vector<std::string> columns_;
+    };
+
+    template<class T>
+    usub::uvent::task::Awaitable<std::expected<std::vector<T>, PgOpError> >
+    PgRowStream::next_as() {
+        PgCursorChunk ch = co_await next();
+        if (!ch.ok)
+            co_return std::unexpected(PgOpError{ch.code, ch.error, ch.err_detail});
+
+        QueryResult qr;
+        qr.ok = true;
+        qr.code = PgErrorCode::OK;
+        qr.rows_valid = true;
+        qr.columns = std::move(ch.columns);
+        qr.column_oids = std::move(ch.column_oids);
+        qr.binary = ch.binary;
+        qr.rows = std::move(ch.rows);
+        qr.rows_affected = qr.rows.size();
+
+        co_return usub::pg::map_all_reflect_expected<T>(qr);
+    }
+} // namespace usub::pg
+
+#endif // PGSTREAM_H
@@ -0,0 +1,84 @@
+#ifndef PGTEXTSCAN_H
+#define PGTEXTSCAN_H
+
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+namespace usub::pg::detail {
+    // Index of the first ',', '"', '\\', '{' or '}' in p[0, n), or n. The
+    // kernel (AVX2, SSE4.2, NEON or scalar) is picked once from the CPU.
+    size_t scan_array_special(const char *p, size_t n) noexcept;
+
+    // "avx2", "sse4.2", "neon" or "scalar".
+    const char *text_scan_kernel() noexcept;
+
+    // Eight ASCII digits, first one in the lowest byte.
+    constexpr bool swar_is_eight_digits(uint64_t w) noexcept {
+        return ((w & 0xF0F0F0F0F0F0F0F0ull) |
+                (((w + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+    }
+
+    constexpr uint32_t swar_parse_eight_digits(uint64_t w) noexcept {
+        w -= 0x3030303030303030ull;
+        w = w * 10 + (w >> 8);
+        w = (((w & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+             (((w >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+        return static_cast<uint32_t>(w);
+    }
+
+    // Same contract as std::from_chars over the whole view (optional '-',
+    // decimal digits only, range-checked), eight digits per step.
+    template <class Int>
+    inline bool parse_decimal_int(std::string_view sv, Int &out) noexcept {
+        const char *p = sv.data();
+        const char *end = p + sv.size();
+        bool neg = false;
+        if constexpr (std::is_signed_v<Int>) {
+            if (p != end && *p == '-') {
+                neg = true;
+                ++p;
+            }
+        }
+
+        // 19 digits always fit in a uint64_t; longer input is left to libstdc++
+        if (std::endian::native != std::endian::little || p == end || end - p > 19) {
+            Int tmp{};
+            auto r = std::from_chars(sv.data(), sv.data() + sv.size(), tmp);
+            if (r.ec != std::errc{} || r.ptr != sv.data() + sv.size()) return false;
+            out = tmp;
+            return true;
+        }
+
+        uint64_t v = 0;
+        for (; end - p >= 8; p += 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            if (!swar_is_eight_digits(w)) return false;
+            v = v * 100000000u + swar_parse_eight_digits(w);
+        }
+        for (; p != end; ++p) {
+            const auto d = static_cast<unsigned>(static_cast<unsigned char>(*p) - '0');
+            if (d > 9) return false;
+            v = v * 10 + d;
+        }
+
+        if constexpr (std::is_signed_v<Int>) {
+            using U = std::make_unsigned_t<Int>;
+            const uint64_t limit = static_cast<uint64_t>(std::numeric_limits<Int>::max()) + (neg ? 1 : 0);
+            if (v > limit) return false;
+            out = neg ? static_cast<Int>(static_cast<U>(0) - static_cast<U>(v)) : static_cast<Int>(v);
+        } else {
+            if (v > std::numeric_limits<Int>::max()) return false;
+            out = static_cast<Int>(v);
+        }
+        return true;
+    }
+} // namespace usub::pg::detail
+
+#endif // PGTEXTSCAN_H
@@ -0,0 +1,109 @@
+#ifndef PGTRACE_H
+#define PGTRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "PgTypes.h"
+
+namespace usub::pg {
+    // One statement, as seen by the client. Phase timestamps are monotonic
+    // (steady_clock); a default-constructed time_point means the phase was
+    // not reached (an early error) or does not apply (no mapping step).
+    //
+    //   start    -> encoded : parameter encoding (encode_one)
+    //   encoded  -> sent    : PQsend* + flushing the socket
+    //   sent     -> server  : waiting for the first result
+    //   server   -> decoded : building QueryResult rows
+    //   decoded  -> mapped  : map_*_reflect into the caller's type
+    struct PgTraceSpan {
+        uint64_t connection_id{0};
+        std::string_view node;
+        std::string_view sql;
+        uint64_t fingerprint{0};
+
+        std::chrono::steady_clock::time_point start{};
+        std::chrono::steady_clock::time_point encoded{};
+        std::chrono::steady_clock::time_point sent{};
+        std::chrono::steady_clock::time_point server{};
+        std::chrono::steady_clock::time_point decoded{};
+        std::chrono::steady_clock::time_point mapped{};
+
+        uint64_t rows{0};
+        uint64_t bytes_out{0};
+        uint64_t bytes_in{0};
+
+        bool ok{false};
+        PgErrorCode code{PgErrorCode::OK};
+        std::string_view sqlstate;
+    };
+
+    // Receives sampled spans on the thread that ran the query; must not
+    // block. Views in the span are only valid during the call.
+    class PgTraceSink {
+    public:
+        virtual ~PgTraceSink() = default;
+
+        virtual void on_span(const PgTraceSpan &span) noexcept = 0;
+    };
+
+    // Shared by a pool and its connections; replaced as a whole, never mutated.
+    struct PgTraceConfig {
+        std::shared_ptr<PgTraceSink> sink;
+        uint64_t sample_threshold{~uint64_t{0}};  // sampled when a random u64 <= this
+        std::string node;
+
+        static uint64_t threshold_for(double ratio) noexcept {
+            if (ratio >= 1.0) return ~uint64_t{0};
+            if (ratio <= 0.0) return 0;
+            return static_cast<uint64_t>(ratio * 18446744073709551615.0);
+        }
+
+        [[nodiscard]] bool sample() const noexcept {
+            if (this->sample_threshold == ~uint64_t{0}) return true;
+            // xorshift64*, per thread
+            thread_local uint64_t s = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&s);
+            s ^= s >> 12;
+            s ^= s << 25;
+            s ^= s >> 27;
+            return s * 0x2545F4914F6CDD1Dull <= this->sample_threshold && this->sample_threshold != 0;
+        }
+    };
+
+    // Started by a connection when a statement begins, handed back with its
+    // result. Inactive (and free) when neither stats nor tracing want it.
+    struct PgQueryProbe {
+        bool active{false};
+        bool traced{false};
+        uint64_t fingerprint{0};
+        std::string_view sql;
+        uint64_t bytes_out{0};
+        uint64_t bytes_in_at{0};
+        uint64_t statements{1};  // more than one for a batch recorded as a whole
+        uint64_t failed{0};
+        std::chrono::steady_clock::time_point t0{};
+        std::chrono::steady_clock::time_point encoded{};
+        std::chrono::steady_clock::time_point sent{};
+        std::chrono::steady_clock::time_point server{};
+        bool defer_map{false};
+
+        void add_params(int n, const char *const *values, const int *lengths, const int *formats) noexcept {
+            if (!this->active) return;
+            for (int i = 0; i < n; ++i) {
+                if (!values[i]) continue;
+                this->bytes_out += formats[i] == 0 ? std::strlen(values[i]) : static_cast<size_t>(lengths[i]);
+            }
+            this->mark(this->encoded);
+        }
+
+        void mark(std::chrono::steady_clock::time_point &at) noexcept {
+            if (this->traced) at = std::chrono::steady_clock::now();
+        }
+    };
+} // namespace usub::pg
+
+#endif // PGTRACE_H
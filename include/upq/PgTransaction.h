@@ -14,6 +14,7 @@
 
 #include "PgPool.h"
 #include "PgConnection.h"
+#include "PgStatement.h"
 #include "PgTypes.h"
 #include "PgReflect.h"
 #include "uvent/Uvent.h"
@@ -30,6 +31,12 @@ namespace usub::pg {
         TxIsolationLevel isolation = TxIsolationLevel::Default;
         bool read_only = false;
         bool deferrable = false;
+        // COMMIT also returns the WAL position in the same round trip, for
+        // PgTransaction::commit_lsn() / RouteHint::min_lsn.
+        bool capture_commit_lsn = false;
+        // begin() only takes a connection; BEGIN goes out in the same round
+        // trip as the first statement (or not at all if none runs).
+        bool lazy_begin = false;
     };
 
     class PgTransaction {
@@ -47,6 +54,29 @@ namespace usub::pg {
         usub::uvent::task::Awaitable<QueryResult>
         query(std::string sql, Args &&... args);
 
+        // With a deadline (see PgQueryOptions). A timed-out statement aborts
+        // the transaction like any other failure; the connection survives.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResult>
+        query(PgQueryOptions opts, std::string sql, Args &&... args);
+
+        // Runs a PgStatement on the transaction's connection.
+        template<class R, class... P>
+        usub::uvent::task::Awaitable<typename PgStatement<R(P...)>::result_type>
+        execute(const PgStatement<R(P...)> &st, std::type_identity_t<const P &>... args);
+
+        // Runs a PgPipeline inside this transaction. Sync points do not end
+        // the explicit transaction; a failing statement aborts it as usual.
+        usub::uvent::task::Awaitable<std::vector<QueryResult> >
+        pipeline(PgPipeline pipeline);
+
+        // Bulk statement on the transaction's connection (see
+        // PgConnectionLibpq::execute_many). A failing item aborts the
+        // transaction, so the items after it fail too.
+        template<std::ranges::forward_range R>
+        usub::uvent::task::Awaitable<PgExecManyResult>
+        execute_many(std::string sql, R &&items, PgExecManyOptions opts = {});
+
         template<class Obj>
         usub::uvent::task::Awaitable<QueryResult>
         query_reflect(std::string sql, const Obj &obj) {
@@ -58,7 +88,7 @@ namespace usub::pg {
                 bad.rows_valid = false;
                 co_return bad;
             }
-            co_return co_await conn_->exec_param_query_nonblocking(std::move(sql), obj);
+            co_return co_await this->run_on_tx(std::move(sql), obj);
         }
 
         template<class Obj>
@@ -70,7 +100,7 @@ namespace usub::pg {
         template<class T>
         [[deprecated]] usub::uvent::task::Awaitable<std::vector<T> >
         query_reflect(std::string sql) {
-            if (!active_ || !conn_ || !conn_->connected())
+            if (!active_ || !conn_ || !conn_->connected() || !co_await this->flush_begin())
                 co_return std::vector<T>{};
             co_return co_await conn_->exec_simple_query_nonblocking<T>(std::move(sql));
         }
@@ -78,7 +108,7 @@ namespace usub::pg {
         template<class T>
         [[deprecated]] usub::uvent::task::Awaitable<std::optional<T> >
         query_reflect_one(std::string sql) {
-            if (!active_ || !conn_ || !conn_->connected())
+            if (!active_ || !conn_ || !conn_->connected() || !co_await this->flush_begin())
                 co_return std::optional<T>{};
             co_return co_await conn_->exec_simple_query_one_nonblocking<T>(std::move(sql));
         }
@@ -91,7 +121,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::InvalidFuture, "transaction not active", {}}
                 );
 
-            QueryResult qr = co_await pool_->query_on(conn_, std::move(sql));
+            QueryResult qr = co_await this->run_on_tx(std::move(sql));
 
             if (is_fatal_connection_error(qr)) {
                 pool_->mark_dead(conn_);
@@ -105,13 +135,7 @@ namespace usub::pg {
             if (!qr.ok)
                 co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
 
-            try {
-                auto vec = usub::pg::map_all_reflect_named<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            } catch (const std::exception &) {
-                auto vec = usub::pg::map_all_reflect_positional<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            }
+            co_return usub::pg::map_all_reflect_expected<T>(qr);
         }
 
         template<class T>
@@ -122,7 +146,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::InvalidFuture, "transaction not active", {}}
                 );
 
-            QueryResult qr = co_await pool_->query_on(conn_, std::move(sql));
+            QueryResult qr = co_await this->run_on_tx(std::move(sql));
 
             if (is_fatal_connection_error(qr)) {
                 pool_->mark_dead(conn_);
@@ -140,13 +164,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::Unknown, "no rows", {}}
                 );
 
-            try {
-                auto v = usub::pg::map_single_reflect_named<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            } catch (const std::exception &) {
-                auto v = usub::pg::map_single_reflect_positional<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            }
+            co_return usub::pg::map_single_reflect_expected<T>(qr, 0);
         }
 
         template<class T, class Obj>
@@ -157,7 +175,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::InvalidFuture, "transaction not active", {}}
                 );
 
-            QueryResult qr = co_await pool_->query_on(conn_, std::move(sql), obj);
+            QueryResult qr = co_await this->run_on_tx(std::move(sql), obj);
 
             if (is_fatal_connection_error(qr)) {
                 pool_->mark_dead(conn_);
@@ -171,13 +189,7 @@ namespace usub::pg {
             if (!qr.ok)
                 co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
 
-            try {
-                auto vec = usub::pg::map_all_reflect_named<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            } catch (const std::exception &) {
-                auto vec = usub::pg::map_all_reflect_positional<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            }
+            co_return usub::pg::map_all_reflect_expected<T>(qr);
         }
 
         template<class T, class Obj>
@@ -188,7 +200,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::InvalidFuture, "transaction not active", {}}
                 );
 
-            QueryResult qr = co_await pool_->query_on(conn_, std::move(sql), obj);
+            QueryResult qr = co_await this->run_on_tx(std::move(sql), obj);
 
             if (is_fatal_connection_error(qr)) {
                 pool_->mark_dead(conn_);
@@ -206,13 +218,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::Unknown, "no rows", {}}
                 );
 
-            try {
-                auto v = usub::pg::map_single_reflect_named<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            } catch (const std::exception &) {
-                auto v = usub::pg::map_single_reflect_positional<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            }
+            co_return usub::pg::map_single_reflect_expected<T>(qr, 0);
         }
 
         template<class T, typename... Args>
@@ -223,11 +229,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::InvalidFuture, "transaction not active", {}}
                 );
 
-            QueryResult qr = co_await pool_->query_on(
-                conn_,
-                std::move(sql),
-                std::forward<Args>(args)...
-            );
+            QueryResult qr = co_await this->run_on_tx(std::move(sql), std::forward<Args>(args)...);
 
             if (is_fatal_connection_error(qr)) {
                 pool_->mark_dead(conn_);
@@ -241,13 +243,7 @@ namespace usub::pg {
             if (!qr.ok)
                 co_return std::unexpected(PgOpError{qr.code, qr.error, qr.err_detail});
 
-            try {
-                auto vec = usub::pg::map_all_reflect_named<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            } catch (const std::exception &) {
-                auto vec = usub::pg::map_all_reflect_positional<T>(qr);
-                co_return std::expected<std::vector<T>, PgOpError>{std::in_place, std::move(vec)};
-            }
+            co_return usub::pg::map_all_reflect_expected<T>(qr);
         }
 
         template<class T, typename... Args>
@@ -258,11 +254,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::InvalidFuture, "transaction not active", {}}
                 );
 
-            QueryResult qr = co_await pool_->query_on(
-                conn_,
-                std::move(sql),
-                std::forward<Args>(args)...
-            );
+            QueryResult qr = co_await this->run_on_tx(std::move(sql), std::forward<Args>(args)...);
 
             if (is_fatal_connection_error(qr)) {
                 pool_->mark_dead(conn_);
@@ -280,13 +272,7 @@ namespace usub::pg {
                     PgOpError{PgErrorCode::Unknown, "no rows", {}}
                 );
 
-            try {
-                auto v = usub::pg::map_single_reflect_named<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            } catch (const std::exception &) {
-                auto v = usub::pg::map_single_reflect_positional<T>(qr, 0);
-                co_return std::expected<T, PgOpError>{std::in_place, std::move(v)};
-            }
+            co_return usub::pg::map_single_reflect_expected<T>(qr, 0);
         }
 
         template<typename Sql, typename... Args>
@@ -391,6 +377,14 @@ namespace usub::pg {
 
         usub::uvent::task::Awaitable<bool> commit();
 
+        // Runs the last statement and COMMIT in one round trip (plus BEGIN if
+        // still pending). Returns the statement's result, or COMMIT's error;
+        // a failing statement rolls back. is_committed() tells which. SQL
+        // goes over the extended protocol, so one statement only.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResult>
+        commit_with(std::string sql, Args &&... args);
+
         usub::uvent::task::Awaitable<void> rollback();
 
         usub::uvent::task::Awaitable<void> finish();
@@ -401,6 +395,10 @@ namespace usub::pg {
         bool is_committed() const noexcept { return committed_; }
         bool is_rolled_back() const noexcept { return rolled_back_; }
 
+        // After a commit with capture_commit_lsn: a WAL position at or past
+        // the commit record. Empty otherwise.
+        PgLsn commit_lsn() const noexcept { return commit_lsn_; }
+
         class PgSubtransaction {
         public:
             PgSubtransaction(PgTransaction &parent, std::string savepoint_name);
@@ -423,12 +421,24 @@ namespace usub::pg {
                 co_return co_await parent_.query(std::move(sql), std::forward<Args>(args)...);
             }
 
+            template<typename... Args>
+            usub::uvent::task::Awaitable<QueryResult>
+            query(PgQueryOptions opts, std::string sql, Args &&... args) {
+                co_return co_await parent_.query(opts, std::move(sql), std::forward<Args>(args)...);
+            }
+
             template<class Obj>
             usub::uvent::task::Awaitable<QueryResult>
             query_reflect(std::string sql, const Obj &obj) {
                 co_return co_await parent_.query_reflect(std::move(sql), obj);
             }
 
+            template<std::ranges::forward_range R>
+            usub::uvent::task::Awaitable<PgExecManyResult>
+            execute_many(std::string sql, R &&items, PgExecManyOptions opts = {}) {
+                co_return co_await parent_.execute_many(std::move(sql), std::forward<R>(items), opts);
+            }
+
             template<class Obj>
             usub::uvent::task::Awaitable<QueryResult>
             exec_reflect(std::string sql, const Obj &obj) {
@@ -605,14 +615,84 @@ namespace usub::pg {
         bool active_{false};
         bool committed_{false};
         bool rolled_back_{false};
+        PgLsn commit_lsn_{};
+        bool begin_pending_{false};  // lazy_begin: BEGIN not sent yet
 
         bool emulate_readonly_autocommit_{false};
 
         usub::uvent::task::Awaitable<bool> send_sql_nocheck(const std::string &sql);
 
+        // One statement on the transaction's connection, carrying a pending
+        // BEGIN in the same round trip.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResult> run_on_tx(std::string sql, Args &&... args);
+
+        // Sends a pending BEGIN on its own, for paths that cannot carry it.
+        usub::uvent::task::Awaitable<bool> flush_begin();
+
+        // Same outcome as a failed begin_errored(); returns r.
+        QueryResult begin_failed(QueryResult r);
+
+        usub::uvent::task::Awaitable<QueryResult>
+        finish_commit_with(std::vector<QueryResult> rs, bool with_begin, bool want_lsn);
+
         static std::string build_begin_sql(const PgTransactionConfig &cfg);
     };
 
+    template<class R, class... P>
+    usub::uvent::task::Awaitable<typename PgStatement<R(P...)>::result_type>
+    PgTransaction::execute(const PgStatement<R(P...)> &st, std::type_identity_t<const P &>... args) {
+        if (!active_ || !conn_ || !conn_->connected()) {
+            QueryResult bad;
+            bad.ok = false;
+            bad.code = PgErrorCode::InvalidFuture;
+            bad.error = "transaction not active";
+            bad.rows_valid = false;
+            co_return detail::finish_statement<R>(std::move(bad));
+        }
+
+        if (!co_await this->flush_begin()) {
+            QueryResult bad;
+            bad.ok = false;
+            bad.code = PgErrorCode::InvalidFuture;
+            bad.error = "transaction not active";
+            bad.rows_valid = false;
+            co_return detail::finish_statement<R>(std::move(bad));
+        }
+
+        QueryResult qr = co_await detail::run_statement(*conn_, st, args...);
+
+        if (is_fatal_connection_error(qr)) {
+            pool_->mark_dead(conn_);
+            conn_.reset();
+            active_ = false;
+            rolled_back_ = true;
+            committed_ = false;
+        }
+
+        co_return detail::finish_statement<R>(std::move(qr));
+    }
+
+    template<std::ranges::forward_range R>
+    usub::uvent::task::Awaitable<PgExecManyResult>
+    PgTransaction::execute_many(std::string sql, R &&items, PgExecManyOptions opts) {
+        const auto count = static_cast<size_t>(std::ranges::distance(items));
+        if (!active_ || !conn_ || !conn_->connected() || !co_await this->flush_begin())
+            co_return PgExecManyResult::all_failed(
+                count, PgOpError{PgErrorCode::InvalidFuture, "transaction not active", {}});
+
+        PgExecManyResult out = co_await conn_->execute_many(sql, items, opts);
+
+        if (!conn_->connected()) {
+            pool_->mark_dead(conn_);
+            conn_.reset();
+            active_ = false;
+            rolled_back_ = true;
+            committed_ = false;
+        }
+        co_return out;
+    }
+
     template<typename... Args>
     usub::uvent::task::Awaitable<QueryResult>
     PgTransaction::query(std::string sql, Args &&... args) {
@@ -640,11 +720,7 @@ namespace usub::pg {
             co_return bad;
         }
 
-        QueryResult qr = co_await pool_->query_on(
-            conn_,
-            std::move(sql),
-            std::forward<Args>(args)...
-        );
+        QueryResult qr = co_await this->run_on_tx(std::move(sql), std::forward<Args>(args)...);
 
         if (is_fatal_connection_error(qr)) {
             pool_->mark_dead(conn_);
@@ -655,6 +731,76 @@ namespace usub::pg {
         }
         co_return qr;
     }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResult>
+    PgTransaction::query(PgQueryOptions opts, std::string sql, Args &&... args) {
+        // inactive / disconnected: the plain overload reports it
+        if (!active_ || !conn_ || !conn_->connected())
+            co_return co_await this->query(std::move(sql), std::forward<Args>(args)...);
+
+        auto conn = conn_;
+        PgQueryDeadline dl = conn->arm_deadline(opts);
+        QueryResult qr = co_await this->query(std::move(sql), std::forward<Args>(args)...);
+        co_await conn->disarm_deadline(dl, qr);
+
+        if (conn_ && !conn_->connected()) {
+            pool_->mark_dead(conn_);
+            conn_.reset();
+            active_ = false;
+            rolled_back_ = true;
+            committed_ = false;
+        }
+        co_return qr;
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResult>
+    PgTransaction::run_on_tx(std::string sql, Args &&... args) {
+        if (!begin_pending_)
+            co_return co_await pool_->query_on(conn_, std::move(sql), std::forward<Args>(args)...);
+
+        begin_pending_ = false;
+        if constexpr (sizeof...(Args) == 0) {
+            // simple protocol: one query string, and the caller's SQL may
+            // itself hold several statements
+            co_return co_await pool_->query_on(conn_, build_begin_sql(cfg_) + "; " + sql);
+        } else {
+            PgPipeline p;
+            p.add(build_begin_sql(cfg_));
+            p.add(std::move(sql), std::forward<Args>(args)...);
+            std::vector<QueryResult> rs = co_await pool_->pipeline_on(conn_, std::move(p));
+            if (rs.size() != 2 || !rs[0].ok)
+                co_return this->begin_failed(rs.empty() ? QueryResult{} : std::move(rs[0]));
+            co_return std::move(rs[1]);
+        }
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResult>
+    PgTransaction::commit_with(std::string sql, Args &&... args) {
+        if (!active_ || !conn_ || !conn_->connected() || emulate_readonly_autocommit_) {
+            QueryResult qr = co_await this->query(std::move(sql), std::forward<Args>(args)...);
+            if (qr.ok)
+                co_await this->commit();
+            else
+                co_await this->rollback();
+            co_return qr;
+        }
+
+        const bool want_lsn = cfg_.capture_commit_lsn && !cfg_.read_only;
+        const bool with_begin = begin_pending_;
+        begin_pending_ = false;
+
+        PgPipeline p;
+        if (with_begin) p.add(build_begin_sql(cfg_));
+        p.add(std::move(sql), std::forward<Args>(args)...);
+        p.add(std::string{"COMMIT"});
+        if (want_lsn) p.add(std::string{"SELECT pg_current_wal_insert_lsn()::text"});
+
+        std::vector<QueryResult> rs = co_await pool_->pipeline_on(conn_, std::move(p));
+        co_return co_await this->finish_commit_with(std::move(rs), with_begin, want_lsn);
+    }
 } // namespace usub::pg
 
 #endif // PGTRANSACTION_H
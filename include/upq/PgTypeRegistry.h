@@ -0,0 +1,696 @@
+#ifndef PGTYPEREGISTRY_H
+#define PGTYPEREGISTRY_H
+
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include "PgByteSwap.h"
+#include "PgTypes.h"
+
+namespace usub::pg {
+    // resultFormat passed to PQsendQueryParams / PQsendQueryPrepared
+    enum class PgResultFormat : int {
+        Text = 0,
+        Binary = 1
+    };
+
+    namespace detail {
+        constexpr Oid BYTEAOID = 17;
+        constexpr Oid CHAROID = 18;
+        constexpr Oid NAMEOID = 19;
+        constexpr Oid OIDOID = 26;
+        constexpr Oid BPCHAROID = 1042;
+        constexpr Oid VARCHAROID = 1043;
+        constexpr Oid DATEOID = 1082;
+        constexpr Oid TIMESTAMPOID = 1114;
+        constexpr Oid TIMESTAMPTZOID = 1184;
+        constexpr Oid NUMERICOID = 1700;
+        constexpr Oid UUIDOID = 2950;
+        constexpr Oid UNKNOWNOID = 705;
+
+        // 2000-01-01 00:00:00 UTC, the PostgreSQL binary epoch
+        constexpr int64_t PG_EPOCH_UNIX_SECONDS = 946684800;
+
+        template <class U>
+        inline U load_be(const char *p) noexcept {
+            U v;
+            std::memcpy(&v, p, sizeof(U));
+            if constexpr (std::endian::native == std::endian::little && sizeof(U) > 1)
+                v = std::byteswap(v);
+            return v;
+        }
+
+        inline bool is_text_like_oid(uint32_t oid) noexcept {
+            switch (oid) {
+                case TEXTOID:
+                case VARCHAROID:
+                case BPCHAROID:
+                case NAMEOID:
+                case CHAROID:
+                case UNKNOWNOID:
+                case JSONOID:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        template <class T>
+        struct is_sys_time_point : std::false_type {};
+
+        template <class Dur>
+        struct is_sys_time_point<std::chrono::time_point<std::chrono::system_clock, Dur>>
+            : std::true_type {};
+
+        template <class T>
+        inline bool decode_binary_integer(uint32_t oid, std::string_view sv, T &out) noexcept {
+            int64_t v = 0;
+            if (oid == INT2OID && sv.size() == 2) v = static_cast<int16_t>(load_be<uint16_t>(sv.data()));
+            else if (oid == INT4OID && sv.size() == 4) v = static_cast<int32_t>(load_be<uint32_t>(sv.data()));
+            else if (oid == OIDOID && sv.size() == 4) v = static_cast<int64_t>(load_be<uint32_t>(sv.data()));
+            else if (oid == INT8OID && sv.size() == 8) v = static_cast<int64_t>(load_be<uint64_t>(sv.data()));
+            else if (is_text_like_oid(oid)) {
+                auto r = std::from_chars(sv.data(), sv.data() + sv.size(), out);
+                return r.ec == std::errc{} && r.ptr == sv.data() + sv.size();
+            } else return false;
+
+            if constexpr (std::is_signed_v<T>) {
+                if (v < static_cast<int64_t>(std::numeric_limits<T>::min()) ||
+                    v > static_cast<int64_t>(std::numeric_limits<T>::max()))
+                    return false;
+            } else {
+                if (v < 0 || static_cast<uint64_t>(v) > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+                    return false;
+            }
+            out = static_cast<T>(v);
+            return true;
+        }
+
+        // NUMERIC: int16 ndigits, int16 weight, uint16 sign, int16 dscale, base-10000 digits
+        inline bool decode_binary_numeric(std::string_view sv, double &out) noexcept {
+            if (sv.size() < 8) return false;
+            const int ndigits = static_cast<int16_t>(load_be<uint16_t>(sv.data()));
+            const int weight = static_cast<int16_t>(load_be<uint16_t>(sv.data() + 2));
+            const uint16_t sign = load_be<uint16_t>(sv.data() + 4);
+            if (ndigits < 0 || sv.size() < 8 + static_cast<size_t>(ndigits) * 2) return false;
+            if (sign == 0xC000) {
+                out = std::numeric_limits<double>::quiet_NaN();
+                return true;
+            }
+            if (sign == 0xD000 || sign == 0xF000) {  // +/-Infinity (PostgreSQL 14+)
+                out = sign == 0xD000 ? std::numeric_limits<double>::infinity()
+                                     : -std::numeric_limits<double>::infinity();
+                return true;
+            }
+            double v = 0.0;
+            for (int i = 0; i < ndigits; ++i) {
+                const auto d = load_be<uint16_t>(sv.data() + 8 + i * 2);
+                v += static_cast<double>(d) * std::pow(10000.0, weight - i);
+            }
+            out = (sign == 0x4000) ? -v : v;
+            return true;
+        }
+
+        template <class T>
+        inline bool decode_binary_floating(uint32_t oid, std::string_view sv, T &out) noexcept {
+            if (oid == FLOAT8OID && sv.size() == 8) {
+                out = static_cast<T>(std::bit_cast<double>(load_be<uint64_t>(sv.data())));
+                return true;
+            }
+            if (oid == FLOAT4OID && sv.size() == 4) {
+                out = static_cast<T>(std::bit_cast<float>(load_be<uint32_t>(sv.data())));
+                return true;
+            }
+            if (oid == NUMERICOID) {
+                double d = 0;
+                if (!decode_binary_numeric(sv, d)) return false;
+                out = static_cast<T>(d);
+                return true;
+            }
+            if (oid == INT2OID || oid == INT4OID || oid == INT8OID) {
+                int64_t i = 0;
+                if (!decode_binary_integer(oid, sv, i)) return false;
+                out = static_cast<T>(i);
+                return true;
+            }
+            if (is_text_like_oid(oid)) {
+                auto r = std::from_chars(sv.data(), sv.data() + sv.size(), out);
+                return r.ec == std::errc{} && r.ptr == sv.data() + sv.size();
+            }
+            return false;
+        }
+
+        template <class T>
+        struct is_binary_array_target : std::false_type {};
+
+        template <class U, class A>
+        struct is_binary_array_target<std::vector<U, A>> : std::true_type {};
+
+        inline bool is_builtin_array_oid(uint32_t oid) noexcept {
+            switch (oid) {
+                case BOOLARRAYOID:
+                case INT2ARRAYOID:
+                case INT4ARRAYOID:
+                case TEXTARRAYOID:
+                case INT8ARRAYOID:
+                case FLOAT4ARRAYOID:
+                case FLOAT8ARRAYOID:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        template <class Vec>
+        inline bool decode_binary_array(std::string_view sv, Vec &out);
+
+        // Returns true when T/oid is handled natively; `ok` carries the outcome.
+        template <class T>
+        inline bool decode_binary_builtin(uint32_t oid, std::string_view sv, T &out, bool &ok) {
+            if constexpr (std::is_same_v<T, bool>) {
+                if (oid != BOOLOID) return false;
+                ok = sv.size() == 1;
+                if (ok) out = sv[0] != 0;
+                return true;
+            } else if constexpr (std::is_integral_v<T>) {
+                ok = decode_binary_integer(oid, sv, out);
+                return true;
+            } else if constexpr (std::is_floating_point_v<T>) {
+                ok = decode_binary_floating(oid, sv, out);
+                return true;
+            } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+                if (oid == JSONBOID) {
+                    // jsonb binary payload: version byte (1) followed by the JSON text
+                    ok = !sv.empty() && sv[0] == 1;
+                    if (ok) out = T(sv.substr(1));
+                    return true;
+                }
+                if (is_text_like_oid(oid) || oid == BYTEAOID) {
+                    out = T(sv);
+                    ok = true;
+                    return true;
+                }
+                return false;
+            } else if constexpr (std::is_same_v<T, std::vector<uint8_t>> || std::is_same_v<T, std::vector<char>>) {
+                if (oid != BYTEAOID) return false;
+                out.assign(sv.begin(), sv.end());
+                ok = true;
+                return true;
+            } else if constexpr (is_binary_array_target<T>::value) {
+                if (!is_builtin_array_oid(oid)) return false;
+                ok = decode_binary_array(sv, out);
+                return true;
+            } else if constexpr (is_sys_time_point<T>::value) {
+                using namespace std::chrono;
+                const sys_seconds pg_epoch{seconds{PG_EPOCH_UNIX_SECONDS}};
+                if ((oid == TIMESTAMPTZOID || oid == TIMESTAMPOID) && sv.size() == 8) {
+                    const auto us = static_cast<int64_t>(load_be<uint64_t>(sv.data()));
+                    out = time_point_cast<typename T::duration>(pg_epoch + microseconds{us});
+                    ok = true;
+                    return true;
+                }
+                if (oid == DATEOID && sv.size() == 4) {
+                    const auto d = static_cast<int32_t>(load_be<uint32_t>(sv.data()));
+                    out = time_point_cast<typename T::duration>(pg_epoch + days{d});
+                    ok = true;
+                    return true;
+                }
+                return false;
+            } else {
+                (void) oid;
+                (void) sv;
+                (void) out;
+                (void) ok;
+                return false;
+            }
+        }
+
+        // Fixed-width elements read straight into the vector when the column's
+        // element type matches the C++ type exactly.
+        template <class E>
+        constexpr uint32_t exact_array_elem_oid() noexcept {
+            if constexpr (std::is_same_v<E, int16_t>) return INT2OID;
+            else if constexpr (std::is_same_v<E, int32_t>) return INT4OID;
+            else if constexpr (std::is_same_v<E, int64_t>) return INT8OID;
+            else if constexpr (std::is_same_v<E, float>) return FLOAT4OID;
+            else if constexpr (std::is_same_v<E, double>) return FLOAT8OID;
+            else return 0;
+        }
+
+        // One-dimensional array in the binary wire format (see
+        // encode_binary_array). NULL elements become T{} unless T is optional.
+        template <class Vec>
+        inline bool decode_binary_array(std::string_view sv, Vec &out) {
+            using T = typename Vec::value_type;
+            out.clear();
+            if (sv.size() < 12) return false;
+
+            const auto ndim = static_cast<int32_t>(load_be<uint32_t>(sv.data()));
+            const uint32_t elem_oid = load_be<uint32_t>(sv.data() + 8);
+            if (ndim == 0) return true;
+            if (ndim != 1 || sv.size() < 20) return false;
+
+            const auto n = static_cast<int32_t>(load_be<uint32_t>(sv.data() + 12));
+            if (n < 0) return false;
+            out.reserve(static_cast<size_t>(n));
+
+            const char *p = sv.data() + 20;
+            const char *end = sv.data() + sv.size();
+
+            if constexpr (exact_array_elem_oid<T>() != 0) {
+                constexpr size_t W = sizeof(T);
+                using U = std::conditional_t<W == 2, uint16_t, std::conditional_t<W == 4, uint32_t, uint64_t>>;
+                // Exactly n full records means no NULLs. The length words are
+                // folded into one flag instead of an early exit; longer runs
+                // go to the shuffle kernel in PgByteSwap. A mismatch falls
+                // back to the loop below.
+                if (elem_oid == exact_array_elem_oid<T>() &&
+                    static_cast<size_t>(end - p) == static_cast<size_t>(n) * (4 + W)) {
+                    out.resize(static_cast<size_t>(n));
+                    T *dst = out.data();
+                    bool good;
+                    if (n >= 16) {
+                        good = load_be_records(reinterpret_cast<char *>(dst), p, static_cast<size_t>(n), W);
+                    } else {
+                        const char *q = p;
+                        uint32_t bad = 0;
+                        for (size_t i = 0; i < static_cast<size_t>(n); ++i, q += 4 + W) {
+                            bad |= load_be<uint32_t>(q) ^ static_cast<uint32_t>(W);
+                            dst[i] = std::bit_cast<T>(load_be<U>(q + 4));
+                        }
+                        good = bad == 0;
+                    }
+                    if (good) return true;
+                    out.clear();
+                }
+            }
+
+            for (int32_t i = static_cast<int32_t>(out.size()); i < n; ++i) {
+                if (end - p < 4) return false;
+                const auto len = static_cast<int32_t>(load_be<uint32_t>(p));
+                p += 4;
+                if (len < 0) {
+                    out.emplace_back();
+                    continue;
+                }
+                if (end - p < len) return false;
+
+                const std::string_view cell(p, static_cast<size_t>(len));
+                p += len;
+                bool ok = false;
+                if constexpr (Optional<T>) {
+                    typename T::value_type v{};
+                    if (!decode_binary_builtin(elem_oid, cell, v, ok) || !ok) return false;
+                    out.emplace_back(std::move(v));
+                } else {
+                    T v{};
+                    if (!decode_binary_builtin(elem_oid, cell, v, ok) || !ok) return false;
+                    out.emplace_back(std::move(v));
+                }
+            }
+            return p == end;
+        }
+
+        inline void append_padded(std::string &out, unsigned v, int width) {
+            char buf[16];
+            const int n = std::snprintf(buf, sizeof buf, "%0*u", width, v);
+            out.append(buf, static_cast<size_t>(n));
+        }
+
+        // NUMERIC digits printed like numeric_out: dscale fractional digits.
+        inline bool render_binary_numeric(std::string_view sv, std::string &out) {
+            if (sv.size() < 8) return false;
+            const int ndigits = static_cast<int16_t>(load_be<uint16_t>(sv.data()));
+            const int weight = static_cast<int16_t>(load_be<uint16_t>(sv.data() + 2));
+            const uint16_t sign = load_be<uint16_t>(sv.data() + 4);
+            const int dscale = static_cast<int16_t>(load_be<uint16_t>(sv.data() + 6));
+            if (ndigits < 0 || dscale < 0 || sv.size() != 8 + static_cast<size_t>(ndigits) * 2) return false;
+            switch (sign) {
+                case 0xC000: out = "NaN";
+                    return true;
+                case 0xD000: out = "Infinity";
+                    return true;
+                case 0xF000: out = "-Infinity";
+                    return true;
+                case 0x0000:
+                case 0x4000: break;
+                default: return false;
+            }
+            auto digit = [&](int i) -> unsigned {
+                return i >= 0 && i < ndigits ? load_be<uint16_t>(sv.data() + 8 + i * 2) : 0u;
+            };
+
+            out.clear();
+            if (sign == 0x4000) out.push_back('-');
+            if (weight < 0) out.push_back('0');
+            for (int i = 0; i <= weight; ++i) append_padded(out, digit(i), i == 0 ? 1 : 4);
+            if (dscale > 0) {
+                out.push_back('.');
+                const size_t frac_end = out.size() + static_cast<size_t>(dscale);
+                for (int i = weight + 1; out.size() < frac_end; ++i) append_padded(out, digit(i), 4);
+                out.resize(frac_end);
+            }
+            return true;
+        }
+
+        template <class F>
+        inline void append_float_text(std::string &out, F v) {
+            if (std::isnan(v)) out += "NaN";
+            else if (std::isinf(v)) out += v > 0 ? "Infinity" : "-Infinity";
+            else {
+                char buf[32];
+                const auto r = std::to_chars(buf, buf + sizeof buf, v);
+                out.append(buf, r.ptr);
+            }
+        }
+
+        // "YYYY-MM-DD" (BC years are not rendered)
+        inline bool append_date_text(std::string &out, std::chrono::sys_days d) {
+            const std::chrono::year_month_day ymd{d};
+            const int y = static_cast<int>(ymd.year());
+            if (y < 1) return false;
+            append_padded(out, static_cast<unsigned>(y), 4);
+            out.push_back('-');
+            append_padded(out, static_cast<unsigned>(ymd.month()), 2);
+            out.push_back('-');
+            append_padded(out, static_cast<unsigned>(ymd.day()), 2);
+            return true;
+        }
+
+        inline bool render_binary_element(uint32_t oid, std::string_view sv, std::string &out);
+
+        // Array literal as array_out writes it; one dimension only.
+        inline bool render_binary_array(std::string_view sv, std::string &out) {
+            if (sv.size() < 12) return false;
+            const auto ndim = static_cast<int32_t>(load_be<uint32_t>(sv.data()));
+            const uint32_t elem_oid = load_be<uint32_t>(sv.data() + 8);
+            out = "{";
+            if (ndim == 0) {
+                out.push_back('}');
+                return true;
+            }
+            if (ndim != 1 || sv.size() < 20) return false;
+            const auto n = static_cast<int32_t>(load_be<uint32_t>(sv.data() + 12));
+            const char *p = sv.data() + 20;
+            const char *end = sv.data() + sv.size();
+            std::string elem;
+            for (int32_t i = 0; i < n; ++i) {
+                if (end - p < 4) return false;
+                const auto len = static_cast<int32_t>(load_be<uint32_t>(p));
+                p += 4;
+                if (i > 0) out.push_back(',');
+                if (len < 0) {
+                    out += "NULL";
+                    continue;
+                }
+                if (end - p < len) return false;
+                if (!render_binary_element(elem_oid, std::string_view(p, static_cast<size_t>(len)), elem))
+                    return false;
+                p += len;
+
+                const bool quote = elem.empty() || elem == "NULL" ||
+                                   elem.find_first_of("{},\"\\ \t\n\r\v\f") != std::string::npos;
+                if (!quote) {
+                    out += elem;
+                    continue;
+                }
+                out.push_back('"');
+                for (char c: elem) {
+                    if (c == '"' || c == '\\') out.push_back('\\');
+                    out.push_back(c);
+                }
+                out.push_back('"');
+            }
+            out.push_back('}');
+            return p == end;
+        }
+
+        // Binary cell -> the text PostgreSQL would have sent for it, so that a
+        // std::string target reads any built-in column in either result
+        // format. timestamptz is rendered in UTC ("+00").
+        inline bool render_binary_element(uint32_t oid, std::string_view sv, std::string &out) {
+            out.clear();
+            if (is_text_like_oid(oid)) {
+                out.assign(sv);
+                return true;
+            }
+            switch (oid) {
+                case BOOLOID:
+                    if (sv.size() != 1) return false;
+                    out = sv[0] ? "t" : "f";
+                    return true;
+                case INT2OID:
+                case INT4OID:
+                case INT8OID:
+                case OIDOID: {
+                    int64_t v = 0;
+                    if (!decode_binary_integer(oid, sv, v)) return false;
+                    out = std::to_string(v);
+                    return true;
+                }
+                case FLOAT4OID:
+                    if (sv.size() != 4) return false;
+                    append_float_text(out, std::bit_cast<float>(load_be<uint32_t>(sv.data())));
+                    return true;
+                case FLOAT8OID:
+                    if (sv.size() != 8) return false;
+                    append_float_text(out, std::bit_cast<double>(load_be<uint64_t>(sv.data())));
+                    return true;
+                case NUMERICOID:
+                    return render_binary_numeric(sv, out);
+                case UUIDOID: {
+                    if (sv.size() != 16) return false;
+                    static constexpr char hex[] = "0123456789abcdef";
+                    for (size_t i = 0; i < 16; ++i) {
+                        if (i == 4 || i == 6 || i == 8 || i == 10) out.push_back('-');
+                        out.push_back(hex[static_cast<unsigned char>(sv[i]) >> 4]);
+                        out.push_back(hex[static_cast<unsigned char>(sv[i]) & 15]);
+                    }
+                    return true;
+                }
+                case DATEOID: {
+                    if (sv.size() != 4) return false;
+                    const auto d = static_cast<int32_t>(load_be<uint32_t>(sv.data()));
+                    if (d == std::numeric_limits<int32_t>::max()) out = "infinity";
+                    else if (d == std::numeric_limits<int32_t>::min()) out = "-infinity";
+                    else {
+                        using namespace std::chrono;
+                        return append_date_text(out, sys_days{days{PG_EPOCH_UNIX_SECONDS / 86400 + d}});
+                    }
+                    return true;
+                }
+                case TIMESTAMPOID:
+                case TIMESTAMPTZOID: {
+                    if (sv.size() != 8) return false;
+                    const auto us = static_cast<int64_t>(load_be<uint64_t>(sv.data()));
+                    if (us == std::numeric_limits<int64_t>::max()) out = "infinity";
+                    else if (us == std::numeric_limits<int64_t>::min()) out = "-infinity";
+                    else {
+                        using namespace std::chrono;
+                        const sys_time<microseconds> tp{microseconds{PG_EPOCH_UNIX_SECONDS * 1000000 + us}};
+                        const auto day = floor<days>(tp);
+                        const hh_mm_ss<microseconds> tod{tp - day};
+                        if (!append_date_text(out, day)) return false;
+                        out.push_back(' ');
+                        append_padded(out, static_cast<unsigned>(tod.hours().count()), 2);
+                        out.push_back(':');
+                        append_padded(out, static_cast<unsigned>(tod.minutes().count()), 2);
+                        out.push_back(':');
+                        append_padded(out, static_cast<unsigned>(tod.seconds().count()), 2);
+                        if (auto f = static_cast<unsigned>(tod.subseconds().count()); f != 0) {
+                            int width = 6;
+                            while (f % 10 == 0) {
+                                f /= 10;
+                                --width;
+                            }
+                            out.push_back('.');
+                            append_padded(out, f, width);
+                        }
+                        if (oid == TIMESTAMPTZOID) out += "+00";
+                    }
+                    return true;
+                }
+                default:
+                    if (is_builtin_array_oid(oid)) return render_binary_array(sv, out);
+                    return false;
+            }
+        }
+    } // namespace detail
+
+    // OID -> native decoder table used for binary results (resultFormat=1).
+    // Built-in scalar types are decoded with a byte swap; other OIDs can be
+    // served by decoders registered at startup.
+    class PgTypeRegistry {
+    public:
+        using ErasedDecoder = std::function<bool(std::string_view, void *)>;
+
+        static PgTypeRegistry &instance() {
+            static PgTypeRegistry reg;
+            return reg;
+        }
+
+        template <class T>
+        void register_decoder(uint32_t oid, std::function<bool(std::string_view, T &)> fn) {
+            std::unique_lock lk(this->mu_);
+            this->custom_[Key{oid, std::type_index(typeid(T))}] =
+                [fn = std::move(fn)](std::string_view sv, void *out) {
+                    return fn(sv, *static_cast<T *>(out));
+                };
+            this->has_custom_.store(true, std::memory_order_release);
+        }
+
+        void register_type_name(uint32_t oid, std::string name) {
+            std::unique_lock lk(this->mu_);
+            this->names_[oid] = std::move(name);
+        }
+
+        template <class T>
+        bool decode(uint32_t oid, std::string_view sv, T &out) const {
+            if constexpr (detail::Optional<T>) {
+                using V = typename T::value_type;
+                if (sv.empty()) {
+                    out.reset();
+                    return true;
+                }
+                V v{};
+                if (!decode(oid, sv, v)) return false;
+                out = std::move(v);
+                return true;
+            } else {
+                bool ok = false;
+                if (detail::decode_binary_builtin(oid, sv, out, ok)) return ok;
+                if (decode_custom(oid, sv, out)) return true;
+                // a std::string reads any column, as it does in text mode
+                if constexpr (std::is_same_v<T, std::string>) return detail::render_binary_element(oid, sv, out);
+                return false;
+            }
+        }
+
+        [[nodiscard]] std::string type_name(uint32_t oid) const {
+            switch (oid) {
+                case detail::BOOLOID: return "bool";
+                case detail::BYTEAOID: return "bytea";
+                case detail::CHAROID: return "char";
+                case detail::NAMEOID: return "name";
+                case detail::INT8OID: return "int8";
+                case detail::INT2OID: return "int2";
+                case detail::INT4OID: return "int4";
+                case detail::TEXTOID: return "text";
+                case detail::OIDOID: return "oid";
+                case detail::JSONOID: return "json";
+                case detail::FLOAT4OID: return "float4";
+                case detail::FLOAT8OID: return "float8";
+                case detail::UNKNOWNOID: return "unknown";
+                case detail::BOOLARRAYOID: return "bool[]";
+                case detail::INT2ARRAYOID: return "int2[]";
+                case detail::INT4ARRAYOID: return "int4[]";
+                case detail::TEXTARRAYOID: return "text[]";
+                case detail::INT8ARRAYOID: return "int8[]";
+                case detail::FLOAT4ARRAYOID: return "float4[]";
+                case detail::FLOAT8ARRAYOID: return "float8[]";
+                case detail::BPCHAROID: return "bpchar";
+                case detail::VARCHAROID: return "varchar";
+                case detail::DATEOID: return "date";
+                case detail::TIMESTAMPOID: return "timestamp";
+                case detail::TIMESTAMPTZOID: return "timestamptz";
+                case detail::NUMERICOID: return "numeric";
+                case detail::UUIDOID: return "uuid";
+                case detail::JSONBOID: return "jsonb";
+                default: break;
+            }
+            std::shared_lock lk(this->mu_);
+            if (auto it = this->names_.find(oid); it != this->names_.end()) return it->second;
+            return "oid:" + std::to_string(oid);
+        }
+
+    private:
+        struct Key {
+            uint32_t oid;
+            std::type_index type;
+
+            bool operator==(const Key &o) const noexcept { return oid == o.oid && type == o.type; }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &k) const noexcept {
+                return std::hash<std::type_index>{}(k.type) ^ (static_cast<size_t>(k.oid) * 0x9E3779B97F4A7C15ull);
+            }
+        };
+
+        template <class T>
+        bool decode_custom(uint32_t oid, std::string_view sv, T &out) const {
+            if (!this->has_custom_.load(std::memory_order_acquire)) return false;
+            std::shared_lock lk(this->mu_);
+            auto it = this->custom_.find(Key{oid, std::type_index(typeid(T))});
+            if (it == this->custom_.end()) return false;
+            return it->second(sv, &out);
+        }
+
+        PgTypeRegistry() = default;
+
+        mutable std::shared_mutex mu_;
+        std::atomic<bool> has_custom_{false};
+        std::unordered_map<Key, ErasedDecoder, KeyHash> custom_;
+        std::unordered_map<uint32_t, std::string> names_;
+    };
+
+    namespace detail {
+        inline std::string oid_to_typename(uint32_t oid) {
+            return PgTypeRegistry::instance().type_name(oid);
+        }
+    } // namespace detail
+
+    template <class T>
+    std::expected<T, PgOpError> decode_binary_cell(uint32_t oid, std::string_view sv) {
+        using D = std::decay_t<T>;
+        D out{};
+
+        if constexpr (std::is_enum_v<D>) {
+            using U = std::underlying_type_t<D>;
+            U u{};
+            if (PgTypeRegistry::instance().decode(oid, sv, u)) return static_cast<D>(u);
+            if (detail::is_text_like_oid(oid) && detail::enum_from_token_impl(sv, out)) return out;
+        } else if constexpr (detail::is_pg_json_v<D>) {
+            std::string_view text = sv;
+            if (oid == detail::JSONBOID) {
+                if (sv.empty() || sv[0] != 1) text = {};
+                else text = sv.substr(1);
+            }
+            if (!text.empty()) {
+                auto parsed = ::ujson::try_parse<typename D::value_type, D::strict>(text);
+                if (parsed) {
+                    out.value = std::move(*parsed);
+                    return out;
+                }
+            }
+        } else {
+            if (PgTypeRegistry::instance().decode(oid, sv, out)) return out;
+        }
+
+        PgOpError e;
+        e.code = PgErrorCode::ProtocolCorrupt;
+        e.error = "no binary decoder for column type " + PgTypeRegistry::instance().type_name(oid);
+        return std::unexpected(std::move(e));
+    }
+} // namespace usub::pg
+
+#define UPQ_HAVE_OID_TO_TYPENAME 1
+
+#endif // PGTYPEREGISTRY_H
@@ -7,6 +7,7 @@
 
 #include <atomic>
 #include <charconv>
+#include <chrono>
 #include <condition_variable>
 #include <coroutine>
 #include <cstdint>
@@ -24,10 +25,14 @@
 #include <utility>
 #include <vector>
 
+#include "PgTextScan.h"
 #include "ureflect/ureflect_auto.h"
 #include "uvent/Uvent.h"
 #include "uvent/utils/sync/RefCountedSession.h"
 
+// QueryResult carries per-column type OIDs (used by PgReflect diagnostics and binary decoding)
+#define UPQ_RESULT_HAS_COLUMN_OIDS 1
+
 namespace usub::pg {
     enum class PgErrorCode : uint32_t {
         OK = 0,
@@ -42,6 +47,11 @@ namespace usub::pg {
         AuthFailed,
         AwaitCanceled,
         TooManyConnections,
+        PoolAcquireTimeout,
+        PoolQueueFull,
+        QueryTimeout,   // our per-query deadline passed; the statement was canceled
+        QueryCanceled,  // canceled by anyone else (SQLSTATE 57014: statement_timeout, pg_cancel_backend)
+        SocketWriteFailed,  // sending or flushing the request failed
         Unknown
     };
 
@@ -91,6 +101,16 @@ namespace usub::pg {
                 return "AwaitCanceled";
             case PgErrorCode::TooManyConnections:
                 return "TooManyConnections";
+            case PgErrorCode::PoolAcquireTimeout:
+                return "PoolAcquireTimeout";
+            case PgErrorCode::PoolQueueFull:
+                return "PoolQueueFull";
+            case PgErrorCode::QueryTimeout:
+                return "QueryTimeout";
+            case PgErrorCode::QueryCanceled:
+                return "QueryCanceled";
+            case PgErrorCode::SocketWriteFailed:
+                return "SocketWriteFailed";
             case PgErrorCode::Unknown:
                 return "Unknown";
         }
@@ -140,6 +160,7 @@ namespace usub::pg {
         std::string message;
         std::string detail;
         std::string hint;
+        std::string routine;  // server source function; not localized
         PgSqlStateClass category{PgSqlStateClass::None};
     };
 
@@ -151,6 +172,76 @@ namespace usub::pg {
         PgErrorDetail err_detail;
     };
 
+    struct PgExecManyOptions {
+        size_t window{256};  // statements in flight before results are drained
+        // One sync for the whole batch: outside a transaction all items commit
+        // or none do, and the first failure aborts the rest (each reported).
+        // Otherwise every item is synced on its own and fails alone.
+        bool all_or_nothing{false};
+    };
+
+    // Per-query deadline (PgPool::query_awaitable, PgTransaction::query).
+    // When it passes, a cancel request is sent on a side connection and the
+    // statement fails with QueryTimeout while the connection stays usable.
+    // If the server has not answered cancel_grace later, the socket is shut
+    // down and the connection is dropped as a last resort.
+    struct PgQueryOptions {
+        std::chrono::milliseconds timeout{0};  // 0: no deadline
+        std::chrono::milliseconds cancel_grace{1000};
+    };
+
+    struct PgExecManyError {
+        size_t index{0};  // position in the input range
+        PgOpError error;
+    };
+
+    struct PgExecManyResult {
+        uint64_t rows_affected{0};  // summed over the items that succeeded
+        size_t succeeded{0};
+        std::vector<PgExecManyError> errors;  // ascending by index
+
+        [[nodiscard]] bool ok() const noexcept { return this->errors.empty(); }
+
+        static PgExecManyResult all_failed(size_t count, const PgOpError &e) {
+            PgExecManyResult r;
+            r.errors.reserve(count);
+            for (size_t i = 0; i < count; ++i) r.errors.push_back(PgExecManyError{i, e});
+            return r;
+        }
+    };
+
+    // A WAL position (pg_lsn, text form "16/B374D848"); 0 means "none".
+    struct PgLsn {
+        uint64_t value{0};
+
+        explicit operator bool() const noexcept { return this->value != 0; }
+
+        friend auto operator<=>(const PgLsn &, const PgLsn &) = default;
+
+        static std::optional<PgLsn> parse(std::string_view text) noexcept {
+            const size_t slash = text.find('/');
+            if (slash == std::string_view::npos || slash == 0 || slash + 1 == text.size())
+                return std::nullopt;
+            uint32_t hi = 0, lo = 0;
+            const char *end = text.data() + text.size();
+            auto r1 = std::from_chars(text.data(), text.data() + slash, hi, 16);
+            auto r2 = std::from_chars(text.data() + slash + 1, end, lo, 16);
+            if (r1.ec != std::errc{} || r1.ptr != text.data() + slash || r2.ec != std::errc{} || r2.ptr != end)
+                return std::nullopt;
+            return PgLsn{static_cast<uint64_t>(hi) << 32 | lo};
+        }
+
+        [[nodiscard]] std::string to_string() const {
+            char buf[20];
+            auto r = std::to_chars(buf, buf + 8, static_cast<uint32_t>(this->value >> 32), 16);
+            *r.ptr++ = '/';
+            r = std::to_chars(r.ptr, buf + sizeof(buf), static_cast<uint32_t>(this->value), 16);
+            std::string out(buf, r.ptr);
+            for (char &c: out) if (c >= 'a' && c <= 'f') c = static_cast<char>(c - 'a' + 'A');
+            return out;
+        }
+    };
+
     // ---------- detail: OIDs + concepts ----------
     namespace detail {
         // OIDs (pg_type.h)
@@ -444,8 +535,11 @@ namespace usub::pg {
         operator const T &() const noexcept { return value; }
     };
 
-    template <class T, bool Strict = true, bool Jsonb = true>
+    // Binary: sent in jsonb's binary format (version byte + text) with an
+    // explicit length, so libpq does not strlen() the document. Jsonb only.
+    template <class T, bool Strict = true, bool Jsonb = true, bool Binary = false>
     struct PgJsonParam {
+        static_assert(Jsonb || !Binary, "binary JSON parameters are jsonb only");
         const T *ptr{};
     };
 
@@ -459,6 +553,11 @@ namespace usub::pg {
         return PgJsonParam<T, Strict, false>{&v};
     }
 
+    template <class T, bool Strict = true>
+    [[nodiscard]] inline PgJsonParam<T, Strict, true, true> pg_jsonb_binary(const T &v) noexcept {
+        return PgJsonParam<T, Strict, true, true>{&v};
+    }
+
     template <class T>
     struct PgNumRange {
         std::optional<T> lo;
@@ -481,8 +580,8 @@ namespace usub::pg {
         template <class T>
         struct is_pg_json_param : std::false_type {};
 
-        template <class T, bool Strict, bool Jsonb>
-        struct is_pg_json_param<::usub::pg::PgJsonParam<T, Strict, Jsonb>> : std::true_type {};
+        template <class T, bool Strict, bool Jsonb, bool Binary>
+        struct is_pg_json_param<::usub::pg::PgJsonParam<T, Strict, Jsonb, Binary>> : std::true_type {};
 
         template <class T>
         inline constexpr bool is_pg_json_param_v = is_pg_json_param<std::decay_t<T>>::value;
@@ -498,6 +597,10 @@ namespace usub::pg {
             is_pg_numrange_reflect<std::decay_t<T>>::value;
     }  // namespace detail
 
+    // Defined in PgTypeRegistry.h; used by Row::get for binary results.
+    template <class T>
+    std::expected<T, PgOpError> decode_binary_cell(uint32_t oid, std::string_view sv);
+
     struct QueryResult {
         struct Row {
             std::vector<std::string> cols;
@@ -510,6 +613,8 @@ namespace usub::pg {
 
             [[nodiscard]] std::string &at(size_t i) noexcept { return this->cols.at(i); }
 
+            [[nodiscard]] inline std::string_view cell(size_t i) const noexcept { return this->cols[i]; }
+
             [[nodiscard]] inline size_t size() const noexcept { return this->cols.size(); }
             [[nodiscard]] inline bool empty() const noexcept { return this->cols.empty(); }
 
@@ -544,12 +649,22 @@ namespace usub::pg {
                     e.error = "column index out of row bounds";
                     return std::unexpected(std::move(e));
                 }
+                if (qr.binary) {
+                    const uint32_t oid = *idx < qr.column_oids.size() ? qr.column_oids[*idx] : 0;
+                    return decode_binary_cell<T>(oid, std::string_view{cols[*idx]});
+                }
                 return QueryResult::parse_cell<T>(std::string_view{cols[*idx]});
             }
         };
 
         std::vector<std::string> columns;
 
+        // PQftype of each column; filled for every result with tuples
+        std::vector<uint32_t> column_oids;
+
+        // cells hold PostgreSQL binary representations (resultFormat=1)
+        bool binary{false};
+
         std::vector<Row> rows;
 
         const Row &operator[](size_t i) const noexcept { return this->rows[i]; }
@@ -571,6 +686,10 @@ namespace usub::pg {
 
         uint64_t rows_affected{0};
 
+        // A statement completed with the ROLLBACK tag, which is also what
+        // COMMIT answers when the transaction had already failed.
+        bool rolled_back{false};
+
         [[nodiscard]] inline bool empty() const noexcept {
             return this->ok && this->rows_valid && this->rows.empty();
         }
@@ -615,19 +734,18 @@ namespace usub::pg {
                 return std::unexpected(std::move(e));
             } else if constexpr (std::is_integral_v<D> && !std::is_same_v<D, bool>) {
                 D v{};
-                auto r = std::from_chars(sv.data(), sv.data() + sv.size(), v);
-                if (r.ec == std::errc{} && r.ptr == sv.data() + sv.size()) return v;
+                if (detail::parse_decimal_int(sv, v)) return v;
 
                 PgOpError e;
                 e.code = PgErrorCode::ProtocolCorrupt;
                 e.error = "failed to parse integer";
                 return std::unexpected(std::move(e));
             } else if constexpr (std::is_floating_point_v<D>) {
-                char *end = nullptr;
-                std::string tmp(sv);
-                const char *s = tmp.c_str();
-                double v = std::strtod(s, &end);
-                if (end == s + tmp.size()) return static_cast<D>(v);
+                // an empty cell (NULL) has always read as 0
+                if (sv.empty()) return D{};
+                D v{};
+                auto r = std::from_chars(sv.data(), sv.data() + sv.size(), v);
+                if (r.ec == std::errc{} && r.ptr == sv.data() + sv.size()) return v;
 
                 PgOpError e;
                 e.code = PgErrorCode::ProtocolCorrupt;
@@ -660,7 +778,7 @@ namespace usub::pg {
                     return std::unexpected(std::move(e));
                 }
 
-                auto parsed = ::ujson::try_parse<Inner, Strict>(std::string(sv));
+                auto parsed = ::ujson::try_parse<Inner, Strict>(sv);
                 if (!parsed) {
                     PgOpError e;
                     e.code = PgErrorCode::ProtocolCorrupt;
@@ -714,6 +832,10 @@ namespace usub::pg {
                 return std::unexpected(std::move(e));
             }
 
+            if (binary) {
+                const uint32_t oid = *idx < column_oids.size() ? column_oids[*idx] : 0;
+                return decode_binary_cell<T>(oid, std::string_view{r.cols[*idx]});
+            }
             return parse_cell<T>(std::string_view{r.cols[*idx]});
         }
 
@@ -811,6 +933,11 @@ namespace usub::pg {
     // classify SQLSTATE string ("23505", "40P01", etc.) into PgSqlStateClass
     PgSqlStateClass classify_sqlstate(std::string_view sqlstate);
 
+    // PgErrorCode for a server error with this SQLSTATE.
+    inline PgErrorCode server_error_code(std::string_view sqlstate) noexcept {
+        return sqlstate == "57014" ? PgErrorCode::QueryCanceled : PgErrorCode::ServerError;
+    }
+
     template <class Socket>
     uvent::task::Awaitable<PgWireResult<void>> read_exact(Socket &sock, std::vector<uint8_t> &buf,
                                                           size_t n) {
@@ -945,6 +1072,11 @@ namespace usub::pg {
         PgErrorCode code{PgErrorCode::Unknown};
         std::string error;
         PgErrorDetail err_detail;
+
+        // row metadata; filled by single-row streaming (stream_fetch_chunk)
+        std::vector<std::string> columns;
+        std::vector<uint32_t> column_oids;
+        bool binary{false};
     };
 }  // namespace usub::pg
 
@@ -0,0 +1,318 @@
+#ifndef PGCONNECTIONNATIVE_H
+#define PGCONNECTIONNATIVE_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "../PgConnection.h"
+#include "../PgNotificationMultiplexer.h"
+#include "../PgTypeRegistry.h"
+#include "../PgTypes.h"
+#include "uvent/Uvent.h"
+
+namespace usub::pg {
+    namespace detail {
+        struct PgNativeIoWait;
+    } // namespace detail
+
+    struct PgNativeConfig {
+        // A numeric IPv4/IPv6 address: names are not resolved, since
+        // getaddrinfo would block the event loop.
+        std::string host{"127.0.0.1"};
+        std::string port{"5432"};
+        std::string user;
+        std::string db;
+        std::string password;
+        std::chrono::milliseconds connect_timeout{5000};  // TCP connect only
+    };
+
+    // Receive side: the socket is read straight into this buffer and frames
+    // are parsed in place. Consumed bytes are reclaimed by sliding the unread
+    // tail to the front, so steady-state traffic never reallocates.
+    class PgWireRecvBuffer {
+    public:
+        explicit PgWireRecvBuffer(size_t initial = 64 * 1024) : buf_(initial) {}
+
+        // At least `min` writable bytes past the unread data.
+        std::span<uint8_t> prepare(size_t min);
+
+        void commit(size_t n) noexcept { this->tail_ += n; }
+
+        [[nodiscard]] std::span<const uint8_t> readable() const noexcept {
+            return {this->buf_.data() + this->head_, this->tail_ - this->head_};
+        }
+
+        void consume(size_t n) noexcept {
+            this->head_ += n;
+            if (this->head_ == this->tail_) this->head_ = this->tail_ = 0;
+        }
+
+    private:
+        std::vector<uint8_t> buf_;
+        size_t head_{0};
+        size_t tail_{0};
+    };
+
+    // Send side: frames for one flush, written with one sendmsg() over an
+    // iovec list. put_ref() values of at least ref_threshold bytes are
+    // referenced rather than copied and must stay alive until the flush.
+    class PgWireSendBuffer {
+    public:
+        static constexpr size_t ref_threshold = 512;
+
+        void begin(char type);
+
+        void end();
+
+        void put_u8(uint8_t v) { this->put(&v, 1); }
+
+        void put_i16(int16_t v);
+
+        void put_i32(int32_t v);
+
+        void put_cstr(std::string_view s);
+
+        void put_bytes(const void *p, size_t n) { this->put(p, n); }
+
+        // Copied below ref_threshold, referenced from there on.
+        void put_ref(const void *p, size_t n);
+
+        // Bytes outside any frame (startup packet).
+        void put_raw(std::span<const uint8_t> bytes) { this->put(bytes.data(), bytes.size()); }
+
+        [[nodiscard]] bool empty() const noexcept { return this->buf_.empty() && this->segs_.empty(); }
+
+        void clear() noexcept;
+
+        // iovecs over everything queued; valid until the next put.
+        void iovecs(std::vector<iovec> &out);
+
+    private:
+        struct Seg {
+            const uint8_t *ext;  // nullptr: buf_[off, off + len)
+            size_t off;
+            size_t len;
+        };
+
+        void put(const void *p, size_t n);
+
+        void close_inline();
+
+        std::vector<uint8_t> buf_;
+        std::vector<Seg> segs_;
+        size_t inline_start_{0};
+        size_t len_at_{0};     // offset of the open frame's length word
+        size_t frame_bytes_{0};
+    };
+
+    // One DataRow handed to PgConnectionNative::for_each_row. Cells point into
+    // the receive buffer and are valid only inside the callback; NULL is a
+    // view with data() == nullptr.
+    class PgNativeRow {
+    public:
+        [[nodiscard]] size_t size() const noexcept { return this->cells_.size(); }
+
+        [[nodiscard]] std::string_view operator[](size_t i) const noexcept { return this->cells_[i]; }
+
+        [[nodiscard]] bool is_null(size_t i) const noexcept { return this->cells_[i].data() == nullptr; }
+
+        [[nodiscard]] const std::vector<std::string> &columns() const noexcept { return *this->columns_; }
+
+        template<class T>
+        [[nodiscard]] std::expected<T, PgOpError> get(size_t i) const {
+            if (i >= this->cells_.size()) {
+                PgOpError e;
+                e.code = PgErrorCode::ParserTruncatedField;
+                e.error = "column index out of row bounds";
+                return std::unexpected(std::move(e));
+            }
+            if constexpr (detail::Optional<std::decay_t<T> >) {
+                if (this->is_null(i)) return T{};
+            }
+            if (this->binary_) return decode_binary_cell<T>((*this->oids_)[i], this->cells_[i]);
+            return QueryResult::parse_cell<T>(this->cells_[i]);
+        }
+
+    private:
+        friend class PgConnectionNative;
+
+        std::vector<std::string_view> cells_;
+        const std::vector<std::string> *columns_{nullptr};
+        const std::vector<uint32_t> *oids_{nullptr};
+        bool binary_{false};
+    };
+
+    // Connection that speaks the v3 wire protocol itself instead of going
+    // through libpq: startup with cleartext / MD5 / SCRAM-SHA-256 auth, the
+    // extended query protocol (Parse/Bind/Describe/Execute/Sync on the
+    // unnamed statement), pipelines, COPY and NOTIFY. Method names follow
+    // PgConnectionLibpq. Plain TCP only; use the libpq backend for TLS.
+    class PgConnectionNative {
+    public:
+        using RowFn = std::function<void(const PgNativeRow &)>;
+
+        PgConnectionNative();
+
+        ~PgConnectionNative();
+
+        PgConnectionNative(const PgConnectionNative &) = delete;
+
+        PgConnectionNative &operator=(const PgConnectionNative &) = delete;
+
+        // nullopt on success, otherwise the error message.
+        usub::uvent::task::Awaitable<std::optional<std::string> > connect_async(PgNativeConfig cfg);
+
+        [[nodiscard]] bool connected() const noexcept { return this->connected_; }
+
+        [[nodiscard]] int backend_pid() const noexcept { return this->backend_pid_; }
+
+        // ParameterStatus value reported by the server ("" when unknown).
+        [[nodiscard]] std::string_view server_parameter(const std::string &name) const;
+
+        void set_result_format(PgResultFormat fmt) noexcept { this->result_format_ = fmt; }
+
+        [[nodiscard]] PgResultFormat result_format() const noexcept { return this->result_format_; }
+
+        usub::uvent::task::Awaitable<QueryResult> exec_simple_query_nonblocking(const std::string &sql);
+
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResult>
+        exec_param_query_nonblocking(const std::string &sql, Args &&... args);
+
+        // Streams rows to on_row as views into the receive buffer; nothing is
+        // copied. The result carries status, columns and rows_affected only.
+        template<typename... Args>
+        usub::uvent::task::Awaitable<QueryResult>
+        for_each_row(const std::string &sql, const RowFn &on_row, Args &&... args);
+
+        // All statements and sync points go out in one vectored write;
+        // responses are buffered while that write waits for room.
+        usub::uvent::task::Awaitable<std::vector<QueryResult> > exec_pipeline_nonblocking(PgPipeline pipeline);
+
+        usub::uvent::task::Awaitable<PgCopyResult> copy_in_start(const std::string &sql);
+
+        usub::uvent::task::Awaitable<PgCopyResult> copy_in_send_chunk(const void *data, size_t len);
+
+        usub::uvent::task::Awaitable<PgCopyResult> copy_in_finish();
+
+        usub::uvent::task::Awaitable<PgCopyResult> copy_out_start(const std::string &sql);
+
+        // ok with an empty value once the copy is done.
+        usub::uvent::task::Awaitable<PgWireResult<std::vector<uint8_t> > > copy_out_read_chunk();
+
+        usub::uvent::task::Awaitable<QueryResult> listen(const std::string &channel);
+
+        // Notifications that arrived during earlier calls come first.
+        usub::uvent::task::Awaitable<PgWireResult<PgNotification> > wait_notification();
+
+        void close();
+
+    private:
+        struct Frame {
+            char type{0};
+            std::span<const uint8_t> payload;
+        };
+
+        enum class StmtEnd { Done, Ready, Broken };
+
+        usub::uvent::task::Awaitable<QueryResult>
+        exec_params(const std::string &sql, int n, const char *const *values, const int *lengths,
+                    const int *formats, const Oid *types, const RowFn *on_row);
+
+        void put_extended(const std::string &sql, int n, const char *const *values, const int *lengths,
+                          const int *formats, const Oid *types);
+
+        void put_sync();
+
+        // Reads one statement's responses up to CommandComplete, EmptyQuery
+        // or an error (Done), or up to ReadyForQuery when no statement
+        // result is left (Ready).
+        usub::uvent::task::Awaitable<StmtEnd> read_statement(QueryResult &out, const RowFn *on_row);
+
+        usub::uvent::task::Awaitable<bool> read_until_ready();
+
+        // The frame stays valid until the next call. NoticeResponse,
+        // ParameterStatus and NotificationResponse are handled here.
+        usub::uvent::task::Awaitable<PgWireResult<Frame> > next_frame();
+
+        usub::uvent::task::Awaitable<bool> fill(size_t need);
+
+        usub::uvent::task::Awaitable<void> wait_readable();
+
+        usub::uvent::task::Awaitable<void> wait_writable();
+
+        // POLLIN and/or POLLOUT once the socket is readable or writable.
+        usub::uvent::task::Awaitable<short> wait_readable_or_writable();
+
+        // POLLOUT once writable, or 0 when `timeout` passes first.
+        usub::uvent::task::Awaitable<short> wait_writable_for(std::chrono::milliseconds timeout);
+
+        // keep_reading: while the socket is full, drain what the server has
+        // already sent into rx_ so it never blocks on us (pipelines).
+        usub::uvent::task::Awaitable<bool> flush(bool keep_reading = false);
+
+        // Non-blocking: everything readable right now goes into rx_.
+        bool stash_input();
+
+        usub::uvent::task::Awaitable<std::optional<std::string> > startup(const PgNativeConfig &cfg);
+
+        void fail_transport(PgErrorCode code, std::string msg);
+
+        int fd_{-1};
+        bool connected_{false};
+        std::unique_ptr<
+            usub::uvent::net::Socket<
+                usub::uvent::net::Proto::TCP,
+                usub::uvent::net::Role::ACTIVE
+            >
+        > sock_;
+        std::shared_ptr<detail::PgNativeIoWait> io_wait_;  // one per socket
+
+        PgWireRecvBuffer rx_;
+        PgWireSendBuffer tx_;
+        std::vector<iovec> iov_;
+        size_t pending_consume_{0};
+
+        int backend_pid_{0};
+        int32_t backend_key_{0};
+        std::unordered_map<std::string, std::string> params_;
+        std::deque<PgNotification> notifications_;
+        PgResultFormat result_format_{PgResultFormat::Text};
+        PgWireError last_error_;
+        PgNativeRow row_;
+    };
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResult>
+    PgConnectionNative::exec_param_query_nonblocking(const std::string &sql, Args &&... args) {
+        constexpr size_t M = detail::count_total_params<Args...>();
+        ParamBuffer<M> pb;
+        (detail::encode_one(pb.ps, std::forward<Args>(args)), ...);
+        co_return co_await this->exec_params(sql, pb.count(), pb.values.data(), pb.lengths.data(),
+                                             pb.formats.data(), pb.types.data(), nullptr);
+    }
+
+    template<typename... Args>
+    usub::uvent::task::Awaitable<QueryResult>
+    PgConnectionNative::for_each_row(const std::string &sql, const RowFn &on_row, Args &&... args) {
+        constexpr size_t M = detail::count_total_params<Args...>();
+        ParamBuffer<M> pb;
+        (detail::encode_one(pb.ps, std::forward<Args>(args)), ...);
+        co_return co_await this->exec_params(sql, pb.count(), pb.values.data(), pb.lengths.data(),
+                                             pb.formats.data(), pb.types.data(), &on_row);
+    }
+} // namespace usub::pg
+
+#endif // PGCONNECTIONNATIVE_H
@@ -0,0 +1,261 @@
+#include "upq/PgByteSwap.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define UPQ_BYTESWAP_X86 1
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define UPQ_BYTESWAP_NEON 1
+#endif
+
+namespace usub::pg::detail {
+    namespace {
+        template<size_t W>
+        char *store_scalar(char *dst, const char *src, size_t n) noexcept {
+            using U = std::conditional_t<W == 2, uint16_t, std::conditional_t<W == 4, uint32_t, uint64_t> >;
+            const unsigned char len_be[4] = {0, 0, 0, static_cast<unsigned char>(W)};
+            for (size_t i = 0; i < n; ++i, src += W, dst += 4 + W) {
+                U v;
+                std::memcpy(&v, src, W);
+                if constexpr (std::endian::native == std::endian::little) v = std::byteswap(v);
+                std::memcpy(dst, len_be, 4);
+                std::memcpy(dst + 4, &v, W);
+            }
+            return dst;
+        }
+
+        template<size_t W>
+        bool load_scalar(char *dst, const char *src, size_t n) noexcept {
+            using U = std::conditional_t<W == 2, uint16_t, std::conditional_t<W == 4, uint32_t, uint64_t> >;
+            uint32_t bad = 0;
+            for (size_t i = 0; i < n; ++i, src += 4 + W, dst += W) {
+                uint32_t len;
+                U v;
+                std::memcpy(&len, src, 4);
+                std::memcpy(&v, src + 4, W);
+                if constexpr (std::endian::native == std::endian::little) {
+                    len = std::byteswap(len);
+                    v = std::byteswap(v);
+                }
+                bad |= len ^ static_cast<uint32_t>(W);
+                std::memcpy(dst, &v, W);
+            }
+            return bad == 0;
+        }
+
+#if UPQ_BYTESWAP_X86 || UPQ_BYTESWAP_NEON
+        // One group is `values` values: in_regs 16-byte vectors of native
+        // values, out_regs 16-byte vectors of records. Record vector b is the OR
+        // over k of shuffle(value vector k, shuf[b][k]) and len[b]; value vector
+        // k is the OR over b of shuffle(record vector b, unshuf[k][b]), and
+        // record vector b is valid when (b & len_mask[b]) == len[b]. Index 0x80
+        // yields zero for both pshufb and tbl.
+        template<size_t W>
+        struct RecordShuffle {
+            static constexpr size_t values = W == 2 ? 8 : 4;
+            static constexpr size_t in_regs = values * W / 16;
+            static constexpr size_t out_regs = values * (4 + W) / 16;
+            uint8_t shuf[out_regs][in_regs][16];
+            uint8_t len[out_regs][16];
+            uint8_t len_mask[out_regs][16];
+            uint8_t unshuf[in_regs][out_regs][16];
+        };
+
+        template<size_t W>
+        constexpr RecordShuffle<W> make_record_shuffle() {
+            using S = RecordShuffle<W>;
+            S t{};
+            for (size_t o = 0; o < S::out_regs * 16; ++o) {
+                const size_t rec = o / (4 + W), off = o % (4 + W);
+                const size_t b = o / 16, j = o % 16;
+                for (size_t k = 0; k < S::in_regs; ++k) t.shuf[b][k][j] = 0x80;
+                t.len[b][j] = off == 3 ? static_cast<uint8_t>(W) : 0;
+                t.len_mask[b][j] = off < 4 ? 0xFF : 0;
+                if (off >= 4) {
+                    const size_t s = rec * W + (W - 1 - (off - 4));
+                    t.shuf[b][s / 16][j] = static_cast<uint8_t>(s % 16);
+                }
+            }
+            for (size_t v = 0; v < S::in_regs * 16; ++v) {
+                const size_t o = (v / W) * (4 + W) + 4 + (W - 1 - v % W);
+                for (size_t b = 0; b < S::out_regs; ++b) t.unshuf[v / 16][b][v % 16] = 0x80;
+                t.unshuf[v / 16][o / 16][v % 16] = static_cast<uint8_t>(o % 16);
+            }
+            return t;
+        }
+
+        template<size_t W>
+        constexpr RecordShuffle<W> record_shuffle = make_record_shuffle<W>();
+#endif
+
+#if UPQ_BYTESWAP_X86
+        template<size_t W>
+        __attribute__((target("ssse3")))
+        char *store_ssse3(char *dst, const char *src, size_t n) noexcept {
+            using S = RecordShuffle<W>;
+            const auto &t = record_shuffle<W>;
+            __m128i shuf[S::out_regs][S::in_regs], len[S::out_regs];
+            for (size_t b = 0; b < S::out_regs; ++b) {
+                len[b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.len[b]));
+                for (size_t k = 0; k < S::in_regs; ++k)
+                    shuf[b][k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.shuf[b][k]));
+            }
+
+            size_t i = 0;
+            for (; i + S::values <= n; i += S::values, src += S::values * W, dst += S::values * (4 + W)) {
+                __m128i in[S::in_regs];
+                for (size_t k = 0; k < S::in_regs; ++k)
+                    in[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16 * k));
+                for (size_t b = 0; b < S::out_regs; ++b) {
+                    __m128i o = len[b];
+                    for (size_t k = 0; k < S::in_regs; ++k)
+                        o = _mm_or_si128(o, _mm_shuffle_epi8(in[k], shuf[b][k]));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16 * b), o);
+                }
+            }
+            return store_scalar<W>(dst, src, n - i);
+        }
+
+        template<size_t W>
+        __attribute__((target("ssse3")))
+        bool load_ssse3(char *dst, const char *src, size_t n) noexcept {
+            using S = RecordShuffle<W>;
+            const auto &t = record_shuffle<W>;
+            __m128i unshuf[S::in_regs][S::out_regs], len[S::out_regs], len_mask[S::out_regs];
+            for (size_t b = 0; b < S::out_regs; ++b) {
+                len[b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.len[b]));
+                len_mask[b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.len_mask[b]));
+                for (size_t k = 0; k < S::in_regs; ++k)
+                    unshuf[k][b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.unshuf[k][b]));
+            }
+
+            __m128i bad = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + S::values <= n; i += S::values, src += S::values * (4 + W), dst += S::values * W) {
+                __m128i rec[S::out_regs];
+                for (size_t b = 0; b < S::out_regs; ++b) {
+                    rec[b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16 * b));
+                    bad = _mm_or_si128(bad, _mm_xor_si128(_mm_and_si128(rec[b], len_mask[b]), len[b]));
+                }
+                for (size_t k = 0; k < S::in_regs; ++k) {
+                    __m128i v = _mm_shuffle_epi8(rec[0], unshuf[k][0]);
+                    for (size_t b = 1; b < S::out_regs; ++b)
+                        v = _mm_or_si128(v, _mm_shuffle_epi8(rec[b], unshuf[k][b]));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16 * k), v);
+                }
+            }
+            const bool ok = _mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) == 0xFFFF;
+            return load_scalar<W>(dst, src, n - i) && ok;
+        }
+#endif
+
+#if UPQ_BYTESWAP_NEON
+        template<size_t W>
+        char *store_neon(char *dst, const char *src, size_t n) noexcept {
+            using S = RecordShuffle<W>;
+            const auto &t = record_shuffle<W>;
+            uint8x16_t shuf[S::out_regs][S::in_regs], len[S::out_regs];
+            for (size_t b = 0; b < S::out_regs; ++b) {
+                len[b] = vld1q_u8(t.len[b]);
+                for (size_t k = 0; k < S::in_regs; ++k) shuf[b][k] = vld1q_u8(t.shuf[b][k]);
+            }
+
+            size_t i = 0;
+            for (; i + S::values <= n; i += S::values, src += S::values * W, dst += S::values * (4 + W)) {
+                uint8x16_t in[S::in_regs];
+                for (size_t k = 0; k < S::in_regs; ++k)
+                    in[k] = vld1q_u8(reinterpret_cast<const uint8_t *>(src + 16 * k));
+                for (size_t b = 0; b < S::out_regs; ++b) {
+                    uint8x16_t o = len[b];
+                    for (size_t k = 0; k < S::in_regs; ++k) o = vorrq_u8(o, vqtbl1q_u8(in[k], shuf[b][k]));
+                    vst1q_u8(reinterpret_cast<uint8_t *>(dst + 16 * b), o);
+                }
+            }
+            return store_scalar<W>(dst, src, n - i);
+        }
+
+        template<size_t W>
+        bool load_neon(char *dst, const char *src, size_t n) noexcept {
+            using S = RecordShuffle<W>;
+            const auto &t = record_shuffle<W>;
+            uint8x16_t unshuf[S::in_regs][S::out_regs], len[S::out_regs], len_mask[S::out_regs];
+            for (size_t b = 0; b < S::out_regs; ++b) {
+                len[b] = vld1q_u8(t.len[b]);
+                len_mask[b] = vld1q_u8(t.len_mask[b]);
+                for (size_t k = 0; k < S::in_regs; ++k) unshuf[k][b] = vld1q_u8(t.unshuf[k][b]);
+            }
+
+            uint8x16_t bad = vdupq_n_u8(0);
+            size_t i = 0;
+            for (; i + S::values <= n; i += S::values, src += S::values * (4 + W), dst += S::values * W) {
+                uint8x16_t rec[S::out_regs];
+                for (size_t b = 0; b < S::out_regs; ++b) {
+                    rec[b] = vld1q_u8(reinterpret_cast<const uint8_t *>(src + 16 * b));
+                    bad = vorrq_u8(bad, veorq_u8(vandq_u8(rec[b], len_mask[b]), len[b]));
+                }
+                for (size_t k = 0; k < S::in_regs; ++k) {
+                    uint8x16_t v = vqtbl1q_u8(rec[0], unshuf[k][0]);
+                    for (size_t b = 1; b < S::out_regs; ++b) v = vorrq_u8(v, vqtbl1q_u8(rec[b], unshuf[k][b]));
+                    vst1q_u8(reinterpret_cast<uint8_t *>(dst + 16 * k), v);
+                }
+            }
+            return load_scalar<W>(dst, src, n - i) && vmaxvq_u8(bad) == 0;
+        }
+#endif
+
+        using StoreFn = char *(*)(char *, const char *, size_t) noexcept;
+        using LoadFn = bool (*)(char *, const char *, size_t) noexcept;
+
+        struct SwapKernel {
+            StoreFn w2, w4, w8;
+            LoadFn r2, r4, r8;
+            const char *name;
+        };
+
+        SwapKernel pick_swap_kernel() noexcept {
+#if UPQ_BYTESWAP_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("ssse3"))
+                return {store_ssse3<2>, store_ssse3<4>, store_ssse3<8>,
+                        load_ssse3<2>, load_ssse3<4>, load_ssse3<8>, "ssse3"};
+#elif UPQ_BYTESWAP_NEON
+            return {store_neon<2>, store_neon<4>, store_neon<8>,
+                    load_neon<2>, load_neon<4>, load_neon<8>, "neon"};
+#endif
+            return {store_scalar<2>, store_scalar<4>, store_scalar<8>,
+                    load_scalar<2>, load_scalar<4>, load_scalar<8>, "scalar"};
+        }
+
+        const SwapKernel &swap_kernel() noexcept {
+            static const SwapKernel k = pick_swap_kernel();
+            return k;
+        }
+    } // namespace
+
+    char *store_be_records(char *dst, const char *src, size_t n, size_t width) noexcept {
+        const auto &k = swap_kernel();
+        switch (width) {
+            case 2: return k.w2(dst, src, n);
+            case 4: return k.w4(dst, src, n);
+            default: return k.w8(dst, src, n);
+        }
+    }
+
+    bool load_be_records(char *dst, const char *src, size_t n, size_t width) noexcept {
+        const auto &k = swap_kernel();
+        switch (width) {
+            case 2: return k.r2(dst, src, n);
+            case 4: return k.r4(dst, src, n);
+            default: return k.r8(dst, src, n);
+        }
+    }
+
+    const char *byteswap_kernel() noexcept {
+        return swap_kernel().name;
+    }
+} // namespace usub::pg::detail
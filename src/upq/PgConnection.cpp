@@ -1,9 +1,15 @@
 #include "upq/PgConnection.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "uvent/sync/AsyncSemaphore.h"
+
 namespace usub::pg {
     static void fill_server_error_fields_copy(PGresult *res, PgCopyResult &out) {
         if (!res) return;
@@ -18,6 +24,13 @@ namespace usub::pg {
         out.ok = false;
         out.code = PgErrorCode::ServerError;
 
+        if (sqlstate) out.err_detail.sqlstate = sqlstate;
+        if (detail) out.err_detail.detail = detail;
+        if (hint) out.err_detail.hint = hint;
+        if (primary) out.err_detail.message = primary;
+        out.err_detail.category = classify_sqlstate(out.err_detail.sqlstate);
+        out.code = server_error_code(out.err_detail.sqlstate);
+
         if (sqlstate && *sqlstate) { out.error.append(" [SQLSTATE ").append(sqlstate).append("]"); }
         if (detail && *detail) { out.error.append(" detail: ").append(detail); }
         if (hint && *hint) { out.error.append(" hint: ").append(hint); }
@@ -37,13 +50,55 @@ namespace usub::pg {
         out.code = PgErrorCode::ServerError;
         out.done = true;
 
+        if (sqlstate) out.err_detail.sqlstate = sqlstate;
+        if (detail) out.err_detail.detail = detail;
+        if (hint) out.err_detail.hint = hint;
+        if (primary) out.err_detail.message = primary;
+        out.err_detail.category = classify_sqlstate(out.err_detail.sqlstate);
+        out.code = server_error_code(out.err_detail.sqlstate);
+
         if (sqlstate && *sqlstate) { out.error.append(" [SQLSTATE ").append(sqlstate).append("]"); }
         if (detail && *detail) { out.error.append(" detail: ").append(detail); }
         if (hint && *hint) { out.error.append(" hint: ").append(hint); }
     }
 
+    namespace detail {
+        // Readiness helpers parked by wait_readable_or_writable. A uvent
+        // awaiter watches one direction, so each direction gets its own
+        // coroutine. One that is still parked after the race is reused by the
+        // next wait rather than putting a second awaiter on the socket.
+        struct PgIoWait {
+            usub::uvent::sync::AsyncSemaphore wake{0};
+            std::atomic<short> events{0};
+            std::atomic<bool> read_parked{false};
+            std::atomic<bool> write_parked{false};
+        };
+    } // namespace detail
+
     // ---- ctor/dtor ----
-    PgConnectionLibpq::PgConnectionLibpq() = default;
+    namespace {
+        std::atomic<uint64_t> g_connection_ids{0};
+
+        template<class Header>
+        usub::uvent::task::Awaitable<void> park_readable(std::shared_ptr<detail::PgIoWait> w, Header *h) {
+            co_await usub::uvent::net::detail::AwaiterRead{h};
+            w->events.fetch_or(POLLIN, std::memory_order_acq_rel);
+            w->read_parked.store(false, std::memory_order_release);
+            w->wake.release();
+        }
+
+        template<class Header>
+        usub::uvent::task::Awaitable<void> park_writable(std::shared_ptr<detail::PgIoWait> w, Header *h) {
+            co_await usub::uvent::net::detail::AwaiterWrite{h};
+            w->events.fetch_or(POLLOUT, std::memory_order_acq_rel);
+            w->write_parked.store(false, std::memory_order_release);
+            w->wake.release();
+        }
+    }
+
+    PgConnectionLibpq::PgConnectionLibpq()
+        : id_(g_connection_ids.fetch_add(1, std::memory_order_relaxed) + 1) {
+    }
 
     PgConnectionLibpq::~PgConnectionLibpq() {
         this->close();
@@ -134,6 +189,16 @@ namespace usub::pg {
             >
         >(fd);
 
+        stmt_cache_.clear();
+        named_prepared_.clear();
+        pending_deallocate_.clear();
+        stream_active_ = false;
+        if (stream_res_) PQclear(stream_res_);
+        stream_res_ = nullptr;
+        stream_res_row_ = 0;
+        cancel_.reset();
+        io_wait_.reset();
+        connected_at_ = std::chrono::steady_clock::now();
         connected_ = true;
         co_return std::nullopt;
     }
@@ -154,6 +219,55 @@ namespace usub::pg {
         }
     }
 
+    usub::uvent::task::Awaitable<bool> PgConnectionLibpq::flush_outgoing_pipelined() {
+        // In pipeline mode the server may start answering before the whole
+        // batch is written and then stop reading until we drain its replies.
+        // Like libpq's pqSendSome: wait for either direction and absorb input
+        // whenever it arrives, so neither side blocks on a full socket.
+        for (;;) {
+            const int fr = PQflush(conn_);
+            if (fr == 0) co_return true;
+            if (fr == -1) {
+                connected_ = false;
+                co_return false;
+            }
+            const short ev = co_await wait_readable_or_writable();
+            if ((ev & (POLLIN | POLLERR | POLLHUP)) && PQconsumeInput(conn_) == 0) {
+                connected_ = false;
+                co_return false;
+            }
+        }
+    }
+
+    usub::uvent::task::Awaitable<short> PgConnectionLibpq::wait_readable_or_writable() {
+        if (!this->io_wait_) this->io_wait_ = std::make_shared<detail::PgIoWait>();
+        auto &w = *this->io_wait_;
+        auto *h = this->sock_->get_raw_header();
+        if (!w.read_parked.exchange(true, std::memory_order_acq_rel))
+            usub::uvent::system::co_spawn(park_readable(this->io_wait_, h));
+        if (!w.write_parked.exchange(true, std::memory_order_acq_rel))
+            usub::uvent::system::co_spawn(park_writable(this->io_wait_, h));
+        for (;;) {
+            co_await w.wake.acquire();
+            // a permit whose bit an earlier wake already took carries nothing
+            if (const short ev = w.events.exchange(0, std::memory_order_acq_rel)) co_return ev;
+        }
+    }
+
+    // Waits for `bit` through a helper left parked by the race, or reports
+    // the readiness it already saw; false when neither applies.
+    static usub::uvent::task::Awaitable<bool> wait_parked(detail::PgIoWait *w, short bit,
+                                                          std::atomic<bool> detail::PgIoWait::*parked) {
+        if (!w) co_return false;
+        // parked first: a helper publishes its bit before clearing the flag
+        if (!(w->*parked).load(std::memory_order_acquire))
+            co_return (w->events.fetch_and(static_cast<short>(~bit), std::memory_order_acq_rel) & bit) != 0;
+        for (;;) {
+            co_await w->wake.acquire();
+            if (w->events.fetch_and(static_cast<short>(~bit), std::memory_order_acq_rel) & bit) co_return true;
+        }
+    }
+
     usub::uvent::task::Awaitable<bool> PgConnectionLibpq::pump_input() {
         for (;;) {
             if (PQconsumeInput(conn_) == 0) {
@@ -166,11 +280,13 @@ namespace usub::pg {
     }
 
     usub::uvent::task::Awaitable<void> PgConnectionLibpq::wait_readable() {
+        if (co_await wait_parked(this->io_wait_.get(), POLLIN, &detail::PgIoWait::read_parked)) co_return;
         co_await usub::uvent::net::detail::AwaiterRead{sock_->get_raw_header()};
         co_return;
     }
 
     usub::uvent::task::Awaitable<void> PgConnectionLibpq::wait_writable() {
+        if (co_await wait_parked(this->io_wait_.get(), POLLOUT, &detail::PgIoWait::write_parked)) co_return;
         co_await usub::uvent::net::detail::AwaiterWrite{sock_->get_raw_header()};
         co_return;
     }
@@ -196,13 +312,16 @@ namespace usub::pg {
             co_return out;
         }
 
+        PgQueryProbe probe = this->begin_query(sql, 0);
+        probe.mark(probe.encoded);
+
         if (!PQsendQuery(conn_, sql.c_str())) {
             out.ok = false;
             out.code = PgErrorCode::SocketReadFailed;
             out.error = PQerrorMessage(conn_);
             out.rows_valid = false;
             connected_ = false;
-            co_return out;
+            co_return this->finish_query(probe, std::move(out));
         }
 
         if (!(co_await flush_outgoing())) {
@@ -211,8 +330,9 @@ namespace usub::pg {
             out.error = PQerrorMessage(conn_);
             out.rows_valid = false;
             connected_ = false;
-            co_return out;
+            co_return this->finish_query(probe, std::move(out));
         }
+        probe.mark(probe.sent);
 
         if (!(co_await pump_input())) {
             out.ok = false;
@@ -220,10 +340,12 @@ namespace usub::pg {
             out.error = PQerrorMessage(conn_);
             out.rows_valid = false;
             connected_ = false;
-            co_return out;
+            co_return this->finish_query(probe, std::move(out));
         }
 
-        co_return drain_all_results();
+        probe.mark(probe.server);
+
+        co_return this->finish_query(probe, drain_all_results());
     }
 
     usub::uvent::task::Awaitable<PgCopyResult>
@@ -346,6 +468,91 @@ namespace usub::pg {
         co_return drain_copy_end_result();
     }
 
+    usub::uvent::task::Awaitable<PgCopyResult>
+    PgConnectionLibpq::copy_out_describe(const std::string &query, std::vector<uint32_t> &oids) {
+        PgCopyResult out{};
+        out.ok = false;
+        out.code = PgErrorCode::Unknown;
+        oids.clear();
+
+        if (!connected()) {
+            out.code = PgErrorCode::ConnectionClosed;
+            out.error = "connection not OK";
+            co_return out;
+        }
+
+        if (PQenterPipelineMode(conn_) != 1) {
+            out.error = PQerrorMessage(conn_);
+            co_return out;
+        }
+
+        if (!PQsendPrepare(conn_, "", query.c_str(), 0, nullptr) ||
+            !PQsendDescribePrepared(conn_, "") || PQpipelineSync(conn_) != 1 ||
+            !(co_await flush_outgoing_pipelined())) {
+            out.code = PgErrorCode::SocketWriteFailed;
+            out.error = PQerrorMessage(conn_);
+            connected_ = false;
+            co_return out;
+        }
+
+        // Prepare and Describe each end in COMMAND_OK; the second one carries
+        // the fields. After an error the Describe comes back PIPELINE_ABORTED.
+        int completed = 0;
+        bool failed = false;
+        bool synced = false;
+        while (!synced) {
+            if (PQconsumeInput(conn_) == 0) {
+                out.code = PgErrorCode::SocketReadFailed;
+                out.error = PQerrorMessage(conn_);
+                connected_ = false;
+                co_return out;
+            }
+
+            while (!synced && !PQisBusy(conn_)) {
+                PGresult *res = PQgetResult(conn_);
+                if (!res) continue;
+
+                const auto st = PQresultStatus(res);
+                if (st == PGRES_PIPELINE_SYNC) {
+                    synced = true;
+                } else if (st == PGRES_COMMAND_OK) {
+                    if (++completed == 2) {
+                        const int n = PQnfields(res);
+                        oids.reserve(static_cast<size_t>(n));
+                        for (int c = 0; c < n; ++c)
+                            oids.push_back(static_cast<uint32_t>(PQftype(res, c)));
+                    }
+                } else if (st != PGRES_PIPELINE_ABORTED && !failed) {
+                    fill_server_error_fields_copy(res, out);
+                    failed = true;
+                }
+                PQclear(res);
+            }
+
+            if (!synced)
+                co_await wait_readable();
+        }
+
+        if (PQexitPipelineMode(conn_) != 1) {
+            UPQ_CONN_DBG("copy describe: exit pipeline failed: %s", PQerrorMessage(conn_));
+            connected_ = false;
+        }
+
+        if (failed) {
+            oids.clear();
+            co_return out;
+        }
+        if (completed != 2) {
+            out.code = PgErrorCode::ProtocolCorrupt;
+            out.error = "COPY describe: missing Describe result";
+            co_return out;
+        }
+
+        out.ok = true;
+        out.code = PgErrorCode::OK;
+        co_return out;
+    }
+
     usub::uvent::task::Awaitable<PgCopyResult>
     PgConnectionLibpq::copy_out_start(const std::string &sql) {
         PgCopyResult out{};
@@ -399,11 +606,12 @@ namespace usub::pg {
         co_return out;
     }
 
-    usub::uvent::task::Awaitable<PgWireResult<std::vector<uint8_t> > >
-    PgConnectionLibpq::copy_out_read_chunk() {
-        PgWireResult<std::vector<uint8_t> > out{};
+    usub::uvent::task::Awaitable<PgWireResult<int> >
+    PgConnectionLibpq::copy_out_fetch(char **buf) {
+        PgWireResult<int> out{};
         out.ok = false;
         out.err.code = PgErrorCode::Unknown;
+        *buf = nullptr;
 
         if (!connected()) {
             out.ok = false;
@@ -423,17 +631,21 @@ namespace usub::pg {
         }
 
         for (;;) {
-            char *buf = nullptr;
-            const int rc = PQgetCopyData(conn_, &buf, 0);
+            const int rc = PQgetCopyData(conn_, buf, 1);
             if (rc > 0) {
-                out.value.resize(static_cast<size_t>(rc));
-                std::memcpy(out.value.data(), buf, static_cast<size_t>(rc));
-                PQfreemem(buf);
                 out.ok = true;
+                out.value = rc;
                 co_return out;
             }
             if (rc == 0) {
                 co_await wait_readable();
+                if (PQconsumeInput(conn_) == 0) {
+                    out.ok = false;
+                    out.err.code = PgErrorCode::SocketReadFailed;
+                    out.err.message = PQerrorMessage(conn_);
+                    connected_ = false;
+                    co_return out;
+                }
                 continue;
             }
 
@@ -441,7 +653,7 @@ namespace usub::pg {
                 if (PQresultStatus(res) == PGRES_COMMAND_OK) {
                     PQclear(res);
                     out.ok = true;
-                    out.value.clear();
+                    out.value = 0;
                     co_return out;
                 }
 
@@ -462,6 +674,38 @@ namespace usub::pg {
         }
     }
 
+    usub::uvent::task::Awaitable<PgWireResult<std::vector<uint8_t> > >
+    PgConnectionLibpq::copy_out_read_chunk() {
+        PgWireResult<std::vector<uint8_t> > out{};
+
+        char *buf = nullptr;
+        PgWireResult<int> r = co_await copy_out_fetch(&buf);
+        out.ok = r.ok;
+        out.err = std::move(r.err);
+        if (r.ok && r.value > 0) {
+            out.value.resize(static_cast<size_t>(r.value));
+            std::memcpy(out.value.data(), buf, static_cast<size_t>(r.value));
+        }
+        if (buf) PQfreemem(buf);
+        co_return out;
+    }
+
+    usub::uvent::task::Awaitable<PgWireResult<bool> >
+    PgConnectionLibpq::copy_out_read_append(std::string &dst) {
+        PgWireResult<bool> out{};
+
+        char *buf = nullptr;
+        PgWireResult<int> r = co_await copy_out_fetch(&buf);
+        out.ok = r.ok;
+        out.err = std::move(r.err);
+        if (r.ok && r.value > 0) {
+            dst.append(buf, static_cast<size_t>(r.value));
+            out.value = true;
+        }
+        if (buf) PQfreemem(buf);
+        co_return out;
+    }
+
     std::string PgConnectionLibpq::make_cursor_name() {
         const uint64_t seq = ++cursor_seq_;
         char buf[64];
@@ -561,6 +805,881 @@ namespace usub::pg {
         co_return final;
     }
 
+    // ---- single-row / chunked streaming ----
+
+    static bool is_stream_rows(ExecStatusType st) noexcept {
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        if (st == PGRES_TUPLES_CHUNK) return true;
+#endif
+        return st == PGRES_SINGLE_TUPLE || st == PGRES_TUPLES_OK;
+    }
+
+    usub::uvent::task::Awaitable<PgCursorChunk>
+    PgConnectionLibpq::stream_fetch_chunk(uint32_t max_rows) {
+        PgCursorChunk out{};
+        out.ok = true;
+        out.code = PgErrorCode::OK;
+
+        if (!stream_active_) {
+            out.done = true;
+            co_return out;
+        }
+
+        if (!connected()) {
+            stream_active_ = false;
+            out.ok = false;
+            out.code = PgErrorCode::ConnectionClosed;
+            out.error = "connection not OK";
+            out.done = true;
+            co_return out;
+        }
+
+        if (max_rows == 0) max_rows = 1;
+        out.rows.reserve(max_rows);
+
+        while (out.rows.size() < max_rows) {
+            // a chunk can hold more rows than fit; the rest wait for the next call
+            if (stream_res_) {
+                take_stream_rows(out, max_rows);
+                continue;
+            }
+
+            // Only read from the socket when libpq has no complete row buffered;
+            // the kernel buffer and TCP window provide the backpressure.
+            if (PQisBusy(conn_)) {
+                if (!out.rows.empty())
+                    break;
+
+                if (PQconsumeInput(conn_) == 0) {
+                    out.ok = false;
+                    out.code = PgErrorCode::SocketReadFailed;
+                    out.error = PQerrorMessage(conn_);
+                    out.done = true;
+                    connected_ = false;
+                    stream_active_ = false;
+                    co_return out;
+                }
+
+                if (PQisBusy(conn_)) {
+                    co_await wait_readable();
+                    continue;
+                }
+            }
+
+            PGresult *res = PQgetResult(conn_);
+            if (!res) {
+                stream_active_ = false;
+                out.done = true;
+                break;
+            }
+
+            const auto st = PQresultStatus(res);
+            if (is_stream_rows(st)) {
+                // the final TUPLES_OK is empty in single-row / chunked mode; it
+                // carries all rows only if the mode was refused
+                stream_res_ = res;
+                stream_res_row_ = 0;
+                continue;
+            }
+            if (st != PGRES_COMMAND_OK) {
+                // keep the rows already delivered; the stream ends after the error
+                fill_server_error_fields_cursor(res, out);
+            }
+            PQclear(res);
+        }
+
+        co_return out;
+    }
+
+    void PgConnectionLibpq::take_stream_rows(PgCursorChunk &out, uint32_t max_rows) {
+        PGresult *res = stream_res_;
+        const int ncols = PQnfields(res);
+        if (out.columns.empty()) {
+            out.columns.reserve(ncols);
+            out.column_oids.reserve(ncols);
+            for (int c = 0; c < ncols; ++c) {
+                const char *nm = PQfname(res, c);
+                out.columns.emplace_back(nm ? nm : "");
+                out.column_oids.push_back(static_cast<uint32_t>(PQftype(res, c)));
+            }
+            out.binary = PQbinaryTuples(res) != 0;
+        }
+
+        const int nrows = PQntuples(res);
+        int r = stream_res_row_;
+        for (; r < nrows && out.rows.size() < max_rows; ++r) {
+            QueryResult::Row row;
+            row.cols.reserve(ncols);
+            for (int c = 0; c < ncols; ++c) {
+                if (PQgetisnull(res, r, c)) {
+                    row.cols.emplace_back();
+                } else {
+                    const char *v = PQgetvalue(res, r, c);
+                    const int len = PQgetlength(res, r, c);
+                    row.cols.emplace_back(v, static_cast<size_t>(len));
+                }
+            }
+            out.rows.emplace_back(std::move(row));
+        }
+
+        stream_res_row_ = r;
+        if (r >= nrows) {
+            PQclear(res);
+            stream_res_ = nullptr;
+            stream_res_row_ = 0;
+        }
+    }
+
+    usub::uvent::task::Awaitable<QueryResult> PgConnectionLibpq::stream_close() {
+        QueryResult out{};
+        out.ok = true;
+        out.code = PgErrorCode::OK;
+
+        while (stream_active_) {
+            PgCursorChunk ch = co_await stream_fetch_chunk(1024);
+            if (!ch.ok) {
+                out.ok = false;
+                out.code = ch.code;
+                out.error = std::move(ch.error);
+                out.err_detail = std::move(ch.err_detail);
+                out.rows_valid = false;
+            }
+        }
+        co_return out;
+    }
+
+    bool PgConnectionLibpq::streaming() const noexcept {
+        return stream_active_;
+    }
+
+    void PgConnectionLibpq::set_stream_chunk_rows(int rows) noexcept {
+        stream_chunk_rows_ = rows > 0 ? rows : 1;
+    }
+
+    // ---- zero-copy results ----
+
+    usub::uvent::task::Awaitable<QueryResultView> PgConnectionLibpq::collect_result_view() {
+        QueryResultView out;
+        out.ok = false;
+        out.code = PgErrorCode::Unknown;
+
+        if (!(co_await flush_outgoing()) || !(co_await pump_input())) {
+            out.code = PgErrorCode::SocketReadFailed;
+            out.error = PQerrorMessage(conn_);
+            out.rows_valid = false;
+            connected_ = false;
+            co_return out;
+        }
+
+        bool failed = false;
+        while (PGresult *res = PQgetResult(conn_)) {
+            const auto st = PQresultStatus(res);
+            if (failed) {
+                PQclear(res);
+                continue;
+            }
+
+            if (st == PGRES_TUPLES_OK) {
+                out.adopt(res);
+                out.ok = true;
+                out.code = PgErrorCode::OK;
+            } else if (st == PGRES_COMMAND_OK) {
+                out.ok = true;
+                out.code = PgErrorCode::OK;
+                out.rows_affected += extract_rows_affected(res);
+                PQclear(res);
+            } else {
+                QueryResult tmp;
+                fill_server_error_fields(res, tmp);
+                PQclear(res);
+                out.ok = false;
+                out.code = tmp.code;
+                out.error = std::move(tmp.error);
+                out.err_detail = std::move(tmp.err_detail);
+                out.rows_valid = false;
+                failed = true;
+            }
+        }
+
+        co_return out;
+    }
+
+    // ---- pipeline ----
+
+    static void collect_pipeline_result(PGresult *res, QueryResult &out, uint64_t &bytes_in) {
+        const auto st = PQresultStatus(res);
+        if (st == PGRES_TUPLES_OK) {
+            const int nrows = PQntuples(res);
+            const int ncols = PQnfields(res);
+
+            if (out.columns.empty()) {
+                out.columns.reserve(ncols);
+                out.column_oids.reserve(ncols);
+                for (int c = 0; c < ncols; ++c) {
+                    const char *nm = PQfname(res, c);
+                    out.columns.emplace_back(nm ? nm : "");
+                    out.column_oids.push_back(static_cast<uint32_t>(PQftype(res, c)));
+                }
+                out.binary = PQbinaryTuples(res) != 0;
+            }
+
+            out.rows.reserve(out.rows.size() + static_cast<size_t>(nrows));
+            for (int r = 0; r < nrows; ++r) {
+                QueryResult::Row row;
+                row.cols.reserve(ncols);
+                for (int c = 0; c < ncols; ++c) {
+                    if (PQgetisnull(res, r, c)) {
+                        row.cols.emplace_back();
+                    } else {
+                        const char *v = PQgetvalue(res, r, c);
+                        const int len = PQgetlength(res, r, c);
+                        row.cols.emplace_back(v, static_cast<size_t>(len));
+                        bytes_in += static_cast<uint64_t>(len);
+                    }
+                }
+                out.rows.emplace_back(std::move(row));
+            }
+
+            out.ok = true;
+            out.code = PgErrorCode::OK;
+            out.rows_affected += static_cast<uint64_t>(nrows);
+        } else if (st == PGRES_COMMAND_OK) {
+            out.ok = true;
+            out.code = PgErrorCode::OK;
+            out.rows_affected += extract_rows_affected(res);
+            out.rolled_back = is_rollback_tag(res);
+        } else if (st == PGRES_PIPELINE_ABORTED) {
+            out.ok = false;
+            out.code = PgErrorCode::ServerError;
+            out.error = "pipeline aborted: an earlier statement in the same sync segment failed";
+            out.rows_valid = false;
+        } else {
+            fill_server_error_fields(res, out);
+            out.rows_valid = false;
+        }
+    }
+
+    usub::uvent::task::Awaitable<std::vector<QueryResult> >
+    PgConnectionLibpq::exec_pipeline_nonblocking(PgPipeline pipeline) {
+        auto &stmts = pipeline.statements();
+
+        std::vector<QueryResult> results;
+        results.reserve(stmts.size());
+
+        // one probe per statement so each counts as a query; a statement's
+        // bytes are those decoded after its predecessor completed
+        std::vector<PgQueryProbe> probes;
+        auto complete = [&](QueryResult &&r) {
+            const size_t i = results.size();
+            if (i < probes.size()) {
+                results.emplace_back(this->finish_query(probes[i], std::move(r)));
+                if (i + 1 < probes.size()) probes[i + 1].bytes_in_at = this->bytes_in_;
+            } else {
+                results.emplace_back(std::move(r));
+            }
+        };
+
+        auto fail_rest = [&](PgErrorCode code, const std::string &msg) {
+            while (results.size() < stmts.size()) {
+                QueryResult r{};
+                r.ok = false;
+                r.code = code;
+                r.error = msg;
+                r.rows_valid = false;
+                complete(std::move(r));
+            }
+        };
+
+        if (stmts.empty())
+            co_return results;
+
+        if (!connected()) {
+            fail_rest(PgErrorCode::ConnectionClosed, "connection not OK");
+            co_return results;
+        }
+
+        probes.reserve(stmts.size());
+        for (auto &st: stmts) {
+            probes.push_back(this->begin_query(st.sql, 0));
+            probes.back().add_params(st.n_params, st.values.data(), st.lengths.data(), st.formats.data());
+        }
+
+        if (PQenterPipelineMode(conn_) != 1) {
+            fail_rest(PgErrorCode::Unknown, PQerrorMessage(conn_));
+            co_return results;
+        }
+
+        size_t pending_syncs = 0;
+        for (size_t i = 0; i < stmts.size(); ++i) {
+            auto &st = stmts[i];
+            UPQ_CONN_DBG("pipeline[%zu]: %s nParams=%d", i, st.sql.c_str(), st.n_params);
+
+            if (!PQsendQueryParams(conn_, st.sql.c_str(), st.n_params,
+                                   st.types.data(), st.values.data(),
+                                   st.lengths.data(), st.formats.data(),
+                                   static_cast<int>(result_format_))) {
+                fail_rest(PgErrorCode::SocketWriteFailed, PQerrorMessage(conn_));
+                connected_ = false;
+                co_return results;
+            }
+
+            if (st.sync_after || i + 1 == stmts.size()) {
+                if (PQpipelineSync(conn_) != 1) {
+                    fail_rest(PgErrorCode::SocketWriteFailed, PQerrorMessage(conn_));
+                    connected_ = false;
+                    co_return results;
+                }
+                ++pending_syncs;
+            }
+        }
+
+        if (!(co_await flush_outgoing_pipelined())) {
+            fail_rest(PgErrorCode::SocketWriteFailed, PQerrorMessage(conn_));
+            connected_ = false;
+            co_return results;
+        }
+        for (auto &p: probes) p.mark(p.sent);
+
+        QueryResult cur{};
+        bool have_cur = false;
+
+        while (pending_syncs > 0) {
+            if (PQconsumeInput(conn_) == 0) {
+                fail_rest(PgErrorCode::SocketReadFailed, PQerrorMessage(conn_));
+                connected_ = false;
+                co_return results;
+            }
+
+            while (pending_syncs > 0 && !PQisBusy(conn_)) {
+                PGresult *res = PQgetResult(conn_);
+                if (!res) {
+                    // NULL terminates the results of one statement
+                    if (have_cur) {
+                        if (!cur.ok) cur.rows_valid = false;
+                        complete(std::move(cur));
+                        cur = QueryResult{};
+                        have_cur = false;
+                    }
+                    continue;
+                }
+
+                if (PQresultStatus(res) == PGRES_PIPELINE_SYNC) {
+                    PQclear(res);
+                    --pending_syncs;
+                    continue;
+                }
+
+                collect_pipeline_result(res, cur, this->bytes_in_);
+                have_cur = true;
+                PQclear(res);
+            }
+
+            if (pending_syncs > 0)
+                co_await wait_readable();
+        }
+
+        if (results.size() != stmts.size())
+            fail_rest(PgErrorCode::ProtocolCorrupt, "pipeline: result count does not match statement count");
+
+        if (PQexitPipelineMode(conn_) != 1) {
+            UPQ_CONN_DBG("pipeline: exit failed: %s", PQerrorMessage(conn_));
+            connected_ = false;
+        }
+
+        co_return results;
+    }
+
+    usub::uvent::task::Awaitable<PgExecManyResult>
+    PgConnectionLibpq::execute_many_encoded(const std::string &sql, size_t count, ParamSlices &ps,
+                                            const std::function<void(size_t, ParamSlices &)> &encode,
+                                            PgExecManyOptions opts) {
+        PgExecManyResult out;
+        size_t done = 0;
+
+        auto fail_rest = [&](PgErrorCode code, const std::string &msg, const PgErrorDetail &detail = {}) {
+            for (; done < count; ++done)
+                out.errors.push_back(PgExecManyError{done, PgOpError{code, msg, detail}});
+        };
+
+        if (count == 0)
+            co_return out;
+
+        if (!connected()) {
+            fail_rest(PgErrorCode::ConnectionClosed, "connection not OK");
+            co_return out;
+        }
+
+        const size_t window = std::max<size_t>(opts.window, 1);
+        PgQueryProbe probe = this->begin_query(sql, 0);
+
+        auto reset = [&ps] {
+            *ps.idx = 0;
+            ps.arena_used = 0;
+            ps.temp_strings.clear();
+            ps.temp_bytes.clear();
+        };
+
+        // The prepared statement takes element 0's parameter types. A NULL
+        // there carries no type (OID 0, so the server would infer one), so
+        // such a slot takes the type of the first later element that has a
+        // value. Untyped text stays 0 on purpose.
+        encode(0, ps);
+        const int n_params = static_cast<int>(*ps.idx);
+        std::vector<Oid> types(ps.types, ps.types + n_params);
+        std::vector<int> open;
+        for (int p = 0; p < n_params; ++p)
+            if (!ps.values[p]) open.push_back(p);
+
+        if (!open.empty()) {
+            for (size_t i = 1; i < count && !open.empty(); ++i) {
+                reset();
+                encode(i, ps);
+                std::erase_if(open, [&](int p) {
+                    if (p >= static_cast<int>(*ps.idx) || !ps.values[p]) return false;
+                    types[p] = ps.types[p];
+                    return true;
+                });
+            }
+            reset();
+            encode(0, ps);
+        }
+
+        if (!PQsendPrepare(conn_, "", sql.c_str(), n_params, types.data())
+            || !(co_await flush_outgoing()) || !(co_await pump_input())) {
+            connected_ = false;
+            fail_rest(PgErrorCode::SocketReadFailed, PQerrorMessage(conn_));
+            co_return out;
+        }
+
+        // one round trip for the whole batch, but every element is a query
+        probe.statements = count;
+
+        QueryResult prep = drain_all_results();
+        if (!prep.ok) {
+            fail_rest(prep.code, prep.error, prep.err_detail);
+            probe.failed = count;
+            (void) this->finish_query(probe, std::move(prep));
+            co_return out;
+        }
+
+        if (PQenterPipelineMode(conn_) != 1) {
+            fail_rest(PgErrorCode::Unknown, PQerrorMessage(conn_));
+            co_return out;
+        }
+
+        size_t next = 0;
+        size_t pending_syncs = 0;
+        QueryResult cur{};
+        bool have_cur = false;
+
+        while (done < count || pending_syncs > 0) {
+            bool sent = false;
+            while (next < count && next - done < window) {
+                if (next > 0) {
+                    reset();
+                    encode(next, ps);
+                }
+                probe.add_params(n_params, ps.values, ps.lengths, ps.formats);
+
+                if (!PQsendQueryPrepared(conn_, "", n_params, ps.values, ps.lengths, ps.formats,
+                                         static_cast<int>(result_format_))) {
+                    connected_ = false;
+                    fail_rest(PgErrorCode::SocketWriteFailed, PQerrorMessage(conn_));
+                    co_return out;
+                }
+                ++next;
+
+                if (!opts.all_or_nothing || next == count) {
+                    if (PQpipelineSync(conn_) != 1) {
+                        connected_ = false;
+                        fail_rest(PgErrorCode::SocketWriteFailed, PQerrorMessage(conn_));
+                        co_return out;
+                    }
+                    ++pending_syncs;
+                }
+                sent = true;
+            }
+
+            if (sent) {
+                // without a sync the server holds its replies until asked
+                const bool flush_req = opts.all_or_nothing && next < count;
+                if ((flush_req && PQsendFlushRequest(conn_) != 1) || !(co_await flush_outgoing_pipelined())) {
+                    connected_ = false;
+                    fail_rest(PgErrorCode::SocketWriteFailed, PQerrorMessage(conn_));
+                    co_return out;
+                }
+                probe.mark(probe.sent);
+            }
+
+            if (PQconsumeInput(conn_) == 0) {
+                connected_ = false;
+                fail_rest(PgErrorCode::SocketReadFailed, PQerrorMessage(conn_));
+                co_return out;
+            }
+
+            while ((done < next || pending_syncs > 0) && !PQisBusy(conn_)) {
+                PGresult *res = PQgetResult(conn_);
+                if (!res) {
+                    if (have_cur) {
+                        if (cur.ok) {
+                            out.rows_affected += cur.rows_affected;
+                            ++out.succeeded;
+                        } else {
+                            out.errors.push_back(PgExecManyError{
+                                done, PgOpError{cur.code, std::move(cur.error), std::move(cur.err_detail)}
+                            });
+                        }
+                        ++done;
+                        cur = QueryResult{};
+                        have_cur = false;
+                    }
+                    continue;
+                }
+
+                if (PQresultStatus(res) == PGRES_PIPELINE_SYNC) {
+                    PQclear(res);
+                    --pending_syncs;
+                    continue;
+                }
+
+                collect_pipeline_result(res, cur, this->bytes_in_);
+                have_cur = true;
+                PQclear(res);
+            }
+
+            const bool can_send = next < count && next - done < window;
+            if (!can_send && (done < next || pending_syncs > 0))
+                co_await wait_readable();
+        }
+
+        if (PQexitPipelineMode(conn_) != 1) {
+            UPQ_CONN_DBG("execute_many: exit failed: %s", PQerrorMessage(conn_));
+            connected_ = false;
+        }
+
+        probe.mark(probe.server);
+        QueryResult summary{};
+        summary.ok = out.errors.empty();
+        summary.code = summary.ok ? PgErrorCode::OK : out.errors.front().error.code;
+        summary.rows_affected = out.rows_affected;
+        probe.failed = out.errors.size();
+        (void) this->finish_query(probe, std::move(summary));
+
+        // a failed all-or-nothing batch changed nothing
+        if (opts.all_or_nothing && !out.errors.empty()) {
+            out.rows_affected = 0;
+            out.succeeded = 0;
+        }
+        co_return out;
+    }
+
+    // ---- prepared statement cache ----
+
+    void PgConnectionLibpq::set_statement_cache_capacity(size_t capacity, PgStatementCacheStats *shared) {
+        for (auto &name: stmt_cache_.set_capacity(capacity, shared))
+            pending_deallocate_.push_back(std::move(name));
+    }
+
+    usub::uvent::task::Awaitable<bool> PgConnectionLibpq::flush_deallocations() {
+        if (pending_deallocate_.empty() || PQtransactionStatus(conn_) != PQTRANS_IDLE)
+            co_return connected();
+
+        // one query each: in a multi-statement string a name the server
+        // already dropped (DISCARD ALL) would abort the ones after it
+        std::vector<std::string> names = std::move(pending_deallocate_);
+        pending_deallocate_.clear();
+        for (const auto &name: names) {
+            (void) co_await exec_simple_query_nonblocking("DEALLOCATE " + name);
+            if (!connected()) co_return false;
+        }
+        co_return true;
+    }
+
+    const PgStatementCache &PgConnectionLibpq::statement_cache() const noexcept {
+        return stmt_cache_;
+    }
+
+    void PgConnectionLibpq::set_result_format(PgResultFormat fmt) noexcept {
+        result_format_ = fmt;
+    }
+
+    PgResultFormat PgConnectionLibpq::result_format() const noexcept {
+        return result_format_;
+    }
+
+    static bool is_stale_prepared_error(const QueryResult &qr) {
+        if (qr.ok) return false;
+        // 26000 invalid_sql_statement_name: statement vanished (DISCARD ALL, pooler)
+        if (qr.err_detail.sqlstate == "26000") return true;
+        // "cached plan must not change result type": 0A000 is shared with every
+        // other feature_not_supported error and the message follows lc_messages,
+        // so tell it apart by the raising function
+        return qr.err_detail.sqlstate == "0A000" && qr.err_detail.routine == "RevalidateCachedQuery";
+    }
+
+    usub::uvent::task::Awaitable<QueryResult>
+    PgConnectionLibpq::exec_prepared_cached(const std::string &sql, int n_params, const Oid *types,
+                                            const char *const *values, const int *lengths,
+                                            const int *formats, PgQueryProbe &probe) {
+        QueryResult fail{};
+        fail.ok = false;
+        fail.code = PgErrorCode::SocketReadFailed;
+        fail.rows_valid = false;
+
+        const uint64_t key = PgStatementCache::make_key(sql, types, n_params);
+
+        for (int attempt = 0;; ++attempt) {
+            const PgStatementCache::Entry *entry = stmt_cache_.find(key, sql, types, n_params);
+
+            if (!entry) {
+                while (stmt_cache_.full()) {
+                    auto victim = stmt_cache_.evict_lru();
+                    if (!victim) break;
+                    pending_deallocate_.push_back(std::move(*victim));
+                }
+                if (!(co_await flush_deallocations())) {
+                    fail.error = PQerrorMessage(conn_);
+                    co_return fail;
+                }
+
+                std::string name = stmt_cache_.next_name();
+                UPQ_CONN_DBG("stmt-cache miss: prepare %s", name.c_str());
+
+                if (!PQsendPrepare(conn_, name.c_str(), sql.c_str(), n_params, types)) {
+                    fail.error = PQerrorMessage(conn_);
+                    connected_ = false;
+                    co_return fail;
+                }
+
+                if (!(co_await flush_outgoing()) || !(co_await pump_input())) {
+                    fail.error = PQerrorMessage(conn_);
+                    connected_ = false;
+                    co_return fail;
+                }
+
+                QueryResult prep = drain_all_results();
+                if (!prep.ok) co_return prep;
+
+                entry = &stmt_cache_.insert(key, sql, types, n_params, std::move(name));
+            }
+
+            if (!PQsendQueryPrepared(conn_, entry->name.c_str(), n_params,
+                                     values, lengths, formats, static_cast<int>(result_format_))) {
+                fail.error = PQerrorMessage(conn_);
+                connected_ = false;
+                co_return fail;
+            }
+
+            const bool flushed = co_await flush_outgoing();
+            probe.mark(probe.sent);
+            if (!flushed || !(co_await pump_input())) {
+                fail.error = PQerrorMessage(conn_);
+                connected_ = false;
+                co_return fail;
+            }
+            probe.mark(probe.server);
+
+            QueryResult out = drain_all_results();
+
+            if (attempt == 0 && is_stale_prepared_error(out)) {
+                const bool gone = out.err_detail.sqlstate == "26000";
+                auto stale = stmt_cache_.invalidate(key);
+                UPQ_CONN_DBG("stmt-cache invalidate: %s", out.error.c_str());
+
+                if (stale && !gone) pending_deallocate_.push_back(std::move(*stale));
+
+                // inside a transaction the error already aborted it; retrying is pointless
+                if (PQtransactionStatus(conn_) == PQTRANS_IDLE) {
+                    if (!(co_await flush_deallocations())) co_return out;
+                    continue;
+                }
+            }
+
+            co_return out;
+        }
+    }
+
+    usub::uvent::task::Awaitable<QueryResult>
+    PgConnectionLibpq::exec_prepared_named(const char *name, const char *sql, uint64_t key, int n_params,
+                                           const Oid *types, const char *const *values, const int *lengths,
+                                           const int *formats) {
+        QueryResult fail{};
+        fail.ok = false;
+        fail.code = PgErrorCode::SocketReadFailed;
+        fail.rows_valid = false;
+
+        if (!connected()) {
+            fail.code = PgErrorCode::ConnectionClosed;
+            fail.error = "connection not OK";
+            co_return fail;
+        }
+
+        PgQueryProbe probe = this->begin_query(sql, key);
+        probe.add_params(n_params, values, lengths, formats);
+
+        for (int attempt = 0;; ++attempt) {
+            if (!named_prepared_.contains(key)) {
+                UPQ_CONN_DBG("named statement: prepare %s", name);
+
+                if (!PQsendPrepare(conn_, name, sql, n_params, types)) {
+                    fail.error = PQerrorMessage(conn_);
+                    connected_ = false;
+                    co_return this->finish_query(probe, std::move(fail));
+                }
+
+                if (!(co_await flush_outgoing()) || !(co_await pump_input())) {
+                    fail.error = PQerrorMessage(conn_);
+                    connected_ = false;
+                    co_return this->finish_query(probe, std::move(fail));
+                }
+
+                QueryResult prep = drain_all_results();
+                if (!prep.ok) {
+                    // 42P05 duplicate_prepared_statement: left over from a stale plan
+                    // that could not be deallocated inside a transaction
+                    if (attempt == 0 && prep.err_detail.sqlstate == "42P05"
+                        && PQtransactionStatus(conn_) == PQTRANS_IDLE) {
+                        (void) co_await exec_simple_query_nonblocking(std::string("DEALLOCATE ") + name);
+                        if (!connected()) co_return this->finish_query(probe, std::move(prep));
+                        continue;
+                    }
+                    co_return this->finish_query(probe, std::move(prep));
+                }
+
+                named_prepared_.insert(key);
+            }
+
+            if (!PQsendQueryPrepared(conn_, name, n_params,
+                                     values, lengths, formats, static_cast<int>(result_format_))) {
+                fail.error = PQerrorMessage(conn_);
+                connected_ = false;
+                co_return this->finish_query(probe, std::move(fail));
+            }
+
+            const bool flushed = co_await flush_outgoing();
+            probe.mark(probe.sent);
+            if (!flushed || !(co_await pump_input())) {
+                fail.error = PQerrorMessage(conn_);
+                connected_ = false;
+                co_return this->finish_query(probe, std::move(fail));
+            }
+            probe.mark(probe.server);
+
+            QueryResult out = drain_all_results();
+
+            if (attempt == 0 && is_stale_prepared_error(out)) {
+                const bool gone = out.err_detail.sqlstate == "26000";
+                named_prepared_.erase(key);
+                UPQ_CONN_DBG("named statement %s invalidated: %s", name, out.error.c_str());
+
+                if (PQtransactionStatus(conn_) == PQTRANS_IDLE) {
+                    if (!gone)
+                        (void) co_await exec_simple_query_nonblocking(std::string("DEALLOCATE ") + name);
+                    if (!connected()) co_return this->finish_query(probe, std::move(out));
+                    continue;
+                }
+            }
+
+            co_return this->finish_query(probe, std::move(out));
+        }
+    }
+
+    PgQueryProbe PgConnectionLibpq::begin_query(std::string_view sql, uint64_t fingerprint) noexcept {
+        PgQueryProbe p;
+        if (this->span_held_) this->trace_flush();
+
+        p.traced = this->trace_ && this->trace_->sample();
+        p.defer_map = p.traced && this->trace_defer_map_;
+        this->trace_defer_map_ = false;
+        if (!p.traced && !this->latency_ewma_ && !PgStatsRegistry::instance().enabled()) return p;
+
+        p.active = true;
+        p.sql = sql;
+        p.fingerprint = fingerprint ? fingerprint : detail::stats_fingerprint(sql);
+        p.bytes_out = sql.size();
+        p.bytes_in_at = this->bytes_in_;
+        p.t0 = std::chrono::steady_clock::now();
+        return p;
+    }
+
+    QueryResult PgConnectionLibpq::finish_query(PgQueryProbe &probe, QueryResult &&r) noexcept {
+        if (!probe.active) return std::move(r);
+
+        const auto now = std::chrono::steady_clock::now();
+        // the decoders count cell bytes as they copy them
+        const uint64_t bytes_in = this->bytes_in_ - probe.bytes_in_at;
+
+        PgStatsRegistry::instance().record_query(this->stats_scope_, probe.fingerprint, probe.sql,
+                                                 now - probe.t0, r, probe.bytes_out, bytes_in,
+                                                 probe.statements, probe.failed);
+        if (this->latency_ewma_)
+            this->latency_ewma_->observe(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - probe.t0).count()));
+        if (!probe.traced) return std::move(r);
+
+        PgTraceSpan span;
+        span.connection_id = this->id_;
+        span.node = this->trace_->node;
+        span.sql = probe.sql;
+        span.fingerprint = probe.fingerprint;
+        span.start = probe.t0;
+        span.encoded = probe.encoded;
+        span.sent = probe.sent;
+        span.server = probe.server;
+        span.decoded = now;
+        span.rows = r.rows.size();
+        span.bytes_out = probe.bytes_out;
+        span.bytes_in = bytes_in;
+        span.ok = r.ok;
+        span.code = r.code;
+        span.sqlstate = r.err_detail.sqlstate;
+
+        if (!probe.defer_map) {
+            this->emit_span(span);
+            return std::move(r);
+        }
+
+        // views into the caller's SQL and result die before mapping ends
+        try {
+            this->held_sql_.assign(probe.sql);
+            this->held_sql_.push_back('\0');
+            this->held_sql_.append(r.err_detail.sqlstate);
+        } catch (...) {
+            this->emit_span(span);
+            return std::move(r);
+        }
+        span.sql = std::string_view(this->held_sql_.data(), probe.sql.size());
+        span.sqlstate = std::string_view(this->held_sql_).substr(probe.sql.size() + 1);
+        this->held_span_ = span;
+        this->span_held_ = true;
+        return std::move(r);
+    }
+
+    void PgConnectionLibpq::emit_span(PgTraceSpan &span) noexcept {
+        if (this->trace_ && this->trace_->sink)
+            this->trace_->sink->on_span(span);
+    }
+
+    void PgConnectionLibpq::set_trace(std::shared_ptr<const PgTraceConfig> cfg) noexcept {
+        if (this->trace_ == cfg) return;
+        if (this->span_held_) this->trace_flush();
+        this->trace_ = std::move(cfg);
+    }
+
+    void PgConnectionLibpq::trace_mapped() noexcept {
+        this->trace_defer_map_ = false;
+        if (!this->span_held_) return;
+        this->held_span_.mapped = std::chrono::steady_clock::now();
+        this->trace_flush();
+    }
+
+    void PgConnectionLibpq::trace_flush() noexcept {
+        this->trace_defer_map_ = false;
+        if (!this->span_held_) return;
+        this->span_held_ = false;
+        this->emit_span(this->held_span_);
+    }
+
     PGconn *PgConnectionLibpq::raw_conn() noexcept { return conn_; }
 
     bool PgConnectionLibpq::is_idle() {
@@ -575,6 +1694,15 @@ namespace usub::pg {
         UPQ_CONN_DBG("close: conn=%p connected=%d", static_cast<void*>(conn_), connected_ ? 1 : 0);
 
         this->connected_ = false;
+        this->stmt_cache_.clear();
+        this->named_prepared_.clear();
+        this->pending_deallocate_.clear();
+        this->stream_active_ = false;
+        if (this->stream_res_) PQclear(this->stream_res_);
+        this->stream_res_ = nullptr;
+        this->stream_res_row_ = 0;
+        this->cancel_.reset();
+        this->io_wait_.reset();
 
         if (this->sock_) {
             this->sock_->shutdown();
@@ -587,6 +1715,159 @@ namespace usub::pg {
         }
     }
 
+    // ---- per-query deadlines ----
+    namespace detail {
+        // Cancel request for one backend. libpq 17 sends it without blocking
+        // (PQcancelStart + PQcancelPoll); older versions only have the
+        // blocking PQcancel, which holds the worker thread for one round trip.
+        struct PgCancelHandle {
+#ifdef LIBPQ_HAS_ASYNC_CANCEL
+            PGcancelConn *cc{nullptr};
+            bool used{false};
+
+            ~PgCancelHandle() {
+                if (this->cc) PQcancelFinish(this->cc);
+            }
+#else
+            PGcancel *c{nullptr};
+
+            ~PgCancelHandle() {
+                if (this->c) PQfreeCancel(this->c);
+            }
+#endif
+        };
+
+        enum class DeadlinePhase : uint8_t { Running, Done, Canceling, Killed };
+
+        struct PgDeadlineState {
+            std::atomic<DeadlinePhase> phase{DeadlinePhase::Running};
+            // the watchdog waits here; released by a deadline_timer and by
+            // disarm_deadline, whichever comes first
+            usub::uvent::sync::AsyncSemaphore wake{0};
+            // released once the watchdog's cancel request has completed
+            usub::uvent::sync::AsyncSemaphore cancel_done{0};
+            std::shared_ptr<PgCancelHandle> cancel;
+            int fd{-1};
+            PgQueryOptions opts;
+        };
+    } // namespace detail
+
+    namespace {
+        using namespace std::chrono_literals;
+
+        usub::uvent::task::Awaitable<bool> send_cancel(detail::PgCancelHandle &h,
+                                                       std::chrono::milliseconds budget) {
+#ifdef LIBPQ_HAS_ASYNC_CANCEL
+            if (!h.cc) co_return false;
+            if (h.used) PQcancelReset(h.cc);
+            h.used = true;
+            if (!PQcancelStart(h.cc)) co_return false;
+
+            const auto deadline = std::chrono::steady_clock::now() + budget;
+            for (;;) {
+                const auto st = PQcancelPoll(h.cc);
+                if (st == PGRES_POLLING_OK) co_return true;
+                if (st == PGRES_POLLING_FAILED || std::chrono::steady_clock::now() >= deadline) co_return false;
+                co_await usub::uvent::system::this_coroutine::sleep_for(1ms);
+            }
+#else
+            (void) budget;
+            char errbuf[256];
+            co_return h.c && PQcancel(h.c, errbuf, sizeof(errbuf)) == 1;
+#endif
+        }
+
+        // uvent sleeps cannot be cancelled, so the sleep lives in this helper:
+        // it holds only a weak_ptr, and the state is gone once the statement
+        // is disarmed and its watchdog has returned.
+        usub::uvent::task::Awaitable<void> deadline_timer(std::weak_ptr<detail::PgDeadlineState> w,
+                                                          std::chrono::milliseconds after) {
+            co_await usub::uvent::system::this_coroutine::sleep_for(after);
+            if (auto st = w.lock()) st->wake.release();
+        }
+
+        usub::uvent::task::Awaitable<void> deadline_watchdog(std::shared_ptr<detail::PgDeadlineState> st) {
+            using detail::DeadlinePhase;
+            usub::uvent::system::co_spawn(deadline_timer(st, st->opts.timeout));
+            co_await st->wake.acquire();
+
+            // disarm_deadline got here first
+            auto expected = DeadlinePhase::Running;
+            if (!st->phase.compare_exchange_strong(expected, DeadlinePhase::Canceling, std::memory_order_acq_rel))
+                co_return;
+
+            const bool sent = co_await send_cancel(*st->cancel, st->opts.cancel_grace);
+            st->cancel_done.release();
+
+            // the server answers a delivered cancel with 57014, and the
+            // disarm that follows wakes us; if that never arrives within the
+            // grace, wake the reader by shutting the socket down
+            if (sent) {
+                usub::uvent::system::co_spawn(deadline_timer(st, st->opts.cancel_grace));
+                co_await st->wake.acquire();
+            }
+            expected = DeadlinePhase::Canceling;
+            if (st->phase.compare_exchange_strong(expected, DeadlinePhase::Killed, std::memory_order_acq_rel))
+                ::shutdown(st->fd, SHUT_RDWR);
+        }
+    } // namespace
+
+    PgQueryDeadline PgConnectionLibpq::arm_deadline(const PgQueryOptions &opts) {
+        PgQueryDeadline dl;
+        if (opts.timeout.count() <= 0 || !this->connected()) return dl;
+
+        if (!this->cancel_) {
+            auto h = std::make_shared<detail::PgCancelHandle>();
+#ifdef LIBPQ_HAS_ASYNC_CANCEL
+            h->cc = PQcancelCreate(this->conn_);
+#else
+            h->c = PQgetCancel(this->conn_);
+#endif
+            this->cancel_ = std::move(h);
+        }
+
+        dl.state = std::make_shared<detail::PgDeadlineState>();
+        dl.state->cancel = this->cancel_;
+        dl.state->fd = PQsocket(this->conn_);
+        dl.state->opts = opts;
+        usub::uvent::system::co_spawn(deadline_watchdog(dl.state));
+        return dl;
+    }
+
+    usub::uvent::task::Awaitable<void> PgConnectionLibpq::disarm_deadline(PgQueryDeadline &dl, QueryResult &r) {
+        using detail::DeadlinePhase;
+        auto st = std::move(dl.state);
+        if (!st) co_return;
+
+        auto expected = DeadlinePhase::Running;
+        if (st->phase.compare_exchange_strong(expected, DeadlinePhase::Done, std::memory_order_acq_rel)) {
+            st->wake.release();
+            co_return;
+        }
+
+        // the watchdog fired: let its cancel request finish first
+        co_await st->cancel_done.acquire();
+
+        expected = DeadlinePhase::Canceling;
+        const bool killed = !st->phase.compare_exchange_strong(expected, DeadlinePhase::Done,
+                                                               std::memory_order_acq_rel);
+        if (!killed) st->wake.release();  // ends the watchdog's grace wait
+        const std::string budget = std::to_string(st->opts.timeout.count()) + " ms";
+
+        if (killed) {
+            // the socket is gone even if a result made it out before
+            this->connected_ = false;
+            r.ok = false;
+            r.code = PgErrorCode::QueryTimeout;
+            r.error = "query timeout after " + budget + "; cancel not answered, connection closed";
+            r.rows_valid = false;
+        } else if (!r.ok && r.code == PgErrorCode::QueryCanceled) {
+            r.code = PgErrorCode::QueryTimeout;
+            r.error = "query timeout after " + budget + ": " + r.error;
+        }
+        // a statement that finished before the cancel landed keeps its result
+    }
+
     usub::pg::QueryResult PgConnectionLibpq::drain_all_results() {
         QueryResult final_out;
         final_out.ok = true;
@@ -603,10 +1884,13 @@ namespace usub::pg {
                 const int ncols = PQnfields(res);
 
                 tmp.columns.reserve(ncols);
+                tmp.column_oids.reserve(ncols);
                 for (int c = 0; c < ncols; ++c) {
                     const char *nm = PQfname(res, c);
                     tmp.columns.emplace_back(nm ? nm : "");
+                    tmp.column_oids.push_back(static_cast<uint32_t>(PQftype(res, c)));
                 }
+                tmp.binary = PQbinaryTuples(res) != 0;
 
 #if UPQ_REFLECT_DEBUG
                 {
@@ -630,6 +1914,7 @@ namespace usub::pg {
                             const char *v = PQgetvalue(res, r, c);
                             const int len = PQgetlength(res, r, c);
                             row.cols.emplace_back(v, static_cast<size_t>(len));
+                            this->bytes_in_ += static_cast<uint64_t>(len);
                         }
                     }
                     tmp.rows.emplace_back(std::move(row));
@@ -643,6 +1928,7 @@ namespace usub::pg {
                 tmp.ok = true;
                 tmp.code = PgErrorCode::OK;
                 tmp.rows_affected = extract_rows_affected(res);
+                tmp.rolled_back = is_rollback_tag(res);
             } else {
                 fill_server_error_fields(res, tmp);
             }
@@ -652,9 +1938,13 @@ namespace usub::pg {
                 final_out = std::move(tmp);
             } else {
                 final_out.rows_affected += tmp.rows_affected;
+                final_out.rolled_back = final_out.rolled_back || tmp.rolled_back;
 
-                if (final_out.columns.empty() && !tmp.columns.empty())
+                if (final_out.columns.empty() && !tmp.columns.empty()) {
                     final_out.columns = tmp.columns;
+                    final_out.column_oids = tmp.column_oids;
+                    final_out.binary = tmp.binary;
+                }
 
                 if (tmp.rows_valid && !tmp.rows.empty()) {
                     final_out.rows.reserve(final_out.rows.size() + tmp.rows.size());
@@ -683,7 +1973,7 @@ namespace usub::pg {
                 if (const char *aff = PQcmdTuples(res); aff && *aff)
                     tmp.rows_affected = std::strtoull(aff, nullptr, 10);
             } else {
-                fill_server_error_fields(res, reinterpret_cast<QueryResult &>(tmp));
+                fill_server_error_fields_copy(res, tmp);
             }
             PQclear(res);
 
@@ -722,14 +2012,13 @@ namespace usub::pg {
                 out.code = PgErrorCode::OK;
                 out.done = true;
             } else {
-                fill_server_error_fields(res, reinterpret_cast<QueryResult &>(out));
-                out.done = true;
+                fill_server_error_fields_cursor(res, out);
             }
             PQclear(res);
 
             if (PGresult *leftover = PQgetResult(conn_)) {
                 PgCursorChunk err{};
-                fill_server_error_fields(leftover, reinterpret_cast<QueryResult &>(err));
+                fill_server_error_fields_cursor(leftover, err);
                 PQclear(leftover);
                 return err;
             }
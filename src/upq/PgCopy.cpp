@@ -0,0 +1,154 @@
+#include "upq/PgCopy.h"
+#include "upq/PgPool.h"
+
+#include <utility>
+
+namespace usub::pg {
+    PgCopyInWriter::PgCopyInWriter(PgPool *pool, std::shared_ptr<PgConnectionLibpq> conn, size_t chunk_bytes)
+        : pool_(pool)
+          , conn_(std::move(conn))
+          , chunk_bytes_(chunk_bytes ? chunk_bytes : default_chunk_bytes) {
+        // headroom for the row that crosses the threshold
+        this->buf_.reserve(this->chunk_bytes_ + this->chunk_bytes_ / 4);
+        detail::copy_binary_header(this->buf_);
+    }
+
+    PgCopyInWriter::PgCopyInWriter(PgCopyInWriter &&o) noexcept
+        : pool_(std::exchange(o.pool_, nullptr))
+          , conn_(std::move(o.conn_))
+          , chunk_bytes_(o.chunk_bytes_)
+          , buf_(std::move(o.buf_)) {
+    }
+
+    PgCopyInWriter &PgCopyInWriter::operator=(PgCopyInWriter &&o) noexcept {
+        if (this != &o) {
+            this->release();
+            this->pool_ = std::exchange(o.pool_, nullptr);
+            this->conn_ = std::move(o.conn_);
+            this->chunk_bytes_ = o.chunk_bytes_;
+            this->buf_ = std::move(o.buf_);
+        }
+        return *this;
+    }
+
+    PgCopyInWriter::~PgCopyInWriter() {
+        this->release();
+    }
+
+    void PgCopyInWriter::release() noexcept {
+        if (!this->conn_)
+            return;
+        if (this->pool_)
+            this->pool_->release_connection(std::move(this->conn_));
+        this->conn_.reset();
+    }
+
+    usub::uvent::task::Awaitable<std::optional<PgOpError> > PgCopyInWriter::flush() {
+        if (!this->conn_)
+            co_return PgOpError{PgErrorCode::InvalidFuture, "COPY writer is not active", {}};
+
+        if (this->buf_.empty())
+            co_return std::nullopt;
+
+        PgCopyResult r = co_await this->conn_->copy_in_send_chunk(this->buf_.data(), this->buf_.size());
+        this->buf_.clear();
+        if (!r.ok) {
+            PgOpError e{r.code, std::move(r.error), std::move(r.err_detail)};
+            this->release();
+            co_return e;
+        }
+        co_return std::nullopt;
+    }
+
+    usub::uvent::task::Awaitable<std::expected<uint64_t, PgOpError> > PgCopyInWriter::finish() {
+        if (!this->conn_)
+            co_return std::unexpected(PgOpError{PgErrorCode::InvalidFuture, "COPY writer is not active", {}});
+
+        detail::copy_binary_trailer(this->buf_);
+        if (auto e = co_await this->flush())
+            co_return std::unexpected(std::move(*e));
+
+        auto conn = std::move(this->conn_);
+        PgCopyResult r = co_await conn->copy_in_finish();
+
+        if (!conn->connected()) {
+            this->pool_->mark_dead(conn);
+        } else {
+            co_await this->pool_->release_connection_async(std::move(conn));
+        }
+
+        if (!r.ok)
+            co_return std::unexpected(PgOpError{r.code, std::move(r.error), std::move(r.err_detail)});
+        co_return r.rows_affected;
+    }
+
+    PgCopyOutReader::PgCopyOutReader(PgPool *pool, std::shared_ptr<PgConnectionLibpq> conn, size_t buffer_bytes)
+        : pool_(pool)
+          , conn_(std::move(conn))
+          , finished_(false) {
+        this->buf_.reserve(buffer_bytes ? buffer_bytes : default_buffer_bytes);
+    }
+
+    PgCopyOutReader::PgCopyOutReader(PgCopyOutReader &&o) noexcept
+        : pool_(std::exchange(o.pool_, nullptr))
+          , conn_(std::move(o.conn_))
+          , buf_(std::move(o.buf_))
+          , pos_(std::exchange(o.pos_, 0))
+          , finished_(std::exchange(o.finished_, true)) {
+    }
+
+    PgCopyOutReader &PgCopyOutReader::operator=(PgCopyOutReader &&o) noexcept {
+        if (this != &o) {
+            this->release();
+            this->pool_ = std::exchange(o.pool_, nullptr);
+            this->conn_ = std::move(o.conn_);
+            this->buf_ = std::move(o.buf_);
+            this->pos_ = std::exchange(o.pos_, 0);
+            this->finished_ = std::exchange(o.finished_, true);
+        }
+        return *this;
+    }
+
+    PgCopyOutReader::~PgCopyOutReader() {
+        this->release();
+    }
+
+    void PgCopyOutReader::release() noexcept {
+        if (!this->conn_)
+            return;
+        if (this->pool_)
+            this->pool_->release_connection(std::move(this->conn_));
+        this->conn_.reset();
+        this->finished_ = true;
+    }
+
+    usub::uvent::task::Awaitable<std::optional<PgOpError> > PgCopyOutReader::fill() {
+        if (!this->conn_)
+            co_return PgOpError{PgErrorCode::InvalidFuture, "COPY reader is not active", {}};
+
+        if (this->pos_) {
+            this->buf_.erase(0, this->pos_);
+            this->pos_ = 0;
+        }
+
+        PgWireResult<bool> r = co_await this->conn_->copy_out_read_append(this->buf_);
+        if (!r.ok) {
+            PgOpError e{r.err.code, std::move(r.err.message), {}};
+            auto conn = std::move(this->conn_);
+            this->finished_ = true;
+            if (!conn->connected()) {
+                this->pool_->mark_dead(conn);
+            } else {
+                co_await this->pool_->release_connection_async(std::move(conn));
+            }
+            co_return e;
+        }
+
+        if (!r.value) {
+            this->finished_ = true;
+            auto conn = std::move(this->conn_);
+            co_await this->pool_->release_connection_async(std::move(conn));
+        }
+        co_return std::nullopt;
+    }
+} // namespace usub::pg
@@ -1,9 +1,26 @@
 #include "upq/PgPool.h"
 
+#include <atomic>
 #include <cstdlib>
+#include <iterator>
+#include <mutex>
 #include <utility>
 
 namespace usub::pg {
+    namespace {
+        // Stable small index per thread, assigned on first use; uvent workers
+        // that start first get 0..N-1 and so one shard each.
+        size_t worker_slot() noexcept {
+            static std::atomic<size_t> next{0};
+            thread_local const size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+            return slot;
+        }
+
+        // Granularity at which an acquire deadline notices that its waiter
+        // no longer needs it; bounds how long a served waiter's timer lives.
+        constexpr std::chrono::milliseconds deadline_slice{20};
+    } // namespace
+
     PgPool::PgPool(std::string host,
                    std::string port,
                    std::string user,
@@ -21,24 +38,90 @@ namespace usub::pg {
           , live_count_(0)
           , stats_{}
           , retries_on_connection_failed_(retries_on_connection_failed)
-          , idle_sem_(0), ssl_config_(std::move(ssl_config)), keepalive_config_(keepalive_config) {
+          , ssl_config_(std::move(ssl_config)), keepalive_config_(keepalive_config) {
 #if UPQ_POOL_DEBUG
         UPQ_POOL_DBG("ctor: host=%s port=%s user=%s db=%s max_pool=%zu retries=%d",
                      host_.c_str(), port_.c_str(), user_.c_str(), db_.c_str(),
                      max_pool_, retries_on_connection_failed_);
 #endif
+        auto &reg = PgStatsRegistry::instance();
+        this->stats_name_ = user_ + "@" + host_ + ":" + port_ + "/" + db_;
+        this->stats_scope_ = reg.register_scope(this->stats_name_);
+        this->stats_gauges_ = reg.register_pool_gauges(this->stats_scope_, [this] {
+            PgPoolGauges g;
+            g.live = this->live_count();
+            g.idle = this->idle_count();
+            g.waiters = this->acquire_queue_depth();
+            g.acquire_waits = this->acquire_stats_.waits.load(std::memory_order_relaxed);
+            g.acquire_timeouts = this->acquire_stats_.timeouts.load(std::memory_order_relaxed);
+            g.acquire_wait_us_total = this->acquire_stats_.wait_us_total.load(std::memory_order_relaxed);
+            g.acquire_wait_us_max = this->acquire_stats_.wait_us_max.load(std::memory_order_relaxed);
+            return g;
+        });
+    }
+
+    PgPool::~PgPool() {
+        PgStatsRegistry::instance().unregister_pool_gauges(this->stats_gauges_);
+    }
+
+    void PgPool::set_stats_name(std::string name) {
+        PgStatsRegistry::instance().rename_scope(this->stats_scope_, name);
+        std::lock_guard lk(this->trace_mu_);
+        this->stats_name_ = std::move(name);
+        if (auto cur = this->trace_.load(std::memory_order_acquire)) {
+            auto cfg = std::make_shared<PgTraceConfig>(*cur);
+            cfg->node = this->stats_name_;
+            this->trace_.store(std::move(cfg), std::memory_order_release);
+        }
     }
 
-    PgPool::~PgPool() = default;
+    void PgPool::set_trace_sink(std::shared_ptr<PgTraceSink> sink, double sample_ratio) {
+        std::lock_guard lk(this->trace_mu_);
+        if (!sink) {
+            this->tracing_.store(false, std::memory_order_release);
+            this->trace_.store(nullptr, std::memory_order_release);
+            return;
+        }
+        auto cfg = std::make_shared<PgTraceConfig>();
+        cfg->sink = std::move(sink);
+        cfg->sample_threshold = PgTraceConfig::threshold_for(sample_ratio);
+        cfg->node = this->stats_name_;
+        this->trace_.store(std::move(cfg), std::memory_order_release);
+        this->tracing_.store(true, std::memory_order_release);
+    }
 
     usub::uvent::task::Awaitable<std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError> >
     PgPool::acquire_connection() {
+        co_return co_await this->acquire_connection(PgAcquireOptions{});
+    }
+
+    usub::uvent::task::Awaitable<std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError> >
+    PgPool::acquire_connection(PgAcquireOptions opts) {
         using namespace std::chrono_literals;
 
         std::shared_ptr<PgConnectionLibpq> conn;
+        std::shared_ptr<AcquireWaiter> w;  // kept across nudges: one queue slot, one deadline
+        bool handed = false;
+        bool waited = false;
+        bool nudged = false;
+
+        // stops the deadline coroutine however this acquire ends
+        struct WaiterDone {
+            std::shared_ptr<AcquireWaiter> &w;
+
+            ~WaiterDone() {
+                if (this->w) this->w->finished.store(true, std::memory_order_release);
+            }
+        } waiter_done{w};
+
+        const auto t0 = std::chrono::steady_clock::now();
+        const auto timeout = opts.timeout.value_or(this->acquire_timeout());
+        const size_t prio = static_cast<size_t>(opts.priority) < std::size(this->wait_q_)
+                                ? static_cast<size_t>(opts.priority)
+                                : static_cast<size_t>(PgAcquirePriority::Normal);
 
         for (;;) {
-            if (this->idle_.try_dequeue(conn)) {
+            if (std::exchange(handed, false) || this->try_take_idle(conn)) {
                 stats_.checked.fetch_add(1, std::memory_order_relaxed);
 
                 if (!conn) {
@@ -57,40 +140,29 @@ namespace usub::pg {
                     continue;
                 }
 
-                if (!conn->is_idle()) {
+                if (this->expired(*conn)) {
 #if UPQ_POOL_DEBUG
-                    UPQ_POOL_DBG("acquire: got non-idle from idle queue conn=%p, trying to drain",
-                                 conn.get());
+                    UPQ_POOL_DBG("acquire: conn=%p reached max lifetime, retiring", conn.get());
 #endif
+                    mark_dead(conn);
+                    continue;
+                }
 
-                    bool pumped = co_await conn->pump_input();
-                    if (pumped) {
-                        (void) conn->drain_all_results();
-                    }
-
-                    if (!conn->connected()) {
-#if UPQ_POOL_DEBUG
-                        UPQ_POOL_DBG("acquire: conn=%p disconnected after drain, dropping",
-                                     conn.get());
-#endif
-                        mark_dead(conn);
-                        continue;
-                    }
-
-                    if (!conn->is_idle()) {
-#if UPQ_POOL_DEBUG
-                        UPQ_POOL_DBG("acquire: conn=%p still non-idle after drain, dropping",
-                                     conn.get());
-#endif
-                        mark_dead(conn);
-                        continue;
-                    }
+                if (!conn->is_idle()) {
 #if UPQ_POOL_DEBUG
-                    UPQ_POOL_DBG("acquire: conn=%p became idle after drain, reuse", conn.get());
+                    UPQ_POOL_DBG("acquire: got non-idle from idle queue conn=%p, draining in background",
+                                 conn.get());
 #endif
+                    // the drain runs on its own coroutine; it parks or retires
+                    // the connection and this caller moves on
+                    usub::uvent::system::co_spawn(this->release_connection_async(std::move(conn)));
+                    conn.reset();
+                    continue;
                 }
 
                 stats_.alive.fetch_add(1, std::memory_order_relaxed);
+                apply_connection_settings(*conn);
+                if (waited) this->record_wait(t0);
 #if UPQ_POOL_DEBUG
                 UPQ_POOL_DBG("acquire: reuse idle conn=%p", conn.get());
 #endif
@@ -111,83 +183,319 @@ namespace usub::pg {
                     UPQ_POOL_DBG("acquire: creating new conn (live=%zu -> %zu)",
                                  cur_live, cur_live + 1);
 #endif
+                    if (waited) this->record_wait(t0);
+                    co_return co_await this->open_connection(retries_on_connection_failed_);
+                }
+                continue;
+            }
 
-                    auto newConn = std::make_shared<PgConnectionLibpq>();
+            const size_t max_waiters = this->max_acquire_waiters();
+            if (max_waiters && this->waiting_.load(std::memory_order_relaxed) >= max_waiters) {
+                this->acquire_stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+                co_return std::unexpected(PgOpError{
+                    PgErrorCode::PoolQueueFull,
+                    "acquire queue is full (" + std::to_string(max_waiters) + " waiting)",
+                    {}
+                });
+            }
 
-                    auto conninfo = make_conninfo(host_, port_, user_, db_, password_, ssl_config_, this->keepalive_config_);
-                    if (!conninfo)
-                        co_return std::unexpected(PgOpError{
-                            PgErrorCode::ProtocolCorrupt, "conninfo contains NUL", {}
-                        });
+            std::chrono::milliseconds remaining{0};
+            if (timeout.count() > 0) {
+                remaining = timeout - std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - t0);
+                if (remaining.count() <= 0) {
+                    this->acquire_stats_.timeouts.fetch_add(1, std::memory_order_relaxed);
+                    co_return std::unexpected(PgOpError{
+                        PgErrorCode::PoolAcquireTimeout, "timed out waiting for a connection", {}
+                    });
+                }
+            }
+#if UPQ_POOL_DEBUG
+            UPQ_POOL_DBG("acquire: no idle and at max live=%zu, queued (prio=%zu)", cur_live, prio);
+#endif
+            // a nudged waiter that found nothing goes back to the head of
+            // its class, not behind everyone who queued while it retried
+            if (!w) w = std::make_shared<AcquireWaiter>();
+            const bool front = std::exchange(nudged, false);
+            this->enqueue_waiter(w, prio, front);
+
+            if (w->expired.load(std::memory_order_acquire) && this->cancel_waiter(*w)) {
+                this->acquire_stats_.timeouts.fetch_add(1, std::memory_order_relaxed);
+                co_return std::unexpected(PgOpError{
+                    PgErrorCode::PoolAcquireTimeout, "timed out waiting for a connection", {}
+                });
+            }
 
-                    bool connected = false;
-                    std::optional<std::string> last_err;
+            // a release that raced with the enqueue may have parked its
+            // connection without seeing us: look once more before sleeping
+            if (this->any_idle_or_capacity() && this->cancel_waiter(*w)) {
+                nudged = front;
+                continue;
+            }
 
-                    for (int attempt = 0; attempt < retries_on_connection_failed_; ++attempt) {
-                        auto err = co_await newConn->connect_async(conninfo.value());
-                        if (!err.has_value()) {
-                            connected = true;
-                            break;
-                        }
+            if (!waited) {
+                waited = true;
+                this->acquire_stats_.waits.fetch_add(1, std::memory_order_relaxed);
+                if (remaining.count() > 0)
+                    usub::uvent::system::co_spawn(acquire_deadline(w, remaining));
+            }
 
-                        last_err = err;
-#if UPQ_POOL_DEBUG
-                        UPQ_POOL_DBG("acquire: new conn=%p connect_async failed (attempt %d/%d): %s",
-                                     newConn.get(),
-                                     attempt + 1,
-                                     retries_on_connection_failed_,
-                                     err->c_str());
-#endif
+            co_await w->ready.acquire();
 
-                        if (attempt + 1 < retries_on_connection_failed_)
-                            co_await uvent::system::this_coroutine::sleep_for(100ms);
-                    }
+            if (w->state.load(std::memory_order_acquire) == AcquireWaiter::Served) {
+                // a released connection handed over directly, or a null
+                // nudge meaning "capacity freed up, try again"
+                conn = std::move(w->conn);
+                handed = conn != nullptr;
+                nudged = !handed;
+                continue;
+            }
+
+            this->waiting_.fetch_sub(1, std::memory_order_relaxed);
+            this->acquire_stats_.timeouts.fetch_add(1, std::memory_order_relaxed);
+            co_return std::unexpected(PgOpError{
+                PgErrorCode::PoolAcquireTimeout, "timed out waiting for a connection", {}
+            });
+        }
+    }
+
+    usub::uvent::task::Awaitable<void>
+    PgPool::acquire_deadline(std::shared_ptr<AcquireWaiter> w, std::chrono::milliseconds d) {
+        // sliced so an acquire that was served stops its timer within a
+        // slice instead of leaving it asleep for the full timeout
+        const auto until = std::chrono::steady_clock::now() + d;
+        for (;;) {
+            if (w->finished.load(std::memory_order_acquire))
+                co_return;
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                until - std::chrono::steady_clock::now());
+            if (left.count() <= 0)
+                break;
+            co_await usub::uvent::system::this_coroutine::sleep_for(std::min(left, deadline_slice));
+        }
 
-                    if (!connected) {
-                        stats_.reconnected.fetch_add(1, std::memory_order_relaxed);
-                        mark_dead(newConn);
-
-                        std::string msg = "Connection failed after retries";
-                        if (last_err) {
-                            msg += ": ";
-                            msg += *last_err;
-                        }
-
-                        co_return std::unexpected(PgOpError{
-                            PgErrorCode::TooManyConnections,
-                            std::move(msg),
-                            {}
-                        });
+        // a waiter between a nudge and its requeue sees expired itself
+        w->expired.store(true, std::memory_order_release);
+        uint8_t expected = AcquireWaiter::Waiting;
+        if (w->state.compare_exchange_strong(expected, AcquireWaiter::TimedOut, std::memory_order_acq_rel))
+            w->ready.release();
+    }
+
+    void PgPool::enqueue_waiter(std::shared_ptr<AcquireWaiter> const &w, size_t prio, bool front) {
+        std::lock_guard lk(this->wait_mu_);
+        auto &q = this->wait_q_[prio];
+        // timed-out entries are skipped lazily; trim them here too
+        while (!q.empty() && q.front()->state.load(std::memory_order_relaxed) != AcquireWaiter::Waiting)
+            q.pop_front();
+        if (std::exchange(w->stale, false))
+            std::erase(q, w);
+        w->conn.reset();
+        w->state.store(AcquireWaiter::Waiting, std::memory_order_release);
+        if (front)
+            q.push_front(w);
+        else
+            q.push_back(w);
+        this->waiting_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    bool PgPool::cancel_waiter(AcquireWaiter &w) {
+        uint8_t expected = AcquireWaiter::Waiting;
+        if (!w.state.compare_exchange_strong(expected, AcquireWaiter::TimedOut, std::memory_order_acq_rel))
+            return false;  // already served: the hand-off is waiting on w.ready
+        // still queued; a requeue removes the entry before adding it again
+        std::lock_guard lk(this->wait_mu_);
+        w.stale = true;
+        this->waiting_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool PgPool::serve_waiter(std::shared_ptr<PgConnectionLibpq> &conn) {
+        std::shared_ptr<AcquireWaiter> w;
+        {
+            std::lock_guard lk(this->wait_mu_);
+            for (auto &q: this->wait_q_) {
+                while (!q.empty()) {
+                    auto front = std::move(q.front());
+                    q.pop_front();
+                    uint8_t expected = AcquireWaiter::Waiting;
+                    if (front->state.compare_exchange_strong(expected, AcquireWaiter::Served,
+                                                             std::memory_order_acq_rel)) {
+                        w = std::move(front);
+                        break;
                     }
+                }
+                if (w) break;
+            }
+        }
+        if (!w)
+            return false;
+
+        this->waiting_.fetch_sub(1, std::memory_order_relaxed);
+        w->conn = std::move(conn);
+        w->ready.release();
+        return true;
+    }
+
+    void PgPool::record_wait(std::chrono::steady_clock::time_point t0) {
+        const auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count());
+        this->acquire_stats_.wait_us_total.fetch_add(us, std::memory_order_relaxed);
+        uint64_t prev = this->acquire_stats_.wait_us_max.load(std::memory_order_relaxed);
+        while (prev < us && !this->acquire_stats_.wait_us_max.compare_exchange_weak(
+                   prev, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    usub::uvent::task::Awaitable<std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError> >
+    PgPool::open_connection(int attempts) {
+        using namespace std::chrono_literals;
+
+        auto newConn = std::make_shared<PgConnectionLibpq>();
+        if (!this->shards_.empty()) {
+            const size_t home = this->local_shard();
+            newConn->set_pool_shard(static_cast<uint32_t>(home));
+            this->shards_[home]->created.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto conninfo = make_conninfo(host_, port_, user_, db_, password_, ssl_config_, this->keepalive_config_);
+        if (!conninfo) {
+            mark_dead(newConn);
+            co_return std::unexpected(PgOpError{
+                PgErrorCode::ProtocolCorrupt, "conninfo contains NUL", {}
+            });
+        }
+
+        bool connected = false;
+        std::optional<std::string> last_err;
+
+        for (int attempt = 0; attempt < attempts; ++attempt) {
+            auto err = co_await newConn->connect_async(conninfo.value());
+            if (!err.has_value()) {
+                connected = true;
+                break;
+            }
+
+            last_err = err;
 #if UPQ_POOL_DEBUG
-                    UPQ_POOL_DBG("acquire: new conn=%p ready", newConn.get());
+            UPQ_POOL_DBG("acquire: new conn=%p connect_async failed (attempt %d/%d): %s",
+                         newConn.get(),
+                         attempt + 1,
+                         attempts,
+                         err->c_str());
 #endif
-                    co_return std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError>{
-                        std::in_place, std::move(newConn)
-                    };
-                }
-                continue;
+
+            if (attempt + 1 < attempts)
+                co_await uvent::system::this_coroutine::sleep_for(100ms);
+        }
+
+        if (!connected) {
+            stats_.reconnected.fetch_add(1, std::memory_order_relaxed);
+            mark_dead(newConn);
+
+            std::string msg = "Connection failed after retries";
+            if (last_err) {
+                msg += ": ";
+                msg += *last_err;
             }
+
+            co_return std::unexpected(PgOpError{
+                PgErrorCode::TooManyConnections,
+                std::move(msg),
+                {}
+            });
+        }
 #if UPQ_POOL_DEBUG
-            UPQ_POOL_DBG("acquire: no idle and at max live=%zu, waiting on idle_sem", cur_live);
+        UPQ_POOL_DBG("acquire: new conn=%p ready", newConn.get());
 #endif
-            co_await idle_sem_.acquire();
+        apply_connection_settings(*newConn);
+        co_return std::expected<std::shared_ptr<PgConnectionLibpq>, PgOpError>{
+            std::in_place, std::move(newConn)
+        };
+    }
+
+    bool PgPool::reserve_slot() {
+        size_t cur_live = this->live_count_.load(std::memory_order_relaxed);
+        while (cur_live < this->max_pool_) {
+            if (this->live_count_.compare_exchange_weak(
+                cur_live,
+                cur_live + 1,
+                std::memory_order_acq_rel,
+                std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    bool PgPool::expired(const PgConnectionLibpq &conn) const {
+        const auto max_life = this->max_lifetime_.load(std::memory_order_relaxed);
+        if (max_life.count() <= 0)
+            return false;
+        return std::chrono::steady_clock::now() - conn.connected_at() >= max_life;
+    }
+
+    struct PgPool::PrewarmJoin {
+        std::atomic<size_t> opened{0};
+        usub::uvent::sync::AsyncSemaphore done{0};
+    };
+
+    usub::uvent::task::Awaitable<void>
+    PgPool::prewarm_one(std::shared_ptr<PrewarmJoin> join, int attempts) {
+        auto c = co_await this->open_connection(attempts);
+        if (c) {
+            auto conn = std::move(*c);
+            if (this->put_idle(conn)) {
+                join->opened.fetch_add(1, std::memory_order_relaxed);
+                this->wake_waiter();
+            } else {
+                mark_dead(conn);
+            }
         }
+        join->done.release();
+    }
+
+    usub::uvent::task::Awaitable<size_t> PgPool::prewarm(size_t n, int attempts) {
+        auto join = std::make_shared<PrewarmJoin>();
+
+        // every handshake runs concurrently; the slot is taken up front so
+        // max_pool holds while they are in flight
+        size_t spawned = 0;
+        for (; spawned < n; ++spawned) {
+            if (!this->reserve_slot())
+                break;
+            usub::uvent::system::co_spawn(this->prewarm_one(join, attempts));
+        }
+
+        for (size_t i = 0; i < spawned; ++i)
+            co_await join->done.acquire();
+
+        co_return join->opened.load(std::memory_order_relaxed);
+    }
+
+    size_t PgPool::idle_count() const {
+        if (this->shards_.empty())
+            return this->idle_count_.load(std::memory_order_relaxed);
+        size_t n = 0;
+        for (const auto &sh: this->shards_)
+            n += sh->idle_count.load(std::memory_order_relaxed);
+        return n;
     }
 
     void PgPool::release_connection(std::shared_ptr<PgConnectionLibpq> conn) {
         if (!conn)
             return;
 
-        if (!conn->connected() || !conn->is_idle()) {
+        if (!conn->connected() || !conn->is_idle() || this->expired(*conn)) {
 #if UPQ_POOL_DEBUG
-            UPQ_POOL_DBG("release: conn=%p not idle or disconnected, mark_dead", conn.get());
+            UPQ_POOL_DBG("release: conn=%p not idle, disconnected or expired, mark_dead", conn.get());
 #endif
             mark_dead(conn);
             return;
         }
 
-        if (!this->idle_.try_enqueue(conn)) {
+        if (this->waiting_.load(std::memory_order_seq_cst) != 0 && this->serve_waiter(conn))
+            return;
+
+        if (!this->put_idle(conn)) {
 #if UPQ_POOL_DEBUG
             UPQ_POOL_DBG("release: idle queue full for conn=%p, mark_dead", conn.get());
 #endif
@@ -196,7 +504,7 @@ namespace usub::pg {
 #if UPQ_POOL_DEBUG
             UPQ_POOL_DBG("release: enqueued conn=%p", conn.get());
 #endif
-            idle_sem_.release();
+            this->wake_waiter();
         }
     }
 
@@ -219,16 +527,19 @@ namespace usub::pg {
             (void) conn->drain_all_results();
         }
 
-        if (!conn->connected() || !conn->is_idle()) {
+        if (!conn->connected() || !conn->is_idle() || this->expired(*conn)) {
 #if UPQ_POOL_DEBUG
-            UPQ_POOL_DBG("release_async: conn=%p not idle or disconnected after drain, mark_dead",
+            UPQ_POOL_DBG("release_async: conn=%p not idle, disconnected or expired after drain, mark_dead",
                          conn.get());
 #endif
             mark_dead(conn);
             co_return;
         }
 
-        if (!this->idle_.try_enqueue(conn)) {
+        if (this->waiting_.load(std::memory_order_seq_cst) != 0 && this->serve_waiter(conn))
+            co_return;
+
+        if (!this->put_idle(conn)) {
 #if UPQ_POOL_DEBUG
             UPQ_POOL_DBG("release_async: idle queue full for conn=%p, mark_dead", conn.get());
 #endif
@@ -237,12 +548,167 @@ namespace usub::pg {
 #if UPQ_POOL_DEBUG
             UPQ_POOL_DBG("release_async: enqueued conn=%p", conn.get());
 #endif
-            idle_sem_.release();
+            this->wake_waiter();
         }
 
         co_return;
     }
 
+    usub::uvent::task::Awaitable<std::vector<QueryResult> >
+    PgPool::pipeline_on(std::shared_ptr<PgConnectionLibpq> const &conn,
+                        PgPipeline pipeline) {
+        if (!conn || !conn->connected()) {
+            std::vector<QueryResult> bad(pipeline.size());
+            for (auto &qr: bad) {
+                qr.ok = false;
+                qr.code = PgErrorCode::ConnectionClosed;
+                qr.error = "connection not OK";
+                qr.rows_valid = false;
+            }
+            co_return bad;
+        }
+
+        co_return co_await conn->exec_pipeline_nonblocking(std::move(pipeline));
+    }
+
+    usub::uvent::task::Awaitable<std::vector<QueryResult> >
+    PgPool::pipeline_awaitable(PgPipeline pipeline) {
+        auto c = co_await acquire_connection();
+        if (!c) {
+            const auto &e = c.error();
+            std::vector<QueryResult> bad(pipeline.size());
+            for (auto &qr: bad) {
+                qr.ok = false;
+                qr.code = e.code;
+                qr.error = e.error;
+                qr.err_detail = e.err_detail;
+                qr.rows_valid = false;
+            }
+            co_return bad;
+        }
+
+        auto conn = *c;
+
+        std::vector<QueryResult> results = co_await pipeline_on(conn, std::move(pipeline));
+
+        bool fatal = !conn->connected();
+        for (auto &qr: results)
+            fatal = fatal || is_fatal_connection_error(qr);
+
+        if (fatal) {
+            mark_dead(conn);
+        } else {
+            co_await release_connection_async(conn);
+        }
+
+        co_return results;
+    }
+
+    usub::uvent::task::Awaitable<QueryResult> PgPool::coalesced_query(PgPipelineStatement st) {
+        auto q = std::make_shared<CoalescedQuery>();
+        q->st = std::move(st);
+        q->st.sync_after = true;
+
+        bool spawn = false;
+        {
+            std::lock_guard lk(this->coalesce_mu_);
+            this->coalesce_q_.push_back(q);
+            // one flusher per backlog of max_batch, up to the connection budget
+            const size_t busy = this->coalesce_flushers_;
+            if (busy < this->coalesce_conns_.load(std::memory_order_relaxed) &&
+                (busy == 0 || this->coalesce_q_.size() >= busy * this->coalesce_batch_.load(std::memory_order_relaxed))) {
+                ++this->coalesce_flushers_;
+                spawn = true;
+            }
+        }
+        if (spawn)
+            usub::uvent::system::co_spawn(this->coalesce_flusher());
+
+        co_await q->done.acquire();
+        co_return std::move(q->result);
+    }
+
+    usub::uvent::task::Awaitable<void> PgPool::coalesce_flusher() {
+        std::vector<std::shared_ptr<CoalescedQuery> > batch;
+        for (;;) {
+            batch.clear();
+            {
+                std::lock_guard lk(this->coalesce_mu_);
+                const size_t max_batch = this->coalesce_batch_.load(std::memory_order_relaxed);
+                while (!this->coalesce_q_.empty() && batch.size() < max_batch) {
+                    batch.push_back(std::move(this->coalesce_q_.front()));
+                    this->coalesce_q_.pop_front();
+                }
+                if (batch.empty()) {
+                    // decided under the lock, so a new query either sees us or spawns
+                    --this->coalesce_flushers_;
+                    co_return;
+                }
+            }
+
+            auto c = co_await acquire_connection();
+            if (!c) {
+                for (auto &q: batch) {
+                    q->result.ok = false;
+                    q->result.code = c.error().code;
+                    q->result.error = c.error().error;
+                    q->result.err_detail = c.error().err_detail;
+                    q->result.rows_valid = false;
+                    q->done.release();
+                }
+                continue;
+            }
+
+            auto conn = *c;
+
+            PgPipeline pipeline;
+            for (auto &q: batch)
+                pipeline.add_statement(std::move(q->st));
+
+            std::vector<QueryResult> results = co_await conn->exec_pipeline_nonblocking(std::move(pipeline));
+
+            bool fatal = !conn->connected();
+            for (auto &qr: results)
+                fatal = fatal || is_fatal_connection_error(qr);
+
+            if (fatal) {
+                mark_dead(conn);
+            } else {
+                co_await release_connection_async(conn);
+            }
+
+            this->coalesce_stats_.queries.fetch_add(batch.size(), std::memory_order_relaxed);
+            this->coalesce_stats_.batches.fetch_add(1, std::memory_order_relaxed);
+            uint64_t prev = this->coalesce_stats_.max_batch.load(std::memory_order_relaxed);
+            while (prev < batch.size() && !this->coalesce_stats_.max_batch.compare_exchange_weak(
+                       prev, batch.size(), std::memory_order_relaxed)) {
+            }
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (i < results.size()) {
+                    batch[i]->result = std::move(results[i]);
+                } else {
+                    batch[i]->result.ok = false;
+                    batch[i]->result.code = PgErrorCode::ProtocolCorrupt;
+                    batch[i]->result.error = "pipeline returned fewer results than statements";
+                    batch[i]->result.rows_valid = false;
+                }
+                batch[i]->done.release();
+            }
+        }
+    }
+
+    void PgPool::apply_connection_settings(PgConnectionLibpq &conn) {
+        conn.set_statement_cache_capacity(statement_cache_capacity(), &stmt_cache_stats_);
+        conn.set_result_format(result_format());
+        conn.set_stats_scope(this->stats_scope_);
+        conn.set_latency_ewma(&this->latency_ewma_);
+        if (this->tracing_.load(std::memory_order_acquire))
+            conn.set_trace(this->trace_.load(std::memory_order_acquire));
+        else if (conn.trace())
+            conn.set_trace(nullptr);
+    }
+
     void PgPool::mark_dead(std::shared_ptr<PgConnectionLibpq> const &conn) {
         if (!conn)
             return;
@@ -250,7 +716,102 @@ namespace usub::pg {
         UPQ_POOL_DBG("mark_dead: conn=%p", conn.get());
 #endif
         conn->close();
-        this->live_count_.fetch_sub(1, std::memory_order_relaxed);
-        idle_sem_.release();
+        this->live_count_.fetch_sub(1, std::memory_order_seq_cst);
+        this->wake_waiter();
+    }
+
+    void PgPool::enable_sharding(size_t shards) {
+        this->shards_.clear();
+        if (shards <= 1)
+            return;
+        this->shards_.reserve(shards);
+        for (size_t i = 0; i < shards; ++i)
+            this->shards_.push_back(std::make_unique<Shard>(this->max_pool_));
+    }
+
+    std::vector<PgPoolShardStats> PgPool::shard_stats() const {
+        std::vector<PgPoolShardStats> out;
+        out.reserve(this->shards_.size());
+        for (const auto &sh: this->shards_) {
+            PgPoolShardStats st;
+            st.idle = sh->idle_count.load(std::memory_order_relaxed);
+            st.local_hits = sh->local_hits.load(std::memory_order_relaxed);
+            st.stolen = sh->stolen.load(std::memory_order_relaxed);
+            st.created = sh->created.load(std::memory_order_relaxed);
+            st.returned = sh->returned.load(std::memory_order_relaxed);
+            out.push_back(st);
+        }
+        return out;
+    }
+
+    size_t PgPool::local_shard() const noexcept {
+        return worker_slot() % this->shards_.size();
+    }
+
+    bool PgPool::try_take_idle(std::shared_ptr<PgConnectionLibpq> &conn) {
+        if (this->shards_.empty()) {
+            if (!this->idle_.try_dequeue(conn))
+                return false;
+            this->idle_count_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        const size_t n = this->shards_.size();
+        const size_t self = this->local_shard();
+        for (size_t k = 0; k < n; ++k) {
+            Shard &sh = *this->shards_[(self + k) % n];
+            // skip empty shards without touching their queue
+            if (sh.idle_count.load(std::memory_order_relaxed) == 0)
+                continue;
+            if (!sh.idle.try_dequeue(conn))
+                continue;
+            sh.idle_count.fetch_sub(1, std::memory_order_relaxed);
+            if (k == 0)
+                sh.local_hits.fetch_add(1, std::memory_order_relaxed);
+            else
+                sh.stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    bool PgPool::put_idle(std::shared_ptr<PgConnectionLibpq> const &conn) {
+        if (this->shards_.empty()) {
+            if (!this->idle_.try_enqueue(conn))
+                return false;
+            this->idle_count_.fetch_add(1, std::memory_order_seq_cst);
+            return true;
+        }
+
+        size_t home = conn->pool_shard();
+        if (home >= this->shards_.size())
+            home = this->local_shard();
+
+        Shard &sh = *this->shards_[home];
+        if (!sh.idle.try_enqueue(conn))
+            return false;
+        sh.idle_count.fetch_add(1, std::memory_order_seq_cst);
+        sh.returned.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool PgPool::any_idle_or_capacity() const {
+        if (this->live_count_.load(std::memory_order_seq_cst) < this->max_pool_)
+            return true;
+        if (this->idle_count_.load(std::memory_order_seq_cst) != 0)
+            return true;
+        for (const auto &sh: this->shards_)
+            if (sh->idle_count.load(std::memory_order_seq_cst) != 0)
+                return true;
+        return false;
+    }
+
+    void PgPool::wake_waiter() {
+        // a parked connection or a freed slot: nudge the longest waiter so it
+        // retries; it pairs with the re-check after enqueue_waiter
+        if (this->waiting_.load(std::memory_order_seq_cst) != 0) {
+            std::shared_ptr<PgConnectionLibpq> none;
+            (void) this->serve_waiter(none);
+        }
     }
 } // namespace usub::pg
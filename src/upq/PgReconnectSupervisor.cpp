@@ -0,0 +1,87 @@
+#include "upq/PgReconnectSupervisor.h"
+
+#include <algorithm>
+
+namespace usub::pg {
+    PgReconnectSupervisor::PgReconnectSupervisor(PgPool &pool, PgReconnectConfig cfg)
+        : pool_(pool)
+          , cfg_(cfg)
+          , rng_(static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) |
+                 1u) {
+        if (this->cfg_.max_parallel_connects == 0) this->cfg_.max_parallel_connects = 1;
+        if (this->cfg_.interval.count() <= 0) this->cfg_.interval = std::chrono::milliseconds{200};
+    }
+
+    size_t PgReconnectSupervisor::deficit() const {
+        const size_t live = this->pool_.live_count();
+        const size_t idle = this->pool_.idle_count();
+        const size_t room = live < this->pool_.max_pool_size() ? this->pool_.max_pool_size() - live : 0;
+
+        size_t want = 0;
+        const size_t min_idle = this->pool_.min_idle();
+        if (idle < min_idle) want = min_idle - idle;
+        if (live < this->cfg_.target_live) want = std::max(want, this->cfg_.target_live - live);
+        return std::min(want, room);
+    }
+
+    usub::uvent::task::Awaitable<size_t> PgReconnectSupervisor::tick() {
+        this->stats_.ticks.fetch_add(1, std::memory_order_relaxed);
+
+        const size_t want = std::min(this->deficit(), this->cfg_.max_parallel_connects);
+        if (want == 0) {
+            this->stats_.consecutive_failures.store(0, std::memory_order_relaxed);
+            co_return 0;
+        }
+
+        const size_t opened = co_await this->pool_.prewarm(want);
+        this->stats_.opened.fetch_add(opened, std::memory_order_relaxed);
+
+        if (opened < want) {
+            this->stats_.failed.fetch_add(want - opened, std::memory_order_relaxed);
+            // a partial success still counts: the server is reachable
+            if (opened == 0)
+                this->stats_.consecutive_failures.fetch_add(1, std::memory_order_relaxed);
+            else
+                this->stats_.consecutive_failures.store(0, std::memory_order_relaxed);
+        } else {
+            this->stats_.consecutive_failures.store(0, std::memory_order_relaxed);
+        }
+        co_return opened;
+    }
+
+    std::chrono::milliseconds PgReconnectSupervisor::next_delay() {
+        const uint32_t fails = this->stats_.consecutive_failures.load(std::memory_order_relaxed);
+        const int64_t base = std::max<int64_t>(1, this->cfg_.backoff_initial.count());
+        if (fails == 0) {
+            // keep topping up while there is still a deficit, but no faster
+            // than the backoff floor: a tick that opened only part of it
+            // would otherwise spin
+            if (this->deficit())
+                return std::min(this->cfg_.interval, std::chrono::milliseconds{base});
+            return this->cfg_.interval;
+        }
+
+        const int64_t cap = std::max<int64_t>(base, this->cfg_.backoff_max.count());
+        int64_t d = base;
+        for (uint32_t i = 1; i < fails && d < cap; ++i) d *= 2;
+        d = std::min(d, cap);
+
+        // xorshift64: jitter in [d/2, 3d/2)
+        this->rng_ ^= this->rng_ << 13;
+        this->rng_ ^= this->rng_ >> 7;
+        this->rng_ ^= this->rng_ << 17;
+        const int64_t jittered = d / 2 + static_cast<int64_t>(this->rng_ % static_cast<uint64_t>(d));
+        return std::chrono::milliseconds{jittered};
+    }
+
+    usub::uvent::task::Awaitable<void> PgReconnectSupervisor::run() {
+        this->running_.store(true, std::memory_order_relaxed);
+        while (!this->stop_.load(std::memory_order_relaxed)) {
+            (void) co_await this->tick();
+            const auto delay = this->next_delay();
+            if (delay.count() > 0)
+                co_await usub::uvent::system::this_coroutine::sleep_for(delay);
+        }
+        this->running_.store(false, std::memory_order_relaxed);
+    }
+} // namespace usub::pg
@@ -0,0 +1,218 @@
+#include "upq/PgResultCache.h"
+
+#include <algorithm>
+
+namespace usub::pg {
+    namespace detail {
+        size_t result_cache_footprint(const QueryResult &qr) noexcept {
+            size_t n = sizeof(QueryResult) + qr.error.size();
+            for (const auto &c: qr.columns) n += sizeof(std::string) + c.size();
+            n += qr.column_oids.size() * sizeof(uint32_t);
+            for (const auto &row: qr.rows) {
+                n += sizeof(QueryResult::Row);
+                for (const auto &cell: row.cols) n += sizeof(std::string) + cell.size();
+            }
+            return n;
+        }
+    } // namespace detail
+
+    namespace {
+        struct CacheInvalidator final : IPgNotifyHandler {
+            explicit CacheInvalidator(PgResultCache *cache) : cache(cache) {}
+
+            usub::uvent::task::Awaitable<void> operator()(std::string channel, std::string payload,
+                                                          int) override {
+                this->cache->invalidate(channel);
+                if (!payload.empty())
+                    this->cache->invalidate(channel + ":" + payload);
+                co_return;
+            }
+
+            PgResultCache *cache;
+        };
+    } // namespace
+
+    PgResultCache::PgResultCache(PgPool &pool, PgResultCacheConfig cfg)
+        : PgResultCache(cfg, [&pool]() -> PgPool * { return &pool; }) {
+    }
+
+    PgResultCache::PgResultCache(PgConnector &connector, PgResultCacheConfig cfg, RouteHint hint)
+        : PgResultCache(cfg, [&connector, hint]() -> PgPool * { return connector.route(hint); }) {
+    }
+
+    PgResultCache::PgResultCache(PgResultCacheConfig cfg, std::function<PgPool *()> resolve)
+        : cfg_(cfg)
+          , resolve_(std::move(resolve)) {
+        const size_t n = std::max<size_t>(this->cfg_.shards, 1);
+        this->shard_budget_ = this->cfg_.memory_budget_bytes / n;
+        this->shards_.reserve(n);
+        for (size_t i = 0; i < n; ++i) this->shards_.push_back(std::make_unique<Shard>());
+    }
+
+    PgPool *PgResultCache::pick_pool() {
+        return this->resolve_();
+    }
+
+    PgResultCache::Shard &PgResultCache::shard_for(const std::string &key) {
+        const size_t h = std::hash<std::string>{}(key);
+        return *this->shards_[h % this->shards_.size()];
+    }
+
+    PgResultCache::Lookup PgResultCache::lookup(const std::string &key, const PgCacheOptions &opts) {
+        Shard &sh = this->shard_for(key);
+        Lookup out;
+        const auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard lk(sh.mu);
+
+        if (auto it = sh.index.find(key); it != sh.index.end()) {
+            auto e = it->second;
+            if (e->expires == std::chrono::steady_clock::time_point{} || e->expires > now) {
+                sh.lru.splice(sh.lru.begin(), sh.lru, e);
+                this->stats_.hits.fetch_add(1, std::memory_order_relaxed);
+                out.value = e->value;
+                return out;
+            }
+            this->erase_locked(sh, e);
+            this->stats_.expired.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (auto it = sh.inflight.find(key); it != sh.inflight.end()) {
+            out.flight = it->second;
+            ++out.flight->waiters;
+            this->stats_.coalesced.fetch_add(1, std::memory_order_relaxed);
+            return out;
+        }
+
+        out.flight = std::make_shared<Flight>();
+        out.flight->tags = opts.tags;
+        out.leader = true;
+        sh.inflight.emplace(key, out.flight);
+        this->stats_.misses.fetch_add(1, std::memory_order_relaxed);
+        return out;
+    }
+
+    void PgResultCache::complete(const std::string &key, Lookup &lk, std::shared_ptr<const void> value,
+                                 size_t bytes, std::optional<PgOpError> error, const PgCacheOptions &opts) {
+        Shard &sh = this->shard_for(key);
+        lk.flight->value = value;
+        const bool cacheable = !error && value && bytes <= this->shard_budget_;
+        lk.flight->error = std::move(error);
+
+        size_t waiters = 0;
+        {
+            std::lock_guard g(sh.mu);
+            // invalidate() may have detached this flight already
+            if (auto it = sh.inflight.find(key); it != sh.inflight.end() && it->second == lk.flight)
+                sh.inflight.erase(it);
+            waiters = lk.flight->waiters;
+            lk.flight->waiters = 0;
+
+            if (cacheable && !lk.flight->stale) {
+                if (auto it = sh.index.find(key); it != sh.index.end())
+                    this->erase_locked(sh, it->second);
+
+                const auto ttl = opts.ttl.count() > 0 ? opts.ttl : this->cfg_.default_ttl;
+                Entry e;
+                e.key = key;
+                e.value = std::move(value);
+                e.bytes = bytes;
+                if (ttl.count() > 0) e.expires = std::chrono::steady_clock::now() + ttl;
+                e.tags = opts.tags;
+
+                sh.lru.push_front(std::move(e));
+                const Entry &stored = sh.lru.front();
+                sh.index.emplace(stored.key, sh.lru.begin());
+                for (const auto &tag: stored.tags) sh.tagged[tag].insert(stored.key);
+                sh.bytes += bytes;
+
+                while (sh.bytes > this->shard_budget_ && sh.lru.size() > 1) {
+                    this->erase_locked(sh, std::prev(sh.lru.end()));
+                    this->stats_.evictions.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < waiters; ++i) lk.flight->done.release();
+    }
+
+    void PgResultCache::erase_locked(Shard &sh, std::list<Entry>::iterator it) {
+        for (const auto &tag: it->tags) {
+            auto t = sh.tagged.find(tag);
+            if (t == sh.tagged.end()) continue;
+            t->second.erase(it->key);
+            if (t->second.empty()) sh.tagged.erase(t);
+        }
+        sh.index.erase(it->key);
+        sh.bytes -= it->bytes;
+        sh.lru.erase(it);
+    }
+
+    void PgResultCache::invalidate(std::string_view tag) {
+        auto tagged = [tag](const std::vector<std::string> &tags) {
+            return std::find(tags.begin(), tags.end(), tag) != tags.end();
+        };
+        const std::string tag_key(tag);
+        for (auto &sp: this->shards_) {
+            Shard &sh = *sp;
+            std::lock_guard lk(sh.mu);
+            // running queries with this tag may have read pre-change data:
+            // they are not stored and newcomers start fresh; others go on
+            for (auto it = sh.inflight.begin(); it != sh.inflight.end();) {
+                if (tagged(it->second->tags)) {
+                    it->second->stale = true;
+                    it = sh.inflight.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            // stored entries come from the tag index, not an LRU walk
+            auto t = sh.tagged.find(tag_key);
+            if (t == sh.tagged.end()) continue;
+            const std::vector<std::string_view> keys(t->second.begin(), t->second.end());
+            for (std::string_view key: keys) {
+                if (auto e = sh.index.find(key); e != sh.index.end()) {
+                    this->erase_locked(sh, e->second);
+                    this->stats_.invalidations.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    void PgResultCache::clear() {
+        for (auto &sp: this->shards_) {
+            Shard &sh = *sp;
+            std::lock_guard lk(sh.mu);
+            for (auto &[key, flight]: sh.inflight) flight->stale = true;
+            sh.inflight.clear();
+            this->stats_.invalidations.fetch_add(sh.lru.size(), std::memory_order_relaxed);
+            sh.index.clear();
+            sh.tagged.clear();
+            sh.lru.clear();
+            sh.bytes = 0;
+        }
+    }
+
+    usub::uvent::task::Awaitable<std::optional<PgNotificationMultiplexer::HandlerHandle> >
+    PgResultCache::subscribe(PgNotificationMultiplexer &mux, const std::string &channel) {
+        co_return co_await mux.add_handler(channel, std::make_shared<CacheInvalidator>(this));
+    }
+
+    size_t PgResultCache::size() const {
+        size_t n = 0;
+        for (const auto &sp: this->shards_) {
+            std::lock_guard lk(sp->mu);
+            n += sp->lru.size();
+        }
+        return n;
+    }
+
+    size_t PgResultCache::bytes() const {
+        size_t n = 0;
+        for (const auto &sp: this->shards_) {
+            std::lock_guard lk(sp->mu);
+            n += sp->bytes;
+        }
+        return n;
+    }
+} // namespace usub::pg
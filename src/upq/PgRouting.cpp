@@ -1,7 +1,9 @@
 // PgRouting.cpp
 #include "upq/PgRouting.h"
 #include "uvent/Uvent.h"
+#include "uvent/sync/AsyncSemaphore.h"
 #include <algorithm>
+#include <array>
 #include <chrono>
 
 using namespace std::chrono;
@@ -11,6 +13,25 @@ namespace usub::pg {
         return (role == NodeRole::Analytics) ? lim.analytics_max_conns : lim.default_max_conns;
     }
 
+    namespace {
+        uint64_t route_rand() noexcept {
+            thread_local uint64_t s = 0x2545F4914F6CDD1Dull ^ reinterpret_cast<uintptr_t>(&s);
+            s ^= s >> 12;
+            s ^= s << 25;
+            s ^= s >> 27;
+            return s * 0x2545F4914F6CDD1Dull;
+        }
+
+        // Lower is better. Nodes without query samples fall back to the probe
+        // RTT (and then 1ms) so they still get traffic and produce samples.
+        double load_score(const PgPool &pool, std::chrono::milliseconds rtt, uint8_t weight) {
+            uint64_t lat = pool.latency_ewma_us();
+            if (!lat) lat = rtt.count() > 0 ? static_cast<uint64_t>(rtt.count()) * 1000 : 1000;
+            const size_t outstanding = pool.busy_count() + pool.acquire_queue_depth() + 1;
+            return static_cast<double>(lat) * static_cast<double>(outstanding) / (weight ? weight : 1);
+        }
+    } // namespace
+
     bool PgConnector::is_replica(NodeRole r) {
         return r == NodeRole::SyncReplica || r == NodeRole::AsyncReplica || r == NodeRole::Analytics;
     }
@@ -20,7 +41,6 @@ namespace usub::pg {
     }
 
     PgConnector::PgConnector(Config cfg) : cfg_(std::move(cfg)) {
-        this->nodes_.reserve(this->cfg_.nodes.size());
         for (const auto &ep: this->cfg_.nodes) {
             std::unique_ptr<PgPool> pool;
             try {
@@ -31,7 +51,9 @@ namespace usub::pg {
                 );
             } catch (...) {
             }
-            this->nodes_.push_back(Node{ep, std::move(pool), {}});
+            auto &n = this->nodes_.emplace_back();
+            n.ep = ep;
+            n.pool = std::move(pool);
         }
         for (const auto &name: this->cfg_.primary_failover) {
             auto it = std::find_if(this->nodes_.begin(), this->nodes_.end(),
@@ -59,6 +81,8 @@ namespace usub::pg {
             n.pool = std::make_unique<PgPool>(n.ep.host, n.ep.port, n.ep.user, n.ep.db, n.ep.password, cap,
                                               this->cfg_.connect_retries, this->cfg_.ssl_config,
                                               this->cfg_.keepalive_config);
+            if (!n.ep.name.empty()) n.pool->set_stats_name(n.ep.name);
+            if (this->trace_sink_) n.pool->set_trace_sink(this->trace_sink_, this->trace_ratio_);
             return true;
         } catch (...) {
             n.pool.reset();
@@ -66,11 +90,18 @@ namespace usub::pg {
         }
     }
 
+    void PgConnector::set_trace_sink(std::shared_ptr<PgTraceSink> sink, double sample_ratio) {
+        this->trace_sink_ = std::move(sink);
+        this->trace_ratio_ = sample_ratio;
+        for (auto &n: this->nodes_)
+            if (n.pool) n.pool->set_trace_sink(this->trace_sink_, this->trace_ratio_);
+    }
+
     PgPool *PgConnector::route(const RouteHint &hint) {
         if (hint.kind == QueryKind::Write ||
             hint.kind == QueryKind::DDL ||
             hint.consistency == Consistency::Strong ||
-            hint.read_my_writes) {
+            (hint.read_my_writes && !hint.min_lsn)) {
             if (auto *p = this->pick_primary())
                 if (this->ensure_pool(*p))
                     return p->pool.get();
@@ -89,6 +120,10 @@ namespace usub::pg {
             if (this->ensure_pool(*p))
                 return p->pool.get();
 
+        // any other node may not have replayed the write the token stands for
+        if (hint.min_lsn)
+            return nullptr;
+
         if (auto *any = this->pick_any(false))
             return any->pool.get();
 
@@ -115,15 +150,19 @@ namespace usub::pg {
 
         if (cfg_tx.deferrable) {
             Node *best = nullptr;
+            milliseconds best_lag{0};
             for (auto &n: this->nodes_) {
                 if (n.ep.role != NodeRole::SyncReplica ||
                     !this->is_usable(n.ep.role) ||
                     n.cb_state == 2)
                     continue;
-                if (!n.pool || !n.stats.healthy)
+                const NodeStats st = n.stats.load();
+                if (!n.pool || !st.healthy)
                     continue;
-                if (!best || n.stats.replay_lag < best->stats.replay_lag)
+                if (!best || st.replay_lag < best_lag) {
                     best = &n;
+                    best_lag = st.replay_lag;
+                }
             }
             if (best && this->ensure_pool(*best))
                 return best->pool.get();
@@ -163,8 +202,8 @@ namespace usub::pg {
     PgConnector::Node *PgConnector::pick_primary() {
         for (auto idx: this->primary_failover_idx_) {
             auto &n = this->nodes_[idx];
-            if (n.ep.role == NodeRole::Primary && this->is_usable(n.ep.role) && n.cb_state != 2 && n.stats.healthy && n.
-                pool)
+            if (n.ep.role == NodeRole::Primary && this->is_usable(n.ep.role) && n.cb_state != 2 && n.pool &&
+                n.stats.load().healthy)
                 return &n;
         }
         for (auto &n: this->nodes_)
@@ -174,24 +213,61 @@ namespace usub::pg {
     }
 
     PgConnector::Node *PgConnector::pick_best_replica(const RouteHint &hint) {
-        Node *best = nullptr;
-        auto ok_stale = [&](const Node &n)-> bool {
+        auto ok_stale = [&](const NodeStats &st)-> bool {
+            if (hint.min_lsn && st.replay_lsn < hint.min_lsn.value) return false;
             if (hint.consistency != Consistency::BoundedStaleness) return true;
-            if (n.stats.replay_lag > hint.staleness.max_staleness) return false;
-            if (hint.staleness.max_lsn_lag && n.stats.lsn_lag > hint.staleness.max_lsn_lag) return false;
+            if (st.replay_lag > hint.staleness.max_staleness) return false;
+            if (hint.staleness.max_lsn_lag && st.lsn_lag > hint.staleness.max_lsn_lag) return false;
             return true;
         };
-        auto better = [&](const Node *a, const Node *b)-> bool {
-            if (a->stats.rtt != b->stats.rtt) return a->stats.rtt < b->stats.rtt;
-            return a->ep.weight > b->ep.weight;
+
+        // no allocation or locking: candidates live on the stack
+        struct Candidate {
+            Node *node;
+            milliseconds rtt;
         };
+        std::array<Candidate, 64> cand;
+        size_t count = 0;
         for (auto &n: this->nodes_) {
             if (!this->is_replica(n.ep.role) || !this->is_usable(n.ep.role) || n.cb_state == 2) continue;
-            if (!n.pool || !n.stats.healthy) continue;
-            if (!ok_stale(n)) continue;
-            if (!best || better(&n, best)) best = &n;
+            if (!n.pool) continue;
+            const NodeStats st = n.stats.load();
+            if (!st.healthy || !ok_stale(st)) continue;
+            if (count < cand.size()) cand[count++] = Candidate{&n, st.rtt};
         }
-        return best;
+        if (count == 0) return nullptr;
+        if (count == 1) return cand[0].node;
+
+        const auto mode = this->cfg_.routing.replica_selection;
+        if (mode == ReplicaSelection::LowestRtt) {
+            size_t best = 0;
+            for (size_t i = 1; i < count; ++i) {
+                const auto &c = cand[i], &b = cand[best];
+                if (c.rtt < b.rtt || (c.rtt == b.rtt && c.node->ep.weight > b.node->ep.weight)) best = i;
+            }
+            return cand[best].node;
+        }
+
+        auto score = [](const Candidate &c) { return load_score(*c.node->pool, c.rtt, c.node->ep.weight); };
+
+        if (mode == ReplicaSelection::LeastOutstanding) {
+            size_t best = 0;
+            double best_score = score(cand[0]);
+            for (size_t i = 1; i < count; ++i) {
+                const double s = score(cand[i]);
+                if (s < best_score) {
+                    best = i;
+                    best_score = s;
+                }
+            }
+            return cand[best].node;
+        }
+
+        const uint64_t r = route_rand();
+        const size_t a = static_cast<size_t>(r % count);
+        size_t b = static_cast<size_t>((r >> 32) % (count - 1));
+        if (b >= a) ++b;
+        return score(cand[b]) < score(cand[a]) ? cand[b].node : cand[a].node;
     }
 
     PgConnector::Node *PgConnector::pick_any(bool prefer_primary) {
@@ -236,53 +312,200 @@ namespace usub::pg {
         } else n.cb_until = now + maxb;
     }
 
-    usub::uvent::task::Awaitable<bool> PgConnector::probe_healthy(PgPool &pool) {
-        auto qr = co_await pool.query_awaitable("SELECT 1");
-        co_return qr.ok;
+    NodeStats PgConnector::StatsCell::load() const noexcept {
+        NodeStats st;
+        for (;;) {
+            const uint64_t s0 = this->seq_.load(std::memory_order_acquire);
+            if (s0 & 1) continue;
+            st.healthy = this->healthy_.load(std::memory_order_relaxed);
+            st.rtt = milliseconds{this->rtt_ms_.load(std::memory_order_relaxed)};
+            st.replay_lag = milliseconds{this->replay_lag_ms_.load(std::memory_order_relaxed)};
+            st.lsn_lag = this->lsn_lag_.load(std::memory_order_relaxed);
+            st.replay_lsn = this->replay_lsn_.load(std::memory_order_relaxed);
+            st.open_conns = this->open_conns_.load(std::memory_order_relaxed);
+            st.busy_conns = this->busy_conns_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (this->seq_.load(std::memory_order_relaxed) == s0) return st;
+        }
     }
 
-    usub::uvent::task::Awaitable<std::chrono::milliseconds>
-    PgConnector::probe_rtt(PgPool &pool, const std::string &sql) {
-        using clock = std::chrono::steady_clock;
-        auto t0 = clock::now();
-        auto qr = co_await pool.query_awaitable(sql);
-        auto t1 = clock::now();
-        if (!qr.ok) co_return milliseconds{9999};
-        co_return std::chrono::duration_cast<milliseconds>(t1 - t0);
+    void PgConnector::StatsCell::store(const NodeStats &st) noexcept {
+        const uint64_t s0 = this->seq_.load(std::memory_order_relaxed);
+        this->seq_.store(s0 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        this->healthy_.store(st.healthy, std::memory_order_relaxed);
+        this->rtt_ms_.store(st.rtt.count(), std::memory_order_relaxed);
+        this->replay_lag_ms_.store(st.replay_lag.count(), std::memory_order_relaxed);
+        this->lsn_lag_.store(st.lsn_lag, std::memory_order_relaxed);
+        this->replay_lsn_.store(st.replay_lsn, std::memory_order_relaxed);
+        this->open_conns_.store(st.open_conns, std::memory_order_relaxed);
+        this->busy_conns_.store(st.busy_conns, std::memory_order_relaxed);
+        this->seq_.store(s0 + 2, std::memory_order_release);
     }
 
-    usub::uvent::task::Awaitable<std::pair<std::chrono::milliseconds, uint64_t> >
-    PgConnector::probe_replication_lag(PgPool &pool) {
-        auto opt = co_await pool.query_reflect_one<Row>(R"SQL(
+    namespace {
+        constexpr std::string_view replication_probe_sql = R"SQL(
         SELECT
           COALESCE( (EXTRACT(EPOCH FROM (now() - pg_last_xact_replay_timestamp())) * 1000)::bigint, 0 ) AS lag_ms,
-          COALESCE( pg_wal_lsn_diff(pg_last_wal_receive_lsn(), pg_last_wal_replay_lsn())::bigint, 0 ) AS lsn_lag
-    )SQL");
-        if (!opt.has_value()) co_return std::make_pair(milliseconds{0}, uint64_t{0});
-        co_return std::make_pair(milliseconds{opt->lag_ms}, static_cast<uint64_t>(opt->lsn_lag));
+          COALESCE( pg_wal_lsn_diff(pg_last_wal_receive_lsn(), pg_last_wal_replay_lsn())::bigint, 0 ) AS lsn_lag,
+          COALESCE( CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn()
+                         ELSE pg_current_wal_lsn() END::text, '0/0' ) AS replay_lsn
+    )SQL";
+
+        // Wakes health_tick once: when the last probe finishes or at the deadline.
+        struct ProbeTick {
+            usub::uvent::sync::AsyncSemaphore wake{0};
+            std::atomic<size_t> pending{0};
+            std::atomic<bool> woken{false};
+
+            void wake_once() {
+                if (!this->woken.exchange(true, std::memory_order_acq_rel)) this->wake.release();
+            }
+        };
+
+        usub::uvent::task::Awaitable<void> probe_deadline(std::shared_ptr<ProbeTick> tick, milliseconds d) {
+            co_await usub::uvent::system::this_coroutine::sleep_for(d);
+            tick->wake_once();
+        }
+    } // namespace
+
+    // Shared by health_tick and the probe coroutine, which outlives the tick
+    // when it misses the deadline. The node keeps a late job until it ends:
+    // no second probe is started meanwhile, and a late success hands its
+    // connection to the next probe while its stale result is dropped.
+    struct PgConnector::ProbeJob {
+        std::shared_ptr<PgConnectionLibpq> conn;
+        std::string conninfo;
+        std::string rtt_sql;
+        milliseconds timeout{0};
+        std::shared_ptr<ProbeTick> tick;
+
+        std::atomic<bool> done{false};
+        bool ok{false};
+        bool reconnected{false};  // a new session: its position may be behind the last one
+        microseconds rtt{0};
+        Row lag{0, 0, {}};
+    };
+
+    usub::uvent::task::Awaitable<void> PgConnector::run_probe(std::shared_ptr<ProbeJob> job) {
+        auto &conn = job->conn;
+        if (!conn || !conn->connected()) {
+            conn = std::make_shared<PgConnectionLibpq>();
+            if (auto err = co_await conn->connect_async(job->conninfo, job->timeout)) conn.reset();
+            job->reconnected = true;
+        }
+
+        if (conn) {
+            // health, RTT and lag in a single round trip
+            PgPipeline p;
+            p.add(job->rtt_sql);
+            p.add(std::string{replication_probe_sql});
+
+            const auto t0 = steady_clock::now();
+            // a server or network that stops answering must not hold
+            // the probe forever: cancel, then drop the socket
+            PgQueryDeadline dl = conn->arm_deadline(PgQueryOptions{job->timeout, job->timeout});
+            std::vector<QueryResult> rs = co_await conn->exec_pipeline_nonblocking(std::move(p));
+            const auto t1 = steady_clock::now();
+            // a canceled probe already failed; one whose socket was closed
+            // under it is failed here whatever made it out
+            QueryResult fired;
+            fired.ok = true;
+            co_await conn->disarm_deadline(dl, fired);
+            if (!fired.ok) rs.clear();
+
+            if (rs.size() == 2 && rs[0].ok && rs[1].ok) {
+                if (auto lag = map_single_reflect_expected<Row>(rs[1], 0)) {
+                    job->ok = true;
+                    job->rtt = duration_cast<microseconds>(t1 - t0);
+                    job->lag = std::move(*lag);
+                }
+            }
+            if (!job->ok) conn.reset();
+        }
+
+        job->done.store(true, std::memory_order_release);
+        if (job->tick->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            job->tick->wake_once();
+    }
+
+    void PgConnector::apply_probe(Node &n, const ProbeJob *job) {
+        NodeStats st = n.stats.load();
+        if (job && job->ok) {
+            st.healthy = true;
+            st.rtt = duration_cast<milliseconds>(job->rtt);
+            // decays the EWMA toward the probe RTT once per tick: a node that
+            // spiked and then lost its traffic is tried again as it recovers
+            if (n.pool)
+                n.pool->observe_latency_us(static_cast<uint64_t>(std::max<int64_t>(job->rtt.count(), 1)));
+            st.replay_lag = milliseconds{job->lag.lag_ms};
+            st.lsn_lag = static_cast<uint64_t>(job->lag.lsn_lag);
+            // the position only grows on one session; after a reconnect the
+            // node may have been restored or replaced, so it is taken as is.
+            // A failed probe keeps the last known position.
+            if (auto lsn = PgLsn::parse(job->lag.replay_lsn);
+                lsn && (job->reconnected || lsn->value > st.replay_lsn))
+                st.replay_lsn = lsn->value;
+            if (st.replay_lag > milliseconds{this->cfg_.health.lag_threshold_ms}) st.healthy = false;
+            if (n.ep.role == NodeRole::Primary && st.replay_lag.count() > 0) st.healthy = false;
+        } else {
+            st.healthy = false;
+            st.rtt = milliseconds{9999};
+        }
+        if (n.pool) {
+            st.open_conns = static_cast<uint32_t>(n.pool->live_count());
+            st.busy_conns = static_cast<uint32_t>(n.pool->busy_count());
+        }
+        n.stats.store(st);
+        this->apply_circuit_breaker(n, st.healthy);
     }
 
     usub::uvent::task::Awaitable<void> PgConnector::health_tick() {
-        const auto lag_thr = std::chrono::milliseconds{this->cfg_.health.lag_threshold_ms};
+        const auto timeout = milliseconds{this->cfg_.health.probe_timeout_ms ? this->cfg_.health.probe_timeout_ms : 250};
+        auto tick = std::make_shared<ProbeTick>();
+
+        std::vector<std::pair<Node *, std::shared_ptr<ProbeJob> > > jobs;
+        jobs.reserve(this->nodes_.size());
         for (auto &n: this->nodes_) {
             if (!this->is_usable(n.ep.role)) continue;
-            if (!this->ensure_pool(n)) {
-                n.stats.healthy = false;
-                this->apply_circuit_breaker(n, false);
+            auto conninfo = make_conninfo(n.ep.host, n.ep.port, n.ep.user, n.ep.db, n.ep.password,
+                                          this->cfg_.ssl_config, this->cfg_.keepalive_config);
+            if (!this->ensure_pool(n) || !conninfo) {
+                this->apply_probe(n, nullptr);
                 continue;
             }
-            bool ok = co_await this->probe_healthy(*n.pool);
-            auto rtt = co_await this->probe_rtt(*n.pool, this->cfg_.health.rtt_probe_sql);
-            auto [lag_ms, lsn_lag] = co_await this->probe_replication_lag(*n.pool);
-            n.stats.healthy = ok;
-            n.stats.rtt = rtt;
-            n.stats.replay_lag = lag_ms;
-            n.stats.lsn_lag = lsn_lag;
-            if (n.stats.replay_lag > lag_thr) n.stats.healthy = false;
-            if (n.ep.role == NodeRole::Primary && n.stats.replay_lag.count() > 0) n.stats.healthy = false;
-            this->apply_circuit_breaker(n, n.stats.healthy);
+            if (n.probe_job) {
+                if (!n.probe_job->done.load(std::memory_order_acquire)) {
+                    // still bounded by its own deadline; not answering is unhealthy
+                    this->apply_probe(n, nullptr);
+                    continue;
+                }
+                if (n.probe_job->ok) n.probe_conn = std::move(n.probe_job->conn);
+                n.probe_job.reset();
+            }
+            auto job = std::make_shared<ProbeJob>();
+            job->conn = std::move(n.probe_conn);
+            job->conninfo = std::move(*conninfo);
+            job->rtt_sql = this->cfg_.health.rtt_probe_sql;
+            job->timeout = timeout;
+            job->tick = tick;
+            jobs.emplace_back(&n, std::move(job));
+        }
+        if (jobs.empty()) co_return;
+
+        tick->pending.store(jobs.size(), std::memory_order_relaxed);
+        for (auto &[n, job]: jobs)
+            usub::uvent::system::co_spawn(run_probe(job));
+        usub::uvent::system::co_spawn(probe_deadline(tick, timeout));
+
+        co_await tick->wake.acquire();
+
+        for (auto &[n, job]: jobs) {
+            const bool finished = job->done.load(std::memory_order_acquire);
+            if (finished && job->ok) n->probe_conn = job->conn;
+            if (!finished) n->probe_job = job;
+            this->apply_probe(*n, finished ? job.get() : nullptr);
         }
-        co_return;
     }
 
     usub::uvent::task::Awaitable<void> PgConnector::start_health_loop() {
@@ -297,7 +520,7 @@ namespace usub::pg {
         auto it = std::find_if(this->nodes_.begin(), this->nodes_.end(),
                                [&](const Node &n) { return n.ep.name == node_name; });
         if (it == this->nodes_.end() || !this->is_usable(it->ep.role) || it->cb_state == 2) return nullptr;
-        if (!this->ensure_pool(*it) || !it->stats.healthy) return nullptr;
+        if (!this->ensure_pool(*it) || !it->stats.load().healthy) return nullptr;
         return it->pool.get();
     }
 }
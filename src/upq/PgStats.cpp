@@ -0,0 +1,470 @@
+#include "upq/PgStats.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <new>
+
+namespace usub::pg {
+    struct PgStatsRegistry::ScopeCell {
+        std::atomic<uint64_t> queries{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> bytes_in{0};
+        std::atomic<uint64_t> bytes_out{0};
+        std::atomic<uint64_t> commits{0};
+        std::atomic<uint64_t> rollbacks{0};
+        std::array<std::atomic<uint64_t>, detail::error_code_count> by_code{};
+        std::array<std::atomic<uint64_t>, detail::sqlstate_class_count> by_class{};
+        PgLatencyHistogram latency;
+    };
+
+    struct PgStatsRegistry::FingerprintCell {
+        std::atomic<uint64_t> queries{0};
+        std::atomic<uint64_t> errors{0};
+        PgLatencyHistogram latency;
+    };
+
+    struct PgStatsRegistry::ThreadSlab {
+        struct Slot {
+            std::atomic<uint64_t> key{0};
+            std::atomic<FingerprintCell *> cell{nullptr};
+        };
+
+        ~ThreadSlab() {
+            for (auto &p: this->scopes) delete p.load(std::memory_order_relaxed);
+            for (auto &s: this->fingerprints) delete s.cell.load(std::memory_order_relaxed);
+        }
+
+        std::array<std::atomic<ScopeCell *>, max_scopes> scopes{};
+        std::array<Slot, max_fingerprints> fingerprints{};
+        std::atomic<uint64_t> fingerprint_overflow{0};
+    };
+
+    namespace {
+        std::string escape_label(std::string_view v, size_t max_len = 96) {
+            std::string out;
+            out.reserve(std::min(v.size(), max_len) + 8);
+            size_t n = 0;
+            for (char c: v) {
+                if (n++ == max_len) {
+                    out += "...";
+                    break;
+                }
+                if (c == '\\') out += "\\\\";
+                else if (c == '"') out += "\\\"";
+                else if (c == '\n' || c == '\r' || c == '\t') out.push_back(' ');
+                else out.push_back(c);
+            }
+            return out;
+        }
+
+        void append_u64(std::string &out, uint64_t v) {
+            char buf[24];
+            const int n = std::snprintf(buf, sizeof(buf), "%" PRIu64, v);
+            out.append(buf, static_cast<size_t>(n));
+        }
+
+        void append_seconds(std::string &out, uint64_t us) {
+            char buf[32];
+            const int n = std::snprintf(buf, sizeof(buf), "%.6f", static_cast<double>(us) / 1e6);
+            out.append(buf, static_cast<size_t>(n));
+        }
+
+        void append_sample(std::string &out, std::string_view name, std::string_view labels, uint64_t v) {
+            out.append(name);
+            if (!labels.empty()) {
+                out.push_back('{');
+                out.append(labels);
+                out.push_back('}');
+            }
+            out.push_back(' ');
+            append_u64(out, v);
+            out.push_back('\n');
+        }
+
+        // Cumulative buckets at powers of two (1us .. 2^33us) plus +Inf. A
+        // bucket counts every sample <= le, so the bucket starting at le is
+        // included; above the linear range that one also holds values up to
+        // le + le / 2^latency_sub_bits - 1.
+        void append_histogram(std::string &out, std::string_view name, const std::string &labels,
+                              const PgLatencySnapshot &h) {
+            const std::string sep = labels.empty() ? "" : ",";
+            uint64_t cum = 0;
+            size_t idx = 0;
+            for (unsigned p = 0; p <= 33; ++p) {
+                const uint64_t le_us = uint64_t{1} << p;
+                while (idx < detail::latency_buckets && detail::latency_bucket_lower(idx) <= le_us)
+                    cum += h.counts[idx++];
+                out.append(name);
+                out += "_bucket{";
+                out += labels;
+                out += sep;
+                out += "le=\"";
+                append_seconds(out, le_us);
+                out += "\"} ";
+                append_u64(out, cum);
+                out.push_back('\n');
+            }
+            out.append(name);
+            out += "_bucket{";
+            out += labels;
+            out += sep;
+            out += "le=\"+Inf\"} ";
+            append_u64(out, h.count);
+            out.push_back('\n');
+
+            out.append(name);
+            out += "_sum";
+            if (!labels.empty()) out += "{" + labels + "}";
+            out.push_back(' ');
+            append_seconds(out, h.sum_us);
+            out.push_back('\n');
+
+            append_sample(out, std::string(name) + "_count", labels, h.count);
+        }
+    } // namespace
+
+    PgStatsRegistry::PgStatsRegistry() {
+        this->scope_names_[0] = "default";
+    }
+
+    PgStatsRegistry &PgStatsRegistry::instance() {
+        static PgStatsRegistry reg;
+        return reg;
+    }
+
+    uint32_t PgStatsRegistry::register_scope(std::string name) {
+        std::lock_guard lk(this->mu_);
+        // pools recreated for the same endpoint keep counting into one series
+        for (uint32_t i = 1; i < this->next_scope_; ++i)
+            if (this->scope_names_[i] == name) return i;
+        if (this->next_scope_ >= max_scopes)
+            return 0;
+        const uint32_t id = this->next_scope_++;
+        this->scope_names_[id] = std::move(name);
+        return id;
+    }
+
+    void PgStatsRegistry::rename_scope(uint32_t scope, std::string name) {
+        if (scope == 0 || scope >= max_scopes)
+            return;
+        std::lock_guard lk(this->mu_);
+        this->scope_names_[scope] = std::move(name);
+    }
+
+    uint64_t PgStatsRegistry::register_pool_gauges(uint32_t scope, std::function<PgPoolGauges()> fn) {
+        std::lock_guard lk(this->mu_);
+        const uint64_t token = this->next_gauge_++;
+        this->gauges_.emplace(token, std::make_pair(scope, std::move(fn)));
+        return token;
+    }
+
+    void PgStatsRegistry::unregister_pool_gauges(uint64_t token) {
+        std::lock_guard lk(this->mu_);
+        this->gauges_.erase(token);
+    }
+
+    PgStatsRegistry::ThreadSlab *PgStatsRegistry::slab() noexcept {
+        static thread_local ThreadSlab *tls = nullptr;
+        if (!tls) [[unlikely]]
+            tls = this->slab_slow();
+        return tls;
+    }
+
+    PgStatsRegistry::ThreadSlab *PgStatsRegistry::slab_slow() noexcept {
+        // slabs outlive their threads so counters of finished threads are kept;
+        // out of memory the sample is dropped and the next query tries again
+        try {
+            auto s = std::make_unique<ThreadSlab>();
+            ThreadSlab *raw = s.get();
+            std::lock_guard lk(this->mu_);
+            this->slabs_.push_back(std::move(s));
+            return raw;
+        } catch (...) {
+            return nullptr;
+        }
+    }
+
+    PgStatsRegistry::ScopeCell *PgStatsRegistry::scope_cell(ThreadSlab &s, uint32_t scope) noexcept {
+        if (scope >= max_scopes) scope = 0;
+        ScopeCell *c = s.scopes[scope].load(std::memory_order_relaxed);
+        if (!c) [[unlikely]] {
+            c = new(std::nothrow) ScopeCell();
+            if (c) s.scopes[scope].store(c, std::memory_order_release);
+        }
+        return c;
+    }
+
+    PgStatsRegistry::FingerprintCell *
+    PgStatsRegistry::fingerprint_cell(ThreadSlab &s, uint64_t fp, std::string_view sql) noexcept {
+        constexpr size_t mask = max_fingerprints - 1;
+        static_assert((max_fingerprints & mask) == 0, "max_fingerprints must be a power of two");
+
+        size_t i = static_cast<size_t>(fp) & mask;
+        for (size_t probe = 0; probe < 8; ++probe, i = (i + 1) & mask) {
+            ThreadSlab::Slot &slot = s.fingerprints[i];
+            const uint64_t key = slot.key.load(std::memory_order_relaxed);
+            if (key == fp) [[likely]]
+                return slot.cell.load(std::memory_order_relaxed);
+            if (key != 0)
+                continue;
+
+            // first sighting on this thread: publish the cell before the key
+            auto *cell = new(std::nothrow) FingerprintCell();
+            if (!cell) return nullptr;
+            slot.cell.store(cell, std::memory_order_release);
+            slot.key.store(fp, std::memory_order_release);
+            try {
+                std::lock_guard lk(this->mu_);
+                this->fingerprint_sql_.try_emplace(fp, sql.substr(0, 256));
+            } catch (...) {
+            }
+            return cell;
+        }
+        detail::stat_add(s.fingerprint_overflow);
+        return nullptr;
+    }
+
+    void PgStatsRegistry::record_query(uint32_t scope, uint64_t fingerprint, std::string_view sql,
+                                       std::chrono::steady_clock::duration latency, const QueryResult &r,
+                                       uint64_t bytes_out, uint64_t bytes_in, uint64_t statements,
+                                       uint64_t failed) noexcept {
+        if (!this->enabled()) return;
+
+        ThreadSlab *s = this->slab();
+        ScopeCell *sc = s ? this->scope_cell(*s, scope) : nullptr;
+        if (!sc) [[unlikely]] return;
+        ScopeCell &c = *sc;
+        const auto us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        if (!r.ok && failed == 0) failed = 1;
+
+        detail::stat_add(c.queries, statements);
+        detail::stat_add(c.bytes_out, bytes_out);
+        detail::stat_add(c.bytes_in, bytes_in);
+        if (failed) {
+            detail::stat_add(c.errors, failed);
+        }
+        if (!r.ok) {
+            const auto code = static_cast<size_t>(r.code);
+            if (code < detail::error_code_count) detail::stat_add(c.by_code[code]);
+            const auto cls = static_cast<size_t>(r.err_detail.category);
+            if (cls < detail::sqlstate_class_count) detail::stat_add(c.by_class[cls]);
+        }
+        c.latency.record(us);
+
+        if (fingerprint) {
+            if (FingerprintCell *f = this->fingerprint_cell(*s, fingerprint, sql)) {
+                detail::stat_add(f->queries, statements);
+                if (failed) detail::stat_add(f->errors, failed);
+                f->latency.record(us);
+            }
+        }
+    }
+
+    void PgStatsRegistry::record_commit(uint32_t scope) noexcept {
+        if (!this->enabled()) return;
+        if (ThreadSlab *s = this->slab())
+            if (ScopeCell *c = this->scope_cell(*s, scope)) detail::stat_add(c->commits);
+    }
+
+    void PgStatsRegistry::record_rollback(uint32_t scope) noexcept {
+        if (!this->enabled()) return;
+        if (ThreadSlab *s = this->slab())
+            if (ScopeCell *c = this->scope_cell(*s, scope)) detail::stat_add(c->rollbacks);
+    }
+
+    PgLatencySnapshot PgStatsRegistry::latency(uint32_t scope) const {
+        PgLatencySnapshot out;
+        if (scope >= max_scopes) return out;
+        std::lock_guard lk(this->mu_);
+        for (const auto &s: this->slabs_)
+            if (const ScopeCell *c = s->scopes[scope].load(std::memory_order_acquire))
+                out.merge(c->latency);
+        return out;
+    }
+
+    std::string PgStatsRegistry::metrics_dump() const {
+        struct ScopeTotals {
+            bool seen{false};
+            uint64_t queries{0}, errors{0}, bytes_in{0}, bytes_out{0}, commits{0}, rollbacks{0};
+            std::array<uint64_t, detail::error_code_count> by_code{};
+            std::array<uint64_t, detail::sqlstate_class_count> by_class{};
+            PgLatencySnapshot latency;
+        };
+        struct FingerprintTotals {
+            uint64_t queries{0}, errors{0};
+            PgLatencySnapshot latency;
+        };
+
+        std::vector<ScopeTotals> scopes(max_scopes);
+        std::unordered_map<uint64_t, FingerprintTotals> fps;
+        std::array<std::string, max_scopes> names;
+        std::unordered_map<uint64_t, std::string> fp_sql;
+        std::vector<std::pair<uint32_t, PgPoolGauges> > gauges;
+        uint64_t overflow = 0;
+
+        {
+            std::lock_guard lk(this->mu_);
+            names = this->scope_names_;
+            for (const auto &s: this->slabs_) {
+                for (uint32_t i = 0; i < max_scopes; ++i) {
+                    const ScopeCell *c = s->scopes[i].load(std::memory_order_acquire);
+                    if (!c) continue;
+                    ScopeTotals &t = scopes[i];
+                    t.seen = true;
+                    t.queries += c->queries.load(std::memory_order_relaxed);
+                    t.errors += c->errors.load(std::memory_order_relaxed);
+                    t.bytes_in += c->bytes_in.load(std::memory_order_relaxed);
+                    t.bytes_out += c->bytes_out.load(std::memory_order_relaxed);
+                    t.commits += c->commits.load(std::memory_order_relaxed);
+                    t.rollbacks += c->rollbacks.load(std::memory_order_relaxed);
+                    for (size_t k = 0; k < detail::error_code_count; ++k)
+                        t.by_code[k] += c->by_code[k].load(std::memory_order_relaxed);
+                    for (size_t k = 0; k < detail::sqlstate_class_count; ++k)
+                        t.by_class[k] += c->by_class[k].load(std::memory_order_relaxed);
+                    t.latency.merge(c->latency);
+                }
+                for (const auto &slot: s->fingerprints) {
+                    const uint64_t key = slot.key.load(std::memory_order_acquire);
+                    if (!key) continue;
+                    const FingerprintCell *c = slot.cell.load(std::memory_order_acquire);
+                    FingerprintTotals &t = fps[key];
+                    t.queries += c->queries.load(std::memory_order_relaxed);
+                    t.errors += c->errors.load(std::memory_order_relaxed);
+                    t.latency.merge(c->latency);
+                }
+                overflow += s->fingerprint_overflow.load(std::memory_order_relaxed);
+            }
+            for (const auto &[key, _]: fps)
+                if (auto it = this->fingerprint_sql_.find(key); it != this->fingerprint_sql_.end())
+                    fp_sql.emplace(key, it->second);
+            // pools sharing a scope are summed so each series appears once
+            for (const auto &[token, entry]: this->gauges_) {
+                const PgPoolGauges g = entry.second();
+                auto it = std::find_if(gauges.begin(), gauges.end(),
+                                       [&](const auto &e) { return e.first == entry.first; });
+                if (it == gauges.end()) {
+                    gauges.emplace_back(entry.first, g);
+                    continue;
+                }
+                PgPoolGauges &t = it->second;
+                t.live += g.live;
+                t.idle += g.idle;
+                t.waiters += g.waiters;
+                t.acquire_waits += g.acquire_waits;
+                t.acquire_timeouts += g.acquire_timeouts;
+                t.acquire_wait_us_total += g.acquire_wait_us_total;
+                t.acquire_wait_us_max = std::max(t.acquire_wait_us_max, g.acquire_wait_us_max);
+            }
+        }
+
+        auto scope_label = [&](uint32_t i) {
+            return "pool=\"" + escape_label(names[i]) + "\"";
+        };
+
+        std::string out;
+        out.reserve(16384);
+
+        auto counter = [&](const char *name, const char *help, auto get) {
+            out += "# HELP ";
+            out += name;
+            out += ' ';
+            out += help;
+            out += "\n# TYPE ";
+            out += name;
+            out += " counter\n";
+            for (uint32_t i = 0; i < max_scopes; ++i)
+                if (scopes[i].seen) append_sample(out, name, scope_label(i), get(scopes[i]));
+        };
+
+        counter("upq_queries_total", "Statements executed.", [](const ScopeTotals &t) { return t.queries; });
+        counter("upq_query_errors_total", "Statements that failed.", [](const ScopeTotals &t) { return t.errors; });
+        counter("upq_bytes_out_total", "SQL text and parameter bytes sent.",
+                [](const ScopeTotals &t) { return t.bytes_out; });
+        counter("upq_bytes_in_total", "Result cell bytes received.", [](const ScopeTotals &t) { return t.bytes_in; });
+        counter("upq_commits_total", "Transactions committed.", [](const ScopeTotals &t) { return t.commits; });
+        counter("upq_rollbacks_total", "Transactions rolled back.", [](const ScopeTotals &t) { return t.rollbacks; });
+
+        out += "# HELP upq_errors_by_code_total Failed statements by client error code.\n"
+                "# TYPE upq_errors_by_code_total counter\n";
+        for (uint32_t i = 0; i < max_scopes; ++i) {
+            if (!scopes[i].seen) continue;
+            for (size_t k = 0; k < detail::error_code_count; ++k) {
+                if (!scopes[i].by_code[k]) continue;
+                append_sample(out, "upq_errors_by_code_total",
+                              scope_label(i) + ",code=\"" + toString(static_cast<PgErrorCode>(k)) + "\"",
+                              scopes[i].by_code[k]);
+            }
+        }
+
+        out += "# HELP upq_errors_by_sqlstate_class_total Failed statements by SQLSTATE class.\n"
+                "# TYPE upq_errors_by_sqlstate_class_total counter\n";
+        for (uint32_t i = 0; i < max_scopes; ++i) {
+            if (!scopes[i].seen) continue;
+            for (size_t k = 0; k < detail::sqlstate_class_count; ++k) {
+                if (!scopes[i].by_class[k]) continue;
+                append_sample(out, "upq_errors_by_sqlstate_class_total",
+                              scope_label(i) + ",class=\"" + toString(static_cast<PgSqlStateClass>(k)) + "\"",
+                              scopes[i].by_class[k]);
+            }
+        }
+
+        out += "# HELP upq_query_duration_seconds Statement latency per pool.\n"
+                "# TYPE upq_query_duration_seconds histogram\n";
+        for (uint32_t i = 0; i < max_scopes; ++i)
+            if (scopes[i].seen) append_histogram(out, "upq_query_duration_seconds", scope_label(i), scopes[i].latency);
+
+        out += "# HELP upq_statement_duration_seconds Statement latency per SQL fingerprint.\n"
+                "# TYPE upq_statement_duration_seconds histogram\n";
+        for (const auto &[key, t]: fps) {
+            char hex[20];
+            std::snprintf(hex, sizeof(hex), "%016" PRIx64, key);
+            std::string labels = "fingerprint=\"";
+            labels += hex;
+            labels += "\"";
+            if (auto it = fp_sql.find(key); it != fp_sql.end())
+                labels += ",query=\"" + escape_label(it->second) + "\"";
+            append_histogram(out, "upq_statement_duration_seconds", labels, t.latency);
+        }
+
+        out += "# HELP upq_statement_fingerprint_overflow_total Statements not tracked because a thread's table was full.\n"
+                "# TYPE upq_statement_fingerprint_overflow_total counter\n";
+        append_sample(out, "upq_statement_fingerprint_overflow_total", {}, overflow);
+
+        out += "# HELP upq_pool_connections Pool connections by state.\n"
+                "# TYPE upq_pool_connections gauge\n";
+        for (const auto &[scope, g]: gauges) {
+            append_sample(out, "upq_pool_connections", scope_label(scope) + ",state=\"live\"", g.live);
+            append_sample(out, "upq_pool_connections", scope_label(scope) + ",state=\"idle\"", g.idle);
+        }
+        out += "# HELP upq_pool_acquire_waiters Acquires currently queued.\n"
+                "# TYPE upq_pool_acquire_waiters gauge\n";
+        for (const auto &[scope, g]: gauges)
+            append_sample(out, "upq_pool_acquire_waiters", scope_label(scope), g.waiters);
+        out += "# HELP upq_pool_acquire_waits_total Acquires that had to queue.\n"
+                "# TYPE upq_pool_acquire_waits_total counter\n";
+        for (const auto &[scope, g]: gauges)
+            append_sample(out, "upq_pool_acquire_waits_total", scope_label(scope), g.acquire_waits);
+        out += "# HELP upq_pool_acquire_timeouts_total Acquires that hit their deadline.\n"
+                "# TYPE upq_pool_acquire_timeouts_total counter\n";
+        for (const auto &[scope, g]: gauges)
+            append_sample(out, "upq_pool_acquire_timeouts_total", scope_label(scope), g.acquire_timeouts);
+        out += "# HELP upq_pool_acquire_wait_seconds_total Time served acquires spent queued.\n"
+                "# TYPE upq_pool_acquire_wait_seconds_total counter\n";
+        for (const auto &[scope, g]: gauges) {
+            out += "upq_pool_acquire_wait_seconds_total{" + scope_label(scope) + "} ";
+            append_seconds(out, g.acquire_wait_us_total);
+            out.push_back('\n');
+        }
+        out += "# HELP upq_pool_acquire_wait_max_seconds Longest acquire wait so far.\n"
+                "# TYPE upq_pool_acquire_wait_max_seconds gauge\n";
+        for (const auto &[scope, g]: gauges) {
+            out += "upq_pool_acquire_wait_max_seconds{" + scope_label(scope) + "} ";
+            append_seconds(out, g.acquire_wait_us_max);
+            out.push_back('\n');
+        }
+
+        return out;
+    }
+} // namespace usub::pg
@@ -0,0 +1,86 @@
+#include "upq/PgStream.h"
+#include "upq/PgPool.h"
+
+#include <utility>
+
+namespace usub::pg {
+    PgRowStream::PgRowStream(PgPool *pool, std::shared_ptr<PgConnectionLibpq> conn, uint32_t batch_rows) noexcept
+        : pool_(pool)
+          , conn_(std::move(conn))
+          , batch_rows_(batch_rows ? batch_rows : 1)
+          , done_(false) {
+    }
+
+    PgRowStream::PgRowStream(PgRowStream &&o) noexcept
+        : pool_(std::exchange(o.pool_, nullptr))
+          , conn_(std::move(o.conn_))
+          , batch_rows_(o.batch_rows_)
+          , done_(std::exchange(o.done_, true))
+          , columns_(std::move(o.columns_)) {
+    }
+
+    PgRowStream &PgRowStream::operator=(PgRowStream &&o) noexcept {
+        if (this != &o) {
+            this->release();
+            this->pool_ = std::exchange(o.pool_, nullptr);
+            this->conn_ = std::move(o.conn_);
+            this->batch_rows_ = o.batch_rows_;
+            this->done_ = std::exchange(o.done_, true);
+            this->columns_ = std::move(o.columns_);
+        }
+        return *this;
+    }
+
+    PgRowStream::~PgRowStream() {
+        this->release();
+    }
+
+    void PgRowStream::release() noexcept {
+        if (!this->conn_)
+            return;
+        // an unfinished stream leaves the connection busy; the pool drops it
+        if (this->pool_)
+            this->pool_->release_connection(std::move(this->conn_));
+        this->conn_.reset();
+        this->done_ = true;
+    }
+
+    usub::uvent::task::Awaitable<PgCursorChunk> PgRowStream::next() {
+        if (this->done_ || !this->conn_) {
+            PgCursorChunk end{};
+            end.ok = true;
+            end.code = PgErrorCode::OK;
+            end.done = true;
+            co_return end;
+        }
+
+        PgCursorChunk ch = co_await this->conn_->stream_fetch_chunk(this->batch_rows_);
+        if (this->columns_.empty() && !ch.columns.empty())
+            this->columns_ = ch.columns;
+
+        if (ch.done) {
+            this->done_ = true;
+            auto conn = std::move(this->conn_);
+            if (this->pool_)
+                co_await this->pool_->release_connection_async(std::move(conn));
+        }
+
+        co_return ch;
+    }
+
+    usub::uvent::task::Awaitable<void> PgRowStream::close() {
+        if (!this->conn_) {
+            this->done_ = true;
+            co_return;
+        }
+
+        auto conn = std::move(this->conn_);
+        this->done_ = true;
+
+        if (conn->streaming())
+            (void) co_await conn->stream_close();
+
+        if (this->pool_)
+            co_await this->pool_->release_connection_async(std::move(conn));
+    }
+} // namespace usub::pg
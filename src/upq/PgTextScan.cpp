@@ -0,0 +1,110 @@
+#include "upq/PgTextScan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UPQ_TEXT_SCAN_X86 1
+#elif defined(__aarch64__) || (defined(__ARM_NEON) && defined(__ARM_ARCH_ISA_A64))
+#include <arm_neon.h>
+#define UPQ_TEXT_SCAN_NEON 1
+#endif
+
+namespace usub::pg::detail {
+    namespace {
+        inline bool is_array_special(char c) noexcept {
+            return c == ',' || c == '"' || c == '\\' || c == '{' || c == '}';
+        }
+
+        size_t scan_scalar(const char *p, size_t n) noexcept {
+            for (size_t i = 0; i < n; ++i)
+                if (is_array_special(p[i])) return i;
+            return n;
+        }
+
+#if UPQ_TEXT_SCAN_X86
+        __attribute__((target("sse4.2")))
+        size_t scan_sse42(const char *p, size_t n) noexcept {
+            const __m128i set = _mm_setr_epi8(',', '"', '\\', '{', '}', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                const int at = _mm_cmpestri(set, 5, chunk, 16,
+                                            _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+                if (at < 16) return i + static_cast<size_t>(at);
+            }
+            return i + scan_scalar(p + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        size_t scan_avx2(const char *p, size_t n) noexcept {
+            const __m256i comma = _mm256_set1_epi8(',');
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i bslash = _mm256_set1_epi8('\\');
+            const __m256i open = _mm256_set1_epi8('{');
+            const __m256i close = _mm256_set1_epi8('}');
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(c, comma), _mm256_cmpeq_epi8(c, quote));
+                hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(c, bslash));
+                hit = _mm256_or_si256(hit, _mm256_or_si256(_mm256_cmpeq_epi8(c, open), _mm256_cmpeq_epi8(c, close)));
+                const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+                if (mask) return i + static_cast<size_t>(std::countr_zero(mask));
+            }
+            return i + scan_scalar(p + i, n - i);
+        }
+#endif
+
+#if UPQ_TEXT_SCAN_NEON
+        size_t scan_neon(const char *p, size_t n) noexcept {
+            const uint8x16_t comma = vdupq_n_u8(',');
+            const uint8x16_t quote = vdupq_n_u8('"');
+            const uint8x16_t bslash = vdupq_n_u8('\\');
+            const uint8x16_t open = vdupq_n_u8('{');
+            const uint8x16_t close = vdupq_n_u8('}');
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t *>(p + i));
+                uint8x16_t hit = vorrq_u8(vceqq_u8(c, comma), vceqq_u8(c, quote));
+                hit = vorrq_u8(hit, vceqq_u8(c, bslash));
+                hit = vorrq_u8(hit, vorrq_u8(vceqq_u8(c, open), vceqq_u8(c, close)));
+                // 4 bits per byte: shift-narrow the 0xFF lanes into one u64
+                const uint64_t mask = vget_lane_u64(
+                    vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+                if (mask) return i + static_cast<size_t>(std::countr_zero(mask) >> 2);
+            }
+            return i + scan_scalar(p + i, n - i);
+        }
+#endif
+
+        struct ScanKernel {
+            size_t (*fn)(const char *, size_t) noexcept;
+            const char *name;
+        };
+
+        ScanKernel pick_scan_kernel() noexcept {
+#if UPQ_TEXT_SCAN_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return {scan_avx2, "avx2"};
+            if (__builtin_cpu_supports("sse4.2")) return {scan_sse42, "sse4.2"};
+#elif UPQ_TEXT_SCAN_NEON
+            return {scan_neon, "neon"};
+#endif
+            return {scan_scalar, "scalar"};
+        }
+
+        const ScanKernel &scan_kernel() noexcept {
+            static const ScanKernel k = pick_scan_kernel();
+            return k;
+        }
+    } // namespace
+
+    size_t scan_array_special(const char *p, size_t n) noexcept {
+        // short tokens (most numbers) are not worth a vector load
+        if (n < 16) return scan_scalar(p, n);
+        return scan_kernel().fn(p, n);
+    }
+
+    const char *text_scan_kernel() noexcept {
+        return scan_kernel().name;
+    }
+} // namespace usub::pg::detail
@@ -94,11 +94,12 @@ namespace usub::pg
             co_return std::make_optional(std::move(err));
         }
 
-        if (emulate_readonly_autocommit_)
+        if (emulate_readonly_autocommit_ || cfg_.lazy_begin)
         {
             active_ = true;
             committed_ = false;
             rolled_back_ = false;
+            begin_pending_ = !emulate_readonly_autocommit_;
             co_return std::nullopt;
         }
 
@@ -139,8 +140,11 @@ namespace usub::pg
             co_return false;
         }
 
-        if (emulate_readonly_autocommit_)
+        // lazy_begin with no statement run: nothing to commit on the server
+        if (emulate_readonly_autocommit_ || begin_pending_)
         {
+            PgStatsRegistry::instance().record_commit(pool_->stats_scope());
+            begin_pending_ = false;
             committed_ = true;
             rolled_back_ = false;
             active_ = false;
@@ -149,8 +153,14 @@ namespace usub::pg
             co_return true;
         }
 
-        QueryResult r_commit = co_await pool_->query_on(conn_, "COMMIT");
-        if (!r_commit.ok)
+        // "COMMIT; SELECT ..." runs as one simple-query round trip; the SELECT
+        // executes after the commit record is written
+        const bool want_lsn = cfg_.capture_commit_lsn && !cfg_.read_only;
+        QueryResult r_commit = co_await pool_->query_on(
+            conn_, want_lsn ? "COMMIT; SELECT pg_current_wal_insert_lsn()::text" : "COMMIT");
+        // COMMIT of an already failed transaction succeeds with the ROLLBACK
+        // tag: nothing was written, so there is no position to hand out
+        if (!r_commit.ok || r_commit.rolled_back)
         {
 
             if (is_fatal_connection_error(r_commit))
@@ -162,6 +172,7 @@ namespace usub::pg
                 co_await pool_->release_connection_async(conn_);
             }
 
+            PgStatsRegistry::instance().record_rollback(pool_->stats_scope());
             committed_ = false;
             rolled_back_ = true;
             active_ = false;
@@ -169,6 +180,11 @@ namespace usub::pg
             co_return false;
         }
 
+        PgStatsRegistry::instance().record_commit(pool_->stats_scope());
+        if (want_lsn && !r_commit.rows.empty() && !r_commit.rows[0].cols.empty())
+        {
+            if (auto lsn = PgLsn::parse(r_commit.rows[0].cols[0])) commit_lsn_ = *lsn;
+        }
         committed_ = true;
         rolled_back_ = false;
         active_ = false;
@@ -181,8 +197,11 @@ namespace usub::pg
     {
         if (!active_) co_return;
 
-        if (emulate_readonly_autocommit_)
+        PgStatsRegistry::instance().record_rollback(pool_->stats_scope());
+
+        if (emulate_readonly_autocommit_ || begin_pending_)
         {
+            begin_pending_ = false;
             committed_ = false;
             rolled_back_ = true;
             active_ = false;
@@ -234,8 +253,11 @@ namespace usub::pg
     {
         if (!active_) co_return;
 
-        if (emulate_readonly_autocommit_)
+        PgStatsRegistry::instance().record_rollback(pool_->stats_scope());
+
+        if (emulate_readonly_autocommit_ || begin_pending_)
         {
+            begin_pending_ = false;
             committed_ = false;
             rolled_back_ = true;
             active_ = false;
@@ -268,10 +290,66 @@ namespace usub::pg
         co_return;
     }
 
+    usub::uvent::task::Awaitable<std::vector<QueryResult>> PgTransaction::pipeline(PgPipeline pipeline)
+    {
+        if (!active_ || !conn_ || !conn_->connected())
+        {
+            std::vector<QueryResult> bad(pipeline.size());
+            for (auto& qr : bad)
+            {
+                qr.ok = false;
+                qr.code = PgErrorCode::InvalidFuture;
+                qr.error = "transaction not active";
+                qr.rows_valid = false;
+            }
+            co_return bad;
+        }
+
+        const bool with_begin = begin_pending_;
+        if (with_begin)
+        {
+            begin_pending_ = false;
+            auto& stmts = pipeline.statements();
+            stmts.insert(stmts.begin(), PgPipeline::make_statement(build_begin_sql(cfg_)));
+        }
+
+        std::vector<QueryResult> results = co_await pool_->pipeline_on(conn_, std::move(pipeline));
+
+        if (with_begin && !results.empty())
+        {
+            QueryResult r_begin = std::move(results.front());
+            results.erase(results.begin());
+            if (!r_begin.ok)
+            {
+                for (auto& qr : results)
+                {
+                    qr = r_begin;
+                    qr.rows_valid = false;
+                }
+                this->begin_failed(std::move(r_begin));
+                co_return results;
+            }
+        }
+
+        bool fatal = !conn_->connected();
+        for (auto& qr : results)
+            fatal = fatal || is_fatal_connection_error(qr);
+
+        if (fatal)
+        {
+            pool_->mark_dead(conn_);
+            conn_.reset();
+            active_ = false;
+            rolled_back_ = true;
+            committed_ = false;
+        }
+        co_return results;
+    }
+
     usub::uvent::task::Awaitable<bool> PgTransaction::send_sql_nocheck(const std::string& sql)
     {
         if (!active_ || !conn_ || !conn_->connected()) co_return false;
-        QueryResult r = co_await pool_->query_on(conn_, sql);
+        QueryResult r = co_await this->run_on_tx(sql);
         if (is_fatal_connection_error(r))
         {
             pool_->mark_dead(conn_);
@@ -284,6 +362,117 @@ namespace usub::pg
         co_return r.ok;
     }
 
+    usub::uvent::task::Awaitable<bool> PgTransaction::flush_begin()
+    {
+        if (!begin_pending_) co_return true;
+        begin_pending_ = false;
+
+        QueryResult r_begin = co_await pool_->query_on(conn_, build_begin_sql(cfg_));
+        if (!r_begin.ok)
+        {
+            this->begin_failed(std::move(r_begin));
+            co_return false;
+        }
+        co_return true;
+    }
+
+    QueryResult PgTransaction::begin_failed(QueryResult r)
+    {
+        if (r.ok)
+        {
+            r.ok = false;
+            r.code = PgErrorCode::ProtocolCorrupt;
+            r.error = "missing BEGIN result";
+        }
+        r.rows_valid = false;
+
+        pool_->mark_dead(conn_);
+        conn_.reset();
+        active_ = false;
+        committed_ = false;
+        rolled_back_ = false;
+        return r;
+    }
+
+    usub::uvent::task::Awaitable<QueryResult>
+    PgTransaction::finish_commit_with(std::vector<QueryResult> rs, bool with_begin, bool want_lsn)
+    {
+        const size_t first = with_begin ? 1 : 0;
+        if (rs.size() != first + 2 + (want_lsn ? 1 : 0))
+        {
+            QueryResult bad;
+            bad.ok = false;
+            bad.code = PgErrorCode::ProtocolCorrupt;
+            bad.error = "pipeline result count mismatch";
+            bad.rows_valid = false;
+            rs.assign(1, std::move(bad));
+        }
+
+        bool fatal = !conn_->connected();
+        for (auto& qr : rs)
+            fatal = fatal || is_fatal_connection_error(qr);
+
+        if (rs.size() == 1 || fatal)
+        {
+            PgStatsRegistry::instance().record_rollback(pool_->stats_scope());
+            pool_->mark_dead(conn_);
+            conn_.reset();
+            active_ = false;
+            rolled_back_ = true;
+            committed_ = false;
+            for (auto& qr : rs)
+                if (!qr.ok) co_return std::move(qr);
+            co_return std::move(rs.front());
+        }
+
+        if (with_begin && !rs[0].ok)
+            co_return this->begin_failed(std::move(rs[0]));
+
+        QueryResult& r_stmt = rs[first];
+        QueryResult& r_commit = rs[first + 1];
+
+        if (!r_stmt.ok)
+        {
+            // the pipeline skipped COMMIT; the transaction is left aborted
+            co_await this->rollback();
+            co_return std::move(r_stmt);
+        }
+
+        if (!r_commit.ok || r_commit.rolled_back)
+        {
+            if (r_commit.ok)
+            {
+                r_commit.ok = false;
+                r_commit.code = PgErrorCode::ServerError;
+                r_commit.error = "COMMIT rolled back: the transaction had already failed";
+                r_commit.rows_valid = false;
+            }
+            PgStatsRegistry::instance().record_rollback(pool_->stats_scope());
+            committed_ = false;
+            rolled_back_ = true;
+            active_ = false;
+            co_await pool_->release_connection_async(conn_);
+            conn_.reset();
+            co_return std::move(r_commit);
+        }
+
+        PgStatsRegistry::instance().record_commit(pool_->stats_scope());
+        if (want_lsn)
+        {
+            const QueryResult& r_lsn = rs[first + 2];
+            if (r_lsn.ok && !r_lsn.rows.empty() && !r_lsn.rows[0].cols.empty())
+            {
+                if (auto lsn = PgLsn::parse(r_lsn.rows[0].cols[0])) commit_lsn_ = *lsn;
+            }
+        }
+        committed_ = true;
+        rolled_back_ = false;
+        active_ = false;
+        co_await pool_->release_connection_async(conn_);
+        conn_.reset();
+        co_return std::move(r_stmt);
+    }
+
     static std::atomic<uint64_t> g_subtx_id{0};
 
     PgTransaction::PgSubtransaction PgTransaction::make_subtx()
@@ -309,7 +498,7 @@ namespace usub::pg
         if (parent_.emulate_readonly_autocommit_) co_return false;
 
         std::string cmd = "SAVEPOINT " + sp_name_;
-        QueryResult r = co_await parent_.pool_->query_on(parent_.conn_, cmd);
+        QueryResult r = co_await parent_.run_on_tx(cmd);
         if (!r.ok)
         {
             if (is_fatal_connection_error(r))
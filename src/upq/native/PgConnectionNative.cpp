@@ -0,0 +1,1191 @@
+#include "upq/native/PgConnectionNative.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#include "uvent/sync/AsyncSemaphore.h"
+
+namespace usub::pg {
+    namespace detail {
+        // Readiness helpers, as in PgConnectionLibpq: one parked coroutine
+        // per direction. One still parked after a race serves the next wait
+        // rather than putting a second awaiter on the socket.
+        struct PgNativeIoWait {
+            usub::uvent::sync::AsyncSemaphore wake{0};
+            std::atomic<short> events{0};
+            std::atomic<bool> read_parked{false};
+            std::atomic<bool> write_parked{false};
+        };
+    } // namespace detail
+
+    namespace {
+        using namespace std::chrono_literals;
+
+        constexpr size_t max_iov = 1024;  // IOV_MAX on Linux
+
+        // PgNativeIoWait::events bit set by io_timer
+        constexpr short io_timed_out = 0x4000;
+
+        template<class Header>
+        usub::uvent::task::Awaitable<void> park_readable(std::shared_ptr<detail::PgNativeIoWait> w, Header *h) {
+            co_await usub::uvent::net::detail::AwaiterRead{h};
+            w->events.fetch_or(POLLIN, std::memory_order_acq_rel);
+            w->read_parked.store(false, std::memory_order_release);
+            w->wake.release();
+        }
+
+        template<class Header>
+        usub::uvent::task::Awaitable<void> park_writable(std::shared_ptr<detail::PgNativeIoWait> w, Header *h) {
+            co_await usub::uvent::net::detail::AwaiterWrite{h};
+            w->events.fetch_or(POLLOUT, std::memory_order_acq_rel);
+            w->write_parked.store(false, std::memory_order_release);
+            w->wake.release();
+        }
+
+        // uvent sleeps cannot be cancelled; a timer that loses its race only
+        // sets a bit nobody waits for, or finds its socket already gone.
+        usub::uvent::task::Awaitable<void> io_timer(std::weak_ptr<detail::PgNativeIoWait> w,
+                                                    std::chrono::milliseconds after) {
+            co_await usub::uvent::system::this_coroutine::sleep_for(after);
+            if (auto s = w.lock()) {
+                s->events.fetch_or(io_timed_out, std::memory_order_acq_rel);
+                s->wake.release();
+            }
+        }
+
+        // Waits for `bit` through a helper left parked by the race, or reports
+        // the readiness it already saw; false when neither applies.
+        usub::uvent::task::Awaitable<bool> wait_parked(detail::PgNativeIoWait *w, short bit,
+                                                       std::atomic<bool> detail::PgNativeIoWait::*parked) {
+            if (!w) co_return false;
+            // parked first: a helper publishes its bit before clearing the flag
+            if (!(w->*parked).load(std::memory_order_acquire))
+                co_return (w->events.fetch_and(static_cast<short>(~bit), std::memory_order_acq_rel) & bit) != 0;
+            for (;;) {
+                co_await w->wake.acquire();
+                if (w->events.fetch_and(static_cast<short>(~bit), std::memory_order_acq_rel) & bit) co_return true;
+            }
+        }
+
+        int16_t read_be16(const uint8_t *p) {
+            return static_cast<int16_t>((static_cast<uint16_t>(p[0]) << 8) | p[1]);
+        }
+
+        int32_t read_i32(const uint8_t *p) { return static_cast<int32_t>(read_be32(p)); }
+
+        std::string_view as_sv(std::span<const uint8_t> b) {
+            return {reinterpret_cast<const char *>(b.data()), b.size()};
+        }
+
+        // NUL-terminated string at b[off]; off moves past the terminator.
+        std::string_view read_cstr(std::span<const uint8_t> b, size_t &off) {
+            if (off >= b.size()) return {};
+            const auto *start = b.data() + off;
+            const auto *nul = static_cast<const uint8_t *>(std::memchr(start, 0, b.size() - off));
+            if (!nul) {
+                off = b.size();
+                return {};
+            }
+            std::string_view s(reinterpret_cast<const char *>(start), static_cast<size_t>(nul - start));
+            off += s.size() + 1;
+            return s;
+        }
+
+        // ErrorResponse fields -> out, same shape as the libpq path.
+        template<class Out>
+        void fill_server_error(std::span<const uint8_t> p, Out &out) {
+            size_t off = 0;
+            while (off < p.size() && p[off] != 0) {
+                const char field = static_cast<char>(p[off++]);
+                const std::string_view v = read_cstr(p, off);
+                switch (field) {
+                    case 'C': out.err_detail.sqlstate = v;
+                        break;
+                    case 'M': out.err_detail.message = v;
+                        break;
+                    case 'D': out.err_detail.detail = v;
+                        break;
+                    case 'H': out.err_detail.hint = v;
+                        break;
+                    default: break;
+                }
+            }
+            out.ok = false;
+            out.error = out.err_detail.message.empty() ? "server error" : out.err_detail.message;
+            out.err_detail.category = classify_sqlstate(out.err_detail.sqlstate);
+            out.code = server_error_code(out.err_detail.sqlstate);
+
+            const auto &d = out.err_detail;
+            if (!d.sqlstate.empty()) out.error.append(" [SQLSTATE ").append(d.sqlstate).append("]");
+            if (!d.detail.empty()) out.error.append(" detail: ").append(d.detail);
+            if (!d.hint.empty()) out.error.append(" hint: ").append(d.hint);
+        }
+
+        // "INSERT 0 5", "UPDATE 3", "SELECT 10": trailing number, 0 if none.
+        uint64_t tag_rows(std::string_view tag) {
+            if (!tag.empty() && tag.back() == '\0') tag.remove_suffix(1);
+            const size_t sp = tag.rfind(' ');
+            if (sp == std::string_view::npos) return 0;
+            uint64_t n = 0;
+            for (char c: tag.substr(sp + 1)) {
+                if (c < '0' || c > '9') return 0;
+                n = n * 10 + static_cast<uint64_t>(c - '0');
+            }
+            return n;
+        }
+
+        bool tag_is_rollback(std::string_view tag) {
+            if (!tag.empty() && tag.back() == '\0') tag.remove_suffix(1);
+            return tag == "ROLLBACK";
+        }
+
+        std::string quote_ident(const std::string &s) {
+            std::string out;
+            out.reserve(s.size() + 2);
+            out.push_back('"');
+            for (char c: s) {
+                if (c == '"') out.push_back('"');
+                out.push_back(c);
+            }
+            out.push_back('"');
+            return out;
+        }
+
+        // ---- SCRAM-SHA-256 (RFC 5802 / 7677), no channel binding ----
+
+        using Sha256 = std::array<uint8_t, 32>;
+
+        std::string base64(const uint8_t *p, size_t n) {
+            std::string out(4 * ((n + 2) / 3), '\0');
+            const int k = EVP_EncodeBlock(reinterpret_cast<unsigned char *>(out.data()), p, static_cast<int>(n));
+            out.resize(static_cast<size_t>(std::max(k, 0)));
+            return out;
+        }
+
+        std::optional<std::vector<uint8_t> > unbase64(std::string_view s) {
+            if (s.size() % 4 != 0) return std::nullopt;
+            std::vector<uint8_t> out(s.size() / 4 * 3);
+            const int k = EVP_DecodeBlock(out.data(), reinterpret_cast<const unsigned char *>(s.data()),
+                                          static_cast<int>(s.size()));
+            if (k < 0) return std::nullopt;
+            size_t pad = 0;
+            if (!s.empty() && s.back() == '=') ++pad;
+            if (s.size() > 1 && s[s.size() - 2] == '=') ++pad;
+            out.resize(static_cast<size_t>(k) - pad);
+            return out;
+        }
+
+        Sha256 hmac_sha256(std::span<const uint8_t> key, std::string_view data) {
+            Sha256 out{};
+            unsigned int n = 0;
+            HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()),
+                 reinterpret_cast<const unsigned char *>(data.data()), data.size(), out.data(), &n);
+            return out;
+        }
+
+        Sha256 sha256(std::span<const uint8_t> data) {
+            Sha256 out{};
+            unsigned int n = 0;
+            EVP_Digest(data.data(), data.size(), out.data(), &n, EVP_sha256(), nullptr);
+            return out;
+        }
+
+        // Value of "k=..." in a comma-separated SCRAM message.
+        std::string_view scram_attr(std::string_view msg, char k) {
+            while (!msg.empty()) {
+                const size_t comma = msg.find(',');
+                const std::string_view part = msg.substr(0, comma);
+                if (part.size() >= 2 && part[0] == k && part[1] == '=') return part.substr(2);
+                if (comma == std::string_view::npos) break;
+                msg.remove_prefix(comma + 1);
+            }
+            return {};
+        }
+
+        struct ScramClient {
+            std::string client_first_bare;
+            std::string auth_message;
+            Sha256 salted{};
+
+            std::string first() {
+                uint8_t raw[18];
+                RAND_bytes(raw, sizeof raw);
+                // the server takes the user name from the startup packet
+                this->client_first_bare = "n=,r=" + base64(raw, sizeof raw);
+                return "n,," + this->client_first_bare;
+            }
+
+            std::optional<std::string> final(std::string_view server_first, const std::string &password,
+                                             std::string &err) {
+                const std::string_view nonce = scram_attr(server_first, 'r');
+                const std::string_view salt_b64 = scram_attr(server_first, 's');
+                const std::string_view iters_sv = scram_attr(server_first, 'i');
+                const std::string_view ours = scram_attr(this->client_first_bare, 'r');
+                if (nonce.size() <= ours.size() || nonce.substr(0, ours.size()) != ours) {
+                    err = "SCRAM: server nonce does not extend the client nonce";
+                    return std::nullopt;
+                }
+                const auto salt = unbase64(salt_b64);
+                const int iters = std::atoi(std::string(iters_sv).c_str());
+                if (!salt || iters <= 0) {
+                    err = "SCRAM: malformed server-first-message";
+                    return std::nullopt;
+                }
+
+                PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()), salt->data(),
+                                  static_cast<int>(salt->size()), iters, EVP_sha256(),
+                                  static_cast<int>(this->salted.size()), this->salted.data());
+
+                const Sha256 client_key = hmac_sha256(this->salted, "Client Key");
+                const Sha256 stored_key = sha256(client_key);
+
+                std::string without_proof = "c=biws,r=";
+                without_proof.append(nonce);
+                this->auth_message = this->client_first_bare;
+                this->auth_message.append(",").append(server_first).append(",").append(without_proof);
+
+                const Sha256 signature = hmac_sha256(stored_key, this->auth_message);
+                Sha256 proof{};
+                for (size_t i = 0; i < proof.size(); ++i) proof[i] = client_key[i] ^ signature[i];
+
+                return without_proof + ",p=" + base64(proof.data(), proof.size());
+            }
+
+            [[nodiscard]] bool verify(std::string_view server_final) const {
+                const Sha256 server_key = hmac_sha256(this->salted, "Server Key");
+                const Sha256 expected = hmac_sha256(server_key, this->auth_message);
+                return scram_attr(server_final, 'v') == base64(expected.data(), expected.size());
+            }
+        };
+
+        QueryResult transport_result(const PgWireError &e) {
+            QueryResult r;
+            r.ok = false;
+            r.code = e.code;
+            r.error = e.message;
+            r.rows_valid = false;
+            return r;
+        }
+
+        PgCopyResult transport_copy(const PgWireError &e) {
+            PgCopyResult r;
+            r.ok = false;
+            r.code = e.code;
+            r.error = e.message;
+            return r;
+        }
+    } // namespace
+
+    // ---- buffers ----
+
+    std::span<uint8_t> PgWireRecvBuffer::prepare(size_t min) {
+        if (this->buf_.size() - this->tail_ < min && this->head_ > 0) {
+            std::memmove(this->buf_.data(), this->buf_.data() + this->head_, this->tail_ - this->head_);
+            this->tail_ -= this->head_;
+            this->head_ = 0;
+        }
+        if (this->buf_.size() - this->tail_ < min)
+            this->buf_.resize(std::max(this->buf_.size() * 2, this->tail_ + min));
+        return {this->buf_.data() + this->tail_, this->buf_.size() - this->tail_};
+    }
+
+    void PgWireSendBuffer::put(const void *p, size_t n) {
+        const auto *b = static_cast<const uint8_t *>(p);
+        this->buf_.insert(this->buf_.end(), b, b + n);
+        this->frame_bytes_ += n;
+    }
+
+    void PgWireSendBuffer::begin(char type) {
+        this->put_u8(static_cast<uint8_t>(type));
+        this->len_at_ = this->buf_.size();
+        this->frame_bytes_ = 0;
+        const uint8_t placeholder[4]{};
+        this->put(placeholder, sizeof placeholder);
+    }
+
+    void PgWireSendBuffer::end() {
+        write_be32(this->buf_.data() + this->len_at_, static_cast<uint32_t>(this->frame_bytes_));
+    }
+
+    void PgWireSendBuffer::put_i16(int16_t v) {
+        const uint8_t b[2]{static_cast<uint8_t>(static_cast<uint16_t>(v) >> 8), static_cast<uint8_t>(v)};
+        this->put(b, sizeof b);
+    }
+
+    void PgWireSendBuffer::put_i32(int32_t v) {
+        uint8_t b[4];
+        write_be32(b, static_cast<uint32_t>(v));
+        this->put(b, sizeof b);
+    }
+
+    void PgWireSendBuffer::put_cstr(std::string_view s) {
+        this->put(s.data(), s.size());
+        this->put_u8(0);
+    }
+
+    void PgWireSendBuffer::put_ref(const void *p, size_t n) {
+        if (n < ref_threshold) {
+            this->put(p, n);
+            return;
+        }
+        this->close_inline();
+        this->segs_.push_back(Seg{static_cast<const uint8_t *>(p), 0, n});
+        this->frame_bytes_ += n;
+    }
+
+    void PgWireSendBuffer::close_inline() {
+        if (this->buf_.size() > this->inline_start_)
+            this->segs_.push_back(Seg{nullptr, this->inline_start_, this->buf_.size() - this->inline_start_});
+        this->inline_start_ = this->buf_.size();
+    }
+
+    void PgWireSendBuffer::clear() noexcept {
+        this->buf_.clear();
+        this->segs_.clear();
+        this->inline_start_ = 0;
+        this->len_at_ = 0;
+        this->frame_bytes_ = 0;
+    }
+
+    void PgWireSendBuffer::iovecs(std::vector<iovec> &out) {
+        this->close_inline();
+        out.clear();
+        out.reserve(this->segs_.size());
+        for (const auto &s: this->segs_) {
+            const uint8_t *base = s.ext ? s.ext : this->buf_.data() + s.off;
+            out.push_back(iovec{const_cast<uint8_t *>(base), s.len});
+        }
+    }
+
+    // ---- connection ----
+
+    PgConnectionNative::PgConnectionNative() = default;
+
+    PgConnectionNative::~PgConnectionNative() {
+        this->close();
+    }
+
+    std::string_view PgConnectionNative::server_parameter(const std::string &name) const {
+        const auto it = this->params_.find(name);
+        return it == this->params_.end() ? std::string_view{} : std::string_view{it->second};
+    }
+
+    void PgConnectionNative::fail_transport(PgErrorCode code, std::string msg) {
+        this->connected_ = false;
+        this->last_error_.code = code;
+        this->last_error_.message = std::move(msg);
+    }
+
+    usub::uvent::task::Awaitable<std::optional<std::string> >
+    PgConnectionNative::connect_async(PgNativeConfig cfg) {
+        this->close();
+
+        // numeric only: a name lookup would block the event loop
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+        addrinfo *res = nullptr;
+        if (const int rc = ::getaddrinfo(cfg.host.c_str(), cfg.port.c_str(), &hints, &res); rc != 0) {
+            if (rc == EAI_NONAME)
+                co_return std::optional<std::string>{
+                    "host \"" + cfg.host + "\" / port \"" + cfg.port + "\" must be numeric; names are not resolved"
+                };
+            co_return std::optional<std::string>{std::string("getaddrinfo: ") + ::gai_strerror(rc)};
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + cfg.connect_timeout;
+        std::string err = "no address for host";
+        for (addrinfo *ai = res; ai && !this->connected_; ai = ai->ai_next) {
+            const int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) {
+                err = std::string("socket: ") + std::strerror(errno);
+                continue;
+            }
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0 && errno != EINPROGRESS) {
+                err = std::string("connect: ") + std::strerror(errno);
+                ::close(fd);
+                continue;
+            }
+
+            this->fd_ = fd;
+            this->sock_ = std::make_unique<
+                usub::uvent::net::Socket<
+                    usub::uvent::net::Proto::TCP,
+                    usub::uvent::net::Role::ACTIVE
+                >
+            >(fd);
+            this->io_wait_ = std::make_shared<detail::PgNativeIoWait>();
+
+            // the connect completes when the socket turns writable
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0 || co_await this->wait_writable_for(left) == 0) {
+                err = "connect timeout";
+            } else {
+                int so = 0;
+                socklen_t sl = sizeof so;
+                ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &so, &sl);
+                if (so == 0) this->connected_ = true;
+                else err = std::string("connect: ") + std::strerror(so);
+            }
+            if (!this->connected_) this->close();
+        }
+        ::freeaddrinfo(res);
+        if (!this->connected_) co_return std::optional<std::string>{std::move(err)};
+
+        const int one = 1;
+        ::setsockopt(this->fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+        if (auto e = co_await this->startup(cfg)) {
+            this->close();
+            co_return e;
+        }
+        co_return std::nullopt;
+    }
+
+    usub::uvent::task::Awaitable<std::optional<std::string> >
+    PgConnectionNative::startup(const PgNativeConfig &cfg) {
+        this->tx_.clear();
+        this->tx_.put_raw(build_startup_message(cfg.user, cfg.db));
+        if (!co_await this->flush()) co_return std::optional<std::string>{this->last_error_.message};
+
+        ScramClient scram;
+        for (;;) {
+            auto f = co_await this->next_frame();
+            if (!f.ok) co_return std::optional<std::string>{f.err.message};
+            const auto p = f.value.payload;
+
+            switch (f.value.type) {
+                case 'R': {
+                    if (p.size() < 4) co_return std::optional<std::string>{"short authentication request"};
+                    const int32_t kind = read_i32(p.data());
+                    if (kind == 0) break; // AuthenticationOk
+
+                    if (kind == 3) {
+                        this->tx_.put_raw(build_password_message(cfg.password));
+                    } else if (kind == 5) {
+                        if (p.size() < 8) co_return std::optional<std::string>{"short MD5 salt"};
+                        this->tx_.put_raw(build_md5_password_message(cfg.user, cfg.password, p.data() + 4));
+                    } else if (kind == 10) {
+                        bool offered = false;
+                        size_t off = 4;
+                        while (off < p.size()) {
+                            const std::string_view mech = read_cstr(p, off);
+                            if (mech.empty()) break;
+                            if (mech == "SCRAM-SHA-256") offered = true;
+                        }
+                        if (!offered)
+                            co_return std::optional<std::string>{"server offers no SCRAM-SHA-256 (channel binding is unsupported)"};
+                        const std::string first = scram.first();
+                        this->tx_.begin('p');
+                        this->tx_.put_cstr("SCRAM-SHA-256");
+                        this->tx_.put_i32(static_cast<int32_t>(first.size()));
+                        this->tx_.put_bytes(first.data(), first.size());
+                        this->tx_.end();
+                    } else if (kind == 11) {
+                        std::string err;
+                        const auto fin = scram.final(as_sv(p.subspan(4)), cfg.password, err);
+                        if (!fin) co_return std::optional<std::string>{std::move(err)};
+                        this->tx_.begin('p');
+                        this->tx_.put_bytes(fin->data(), fin->size());
+                        this->tx_.end();
+                    } else if (kind == 12) {
+                        if (!scram.verify(as_sv(p.subspan(4))))
+                            co_return std::optional<std::string>{"SCRAM: server signature mismatch"};
+                        break;
+                    } else {
+                        co_return std::optional<std::string>{
+                            "unsupported authentication request " + std::to_string(kind)
+                        };
+                    }
+                    if (!co_await this->flush()) co_return std::optional<std::string>{this->last_error_.message};
+                    break;
+                }
+                case 'K':
+                    if (p.size() >= 8) {
+                        this->backend_pid_ = read_i32(p.data());
+                        this->backend_key_ = read_i32(p.data() + 4);
+                    }
+                    break;
+                case 'E': {
+                    QueryResult r;
+                    fill_server_error(p, r);
+                    co_return std::optional<std::string>{std::move(r.error)};
+                }
+                case 'Z':
+                    co_return std::nullopt;
+                default:
+                    break;
+            }
+        }
+    }
+
+    usub::uvent::task::Awaitable<bool> PgConnectionNative::fill(size_t need) {
+        const auto room = this->rx_.prepare(std::max<size_t>(need, 16 * 1024));
+        for (;;) {
+            const ssize_t r = ::recv(this->fd_, room.data(), room.size(), 0);
+            if (r > 0) {
+                this->rx_.commit(static_cast<size_t>(r));
+                co_return true;
+            }
+            if (r == 0) {
+                this->fail_transport(PgErrorCode::ConnectionClosed, "server closed the connection");
+                co_return false;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await this->wait_readable();
+                continue;
+            }
+            this->fail_transport(PgErrorCode::SocketReadFailed, std::string("recv: ") + std::strerror(errno));
+            co_return false;
+        }
+    }
+
+    usub::uvent::task::Awaitable<void> PgConnectionNative::wait_readable() {
+        if (co_await wait_parked(this->io_wait_.get(), POLLIN, &detail::PgNativeIoWait::read_parked)) co_return;
+        co_await usub::uvent::net::detail::AwaiterRead{this->sock_->get_raw_header()};
+    }
+
+    usub::uvent::task::Awaitable<void> PgConnectionNative::wait_writable() {
+        if (co_await wait_parked(this->io_wait_.get(), POLLOUT, &detail::PgNativeIoWait::write_parked)) co_return;
+        co_await usub::uvent::net::detail::AwaiterWrite{this->sock_->get_raw_header()};
+    }
+
+    usub::uvent::task::Awaitable<short> PgConnectionNative::wait_readable_or_writable() {
+        if (!this->io_wait_) this->io_wait_ = std::make_shared<detail::PgNativeIoWait>();
+        auto &w = *this->io_wait_;
+        auto *h = this->sock_->get_raw_header();
+        if (!w.read_parked.exchange(true, std::memory_order_acq_rel))
+            usub::uvent::system::co_spawn(park_readable(this->io_wait_, h));
+        if (!w.write_parked.exchange(true, std::memory_order_acq_rel))
+            usub::uvent::system::co_spawn(park_writable(this->io_wait_, h));
+        for (;;) {
+            co_await w.wake.acquire();
+            // a permit whose bit an earlier wake already took carries nothing
+            constexpr short io = POLLIN | POLLOUT;
+            if (const short ev = w.events.fetch_and(static_cast<short>(~io), std::memory_order_acq_rel) & io)
+                co_return ev;
+        }
+    }
+
+    usub::uvent::task::Awaitable<short> PgConnectionNative::wait_writable_for(std::chrono::milliseconds timeout) {
+        if (!this->io_wait_) this->io_wait_ = std::make_shared<detail::PgNativeIoWait>();
+        auto &w = *this->io_wait_;
+        if (!w.write_parked.exchange(true, std::memory_order_acq_rel))
+            usub::uvent::system::co_spawn(park_writable(this->io_wait_, this->sock_->get_raw_header()));
+        usub::uvent::system::co_spawn(io_timer(this->io_wait_, timeout));
+        for (;;) {
+            co_await w.wake.acquire();
+            constexpr short bits = POLLOUT | io_timed_out;
+            const short ev = w.events.fetch_and(static_cast<short>(~bits), std::memory_order_acq_rel) & bits;
+            if (ev & POLLOUT) co_return POLLOUT;
+            if (ev) co_return 0;
+        }
+    }
+
+    bool PgConnectionNative::stash_input() {
+        if (this->pending_consume_) {
+            this->rx_.consume(this->pending_consume_);
+            this->pending_consume_ = 0;
+        }
+        for (;;) {
+            const auto room = this->rx_.prepare(16 * 1024);
+            const ssize_t r = ::recv(this->fd_, room.data(), room.size(), MSG_DONTWAIT);
+            if (r > 0) {
+                this->rx_.commit(static_cast<size_t>(r));
+                continue;
+            }
+            if (r == 0) {
+                this->fail_transport(PgErrorCode::ConnectionClosed, "server closed the connection");
+                return false;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            this->fail_transport(PgErrorCode::SocketReadFailed, std::string("recv: ") + std::strerror(errno));
+            return false;
+        }
+    }
+
+    usub::uvent::task::Awaitable<bool> PgConnectionNative::flush(bool keep_reading) {
+        this->tx_.iovecs(this->iov_);
+        size_t i = 0;
+        while (i < this->iov_.size()) {
+            msghdr m{};
+            m.msg_iov = this->iov_.data() + i;
+            m.msg_iovlen = std::min(this->iov_.size() - i, max_iov);
+            const ssize_t w = ::sendmsg(this->fd_, &m, MSG_NOSIGNAL);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                if ((errno == EAGAIN || errno == EWOULDBLOCK) && !keep_reading) {
+                    co_await this->wait_writable();
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    // The server stops reading while its own sends block, so
+                    // waiting only for POLLOUT can deadlock on a large
+                    // pipeline. Like libpq's pqSendSome, wait for either
+                    // direction and pull its responses into rx_ as they come.
+                    const short ev = co_await this->wait_readable_or_writable();
+                    if ((ev & POLLIN) && !this->stash_input()) {
+                        this->tx_.clear();
+                        co_return false;
+                    }
+                    continue;
+                }
+                this->tx_.clear();
+                this->fail_transport(PgErrorCode::ConnectionClosed, std::string("send: ") + std::strerror(errno));
+                co_return false;
+            }
+            size_t left = static_cast<size_t>(w);
+            while (i < this->iov_.size() && left >= this->iov_[i].iov_len) left -= this->iov_[i++].iov_len;
+            if (left) {
+                this->iov_[i].iov_base = static_cast<uint8_t *>(this->iov_[i].iov_base) + left;
+                this->iov_[i].iov_len -= left;
+            }
+        }
+        this->tx_.clear();
+        co_return true;
+    }
+
+    usub::uvent::task::Awaitable<PgWireResult<PgConnectionNative::Frame> > PgConnectionNative::next_frame() {
+        PgWireResult<Frame> out;
+        if (!this->sock_) {
+            out.err = {PgErrorCode::ConnectionClosed, "not connected"};
+            co_return out;
+        }
+        for (;;) {
+            if (this->pending_consume_) {
+                this->rx_.consume(this->pending_consume_);
+                this->pending_consume_ = 0;
+            }
+
+            size_t need = 5;
+            const auto b = this->rx_.readable();
+            if (b.size() >= 5) {
+                const uint32_t len = read_be32(b.data() + 1);
+                if (len < 4) {
+                    this->fail_transport(PgErrorCode::ProtocolCorrupt, "frame length below 4");
+                    out.err = this->last_error_;
+                    co_return out;
+                }
+                need = 1 + static_cast<size_t>(len);
+                if (b.size() >= need) {
+                    const Frame f{static_cast<char>(b[0]), b.subspan(5, len - 4)};
+                    this->pending_consume_ = need;
+                    switch (f.type) {
+                        case 'N':
+                            continue;
+                        case 'S': {
+                            size_t off = 0;
+                            const std::string_view k = read_cstr(f.payload, off);
+                            const std::string_view v = read_cstr(f.payload, off);
+                            this->params_[std::string(k)] = std::string(v);
+                            continue;
+                        }
+                        case 'A': {
+                            if (f.payload.size() >= 4) {
+                                PgNotification n;
+                                n.backend_pid = read_i32(f.payload.data());
+                                size_t off = 4;
+                                n.channel = read_cstr(f.payload, off);
+                                n.payload = read_cstr(f.payload, off);
+                                this->notifications_.push_back(std::move(n));
+                            }
+                            continue;
+                        }
+                        default:
+                            out.value = f;
+                            out.ok = true;
+                            co_return out;
+                    }
+                }
+            }
+            if (!co_await this->fill(need - b.size())) {
+                out.err = this->last_error_;
+                co_return out;
+            }
+        }
+    }
+
+    usub::uvent::task::Awaitable<bool> PgConnectionNative::read_until_ready() {
+        for (;;) {
+            auto f = co_await this->next_frame();
+            if (!f.ok) co_return false;
+            if (f.value.type == 'Z') co_return true;
+        }
+    }
+
+    void PgConnectionNative::put_extended(const std::string &sql, int n, const char *const *values,
+                                          const int *lengths, const int *formats, const Oid *types) {
+        auto &tx = this->tx_;
+
+        tx.begin('P');
+        tx.put_u8(0); // unnamed statement
+        tx.put_cstr(sql);
+        tx.put_i16(static_cast<int16_t>(n));
+        for (int i = 0; i < n; ++i) tx.put_i32(types ? static_cast<int32_t>(types[i]) : 0);
+        tx.end();
+
+        tx.begin('B');
+        tx.put_u8(0); // unnamed portal
+        tx.put_u8(0);
+        tx.put_i16(static_cast<int16_t>(n));
+        for (int i = 0; i < n; ++i) tx.put_i16(static_cast<int16_t>(formats ? formats[i] : 0));
+        tx.put_i16(static_cast<int16_t>(n));
+        for (int i = 0; i < n; ++i) {
+            if (!values[i]) {
+                tx.put_i32(-1);
+                continue;
+            }
+            const size_t len = formats && formats[i] ? static_cast<size_t>(lengths[i]) : std::strlen(values[i]);
+            tx.put_i32(static_cast<int32_t>(len));
+            tx.put_ref(values[i], len);
+        }
+        tx.put_i16(1);
+        tx.put_i16(static_cast<int16_t>(this->result_format_));
+        tx.end();
+
+        tx.begin('D');
+        tx.put_u8('P');
+        tx.put_u8(0);
+        tx.end();
+
+        tx.begin('E');
+        tx.put_u8(0);
+        tx.put_i32(0); // all rows
+        tx.end();
+    }
+
+    void PgConnectionNative::put_sync() {
+        this->tx_.begin('S');
+        this->tx_.end();
+    }
+
+    usub::uvent::task::Awaitable<PgConnectionNative::StmtEnd>
+    PgConnectionNative::read_statement(QueryResult &out, const RowFn *on_row) {
+        out.ok = false;
+        out.code = PgErrorCode::Unknown;
+
+        for (;;) {
+            auto f = co_await this->next_frame();
+            if (!f.ok) {
+                out = transport_result(f.err);
+                co_return StmtEnd::Broken;
+            }
+            const auto p = f.value.payload;
+
+            switch (f.value.type) {
+                case '1': // ParseComplete
+                case '2': // BindComplete
+                case 'n': // NoData
+                case 'H': // CopyOutResponse / CopyData / CopyDone in a simple query
+                case 'd':
+                case 'c':
+                    break;
+                case 'G': {
+                    // COPY FROM STDIN outside copy_in_start
+                    this->tx_.begin('f');
+                    this->tx_.put_cstr("use copy_in_start for COPY FROM STDIN");
+                    this->tx_.end();
+                    if (!co_await this->flush()) {
+                        out = transport_result(this->last_error_);
+                        co_return StmtEnd::Broken;
+                    }
+                    break;
+                }
+                case 'T': {
+                    if (p.size() < 2) break;
+                    const int16_t n = read_be16(p.data());
+                    out.columns.clear();
+                    out.column_oids.clear();
+                    out.columns.reserve(static_cast<size_t>(n));
+                    out.column_oids.reserve(static_cast<size_t>(n));
+                    size_t off = 2;
+                    int16_t fmt = 0;
+                    for (int16_t i = 0; i < n && off < p.size(); ++i) {
+                        out.columns.emplace_back(read_cstr(p, off));
+                        if (off + 18 > p.size()) break;
+                        out.column_oids.push_back(read_be32(p.data() + off + 6));
+                        fmt = read_be16(p.data() + off + 16);
+                        off += 18;
+                    }
+                    out.binary = fmt == 1;
+                    break;
+                }
+                case 'D': {
+                    if (p.size() < 2) break;
+                    const int16_t n = read_be16(p.data());
+                    size_t off = 2;
+                    if (on_row) {
+                        auto &row = this->row_;
+                        row.cells_.clear();
+                        for (int16_t i = 0; i < n && off + 4 <= p.size(); ++i) {
+                            const int32_t len = read_i32(p.data() + off);
+                            off += 4;
+                            if (len < 0) {
+                                row.cells_.emplace_back();
+                                continue;
+                            }
+                            row.cells_.emplace_back(reinterpret_cast<const char *>(p.data() + off),
+                                                    static_cast<size_t>(len));
+                            off += static_cast<size_t>(len);
+                        }
+                        row.columns_ = &out.columns;
+                        row.oids_ = &out.column_oids;
+                        row.binary_ = out.binary;
+                        (*on_row)(row);
+                        ++out.rows_affected;
+                    } else {
+                        QueryResult::Row row;
+                        row.cols.reserve(static_cast<size_t>(n));
+                        for (int16_t i = 0; i < n && off + 4 <= p.size(); ++i) {
+                            const int32_t len = read_i32(p.data() + off);
+                            off += 4;
+                            if (len < 0) {
+                                row.cols.emplace_back();
+                                continue;
+                            }
+                            row.cols.emplace_back(reinterpret_cast<const char *>(p.data() + off),
+                                                  static_cast<size_t>(len));
+                            off += static_cast<size_t>(len);
+                        }
+                        out.rows.push_back(std::move(row));
+                    }
+                    break;
+                }
+                case 'C':
+                    out.ok = true;
+                    out.code = PgErrorCode::OK;
+                    out.rows_affected = tag_rows(as_sv(p));
+                    out.rolled_back = tag_is_rollback(as_sv(p));
+                    co_return StmtEnd::Done;
+                case 'I':
+                    out.ok = true;
+                    out.code = PgErrorCode::OK;
+                    co_return StmtEnd::Done;
+                case 'E':
+                    fill_server_error(p, out);
+                    out.rows_valid = false;
+                    co_return StmtEnd::Done;
+                case 'Z':
+                    co_return StmtEnd::Ready;
+                default:
+                    break;
+            }
+        }
+    }
+
+    usub::uvent::task::Awaitable<QueryResult>
+    PgConnectionNative::exec_params(const std::string &sql, int n, const char *const *values, const int *lengths,
+                                    const int *formats, const Oid *types, const RowFn *on_row) {
+        if (!this->connected_) co_return transport_result({PgErrorCode::ConnectionClosed, "not connected"});
+
+        this->tx_.clear();
+        this->put_extended(sql, n, values, lengths, formats, types);
+        this->put_sync();
+        if (!co_await this->flush()) co_return transport_result(this->last_error_);
+
+        QueryResult out;
+        const StmtEnd end = co_await this->read_statement(out, on_row);
+        if (end == StmtEnd::Broken) co_return out;
+        if (end == StmtEnd::Ready) {
+            out = transport_result({PgErrorCode::ProtocolCorrupt, "no result before ReadyForQuery"});
+            co_return out;
+        }
+        if (!co_await this->read_until_ready()) co_return transport_result(this->last_error_);
+        co_return out;
+    }
+
+    usub::uvent::task::Awaitable<QueryResult> PgConnectionNative::exec_simple_query_nonblocking(const std::string &sql) {
+        if (!this->connected_) co_return transport_result({PgErrorCode::ConnectionClosed, "not connected"});
+
+        this->tx_.clear();
+        this->tx_.begin('Q');
+        this->tx_.put_cstr(sql);
+        this->tx_.end();
+        if (!co_await this->flush()) co_return transport_result(this->last_error_);
+
+        // last statement's result; rows_affected summed; the first error wins
+        QueryResult out;
+        out.ok = true;
+        out.code = PgErrorCode::OK;
+        uint64_t affected = 0;
+        bool rolled_back = false;
+        bool failed = false;
+        for (;;) {
+            QueryResult cur;
+            const StmtEnd end = co_await this->read_statement(cur, nullptr);
+            if (end == StmtEnd::Broken) co_return cur;
+            if (end == StmtEnd::Ready) break;
+            affected += cur.rows_affected;
+            rolled_back = rolled_back || cur.rolled_back;
+            if (!failed) {
+                failed = !cur.ok;
+                out = std::move(cur);
+            }
+        }
+        if (out.ok) {
+            out.rows_affected = affected;
+            out.rolled_back = rolled_back;
+        }
+        co_return out;
+    }
+
+    usub::uvent::task::Awaitable<std::vector<QueryResult> >
+    PgConnectionNative::exec_pipeline_nonblocking(PgPipeline pipeline) {
+        const auto &stmts = pipeline.statements();
+        std::vector<QueryResult> results(stmts.size());
+        if (stmts.empty()) co_return results;
+
+        auto fail_from = [&](size_t k, const PgWireError &e) {
+            for (; k < results.size(); ++k) results[k] = transport_result(e);
+        };
+
+        if (!this->connected_) {
+            fail_from(0, {PgErrorCode::ConnectionClosed, "not connected"});
+            co_return results;
+        }
+
+        this->tx_.clear();
+        for (size_t i = 0; i < stmts.size(); ++i) {
+            const auto &st = stmts[i];
+            this->put_extended(st.sql, st.n_params, st.values.data(), st.lengths.data(), st.formats.data(),
+                               st.types.data());
+            if (st.sync_after || i + 1 == stmts.size()) this->put_sync();
+        }
+        if (!co_await this->flush(true)) {
+            fail_from(0, this->last_error_);
+            co_return results;
+        }
+
+        for (size_t i = 0; i < stmts.size();) {
+            size_t seg_end = i;
+            while (seg_end + 1 < stmts.size() && !stmts[seg_end].sync_after) ++seg_end;
+
+            // after an error the server skips to the segment's Sync
+            bool aborted = false;
+            bool ready = false;
+            for (size_t k = i; k <= seg_end; ++k) {
+                if (!aborted) {
+                    const StmtEnd end = co_await this->read_statement(results[k], nullptr);
+                    if (end == StmtEnd::Broken) {
+                        fail_from(k, this->last_error_);
+                        co_return results;
+                    }
+                    ready = end == StmtEnd::Ready;
+                    if (end == StmtEnd::Done) {
+                        aborted = !results[k].ok;
+                        continue;
+                    }
+                }
+                auto &r = results[k];
+                r.ok = false;
+                r.code = PgErrorCode::ServerError;
+                r.error = "pipeline aborted: an earlier statement in the same sync segment failed";
+                r.rows_valid = false;
+                aborted = true;
+            }
+            if (!ready && !co_await this->read_until_ready()) {
+                fail_from(seg_end + 1, this->last_error_);
+                co_return results;
+            }
+            i = seg_end + 1;
+        }
+        co_return results;
+    }
+
+    usub::uvent::task::Awaitable<PgCopyResult> PgConnectionNative::copy_in_start(const std::string &sql) {
+        if (!this->connected_) co_return transport_copy({PgErrorCode::ConnectionClosed, "not connected"});
+
+        this->tx_.clear();
+        this->tx_.begin('Q');
+        this->tx_.put_cstr(sql);
+        this->tx_.end();
+        if (!co_await this->flush()) co_return transport_copy(this->last_error_);
+
+        PgCopyResult out;
+        for (;;) {
+            auto f = co_await this->next_frame();
+            if (!f.ok) co_return transport_copy(f.err);
+            switch (f.value.type) {
+                case 'G':
+                    out.ok = true;
+                    out.code = PgErrorCode::OK;
+                    co_return out;
+                case 'E':
+                    fill_server_error(f.value.payload, out);
+                    if (!co_await this->read_until_ready()) co_return transport_copy(this->last_error_);
+                    co_return out;
+                case 'Z':
+                    out.ok = false;
+                    out.code = PgErrorCode::ProtocolCorrupt;
+                    out.error = "statement is not COPY FROM STDIN";
+                    co_return out;
+                default:
+                    break;
+            }
+        }
+    }
+
+    usub::uvent::task::Awaitable<PgCopyResult> PgConnectionNative::copy_in_send_chunk(const void *data, size_t len) {
+        if (!this->connected_) co_return transport_copy({PgErrorCode::ConnectionClosed, "not connected"});
+
+        this->tx_.clear();
+        this->tx_.begin('d');
+        this->tx_.put_ref(data, len);
+        this->tx_.end();
+        if (!co_await this->flush()) co_return transport_copy(this->last_error_);
+
+        PgCopyResult out;
+        out.ok = true;
+        out.code = PgErrorCode::OK;
+        co_return out;
+    }
+
+    usub::uvent::task::Awaitable<PgCopyResult> PgConnectionNative::copy_in_finish() {
+        if (!this->connected_) co_return transport_copy({PgErrorCode::ConnectionClosed, "not connected"});
+
+        this->tx_.clear();
+        this->tx_.begin('c');
+        this->tx_.end();
+        if (!co_await this->flush()) co_return transport_copy(this->last_error_);
+
+        QueryResult qr;
+        const StmtEnd end = co_await this->read_statement(qr, nullptr);
+        if (end == StmtEnd::Broken) co_return transport_copy(this->last_error_);
+        if (end == StmtEnd::Done && !co_await this->read_until_ready()) co_return transport_copy(this->last_error_);
+
+        PgCopyResult out;
+        out.ok = qr.ok;
+        out.code = qr.code;
+        out.error = std::move(qr.error);
+        out.err_detail = std::move(qr.err_detail);
+        out.rows_affected = qr.rows_affected;
+        co_return out;
+    }
+
+    usub::uvent::task::Awaitable<PgCopyResult> PgConnectionNative::copy_out_start(const std::string &sql) {
+        if (!this->connected_) co_return transport_copy({PgErrorCode::ConnectionClosed, "not connected"});
+
+        this->tx_.clear();
+        this->tx_.begin('Q');
+        this->tx_.put_cstr(sql);
+        this->tx_.end();
+        if (!co_await this->flush()) co_return transport_copy(this->last_error_);
+
+        PgCopyResult out;
+        for (;;) {
+            auto f = co_await this->next_frame();
+            if (!f.ok) co_return transport_copy(f.err);
+            switch (f.value.type) {
+                case 'H':
+                    out.ok = true;
+                    out.code = PgErrorCode::OK;
+                    co_return out;
+                case 'E':
+                    fill_server_error(f.value.payload, out);
+                    if (!co_await this->read_until_ready()) co_return transport_copy(this->last_error_);
+                    co_return out;
+                case 'Z':
+                    out.ok = false;
+                    out.code = PgErrorCode::ProtocolCorrupt;
+                    out.error = "statement is not COPY TO STDOUT";
+                    co_return out;
+                default:
+                    break;
+            }
+        }
+    }
+
+    usub::uvent::task::Awaitable<PgWireResult<std::vector<uint8_t> > > PgConnectionNative::copy_out_read_chunk() {
+        PgWireResult<std::vector<uint8_t> > out;
+        for (;;) {
+            auto f = co_await this->next_frame();
+            if (!f.ok) {
+                out.err = f.err;
+                co_return out;
+            }
+            const auto p = f.value.payload;
+            switch (f.value.type) {
+                case 'd':
+                    out.value.assign(p.begin(), p.end());
+                    out.ok = true;
+                    co_return out;
+                case 'E': {
+                    PgCopyResult e;
+                    fill_server_error(p, e);
+                    out.err = {e.code, std::move(e.error)};
+                    co_await this->read_until_ready();
+                    co_return out;
+                }
+                case 'Z':
+                    out.ok = true;
+                    co_return out;
+                default: // CopyDone, CommandComplete
+                    break;
+            }
+        }
+    }
+
+    usub::uvent::task::Awaitable<QueryResult> PgConnectionNative::listen(const std::string &channel) {
+        co_return co_await this->exec_simple_query_nonblocking("LISTEN " + quote_ident(channel));
+    }
+
+    usub::uvent::task::Awaitable<PgWireResult<PgNotification> > PgConnectionNative::wait_notification() {
+        PgWireResult<PgNotification> out;
+        while (this->notifications_.empty()) {
+            auto f = co_await this->next_frame();
+            if (!f.ok) {
+                out.err = f.err;
+                co_return out;
+            }
+        }
+        out.value = std::move(this->notifications_.front());
+        this->notifications_.pop_front();
+        out.ok = true;
+        co_return out;
+    }
+
+    void PgConnectionNative::close() {
+        if (this->connected_ && this->fd_ >= 0) {
+            // Terminate, best effort
+            const uint8_t terminate[5]{'X', 0, 0, 0, 4};
+            (void) ::send(this->fd_, terminate, sizeof terminate, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        this->connected_ = false;
+
+        if (this->sock_) {
+            this->sock_->shutdown();
+            this->sock_.reset();
+        }
+        if (this->fd_ >= 0) {
+            ::close(this->fd_);
+            this->fd_ = -1;
+        }
+        this->io_wait_.reset();
+
+        this->tx_.clear();
+        this->rx_.consume(this->rx_.readable().size());
+        this->pending_consume_ = 0;
+        this->backend_pid_ = 0;
+        this->backend_key_ = 0;
+        this->params_.clear();
+        this->notifications_.clear();
+    }
+} // namespace usub::pg
@@ -0,0 +1,40 @@
+#ifndef UPQ_TESTCOMMON_H
+#define UPQ_TESTCOMMON_H
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Minimal check harness: every test is one executable that reports each
+// failed check and exits non-zero if there was any, which is all ctest needs.
+namespace upq_test {
+    inline int failures = 0;
+
+    inline bool check(bool ok, const char *expr, const char *file, int line) {
+        if (!ok) {
+            ++failures;
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        }
+        return ok;
+    }
+
+    inline bool check_eq(std::string_view got, std::string_view want, const char *expr, const char *file,
+                         int line) {
+        if (got == want) return true;
+        ++failures;
+        std::fprintf(stderr, "%s:%d: %s\n  got:  \"%.*s\"\n  want: \"%.*s\"\n", file, line, expr,
+                     static_cast<int>(got.size()), got.data(), static_cast<int>(want.size()), want.data());
+        return false;
+    }
+
+    inline int finish(const char *name) {
+        std::printf("%s: %s\n", name, failures ? "FAILED" : "ok");
+        std::fflush(stdout);
+        return failures ? 1 : 0;
+    }
+} // namespace upq_test
+
+#define UPQ_CHECK(cond) ::upq_test::check(static_cast<bool>(cond), #cond, __FILE__, __LINE__)
+#define UPQ_CHECK_STR(got, want) ::upq_test::check_eq((got), (want), #got " == " #want, __FILE__, __LINE__)
+
+#endif // UPQ_TESTCOMMON_H
@@ -0,0 +1,215 @@
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "TestCommon.h"
+#include "upq/PgCopy.h"
+
+using namespace usub::pg;
+using namespace usub::pg::detail;  // OIDs
+
+namespace {
+    struct Item {
+        int64_t id;
+        std::string user_name;
+        std::optional<int32_t> qty;
+    };
+
+    // One pg_attribute row per column, the shape copy_target_types_sql returns.
+    QueryResult describe(std::vector<std::tuple<std::string, Oid, bool> > cols) {
+        QueryResult qr;
+        qr.ok = true;
+        qr.code = PgErrorCode::OK;
+        qr.columns = {"name", "oid", "textual"};
+        for (auto &[name, oid, textual]: cols)
+            qr.rows.push_back(QueryResult::Row{{name, std::to_string(oid), textual ? "t" : "f"}});
+        return qr;
+    }
+
+    template<class T>
+    bool append(std::string &buf, const T &row, const std::vector<detail::CopyColumnType> &cols, std::string *err) {
+        ParamBuffer<detail::count_total_params<T>()> pb;
+        detail::encode_one(pb.ps, row);
+        return detail::copy_binary_append_tuple(buf, pb.ps, pb.count(), cols.data(), err);
+    }
+
+    // Splits what append wrote back into cells.
+    std::vector<std::string_view> cells_of(const std::string &buf) {
+        std::vector<std::string_view> cells;
+        size_t used = 0;
+        if (detail::copy_binary_parse_tuple(buf, used, cells) != detail::CopyParse::Tuple || used != buf.size())
+            cells.clear();
+        return cells;
+    }
+
+    void test_quote_name() {
+        UPQ_CHECK_STR(detail::copy_quote_name("users"), "\"users\"");
+        UPQ_CHECK_STR(detail::copy_quote_name("Public.Users"), "\"public\".\"users\"");
+        UPQ_CHECK_STR(detail::copy_quote_name("\"Users\""), "\"Users\"");
+        UPQ_CHECK_STR(detail::copy_quote_name("app.\"Odd\"\"Name\""), "\"app\".\"Odd\"\"Name\"");
+        UPQ_CHECK_STR(detail::copy_quote_name("\"a.b\".c"), "\"a.b\".\"c\"");
+    }
+
+    void test_target_types() {
+        std::vector<detail::CopyColumnType> cols;
+        std::string err;
+        // table order differs from member order; names match after normalize_ident
+        const QueryResult qr = describe({{"qty", INT4OID, false}, {"ID", INT8OID, false}, {"User_Name", TEXTOID, true},
+                                         {"note", TEXTOID, true}});
+        UPQ_CHECK(detail::copy_target_types<Item>(qr, cols, &err));
+        UPQ_CHECK(cols.size() == 3);
+        if (cols.size() == 3) {
+            UPQ_CHECK(cols[0].oid == INT8OID && cols[0].name == "ID");
+            UPQ_CHECK(cols[1].oid == TEXTOID && cols[1].textual);
+            UPQ_CHECK(cols[2].oid == INT4OID);
+        }
+        UPQ_CHECK_STR(detail::copy_column_list<Item>(cols), " (\"ID\", \"User_Name\", \"qty\")");
+
+        err.clear();
+        UPQ_CHECK(!detail::copy_target_types<Item>(describe({{"id", INT8OID, false}, {"qty", INT4OID, false}}), cols,
+                                                   &err));
+        UPQ_CHECK(err.find("user_name") != std::string::npos);
+
+        // tuples take every column and must match its count
+        using Pair = std::tuple<int64_t, std::string>;
+        UPQ_CHECK(detail::copy_target_types<Pair>(describe({{"a", INT8OID, false}, {"b", TEXTOID, true}}), cols,
+                                                  &err));
+        UPQ_CHECK(detail::copy_column_list<Pair>(cols).empty());
+        UPQ_CHECK(!detail::copy_target_types<Pair>(describe({{"a", INT8OID, false}}), cols, &err));
+    }
+
+    void test_append_widening() {
+        const std::vector<detail::CopyColumnType> cols{{INT8OID, false, "a"}, {INT8OID, false, "b"},
+                                                       {INT4OID, false, "c"}};
+        std::string buf, err;
+        UPQ_CHECK(append(buf, std::tuple<int16_t, int32_t, int16_t>{-5, 70000, 300}, cols, &err));
+        const auto cells = cells_of(buf);
+        UPQ_CHECK(cells.size() == 3);
+        if (cells.size() != 3) return;
+        UPQ_CHECK(cells[0].size() == 8 && load_be<int64_t>(cells[0].data()) == -5);
+        UPQ_CHECK(cells[1].size() == 8 && load_be<int64_t>(cells[1].data()) == 70000);
+        UPQ_CHECK(cells[2].size() == 4 && load_be<int32_t>(cells[2].data()) == 300);
+    }
+
+    // The server reads binary fields by the column's type, so each of these
+    // would have been misread rather than refused.
+    void test_append_rejects_mismatches() {
+        std::string buf, err;
+        const std::vector<detail::CopyColumnType> bigint{{INT8OID, false, "id"}};
+        UPQ_CHECK(!append(buf, std::tuple<std::string>{"42"}, bigint, &err));
+        UPQ_CHECK(err.find("text-encoded") != std::string::npos);
+
+        err.clear();
+        const std::vector<detail::CopyColumnType> int4{{INT4OID, false, "n"}};
+        UPQ_CHECK(!append(buf, std::tuple<int64_t>{1}, int4, &err));  // narrowing
+        UPQ_CHECK(!err.empty());
+
+        err.clear();
+        const std::vector<detail::CopyColumnType> f8{{FLOAT8OID, false, "x"}};
+        UPQ_CHECK(!append(buf, std::tuple<int64_t>{1}, f8, &err));
+        UPQ_CHECK(!err.empty());
+
+        err.clear();
+        const std::vector<detail::CopyColumnType> uuid{{UUIDOID, false, "u"}};
+        UPQ_CHECK(!append(buf, std::tuple<std::string>{"00000000-0000-0000-0000-000000000000"}, uuid, &err));
+    }
+
+    void test_append_text_columns() {
+        const std::vector<detail::CopyColumnType> cols{{TEXTOID, true, "t"}, {JSONOID, false, "j"},
+                                                       {JSONBOID, false, "jb"}, {INT4OID, false, "n"}};
+        std::string buf, err;
+        const std::tuple<std::string, std::string, std::string, std::optional<int32_t> > row{
+            "abc", "{\"a\":1}", "{\"b\":2}", std::nullopt};
+        UPQ_CHECK(append(buf, row, cols, &err));
+        const auto cells = cells_of(buf);
+        UPQ_CHECK(cells.size() == 4);
+        if (cells.size() != 4) return;
+        UPQ_CHECK(cells[0] == "abc");
+        UPQ_CHECK(cells[1] == "{\"a\":1}");
+        UPQ_CHECK(cells[2] == std::string_view("\1{\"b\":2}"));  // jsonb version byte
+        UPQ_CHECK(cells[3].data() == nullptr);
+    }
+
+    void test_out_check() {
+        std::string err;
+        using Row = std::tuple<int32_t, double, std::string>;
+        UPQ_CHECK((detail::copy_out_check<Row, 3>({INT4OID, NUMERICOID, UUIDOID}, &err)));
+        UPQ_CHECK((detail::copy_out_check<Row, 3>({INT8OID, FLOAT4OID, INT8OID}, &err)));
+        // a date is an int4 day count on the wire; reading it as int32 is wrong
+        UPQ_CHECK(!(detail::copy_out_check<Row, 3>({DATEOID, FLOAT8OID, TEXTOID}, &err)));
+        UPQ_CHECK(err.find("column 0") != std::string::npos);
+        UPQ_CHECK(!(detail::copy_out_check<Row, 3>({INT4OID, TIMESTAMPTZOID, TEXTOID}, &err)));
+        UPQ_CHECK(!(detail::copy_out_check<Row, 3>({INT4OID, FLOAT8OID}, &err)));
+        UPQ_CHECK(!(detail::copy_out_check<std::tuple<bool>, 1>({INT4OID}, &err)));
+    }
+
+    void put_be16(std::string &s, uint16_t v) {
+        s.push_back(static_cast<char>(v >> 8));
+        s.push_back(static_cast<char>(v));
+    }
+
+    void put_be32(std::string &s, uint32_t v) {
+        put_be16(s, static_cast<uint16_t>(v >> 16));
+        put_be16(s, static_cast<uint16_t>(v));
+    }
+
+    // Cells decode by the column type Describe reported, not by guessing
+    // from the member type.
+    void test_decode_tuple() {
+        std::string tuple;
+        put_be16(tuple, 4);
+        // int8 -7
+        put_be32(tuple, 8);
+        put_be32(tuple, 0xFFFFFFFFu);
+        put_be32(tuple, 0xFFFFFFF9u);
+        // numeric 12.5: ndigits 2, weight 0, sign +, dscale 1, digits 12 5000
+        put_be32(tuple, 12);
+        for (uint16_t w: {2, 0, 0, 1, 12, 5000}) put_be16(tuple, w);
+        // int4 widened into int64
+        put_be32(tuple, 4);
+        put_be32(tuple, 123456);
+        // NULL
+        put_be32(tuple, 0xFFFFFFFFu);
+
+        using Row = std::tuple<int64_t, double, int64_t, std::optional<std::string> >;
+        const std::vector<uint32_t> oids{INT8OID, NUMERICOID, INT4OID, TEXTOID};
+        std::string err;
+        UPQ_CHECK((detail::copy_out_check<Row, 4>(oids, &err)));
+
+        std::vector<std::string_view> cells;
+        size_t used = 0;
+        UPQ_CHECK(detail::copy_binary_parse_tuple(tuple, used, cells) == detail::CopyParse::Tuple);
+        UPQ_CHECK(used == tuple.size());
+        Row row{};
+        UPQ_CHECK((detail::copy_decode_tuple<Row, 4>(cells, oids, row, &err)));
+        UPQ_CHECK(std::get<0>(row) == -7);
+        UPQ_CHECK(std::get<1>(row) == 12.5);
+        UPQ_CHECK(std::get<2>(row) == 123456);
+        UPQ_CHECK(!std::get<3>(row));
+
+        // a NULL into a non-optional member is an error, not a default value
+        std::tuple<int64_t> one{};
+        const std::vector<std::string_view> null_cell{std::string_view{}};
+        UPQ_CHECK((!detail::copy_decode_tuple<std::tuple<int64_t>, 1>(null_cell, {INT8OID}, one, &err)));
+        UPQ_CHECK(err.find("NULL") != std::string::npos);
+
+        // a partial tuple consumes nothing
+        used = 0;
+        UPQ_CHECK(detail::copy_binary_parse_tuple(std::string_view(tuple).substr(0, tuple.size() - 6), used, cells) ==
+                  detail::CopyParse::NeedMore);
+        UPQ_CHECK(used == 0);
+    }
+} // namespace
+
+int main() {
+    test_quote_name();
+    test_target_types();
+    test_append_widening();
+    test_append_rejects_mismatches();
+    test_append_text_columns();
+    test_out_check();
+    test_decode_tuple();
+    return upq_test::finish("copy");
+}
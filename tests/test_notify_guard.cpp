@@ -0,0 +1,140 @@
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FakeServer.h"
+#include "TestCommon.h"
+#include "uvent/Uvent.h"
+#include "uvent/sync/AsyncSemaphore.h"
+#include "upq/PgNotificationMultiplexer.h"
+#include "upq/PgPool.h"
+
+using namespace usub::pg;
+using namespace usub::uvent;
+
+namespace {
+    SSLConfig no_ssl() {
+        SSLConfig ssl;
+        ssl.mode = SSLMode::disable;
+        return ssl;
+    }
+
+    // Returns at once; wakes the test when `target` calls have been made.
+    struct Counter : IPgNotifyHandler {
+        std::atomic<uint64_t> calls{0};
+        uint64_t target{0};
+        usub::uvent::sync::AsyncSemaphore done{0};
+
+        task::Awaitable<void> operator()(std::string, std::string, int) override {
+            if (this->calls.fetch_add(1, std::memory_order_acq_rel) + 1 == this->target) this->done.release();
+            co_return;
+        }
+    };
+
+    // "hold" calls stay running until released; any other payload is
+    // recorded and reported.
+    struct Holder : IPgNotifyHandler {
+        usub::uvent::sync::AsyncSemaphore started{0};
+        usub::uvent::sync::AsyncSemaphore gate{0};
+        usub::uvent::sync::AsyncSemaphore returned{0};
+        usub::uvent::sync::AsyncSemaphore seen{0};
+        std::vector<std::string> payloads;
+
+        task::Awaitable<void> operator()(std::string, std::string payload, int) override {
+            if (payload == "hold") {
+                this->started.release();
+                co_await this->gate.acquire();
+                this->returned.release();
+                co_return;
+            }
+            this->payloads.push_back(std::move(payload));
+            this->seen.release();
+        }
+    };
+
+    struct Setup {
+        std::shared_ptr<PgPool> pool;
+        std::shared_ptr<PgNotificationMultiplexer> mux;
+    };
+
+    task::Awaitable<void> run_mux(Setup s) { co_await s.mux->run(); }
+
+    task::Awaitable<Setup> start_mux(upq_bench::FakeServer &srv, PgNotificationMultiplexer::Config cfg) {
+        Setup s;
+        s.pool = std::make_shared<PgPool>("127.0.0.1", srv.port(), "test", "test", "", 1, 1, no_ssl());
+        auto c = co_await s.pool->acquire_connection();
+        if (!UPQ_CHECK(c.has_value())) std::_Exit(upq_test::finish("notify_guard"));
+        s.mux = std::make_shared<PgNotificationMultiplexer>(*c, s.pool->host(), s.pool->port(), s.pool->user(),
+                                                            s.pool->db(), s.pool->password(), cfg, no_ssl());
+        co_return s;
+    }
+
+    uint64_t dropped_recursive(const PgNotificationMultiplexer &mux, const std::string &channel) {
+        for (const auto &cs: mux.stats().channels)
+            if (cs.channel == channel) return cs.dropped_recursive;
+        return UINT64_MAX;
+    }
+
+    // A burst of identical payloads is not nesting: every one reaches the
+    // handler. Counting calls from their spawn dropped most of it.
+    task::Awaitable<void> test_burst_delivered(upq_bench::FakeServer &srv, uint32_t lanes) {
+        constexpr uint64_t n = 100;
+        const std::string channel = "burst_" + std::to_string(lanes);
+        Setup s = co_await start_mux(srv, PgNotificationMultiplexer::Config{n + 1, 1024, 100000, 4, 0xFFFFFFFFu, lanes});
+        auto counter = std::make_shared<Counter>();
+        counter->target = n;
+        UPQ_CHECK(co_await s.mux->add_handler(channel, counter));
+        system::co_spawn(run_mux(s));
+
+        UPQ_CHECK(srv.notify(channel, "refresh", n) == 1);
+        co_await counter->done.acquire();
+        UPQ_CHECK(counter->calls.load() == n);
+        UPQ_CHECK(dropped_recursive(*s.mux, channel) == 0);
+    }
+
+    // Handlers still running do count: with max_recursive_depth of them
+    // parked, the next event is dropped, and one returning makes room again.
+    task::Awaitable<void> test_running_handlers_capped(upq_bench::FakeServer &srv) {
+        constexpr uint32_t depth = 4;
+        const std::string channel = "nested";
+        Setup s = co_await start_mux(srv, PgNotificationMultiplexer::Config{64, 1024, 100000, depth, 0xFFFFFFFFu, 0});
+        auto holder = std::make_shared<Holder>();
+        UPQ_CHECK(co_await s.mux->add_handler(channel, holder));
+        system::co_spawn(run_mux(s));
+
+        for (uint32_t i = 0; i < depth; ++i) {
+            srv.notify(channel, "hold", 1);
+            co_await holder->started.acquire();
+        }
+        // dropped; the channel worker handles events in order, so it is
+        // decided before "after" below is
+        srv.notify(channel, "over", 1);
+        holder->gate.release();
+        co_await holder->returned.acquire();
+        srv.notify(channel, "after", 1);
+        co_await holder->seen.acquire();
+
+        UPQ_CHECK(holder->payloads == std::vector<std::string>{"after"});
+        UPQ_CHECK(dropped_recursive(*s.mux, channel) == 1);
+        for (uint32_t i = 1; i < depth; ++i) holder->gate.release();
+    }
+
+    task::Awaitable<void> drive(upq_bench::FakeServer &srv) {
+        co_await test_burst_delivered(srv, 0);
+        co_await test_burst_delivered(srv, 2);
+        co_await test_running_handlers_capped(srv);
+        // the pools, the multiplexers and the uvent workers have no shutdown path
+        std::_Exit(upq_test::finish("notify_guard"));
+    }
+} // namespace
+
+int main() {
+    upq_bench::FakeServer srv;
+    if (!UPQ_CHECK(srv.ok())) return upq_test::finish("notify_guard");
+    usub::Uvent uvent(1);
+    system::co_spawn(drive(srv));
+    uvent.run();
+    return upq_test::finish("notify_guard");
+}
@@ -0,0 +1,192 @@
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "TestCommon.h"
+#include "upq/PgByteSwap.h"
+#include "upq/PgConnection.h"
+#include "upq/PgReflect.h"
+#include "upq/PgTextScan.h"
+
+using namespace usub::pg;
+
+namespace {
+    size_t scan_reference(const char *p, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            if (p[i] == ',' || p[i] == '"' || p[i] == '\\' || p[i] == '{' || p[i] == '}') return i;
+        return n;
+    }
+
+    // Every special at every position of every length up to two vectors and
+    // a tail, so each kernel's block and tail paths are both covered.
+    void test_scan_array_special() {
+        for (size_t n = 0; n <= 80; ++n) {
+            std::string s(n, 'a');
+            UPQ_CHECK(detail::scan_array_special(s.data(), n) == n);
+            for (char special: {',', '"', '\\', '{', '}'}) {
+                for (size_t at = 0; at < n; ++at) {
+                    s.assign(n, 'x');
+                    s[at] = special;
+                    if (at + 1 < n) s[n - 1] = ',';  // a later hit must not win
+                    UPQ_CHECK(detail::scan_array_special(s.data(), n) == scan_reference(s.data(), n));
+                }
+            }
+        }
+        // bytes >= 0x80 and NUL are not specials
+        const std::string hi = std::string(40, '\xE9') + std::string(1, '\0') + "}";
+        UPQ_CHECK(detail::scan_array_special(hi.data(), hi.size()) == hi.size() - 1);
+    }
+
+    template<class Int>
+    void expect_like_from_chars(std::string_view sv) {
+        Int want{}, got{};
+        const auto r = std::from_chars(sv.data(), sv.data() + sv.size(), want);
+        const bool want_ok = r.ec == std::errc{} && r.ptr == sv.data() + sv.size();
+        const bool got_ok = detail::parse_decimal_int(sv, got);
+        if (!UPQ_CHECK(got_ok == want_ok) || !want_ok) {
+            if (got_ok != want_ok) std::fprintf(stderr, "  input: \"%.*s\"\n", static_cast<int>(sv.size()), sv.data());
+            return;
+        }
+        UPQ_CHECK(got == want);
+    }
+
+    void test_parse_decimal_int() {
+        const char *inputs[] = {
+            "", "-", "0", "-0", "7", "12345678", "123456789", "-12345678", "1234567a", "12345678a",
+            "+1", " 1", "1 ", "00000000000000000001", "9223372036854775807", "-9223372036854775808",
+            "9223372036854775808", "-9223372036854775809", "18446744073709551615", "18446744073709551616",
+            "99999999999999999999", "2147483647", "2147483648", "-2147483648", "-2147483649", "32767",
+            "32768", "-32768", "65535", "65536", "4294967295", "4294967296", "1:", "/1",
+        };
+        for (const char *in: inputs) {
+            expect_like_from_chars<int16_t>(in);
+            expect_like_from_chars<uint16_t>(in);
+            expect_like_from_chars<int32_t>(in);
+            expect_like_from_chars<uint32_t>(in);
+            expect_like_from_chars<int64_t>(in);
+            expect_like_from_chars<uint64_t>(in);
+        }
+        // every digit count, both signs
+        std::string digits;
+        for (int len = 1; len <= 20; ++len) {
+            digits.push_back(static_cast<char>('0' + (len * 7) % 10));
+            expect_like_from_chars<int64_t>(digits);
+            expect_like_from_chars<int64_t>("-" + digits);
+            expect_like_from_chars<uint64_t>(digits);
+        }
+    }
+
+    template<class T>
+    void roundtrip_be_records(size_t width) {
+        for (size_t n = 0; n <= 70; ++n) {
+            std::vector<T> src(n);
+            for (size_t i = 0; i < n; ++i)
+                src[i] = static_cast<T>(static_cast<uint64_t>(i) * 0x0102030405060708ull + 0x8090A0B0C0D0E0F0ull);
+
+            std::vector<char> rec(n * (4 + width) + 16);
+            char *end = detail::store_be_records(rec.data(), reinterpret_cast<const char *>(src.data()), n, width);
+            UPQ_CHECK(static_cast<size_t>(end - rec.data()) == n * (4 + width));
+
+            // record i: length word == width, then the value big-endian
+            bool layout_ok = true;
+            for (size_t i = 0; i < n; ++i) {
+                const unsigned char *r = reinterpret_cast<const unsigned char *>(rec.data()) + i * (4 + width);
+                const uint32_t len = (uint32_t{r[0]} << 24) | (uint32_t{r[1]} << 16) | (uint32_t{r[2]} << 8) | r[3];
+                uint64_t v = 0;
+                for (size_t b = 0; b < width; ++b) v = (v << 8) | r[4 + b];
+                layout_ok = layout_ok && len == width && static_cast<T>(v) == src[i];
+            }
+            UPQ_CHECK(layout_ok);
+
+            std::vector<T> back(n);
+            UPQ_CHECK(detail::load_be_records(reinterpret_cast<char *>(back.data()), rec.data(), n, width));
+            UPQ_CHECK(back == src);
+
+            // a wrong length word anywhere is rejected
+            for (size_t bad = 0; bad < n; bad += 7) {
+                std::vector<char> broken(rec);
+                broken[bad * (4 + width) + 3] ^= 1;
+                UPQ_CHECK(!detail::load_be_records(reinterpret_cast<char *>(back.data()), broken.data(), n, width));
+            }
+        }
+    }
+
+    template<class T>
+    void roundtrip_binary_array(const std::vector<T> &v) {
+        ParamBuffer<1> pb;
+        detail::encode_one(pb.ps, v);
+        UPQ_CHECK(pb.formats[0] == 1);
+        const std::string_view sv(pb.values[0], static_cast<size_t>(pb.lengths[0]));
+        std::vector<T> out;
+        UPQ_CHECK(detail::decode_field(sv, out, true, pb.types[0]));
+        UPQ_CHECK(out == v);
+    }
+
+    void test_binary_arrays() {
+        for (size_t n: {0u, 1u, 15u, 16u, 17u, 100u}) {
+            std::vector<int16_t> a16(n);
+            std::vector<int32_t> a32(n);
+            std::vector<int64_t> a64(n);
+            std::vector<double> ad(n);
+            for (size_t i = 0; i < n; ++i) {
+                a16[i] = static_cast<int16_t>(i * 997 - 30000);
+                a32[i] = static_cast<int32_t>(i * 2654435761u);
+                a64[i] = -static_cast<int64_t>(i) * 0x123456789ll;
+                ad[i] = static_cast<double>(i) * -0.375;
+            }
+            roundtrip_binary_array(a16);
+            roundtrip_binary_array(a32);
+            roundtrip_binary_array(a64);
+            roundtrip_binary_array(ad);
+        }
+    }
+
+    template<class T>
+    bool text_decode(std::string_view sv, T &out) {
+        return detail::decode_field(sv, out, false, 0);
+    }
+
+    void test_text_arrays() {
+        std::vector<int32_t> ints;
+        UPQ_CHECK(text_decode("{1,-2,3,2147483647}", ints));
+        UPQ_CHECK(ints == (std::vector<int32_t>{1, -2, 3, 2147483647}));
+        UPQ_CHECK(!text_decode("{1,2147483648}", ints));
+
+        std::vector<int32_t> empty{1};
+        UPQ_CHECK(text_decode("{}", empty) && empty.empty());
+
+        std::vector<std::string> strs;
+        UPQ_CHECK(text_decode(R"({plain,"with,comma","q\"uote","back\\slash"})", strs));
+        UPQ_CHECK(strs == (std::vector<std::string>{"plain", "with,comma", "q\"uote", "back\\slash"}));
+
+        std::vector<double> dbl;
+        UPQ_CHECK(text_decode("{0.5,-1.25,1e3}", dbl));
+        UPQ_CHECK(dbl == (std::vector<double>{0.5, -1.25, 1000.0}));
+
+        std::vector<std::optional<int64_t> > opt;
+        UPQ_CHECK(text_decode("{7,NULL,-8}", opt));
+        UPQ_CHECK(opt.size() == 3 && opt[0] == 7 && !opt[1] && opt[2] == -8);
+
+        auto big = QueryResult::parse_cell<int64_t>("-9223372036854775808");
+        UPQ_CHECK(big && *big == std::numeric_limits<int64_t>::min());
+        UPQ_CHECK(!QueryResult::parse_cell<int64_t>("9223372036854775808"));
+        auto f = QueryResult::parse_cell<double>("-0.125");
+        UPQ_CHECK(f && *f == -0.125);
+    }
+} // namespace
+
+int main() {
+    std::printf("text scan kernel: %s, byteswap kernel: %s\n", detail::text_scan_kernel(), detail::byteswap_kernel());
+    test_scan_array_special();
+    test_parse_decimal_int();
+    roundtrip_be_records<int16_t>(2);
+    roundtrip_be_records<int32_t>(4);
+    roundtrip_be_records<int64_t>(8);
+    test_binary_arrays();
+    test_text_arrays();
+    return upq_test::finish("parse_kernels");
+}
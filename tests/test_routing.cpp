@@ -0,0 +1,112 @@
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "FakeServer.h"
+#include "TestCommon.h"
+#include "uvent/Uvent.h"
+#include "upq/PgRouting.h"
+
+using namespace usub::pg;
+using namespace usub::uvent;
+
+namespace {
+    PgEndpoint endpoint(std::string name, std::string port, NodeRole role) {
+        PgEndpoint ep;
+        ep.name = std::move(name);
+        ep.host = "127.0.0.1";
+        ep.port = std::move(port);
+        ep.user = "test";
+        ep.db = "test";
+        ep.max_pool = 2;
+        ep.role = role;
+        return ep;
+    }
+
+    Config config(std::vector<PgEndpoint> nodes) {
+        Config cfg;
+        cfg.nodes = std::move(nodes);
+        cfg.ssl_config.mode = SSLMode::disable;
+        cfg.connect_retries = 1;
+        return cfg;
+    }
+
+    RouteHint read_after(uint64_t lsn) {
+        RouteHint h;
+        h.min_lsn = PgLsn{lsn};
+        return h;
+    }
+
+    bool routes_to(PgPool *pool, const std::string &port) { return pool && pool->port() == port; }
+
+    // No health tick has run, so every node is unhealthy. Pools open lazily:
+    // none of this connects.
+    void test_min_lsn_without_probes() {
+        PgConnector replica_only(config({endpoint("r1", "5001", NodeRole::AsyncReplica)}));
+        // nothing says r1 has replayed the write; before the fix this fell
+        // through to pick_any and read possibly stale data
+        UPQ_CHECK(replica_only.route(read_after(0x1000)) == nullptr);
+        UPQ_CHECK(routes_to(replica_only.route(RouteHint{}), "5001"));
+
+        PgConnector with_primary(config({endpoint("r1", "5001", NodeRole::AsyncReplica),
+                                          endpoint("p", "5000", NodeRole::Primary)}));
+        UPQ_CHECK(routes_to(with_primary.route(read_after(0x1000)), "5000"));
+        UPQ_CHECK(routes_to(with_primary.route(RouteHint{}), "5000"));  // no healthy replica
+        RouteHint write;
+        write.kind = QueryKind::Write;
+        UPQ_CHECK(routes_to(with_primary.route(write), "5000"));
+        RouteHint rmw;
+        rmw.read_my_writes = true;
+        UPQ_CHECK(routes_to(with_primary.route(rmw), "5000"));
+    }
+
+    void answer_probe(upq_bench::FakeServer &srv, const char *lsn) {
+        srv.answer("pg_last_wal_replay_lsn", {"lag_ms", "lsn_lag", "replay_lsn"}, {{"0", "0", lsn}});
+    }
+
+    // Probed positions decide which replicas may serve a read-your-writes
+    // token, for every selection policy.
+    task::Awaitable<void> test_min_lsn_after_probe(ReplicaSelection mode, upq_bench::FakeServer &primary,
+                                                   upq_bench::FakeServer &ahead, upq_bench::FakeServer &behind) {
+        Config cfg = config({endpoint("p", primary.port(), NodeRole::Primary),
+                             endpoint("ahead", ahead.port(), NodeRole::AsyncReplica),
+                             endpoint("behind", behind.port(), NodeRole::AsyncReplica)});
+        cfg.routing.replica_selection = mode;
+        cfg.health.probe_timeout_ms = 2000;
+        // kept: the probe connections and pools have no shutdown path
+        auto &conn = *new PgConnector(std::move(cfg));
+        co_await conn.health_tick();
+
+        UPQ_CHECK(conn.pin("ahead", RouteHint{}) != nullptr);
+        UPQ_CHECK(conn.pin("behind", RouteHint{}) != nullptr);
+        for (int i = 0; i < 32; ++i) {
+            UPQ_CHECK(routes_to(conn.route(read_after(0x0A00)), ahead.port()));
+            UPQ_CHECK(routes_to(conn.route(read_after(0x1000)), ahead.port()));
+            UPQ_CHECK(routes_to(conn.route(read_after(0x1001)), primary.port()));
+            PgPool *any = conn.route(RouteHint{});
+            UPQ_CHECK(routes_to(any, ahead.port()) || routes_to(any, behind.port()));
+        }
+    }
+
+    task::Awaitable<void> drive() {
+        upq_bench::FakeServer primary, ahead, behind;
+        if (!UPQ_CHECK(primary.ok() && ahead.ok() && behind.ok())) std::_Exit(upq_test::finish("routing"));
+        answer_probe(primary, "0/2000");
+        answer_probe(ahead, "0/1000");
+        answer_probe(behind, "0/800");
+
+        co_await test_min_lsn_after_probe(ReplicaSelection::LowestRtt, primary, ahead, behind);
+        co_await test_min_lsn_after_probe(ReplicaSelection::PowerOfTwoChoices, primary, ahead, behind);
+        co_await test_min_lsn_after_probe(ReplicaSelection::LeastOutstanding, primary, ahead, behind);
+        std::_Exit(upq_test::finish("routing"));
+    }
+} // namespace
+
+int main() {
+    test_min_lsn_without_probes();
+
+    usub::Uvent uvent(1);
+    system::co_spawn(drive());
+    uvent.run();
+    return upq_test::finish("routing");
+}
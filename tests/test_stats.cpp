@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "TestCommon.h"
+#include "upq/PgStats.h"
+
+using namespace usub::pg;
+
+namespace {
+    // Every bucket starts where the previous one ends and maps back to itself.
+    void test_bucket_bounds() {
+        for (size_t idx = 0; idx + 1 < detail::latency_buckets; ++idx) {
+            const uint64_t lo = detail::latency_bucket_lower(idx);
+            const uint64_t next = detail::latency_bucket_lower(idx + 1);
+            UPQ_CHECK(next > lo);
+            UPQ_CHECK(detail::latency_bucket(lo) == idx);
+            UPQ_CHECK(detail::latency_bucket(next - 1) == idx);
+        }
+        // exact below 16us, <= 12.5% wide above
+        for (uint64_t us = 0; us < 16; ++us) UPQ_CHECK(detail::latency_bucket_lower(detail::latency_bucket(us)) == us);
+        for (uint64_t us = 16; us < (uint64_t{1} << 32); us = us * 3 + 1) {
+            const size_t idx = detail::latency_bucket(us);
+            const uint64_t lo = detail::latency_bucket_lower(idx);
+            UPQ_CHECK(lo <= us && us - lo <= lo / 8);
+        }
+        UPQ_CHECK(detail::latency_bucket(UINT64_MAX) == detail::latency_buckets - 1);
+    }
+
+    void test_percentile() {
+        PgLatencyHistogram h;
+        for (uint64_t us = 1; us <= 100; ++us) h.record(us);
+        PgLatencySnapshot s;
+        s.merge(h);
+        UPQ_CHECK(s.count == 100);
+        UPQ_CHECK(s.sum_us == 5050);
+        UPQ_CHECK(s.percentile_us(0.0) == 1);
+        const uint64_t p50 = s.percentile_us(0.5);
+        UPQ_CHECK(p50 <= 50 && 50 - p50 <= p50 / 8);
+        UPQ_CHECK(s.percentile_us(1.0) == detail::latency_bucket_lower(detail::latency_bucket(100)));
+    }
+
+    uint64_t bucket_value(const std::string &dump, const std::string &series) {
+        const size_t at = dump.find(series + " ");
+        if (at == std::string::npos) return UINT64_MAX;
+        return std::stoull(dump.substr(at + series.size() + 1));
+    }
+
+    // A sample equal to a bucket's le bound belongs to it (Prometheus buckets
+    // are "less than or equal"); before the fix those were left out.
+    void test_prometheus_le_inclusive() {
+        auto &reg = PgStatsRegistry::instance();
+        const uint32_t scope = reg.register_scope("stats_test");
+        QueryResult ok;
+        ok.ok = true;
+        ok.code = PgErrorCode::OK;
+        for (uint64_t us: {1u, 2u, 3u, 1024u, 1025u, 1151u, 1152u}) {
+            reg.record_query(scope, detail::stats_fingerprint("SELECT 1"), "SELECT 1", std::chrono::microseconds(us), ok,
+                             0, 0);
+        }
+        const std::string dump = reg.metrics_dump();
+        const std::string prefix = "upq_query_duration_seconds_bucket{pool=\"stats_test\",le=\"";
+        UPQ_CHECK(bucket_value(dump, prefix + "0.000001\"}") == 1);
+        UPQ_CHECK(bucket_value(dump, prefix + "0.000002\"}") == 2);
+        UPQ_CHECK(bucket_value(dump, prefix + "0.000512\"}") == 3);
+        // [1024, 1151] is one bucket starting at le, so all of it counts
+        UPQ_CHECK(bucket_value(dump, prefix + "0.001024\"}") == 6);
+        UPQ_CHECK(bucket_value(dump, prefix + "0.002048\"}") == 7);
+        UPQ_CHECK(bucket_value(dump, prefix + "+Inf\"}") == 7);
+        UPQ_CHECK(bucket_value(dump, "upq_query_duration_seconds_count{pool=\"stats_test\"}") == 7);
+    }
+} // namespace
+
+int main() {
+    test_bucket_bounds();
+    test_percentile();
+    test_prometheus_le_inclusive();
+    return upq_test::finish("stats");
+}